@@ -2,58 +2,236 @@
 #define ADD_COMMAND_HANDLER_H
 
 #include "CommandHandler.h"
-#include <regex>
 #include <nlohmann/json.hpp>
+#include <algorithm>
+#include <vector>
 #include "RoktResponseService.h"
 #include "RoktDataset.h"
 #include "RoktService.h"
-#include "Utils.h" // pour trim()
+#include "RoktCommand.h"
+#include "RequestInput.h"
 #include "LogService.h"
 
+#define BULK_DEFAULT_BATCH_ROWS 10000   // lignes écrites en une fois par BULK ADD
+#define BULK_MAX_REPORTED_ERRORS 1000   // erreurs détaillées au plus dans la réponse d'un ajout multiple
+
 /**
- * @brief Gère la commande "ADD { ... } [UNIQUE field] IN dataset;".
+ * @brief Gère les commandes "ADD { ... } [UNIQUE field] IN dataset;", "ADD [ {...}, ... ]
+ * [UNIQUE field] IN dataset;" et "BULK ADD [UNIQUE field] IN dataset [BATCH n]".
+ *
+ * Vérifie si un champ UNIQUE est spécifié (un chemin, "a.b"), et si oui, assure qu'il n'existe
+ * pas déjà : la recherche et l'écriture se font sous le même verrou (RoktDataset::insertRows).
+ * Avec "UNIQUE field ON CONFLICT UPDATE", une ligne dont la valeur existe déjà est fusionnée dans
+ * la ligne existante (ses champs de premier niveau remplacent ceux de la ligne) au lieu d'être
+ * refusée : la recherche et l'écriture se font sous le même verrou (RoktDataset::upsertRows).
  *
- * Vérifie si un champ UNIQUE est spécifié, et si oui, assure qu'il n'existe pas déjà.
+ * Un tableau est ajouté en une seule écriture. BULK ADD lit un objet JSON par ligne jusqu'à une
+ * ligne END (ou la fermeture de la connexion) et écrit les lignes par lots de BATCH lignes, à
+ * mesure de leur réception. Dans les deux cas, une ligne invalide (JSON invalide, pas un objet,
+ * champ unique absent ou déjà présent) est écartée sans arrêter l'ajout, et la réponse unique
+ * donne le nombre de lignes ajoutées et l'erreur de chaque ligne écartée :
+ * {"inserted", "rejected", "batches", "errors": [{"row", "status", "reason"}, ...]}.
  */
 class AddCommandHandler : public CommandHandler {
+private:
+    // Progression d'un ajout multiple (locale à la requête : le handler est partagé par les workers)
+    struct Batch {
+        std::shared_ptr<RoktDataset> dataset;
+        std::string uniqueField;
+        bool onConflictUpdate = false;
+        std::vector<nlohmann::json> pending;
+        std::vector<size_t> pendingRows;  // numéro de chaque ligne en attente dans la requête
+        size_t row = 0;
+        size_t inserted = 0;
+        size_t updated = 0;
+        size_t rejected = 0;
+        size_t batches = 0;
+        nlohmann::json errors = nlohmann::json::array();
+    };
+
+    static void addError(Batch &batch, size_t row, int status, const std::string &reason) {
+        if (batch.errors.size() < BULK_MAX_REPORTED_ERRORS)
+            batch.errors.push_back({{"row", row}, {"status", status}, {"reason", reason}});
+        batch.rejected++;
+    }
+
+    static void reject(Batch &batch, int status, const std::string &reason) {
+        addError(batch, batch.row, status, reason);
+        batch.row++;
+    }
+
+    // Valide une ligne et la met en attente d'écriture
+    static void accept(Batch &batch, nlohmann::json &&row) {
+        if (!row.is_object())
+            return reject(batch, 11, "Ligne qui n'est pas un objet JSON");
+        // Les doublons sont écartés (ou fusionnés) à l'écriture
+        if (!batch.uniqueField.empty() && findNestedValue(row, batch.uniqueField) == nullptr)
+            return reject(batch, 12, "Champ unique '" + batch.uniqueField + "' absent");
+        batch.pending.push_back(std::move(row));
+        batch.pendingRows.push_back(batch.row);
+        batch.row++;
+    }
+
+    // Écrit les lignes en attente ; renvoie l'erreur du dataset en cas d'échec
+    static std::unique_ptr<ROKT::ResponseObject> flush(Batch &batch) {
+        if (batch.pending.empty())
+            return nullptr;
+        size_t inserted = batch.pending.size();
+        size_t updated = 0;
+        std::vector<size_t> duplicates;
+        std::unique_ptr<ROKT::ResponseObject> status = batch.onConflictUpdate
+            ? batch.dataset->upsertRows(batch.pending, batch.uniqueField, &inserted, &updated)
+            : batch.dataset->insertRows(batch.pending, batch.uniqueField, &duplicates);
+        if (status->getStatusCode() != 2)
+            return status;
+        for (size_t duplicate : duplicates)
+            addError(batch, batch.pendingRows[duplicate], 10, "Already Exists");
+        batch.inserted += inserted - duplicates.size();
+        batch.updated += updated;
+        batch.batches++;
+        batch.pending.clear();
+        batch.pendingRows.clear();
+        return nullptr;
+    }
+
+    // Prépare un ajout multiple
+    std::unique_ptr<ROKT::ResponseObject> open(Batch &batch, const std::string &dataset, const std::string &uniqueField,
+                                               bool onConflictUpdate) {
+        batch.uniqueField = uniqueField;
+        batch.onConflictUpdate = onConflictUpdate;
+        std::unique_ptr<ROKT::ResponseObject> status = this->service->from(dataset, batch.dataset, true);
+        if (status->hasError())
+            return status;
+        return nullptr;
+    }
+
+    static std::unique_ptr<ROKT::ResponseObject> summary(const Batch &batch, nlohmann::json result = nlohmann::json::object()) {
+        result["inserted"] = batch.inserted;
+        if (batch.onConflictUpdate)
+            result["updated"] = batch.updated;
+        result["rejected"] = batch.rejected;
+        result["batches"] = batch.batches;
+        // Les doublons sont connus à l'écriture de leur lot : erreurs remises dans l'ordre des lignes
+        nlohmann::json errors = batch.errors;
+        std::stable_sort(errors.begin(), errors.end(),
+                         [](const nlohmann::json &a, const nlohmann::json &b) { return a["row"].get<size_t>() < b["row"].get<size_t>(); });
+        result["errors"] = std::move(errors);
+        // Aucune ligne ajoutée sur un ensemble non vide : échec global
+        if (batch.inserted == 0 && batch.updated == 0 && batch.rejected > 0)
+            return ROKT::ResponseService::response(1, "Aucune ligne ajoutée", result.dump());
+        return ROKT::ResponseService::response(2, "Inserted", result.dump());
+    }
+
+    std::unique_ptr<ROKT::ResponseObject> addRows(const RoktAddQuery &query, nlohmann::json &rows) {
+        Batch batch;
+        if (auto status = open(batch, query.dataset, query.uniqueField, query.onConflictUpdate))
+            return status;
+        for (auto &row : rows)
+            accept(batch, std::move(row));
+        if (auto status = flush(batch))
+            return status;
+        return summary(batch);
+    }
+
+    std::unique_ptr<ROKT::ResponseObject> bulkAdd(const RoktBulkAddQuery &query) {
+        Batch batch;
+        if (auto status = open(batch, query.dataset, query.uniqueField, query.onConflictUpdate))
+            return status;
+        size_t batchRows = query.batchRows > 0 ? query.batchRows : BULK_DEFAULT_BATCH_ROWS;
+        // Sans connexion attachée (ex. PROFILE), seules les lignes reçues avec l'en-tête sont lues
+        RequestInput detached(-1);
+        RequestInput *input = RequestInput::current() != nullptr ? RequestInput::current() : &detached;
+        input->begin(query.body);
+        bool terminated = false;
+        std::string line;
+        while (input->readLine(&line, "END")) {
+            size_t first = line.find_first_not_of(" \t");
+            if (first == std::string::npos)
+                continue;
+            if (RequestInput::isTerminator(line, "END")) {
+                terminated = true;
+                break;
+            }
+            nlohmann::json row = nlohmann::json::parse(line.begin() + first, line.end(), nullptr, false);
+            if (row.is_discarded())
+                reject(batch, 11, "JSON invalide");
+            else
+                accept(batch, std::move(row));
+            if (batch.pending.size() >= batchRows) {
+                if (auto status = flush(batch))
+                    return status;
+            }
+        }
+        // Les lignes reçues avant une interruption sont conservées, comme les lots déjà écrits
+        if (auto status = flush(batch))
+            return status;
+        nlohmann::json result;
+        result["terminated"] = terminated;
+        if (input->hasFailed())
+            LogService::log("BULK ADD interrompu : lecture de la requête impossible.");
+        return summary(batch, result);
+    }
+
+    // ADD { ... } UNIQUE field ON CONFLICT UPDATE : ajout ou fusion en une seule opération
+    std::unique_ptr<ROKT::ResponseObject> upsert(const RoktAddQuery &query, const nlohmann::json &row) {
+        if (!row.is_object() || findNestedValue(row, query.uniqueField) == nullptr) {
+            return ROKT::ResponseService::response(12, "Champ unique '" + query.uniqueField + "' absent");
+        }
+        std::shared_ptr<RoktDataset> datasetObj;
+        std::unique_ptr<ROKT::ResponseObject> status = this->service->from(query.dataset, datasetObj, true);
+        if (status->hasError()) {
+            return status;
+        }
+        size_t inserted = 0;
+        size_t updated = 0;
+        status = datasetObj->upsertRows({row}, query.uniqueField, &inserted, &updated);
+        if (status->getStatusCode() != 2) {
+            return status;
+        }
+        return inserted > 0 ? ROKT::ResponseService::response(2, "Inserted") : ROKT::ResponseService::response(0, "Updated");
+    }
+
 public:
     AddCommandHandler(RoktService *service) : CommandHandler(service) {}
-    virtual std::unique_ptr<ROKT::ResponseObject> handle(const std::string &command) override {
-        std::regex pattern("^ADD\\s*(\\{.*\\})\\s*(?:UNIQUE\\s+(\\S+))?\\s*IN\\s+(\\S+);$", std::regex::icase);
-        std::smatch matches;
-        if (!std::regex_match(command, matches, pattern)) {
+    virtual std::unique_ptr<ROKT::ResponseObject> handle(const RoktCommand &command) override {
+        if (command.getKind() == RoktCommand::Kind::BULK_ADD) {
+            return bulkAdd(command.as<RoktBulkAddQuery>());
+        }
+        if (command.getKind() != RoktCommand::Kind::ADD) {
             return CommandHandler::handle(command);
         }
-        std::string jsonBlock = matches[1].str();
-        std::string uniqueField = (matches.size() > 2 && matches[2].matched) ? matches[2].str() : "";
-        std::string dataset = matches[3].str();
+        const RoktAddQuery &query = command.as<RoktAddQuery>();
+        const std::string &uniqueField = query.uniqueField;
+        const std::string &dataset = query.dataset;
         nlohmann::json newData;
         try {
-            newData = nlohmann::json::parse(jsonBlock);
+            newData = nlohmann::json::parse(query.json.begin(), query.json.end());
         } catch (...) {
             return ROKT::ResponseService::response(11, "JSON invalide");
         }
-        if (!uniqueField.empty()) {
-            if (!newData.contains(uniqueField)) {
-                return ROKT::ResponseService::response(12, "Champ unique '" + uniqueField + "' absent");
-            }
-            auto newUniqueValue = newData[uniqueField];
-            std::shared_ptr<RoktDataset> datasetObj;
-            if(this->service->from(dataset, datasetObj)->hasError()) {
-                    return ROKT::ResponseService::response(1, "Can't get dataset");
-            }
-            nlohmann::json existingData = datasetObj->readData(); // readData() retourne un nlohmann::json (tableau)
-            for (const auto &row : existingData) {
-                if (row.contains(uniqueField) && row[uniqueField] == newUniqueValue) {
-                    return ROKT::ResponseService::response(10, "Already Exists");
-                }
-            }
+        if (newData.is_array()) {
+            return addRows(query, newData);
+        }
+        if (query.onConflictUpdate) {
+            return upsert(query, newData);
+        }
+        if (!uniqueField.empty() && findNestedValue(newData, uniqueField) == nullptr) {
+            return ROKT::ResponseService::response(12, "Champ unique '" + uniqueField + "' absent");
         }
         std::shared_ptr<RoktDataset> datasetObj;
-        if(this->service->from(dataset, datasetObj)->hasError()) {
-                return ROKT::ResponseService::response(1, "Can't get dataset");
+        std::unique_ptr<ROKT::ResponseObject> status = this->service->from(dataset, datasetObj, true);
+        if (status->hasError()) {
+                return status;
+        }
+        if (uniqueField.empty()) {
+            return datasetObj->insert(newData);
+        }
+        std::vector<size_t> duplicates;
+        status = datasetObj->insertRows({newData}, uniqueField, &duplicates);
+        if (status->getStatusCode() == 2 && !duplicates.empty()) {
+            return ROKT::ResponseService::response(10, "Already Exists");
         }
-        return datasetObj->insert(newData);
+        return status;
     }
 };
 
@@ -2,180 +2,120 @@
 #define CHANGE_COMMAND_HANDLER_H
 
 #include "CommandHandler.h"
-#include <sstream>
 #include <nlohmann/json.hpp>
 #include "RoktResponseService.h"
 #include "RoktDataset.h"
 #include "RoktService.h"
 #include "ConditionUtils.h"
+#include "RoktCommand.h"
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
 
+/**
+ * @brief Gère "CHANGE <champ> = <valeur> [WHERE ...] IN <dataset>;" et les incréments
+ * "CHANGE <champ> += <nombre> ..." / "-= <nombre>".
+ *
+ * Un incrément est appliqué en place aux lignes résidentes et ajouté au journal du dataset
+ * (RoktDataset::increment) au lieu de réécrire le fichier : deux entiers donnent un entier, un
+ * champ absent prend la valeur ajoutée et une valeur non numérique est laissée telle quelle.
+ */
 class ChangeCommandHandler : public CommandHandler
 {
 private:
-    std::string lastError;
-
-    struct ChangeParams
+    struct ChangePlan : PreparedPlan
     {
-        std::string field;
-        std::string newValue;
-        std::vector<Condition> conditions;
-        std::string dataset;
+        RoktChangeQuery query;
     };
 
-    bool parseCommand(const std::string &command, ChangeParams *params)
+public:
+    ChangeCommandHandler(RoktService *service) : CommandHandler(service) {}
+    virtual std::shared_ptr<PreparedPlan> prepare(const RoktCommand &command, std::string *error) override
     {
-        std::istringstream iss(command);
-        std::string token, keyword;
-        iss >> keyword;
-        if (keyword != "CHANGE")
-        {
+        auto plan = std::make_shared<ChangePlan>();
+        plan->query = command.as<RoktChangeQuery>();
+        plan->parameterCount = (plan->query.newValue == PREPARED_PARAMETER ? 1 : 0) + countParameters(plan->query.conditions);
+        return plan;
+    }
 
-            this->lastError = "Commande CHANGE invalide";
-            return false;
-        }
-        if (!(iss >> params->field))
-        {
-            this->lastError = "Champ manquant";
-            return false;
-        }
-        params->field = trim(params->field);
-        if (!(iss >> token) || trim(token) != "=")
+    virtual std::unique_ptr<ROKT::ResponseObject> execute(const PreparedPlan &plan, const std::vector<std::string> &parameters) override
+    {
+        RoktChangeQuery params = static_cast<const ChangePlan &>(plan).query;
+        size_t next = 0;
+        bindParameter(params.newValue, parameters, &next);
+        bindParameters(params.conditions, parameters, &next);
+        return run(params);
+    }
+
+    virtual std::unique_ptr<ROKT::ResponseObject>handle(const RoktCommand &command) override
+    {
+        if (command.getKind() != RoktCommand::Kind::CHANGE)
         {
-            this->lastError = "Symbole '=' manquant";
-            return false;
+            return CommandHandler::handle(command);
         }
-        if (!(iss >> params->newValue))
-        {
-            this->lastError = "Nouvelle valeur manquante";
-            return false;
+        return run(command.as<RoktChangeQuery>());
+    }
+
+private:
+    // Valeur d'un incrément : entier si possible, sinon nombre décimal ; false si ce n'est pas un nombre
+    static bool parseIncrement(const RoktChangeQuery &params, nlohmann::json *by)
+    {
+        const char *text = params.newValue.c_str();
+        char *end = nullptr;
+        errno = 0;
+        long long integer = std::strtoll(text, &end, 10);
+        if (!params.newValue.empty() && *end == '\0' && errno == 0 && integer != LLONG_MIN) {
+            *by = params.op == "-=" ? -integer : integer;
+            return true;
         }
-        params->newValue = trim(params->newValue);
-        if (!(iss >> token))
-        {
-            this->lastError = "Syntaxe invalide";
+        double number = std::strtod(text, &end);
+        if (params.newValue.empty() || *end != '\0' || !std::isfinite(number))
             return false;
+        *by = params.op == "-=" ? -number : number;
+        return true;
+    }
+
+    std::unique_ptr<ROKT::ResponseObject> increment(const RoktChangeQuery &params)
+    {
+        nlohmann::json by;
+        if (!parseIncrement(params, &by)) {
+            return ROKT::ResponseService::response(423, "Valeur numérique attendue après " + params.op);
         }
-        token = trim(token);
-        if (token == "WHERE")
-        {
-            Condition cond;
-            if (!(iss >> cond.field >> cond.op >> cond.value))
-            {
-                this->lastError = "Clause WHERE incomplète";
-                return false;
-            }
-            cond.field = trim(cond.field);
-            cond.op = trim(cond.op);
-            cond.value = trim(cond.value);
-            if (cond.op == "IS")
-                cond.op = "==";
-            else if (cond.op == "NOT")
-                cond.op = "!=";
-            else if (cond.op != "==" && cond.op != "!=" && cond.op != "HAS")
-            {
-                this->lastError = "Opérateur invalide";
-                return false;
-            }
-            cond.logic = "";
-            params->conditions.push_back(cond);
-            while (iss >> token)
-            {
-                token = trim(token);
-                if (token == "AND" || token == "OR")
-                {
-                    Condition cond2;
-                    cond2.logic = token;
-                    if (!(iss >> cond2.field >> cond2.op >> cond2.value))
-                    {
-                        this->lastError = "Clause WHERE incomplète après " + token;
-                        return false;
-                    }
-                    cond2.field = trim(cond2.field);
-                    cond2.op = trim(cond2.op);
-                    cond2.value = trim(cond2.value);
-                    if (cond2.op == "IS")
-                        cond2.op = "==";
-                    else if (cond2.op == "NOT")
-                        cond2.op = "!=";
-                    else if (cond2.op != "==" && cond2.op != "!=" && cond2.op != "HAS")
-                    {
-                        this->lastError = "Opérateur invalide";
-                        return false;
-                    }
-                    params->conditions.push_back(cond2);
-                }
-                else if (trim(token) == "IN")
-                {
-                    break;
-                }
-                else
-                {
-                    break;
-                }
-            }
-            if (trim(token) != "IN")
-            {
-                this->lastError = "IN attendu après WHERE";
-                return false;
-            }
-            if (!(iss >> params->dataset))
-            {
-                this->lastError = "Dataset manquant";
-                return false;
-            }
-            params->dataset = trim(params->dataset);
+        std::shared_ptr<RoktDataset> datasetObj;
+        std::unique_ptr<ROKT::ResponseObject> status = this->service->from(params.dataset, datasetObj, true);
+        if (status->hasError()) {
+                return status;
         }
-        else if (token == "IN")
-        {
-            if (!(iss >> params->dataset))
-            {
-                this->lastError = "Dataset manquant";
-                return false;
-            }
-            params->dataset = trim(params->dataset);
+        size_t changedCount = 0;
+        status = datasetObj->increment(params.field, by, params.conditions, &changedCount);
+        if (status->hasError()) {
+            return status;
         }
-        else
-        {
-            {
-                this->lastError = "Syntaxe CHANGE invalide";
-                return false;
-            }
-        }
-        return true;
+        return ROKT::ResponseService::response(0, std::string("OK, mis à jour ") + std::to_string(changedCount) + " ligne(s).");
     }
 
-public:
-    ChangeCommandHandler(RoktService *service) : CommandHandler(service) {}
-    virtual std::unique_ptr<ROKT::ResponseObject>handle(const std::string &command) override
+    // Exécute une commande CHANGE déjà analysée
+    std::unique_ptr<ROKT::ResponseObject> run(const RoktChangeQuery &params)
     {
+        if (params.op != "=")
+        {
+            return increment(params);
+        }
         try
         {
-            ChangeParams params;
-            if(!parseCommand(command, &params))
-            {
-                return CommandHandler::handle(command);
-            }
             std::shared_ptr<RoktDataset> datasetObj;
-            if(this->service->from(params.dataset, datasetObj)->hasError()) {
-                    return ROKT::ResponseService::response(1, "Can't get dataset");
+            std::unique_ptr<ROKT::ResponseObject> status = this->service->from(params.dataset, datasetObj, true);
+            if (status->hasError()) {
+                    return status;
             }
-            nlohmann::json data = datasetObj->select({"*"}).raw();
-            int changedCount = 0;
-            for (auto &item : data)
-            {
-                
-                bool cond;
-                if(!evaluateConditions(item, params.conditions, &cond)) {
-                    return ROKT::ResponseService::response(3, "Can't verify condition");
-                }
-                bool ok = params.conditions.empty() ? true : cond;
-                if (ok)
-                {
-                    item[params.field] = params.newValue;
-                    changedCount++;
-                }
+            // La valeur est enregistrée dans le journal du dataset, sans réécrire son fichier
+            // (RoktDataset::assign) ; elle reste une chaîne, comme la valeur de la commande
+            size_t changedCount = 0;
+            status = datasetObj->assign(params.field, params.newValue, params.conditions, &changedCount);
+            if (status->hasError()) {
+                return status;
             }
-            datasetObj->overwrite(data);
             return ROKT::ResponseService::response(0, std::string("OK, mis à jour ") + std::to_string(changedCount) + " ligne(s).");
         }
         catch (std::exception &e)
@@ -2,15 +2,37 @@
 #define COMMAND_HANDLER_H
 
 #include <string>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <nlohmann/json.hpp>
 #include "RoktResponseObject.h"
 #include "RoktResponseService.h"
 #include "RoktService.h"
+#include "ConditionUtils.h"
+#include "RoktCommand.h"
+
+// Marqueur d'un paramètre dans une commande préparée
+#define PREPARED_PARAMETER "?"
+
+/**
+ * @brief Plan d'une commande préparée (PREPARE) : la commande est analysée et validée une
+ * seule fois, chaque exécution (EXECUTE) ne fait que lier ses paramètres.
+ *
+ * Chaque handler préparable dérive de cette structure pour y conserver ses paramètres analysés.
+ */
+struct PreparedPlan {
+    std::string command;        ///< texte de la commande d'origine, avec ses '?'
+    size_t parameterCount = 0;  ///< nombre de '?' à lier, dans l'ordre de la commande
+    RoktCommand::Kind kind = RoktCommand::Kind::UNKNOWN;  ///< type de la commande (priorité de ses exécutions)
+    virtual ~PreparedPlan() {}
+};
 
 /**
  * @brief Classe de base pour les handlers.
  *
  * Chaque handler doit redéfinir la méthode handle() qui prend en paramètre
- * une commande et une référence à RoktService, et renvoie un std::unique_ptr<ROKT::ResponseObject>.
+ * une commande déjà analysée et renvoie un std::unique_ptr<ROKT::ResponseObject>.
  */
 class CommandHandler {
 protected:
@@ -29,18 +51,99 @@ public:
      * @brief Traite la commande.
      * Si le handler courant ne peut pas la traiter, il la passe au suivant.
      *
-     * @param command La commande à traiter.
-     * @param service Référence à RoktService.
+     * @param command La commande à traiter, analysée à la réception de la requête.
      * @return std::unique_ptr<ROKT::ResponseObject> Le résultat de la commande.
      */
-    virtual std::unique_ptr<ROKT::ResponseObject> handle(const std::string &command) {
+    virtual std::unique_ptr<ROKT::ResponseObject> handle(const RoktCommand &command) {
         if (next != nullptr) {
             return next->handle(command);
         } else {
             return ROKT::ResponseService::response(423, "Commande non reconnue");
         }
     }
+    /**
+     * @brief Indique si la commande est une lecture dont la réponse peut être mise en cache.
+     *
+     * @param command La commande à traiter.
+     * @param version Version courante du dataset lu, qui change à chaque écriture.
+     * @param key Reçoit la clé de cache si elle diffère de la commande normalisée (laissée vide sinon).
+     * @return true si la réponse ne dépend que de la commande et de cette version.
+     */
+    virtual bool cacheVersion(const RoktCommand &command, uint64_t *version, std::string *key) {
+        return false;
+    }
+
+    /**
+     * @brief Décrit le plan d'exécution de la commande sans l'exécuter (EXPLAIN).
+     *
+     * @param command La commande à décrire.
+     * @param plan Reçoit la description : type d'accès, parallélisme, opérations déportées sur le
+     * parcours et suite des opérateurs.
+     * @param error Reçoit la raison de l'échec.
+     * @return false si le plan ne peut pas être établi (dataset inaccessible).
+     */
+    virtual bool explain(const RoktCommand &command, nlohmann::json *plan, std::string *error) {
+        (*plan)["command"] = std::string(command.getKeyword());
+        (*plan)["operators"] = nlohmann::json::array({"execute"});
+        return true;
+    }
+
+    /**
+     * @brief Construit une fois pour toutes le plan d'une commande contenant des paramètres '?'.
+     *
+     * @param command La commande à préparer, déjà analysée.
+     * @param error Reçoit la raison de l'échec.
+     * @return Le plan, ou nullptr si la commande est invalide ou non préparable.
+     */
+    virtual std::shared_ptr<PreparedPlan> prepare(const RoktCommand &command, std::string *error) {
+        *error = "Commande non préparable";
+        return nullptr;
+    }
+
+    /**
+     * @brief Exécute un plan préparé par ce handler avec les valeurs de ses paramètres.
+     */
+    virtual std::unique_ptr<ROKT::ResponseObject> execute(const PreparedPlan &plan, const std::vector<std::string> &parameters) {
+        return ROKT::ResponseService::response(423, "Commande non préparable");
+    }
+
+    /**
+     * @brief Type de la commande réellement exécutée : celui de la requête préparée pour EXECUTE.
+     *
+     * @param command La commande reçue.
+     * @return Son type, ou UNKNOWN si la commande qu'elle désigne est inconnue.
+     */
+    virtual RoktCommand::Kind executedKind(const RoktCommand &command) {
+        return command.getKind();
+    }
+
+    /**
+     * @brief Équivalent de cacheVersion() pour un plan préparé.
+     */
+    virtual bool planVersion(const PreparedPlan &plan, uint64_t *version) {
+        return false;
+    }
     virtual ~CommandHandler() {}
+
+protected:
+    // Compte les paramètres '?' des valeurs de conditions
+    static size_t countParameters(const std::vector<Condition> &conditions) {
+        size_t count = 0;
+        for (const auto &cond : conditions) {
+            if (cond.value == PREPARED_PARAMETER)
+                count++;
+        }
+        return count;
+    }
+    // Remplace `slot` par le paramètre suivant s'il s'agit d'un '?'
+    static void bindParameter(std::string &slot, const std::vector<std::string> &parameters, size_t *next) {
+        if (slot == PREPARED_PARAMETER && *next < parameters.size())
+            slot = parameters[(*next)++];
+    }
+    static void bindParameters(std::vector<Condition> &conditions, const std::vector<std::string> &parameters, size_t *next) {
+        for (auto &cond : conditions)
+            bindParameter(cond.value, parameters, next);
+    }
 };
 
 #endif // COMMAND_HANDLER_H
@@ -4,9 +4,11 @@
 #include "CommandHandler.h"
 #include "RoktResponseService.h"
 #include "RoktService.h"
-#include "Utils.h"           // pour trim()
-#include <sstream>
+#include "RoktCommand.h"
+#include "QueryProfile.h"
 #include <string>
+#include <vector>
+#include <memory>
 #include <nlohmann/json.hpp>
 
 
@@ -17,70 +19,164 @@
  * Syntaxe attendue :
  *   COUNT <dataset> [<key>:<value>];
  *
- * Si aucune condition n'est donnée, il compte toutes les lignes du dataset.
- * Sinon, il ne compte que les lignes où la valeur du champ spécifié est égale à la valeur donnée.
+ * Si aucune condition n'est donnée, le nombre de lignes est lu dans les statistiques du dataset,
+ * sans parcours. Sinon, il ne compte que les lignes où la valeur du champ spécifié est égale à la
+ * valeur donnée ; un champ qu'aucune ligne ne contient donne 0 sans parcours.
  * La réponse est encapsulée dans un ROKT::ResponseObject contenant le nlohmann::json {"count": <nombre>}.
  */
 class CountCommandHandler : public CommandHandler {
+private:
+    // Une ligne est comptée si elle possède le champ et que sa valeur correspond
+    bool matches(const nlohmann::json &row, const std::string &key, const std::string &value) {
+        if (!row.contains(key))
+            return false;
+        try {
+            // Essayer d'obtenir la valeur en tant que chaîne
+            return row[key].get<std::string>() == value;
+        } catch (...) {
+            // Si ce n'est pas une chaîne, comparer via dump()
+            return row[key].dump() == value;
+        }
+    }
+
+    // Même comparaison, sur la valeur du ruban située à `pos`
+    bool matches(const RoktRowStore &store, size_t pos, const std::string &value) {
+        if (pos == RoktRowStore::npos)
+            return false;
+        if (store.tag(pos) == RoktRowStore::TAG_STRING)
+            return store.string(pos) == value;
+        return store.materializeValue<nlohmann::json>(pos).dump() == value;
+    }
+
+    // Renvoie true si les statistiques suffisent (`count` est alors renseigné) : COUNT sans
+    // condition, ou champ qu'aucune ligne ne contient
+    bool countFromStatistics(RoktDataset &datasetObj, const RoktCountQuery &params, size_t *count) {
+        bool answered = false;
+        datasetObj.statistics([&](const RoktDatasetStats &stats) {
+            if (params.condition.empty()) {
+                *count = stats.getRowCount();
+                answered = true;
+            } else if (params.key.find('.') == std::string::npos) {
+                // Les statistiques sont indexées par chemin : une clé contenant un '.' n'y figure pas
+                const RoktColumnStats *column = stats.column(params.key);
+                answered = column == nullptr || (column->present == 0 && column->nulls == 0);
+            }
+        });
+        return answered;
+    }
+
+    struct CountPlan : PreparedPlan {
+        RoktCountQuery query;
+    };
+
 public:
     CountCommandHandler(RoktService *service) : CommandHandler(service) {}
-    virtual std::unique_ptr<ROKT::ResponseObject> handle(const std::string &command) override {
-        std::istringstream iss(command);
-        std::string keyword, dataset, condition;
-        
-        // Lecture initiale de la commande : on attend "COUNT <dataset>"
-        if (!(iss >> keyword >> dataset)) {
-            return CommandHandler::handle(command);
-        }
-        keyword = trim(keyword);
-        dataset = trim(dataset);
-        if (keyword != "COUNT") {
-            return CommandHandler::handle(command);
+
+    virtual bool cacheVersion(const RoktCommand &command, uint64_t *version, std::string *key) override {
+        if (command.getKind() != RoktCommand::Kind::COUNT)
+            return false;
+        return this->service->version(command.as<RoktCountQuery>().dataset, version);
+    }
+
+    virtual std::shared_ptr<PreparedPlan> prepare(const RoktCommand &command, std::string *error) override {
+        auto plan = std::make_shared<CountPlan>();
+        plan->query = command.as<RoktCountQuery>();
+        plan->parameterCount = plan->query.value == PREPARED_PARAMETER ? 1 : 0;
+        return plan;
+    }
+
+    virtual std::unique_ptr<ROKT::ResponseObject> execute(const PreparedPlan &plan, const std::vector<std::string> &parameters) override {
+        RoktCountQuery params = static_cast<const CountPlan &>(plan).query;
+        size_t next = 0;
+        bindParameter(params.value, parameters, &next);
+        return run(params);
+    }
+
+    virtual bool planVersion(const PreparedPlan &plan, uint64_t *version) override {
+        return this->service->version(static_cast<const CountPlan &>(plan).query.dataset, version);
+    }
+
+    virtual bool explain(const RoktCommand &command, nlohmann::json *plan, std::string *error) override {
+        const RoktCountQuery &params = command.as<RoktCountQuery>();
+        std::shared_ptr<RoktDataset> datasetObj;
+        RoktScanPlan scan;
+        if (this->service->from(params.dataset, datasetObj)->hasError() || !datasetObj->planScan(datasetObj->maxScanPartitions(), &scan)) {
+            *error = "Can't get dataset";
+            return false;
         }
-        
-        // Lire la condition optionnelle (format "key:value")
-        if (iss >> condition) {
-            condition = trim(condition);
-        } else {
-            condition = "";
+        (*plan)["command"] = "COUNT";
+        (*plan)["dataset"] = params.dataset;
+        size_t count = 0;
+        if (countFromStatistics(*datasetObj, params, &count)) {
+            (*plan)["access"] = {{"method", "statistics"}, {"rows", scan.rows}};
+            (*plan)["operators"] = nlohmann::json::array({"statistics", "serialize"});
+            return true;
         }
-        
-        // Charger le dataset via le service et lire toutes les données
+        // Clé simple : comparaison sur le ruban, en parallèle ; clé imbriquée : lignes converties
+        bool onTape = params.key.find('.') == std::string::npos;
+        (*plan)["access"] = {{"method", "fullScan"}, {"storage", scan.storage}, {"rows", scan.rows},
+                             {"partitions", onTape ? scan.partitions : 1}};
+        if (scan.runs > 0)
+            (*plan)["access"]["runs"] = scan.runs;
+        (*plan)["operators"] = onTape ? nlohmann::json::array({"statistics", "scan", "count", "serialize"})
+                                      : nlohmann::json::array({"statistics", "scan", "materialize", "count", "serialize"});
+        return true;
+    }
+
+    virtual std::unique_ptr<ROKT::ResponseObject> handle(const RoktCommand &command) override {
+        if (command.getKind() != RoktCommand::Kind::COUNT)
+            return CommandHandler::handle(command);
+        return run(command.as<RoktCountQuery>());
+    }
+
+private:
+    // Exécute un COUNT déjà analysé
+    std::unique_ptr<ROKT::ResponseObject> run(const RoktCountQuery &params) {
+        const std::string &dataset = params.dataset;
+        const std::string &condition = params.condition;
+        const std::string &key = params.key;
+        const std::string &value = params.value;
+
         std::shared_ptr<RoktDataset> datasetObj;
         if(this->service->from(dataset, datasetObj)->hasError()) {
                 return ROKT::ResponseService::response(1, "Can't get dataset");
         }
-        nlohmann::json data = datasetObj->select({"*"}).raw();
-        
         size_t count = 0;
-        if (condition.empty()) {
-            // Si aucune condition n'est donnée, on compte toutes les lignes
-            count = data.size();
-        } else {
-            // Condition attendue : "key:value"
-            size_t pos = condition.find(':');
-            if (pos == std::string::npos) {
-                return ROKT::ResponseService::response(423, "Condition COUNT invalide, format attendu 'key:value'");
+        bool needsScan;
+        {
+            QueryProfile::Timer timer("statistics");
+            needsScan = !countFromStatistics(*datasetObj, params, &count);
+        }
+
+        // Sinon parcourir le dataset : aucune ligne n'est conservée, seuls les compteurs le sont
+        if (needsScan && !condition.empty() && key.find('.') == std::string::npos) {
+            // La valeur est comparée directement sur le ruban, en parallèle
+            size_t partitions = datasetObj->maxScanPartitions();
+            std::vector<size_t> counts(partitions, 0);
+            std::vector<std::unique_ptr<RoktFieldPath>> paths(partitions);
+            QueryProfile::Counter compare("count", partitions);
+            bool scanned = datasetObj->scanRows({}, partitions, [&](const RoktScanRow &row) {
+                std::unique_ptr<RoktFieldPath> &path = paths[row.partition];
+                if (!path)
+                    path = std::make_unique<RoktFieldPath>(key, row.store.dictionary());
+                if (compare.measure(row.partition, [&]() { return matches(row.store, path->lookup(row.store, row.row), value); }))
+                    counts[row.partition]++;
+                return true;
+            });
+            if (!scanned) {
+                return ROKT::ResponseService::response(3, datasetObj->getLastError());
             }
-            std::string key = trim(condition.substr(0, pos));
-            std::string value = trim(condition.substr(pos + 1));
-            
-            // Compter les lignes qui possèdent le champ et dont la valeur correspond
-            for (const auto &row : data) {
-                if (row.contains(key)) {
-                    try {
-                        // Essayer d'obtenir la valeur en tant que chaîne
-                        std::string cell = row[key].get<std::string>();
-                        if (cell == value) {
-                            count++;
-                        }
-                    } catch (...) {
-                        // Si ce n'est pas une chaîne, comparer via dump()
-                        if (row[key].dump() == value) {
-                            count++;
-                        }
-                    }
-                }
+            for (size_t partitionCount : counts)
+                count += partitionCount;
+        } else if (needsScan) {
+            QueryProfile::Counter compare("count", 1);
+            bool scanned = datasetObj->scan<nlohmann::json>({}, [&](nlohmann::json &row) {
+                if (compare.measure(0, [&]() { return condition.empty() || matches(row, key, value); }))
+                    count++;
+                return true;
+            });
+            if (!scanned) {
+                return ROKT::ResponseService::response(3, datasetObj->getLastError());
             }
         }
         
@@ -2,27 +2,25 @@
 #define CREATE_TABLE_COMMAND_HANDLER_H
 
 #include "CommandHandler.h"
-#include <sstream>
 #include "RoktResponseService.h"
-#include "Utils.h" // pour trim()
+#include "RoktCommand.h"
 
 /**
- * @brief Gère la commande "CREATE TABLE <dataset>;".
+ * @brief Gère la commande "CREATE TABLE <dataset> [LSM [KEY <champ>]];".
+ *
+ * Avec LSM, le dataset est stocké en runs immuables alimentés par une memtable (RoktLsmTree) :
+ * un ajout n'écrit que ses lignes, quelle que soit la taille du dataset.
  */
 class CreateTableCommandHandler : public CommandHandler {
 public:
     CreateTableCommandHandler(RoktService *service) : CommandHandler(service) {}
-    virtual std::unique_ptr<ROKT::ResponseObject> handle(const std::string &command) override {
-        if (command.find("CREATE TABLE") == 0) {
-            std::istringstream iss(command);
-            std::string token, dataset;
-            // On s'attend à "CREATE TABLE <dataset>;"
-            iss >> token; // CREATE
-            iss >> token; // TABLE
-            iss >> dataset;
-            dataset = trim(dataset);
-            // Appel de la méthode create() du service pour créer un dataset SIMPLE
-            return this->service->create(dataset, "SIMPLE");
+    virtual std::unique_ptr<ROKT::ResponseObject> handle(const RoktCommand &command) override {
+        if (command.getKind() == RoktCommand::Kind::CREATE) {
+            // Appel de la méthode create() du service pour créer un dataset SIMPLE ou LSM
+            const RoktDatasetQuery &query = command.as<RoktDatasetQuery>();
+            if (query.storage == "LSM")
+                return this->service->create(query.dataset, "LSM", {query.key});
+            return this->service->create(query.dataset, "SIMPLE");
         }
         return CommandHandler::handle(command);
     }
@@ -0,0 +1,30 @@
+#ifndef CREATE_VIEW_COMMAND_HANDLER_H
+#define CREATE_VIEW_COMMAND_HANDLER_H
+
+#include "CommandHandler.h"
+#include "RoktResponseService.h"
+#include "RoktCommand.h"
+
+/**
+ * @brief Gère la commande "CREATE VIEW <nom> AS GET <agrégats> IN <dataset> [WHERE ...] [GROUP BY <clé>];".
+ *
+ * La vue est calculée une fois à sa création, puis chaque ADD, CHANGE ou REMOVE sur le dataset
+ * source lui applique les lignes qu'il ajoute ou retire. Elle se lit comme un dataset (une ligne
+ * par groupe) : "GET * IN <nom>;". Elle n'accepte aucune écriture directe ; DELETE la supprime.
+ */
+class CreateViewCommandHandler : public CommandHandler {
+public:
+    CreateViewCommandHandler(RoktService *service) : CommandHandler(service) {}
+    virtual std::unique_ptr<ROKT::ResponseObject> handle(const RoktCommand &command) override {
+        if (command.getKind() != RoktCommand::Kind::CREATE_VIEW)
+            return CommandHandler::handle(command);
+        const RoktViewQuery &query = command.as<RoktViewQuery>();
+        try {
+            return this->service->createView(query.name, query.inner);
+        } catch (std::exception &e) {
+            return ROKT::ResponseService::response(423, std::string("Erreur CREATE VIEW: ") + e.what());
+        }
+    }
+};
+
+#endif // CREATE_VIEW_COMMAND_HANDLER_H
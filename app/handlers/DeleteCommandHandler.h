@@ -4,21 +4,15 @@
 #include "CommandHandler.h"
 #include "RoktResponseService.h"
 #include "RoktService.h"
-#include <sstream>
-#include "Utils.h" // pour trim()
+#include "RoktCommand.h"
 
 class DeleteCommandHandler : public CommandHandler {
 public:
     DeleteCommandHandler(RoktService *service) : CommandHandler(service) {}
-    virtual std::unique_ptr<ROKT::ResponseObject> handle(const std::string &command) override {
-        std::istringstream iss(command);
-        std::string keyword, dataset;
-        iss >> keyword >> dataset;
-        keyword = trim(keyword);
-        dataset = trim(dataset);
-        if (keyword != "DELETE")
+    virtual std::unique_ptr<ROKT::ResponseObject> handle(const RoktCommand &command) override {
+        if (command.getKind() != RoktCommand::Kind::DELETE)
             return CommandHandler::handle(command);
-        return this->service->drop(dataset);
+        return this->service->drop(command.as<RoktDatasetQuery>().dataset);
     }
 };
 
@@ -5,24 +5,22 @@
 #include "RoktResponseService.h"
 #include "RoktService.h"
 #include "RoktDataset.h"
-#include "Utils.h" // pour trim()
-#include <sstream>
+#include "RoktCommand.h"
 
 class EmptyCommandHandler : public CommandHandler {
 public:
     EmptyCommandHandler(RoktService *service) : CommandHandler(service) {}
-    virtual std::unique_ptr<ROKT::ResponseObject> handle(const std::string &command) override {
-        std::istringstream iss(command);
-        std::string keyword, dataset;
-        iss >> keyword >> dataset;
-        keyword = trim(keyword);
-        dataset = trim(dataset);
-        if (keyword != "EMPTY")
+    virtual std::unique_ptr<ROKT::ResponseObject> handle(const RoktCommand &command) override {
+        if (command.getKind() != RoktCommand::Kind::EMPTY)
             return CommandHandler::handle(command);
+        const std::string &dataset = command.as<RoktDatasetQuery>().dataset;
         std::shared_ptr<RoktDataset> datasetObj;
-        if(this->service->from(dataset, datasetObj)->hasError()) {
-                return ROKT::ResponseService::response(1, "Can't get dataset");
+        std::unique_ptr<ROKT::ResponseObject> status = this->service->from(dataset, datasetObj, true);
+        if (status->hasError()) {
+                return status;
         }
+        // Un compactage commencé avant EMPTY est attendu : il ne travaille pas sur les fichiers vidés
+        datasetObj->waitCompaction();
         nlohmann::json emptyData = nlohmann::json::array();
         datasetObj->overwrite(emptyData);
         return ROKT::ResponseService::response(0, "OK, table vide");
@@ -0,0 +1,74 @@
+#ifndef EXECUTE_COMMAND_HANDLER_H
+#define EXECUTE_COMMAND_HANDLER_H
+
+#include "CommandHandler.h"
+#include "PreparedStatements.h"
+#include "RoktResponseService.h"
+#include "RoktService.h"
+#include "ResultCache.h"
+#include "RoktCommand.h"
+#include <string>
+#include <vector>
+
+/**
+ * @brief ExecuteCommandHandler exécute une requête préparée par PREPARE.
+ *
+ * Syntaxe attendue :
+ *   EXECUTE <nom> [(<valeur>, <valeur>...)];
+ *
+ * Les valeurs sont liées dans l'ordre aux '?' de la requête ; une valeur peut être placée entre
+ * guillemets pour contenir des virgules ou des espaces. La requête préparée n'est pas analysée
+ * à nouveau : son plan est exécuté directement. Les requêtes de lecture passent par le cache de
+ * résultats comme les commandes équivalentes, et sont mises en file avec la priorité de la
+ * commande préparée.
+ */
+class ExecuteCommandHandler : public CommandHandler {
+private:
+    PreparedStatements *statements;
+
+public:
+    ExecuteCommandHandler(RoktService *service, PreparedStatements *statements) : CommandHandler(service), statements(statements) {}
+
+    virtual bool cacheVersion(const RoktCommand &command, uint64_t *version, std::string *key) override {
+        if (command.getKind() != RoktCommand::Kind::EXECUTE)
+            return false;
+        const std::string &name = command.as<RoktExecuteQuery>().name;
+        const std::vector<std::string> &parameters = command.as<RoktExecuteQuery>().parameters;
+        PreparedStatements::Statement statement;
+        if (!statements->find(name, &statement) ||
+            parameters.size() != statement.plan->parameterCount || !statement.handler->planVersion(*statement.plan, version))
+            return false;
+        // La clé porte sur la requête préparée elle-même : un nom redéfini ne réutilise pas
+        // les réponses de l'ancienne requête
+        *key = "EXECUTE " + ResultCache::normalize(statement.plan->command);
+        for (const auto &parameter : parameters)
+            *key += '\x1f' + parameter;
+        return true;
+    }
+
+    virtual RoktCommand::Kind executedKind(const RoktCommand &command) override {
+        if (command.getKind() != RoktCommand::Kind::EXECUTE)
+            return command.getKind();
+        PreparedStatements::Statement statement;
+        if (!statements->find(command.as<RoktExecuteQuery>().name, &statement))
+            return RoktCommand::Kind::UNKNOWN;
+        return statement.plan->kind;
+    }
+
+    virtual std::unique_ptr<ROKT::ResponseObject> handle(const RoktCommand &command) override {
+        if (command.getKind() != RoktCommand::Kind::EXECUTE)
+            return CommandHandler::handle(command);
+        const std::string &name = command.as<RoktExecuteQuery>().name;
+        const std::vector<std::string> &parameters = command.as<RoktExecuteQuery>().parameters;
+        PreparedStatements::Statement statement;
+        if (!statements->find(name, &statement))
+            return ROKT::ResponseService::response(1, "Requête préparée inconnue : " + name);
+        if (parameters.size() != statement.plan->parameterCount) {
+            return ROKT::ResponseService::response(3, "Nombre de paramètres invalide : " + std::to_string(statement.plan->parameterCount) +
+                                                          " attendu(s), " + std::to_string(parameters.size()) + " reçu(s)");
+        }
+        return statement.handler->execute(*statement.plan, parameters);
+    }
+};
+
+#endif // EXECUTE_COMMAND_HANDLER_H
@@ -0,0 +1,77 @@
+#ifndef EXPLAIN_COMMAND_HANDLER_H
+#define EXPLAIN_COMMAND_HANDLER_H
+
+#include "CommandHandler.h"
+#include "RoktResponseService.h"
+#include "RoktService.h"
+#include "RoktCommand.h"
+#include "QueryProfile.h"
+#include "ResponseStream.h"
+#include <string>
+#include <unordered_map>
+#include <nlohmann/json.hpp>
+
+/**
+ * @brief ExplainCommandHandler décrit ou mesure l'exécution d'une autre commande.
+ *
+ * Syntaxe attendue :
+ *   EXPLAIN <commande>;
+ *   PROFILE <commande>;
+ *
+ * EXPLAIN n'exécute rien : il renvoie le plan choisi par le handler de la commande (mode
+ * d'accès, stockage, partitions du parcours, opérateurs appliqués sur le ruban, estimation
+ * du nombre de lignes tirée des statistiques du dataset).
+ * PROFILE exécute la commande (une écriture est donc appliquée) et renvoie, à la place de
+ * son résultat, son statut et la liste de ses étapes avec leurs lignes en entrée et en
+ * sortie, leurs octets, leur temps écoulé et leur temps CPU.
+ */
+class ExplainCommandHandler : public CommandHandler {
+private:
+    std::unordered_map<RoktCommand::Kind, CommandHandler *> handlers;
+
+public:
+    explicit ExplainCommandHandler(RoktService *service) : CommandHandler(service) {}
+
+    void addHandler(RoktCommand::Kind kind, CommandHandler *handler) {
+        handlers[kind] = handler;
+    }
+
+    virtual std::unique_ptr<ROKT::ResponseObject> handle(const RoktCommand &command) override {
+        if (command.getKind() != RoktCommand::Kind::EXPLAIN && command.getKind() != RoktCommand::Kind::PROFILE)
+            return CommandHandler::handle(command);
+        const RoktCommand &inner = *command.as<RoktExplainQuery>().inner;
+        auto it = handlers.find(inner.getKind());
+        if (it == handlers.end())
+            return ROKT::ResponseService::response(423, "Commande non reconnue : " + std::string(inner.getKeyword()));
+
+        if (command.getKind() == RoktCommand::Kind::EXPLAIN) {
+            nlohmann::json plan;
+            std::string error;
+            if (!it->second->explain(inner, &plan, &error))
+                return ROKT::ResponseService::response(1, error);
+            return ROKT::ResponseService::response(0, "OK", plan.dump());
+        }
+
+        QueryProfile profile;
+        std::unique_ptr<ROKT::ResponseObject> response;
+        uint64_t wallNs;
+        {
+            QueryProfile::Scope scope(&profile);
+            // Le résultat de la commande n'est pas renvoyé : pas d'envoi par blocs
+            ResponseStream::Scope noStream(nullptr);
+            uint64_t start = QueryProfile::wallNow();
+            response = it->second->handle(inner);
+            wallNs = QueryProfile::wallNow() - start;
+        }
+        nlohmann::json result;
+        result["command"] = std::string(inner.getKeyword());
+        result["status"] = response->getStatusCode();
+        result["reason"] = response->getReasonPhrase();
+        result["resultBytes"] = response->getDatas().size();
+        result["totalMs"] = static_cast<double>(wallNs) / 1e6;
+        result["stages"] = profile.toJson();
+        return ROKT::ResponseService::response(0, "OK", result.dump());
+    }
+};
+
+#endif // EXPLAIN_COMMAND_HANDLER_H
@@ -4,390 +4,732 @@
 #include "CommandHandler.h"
 #include "RoktService.h"
 #include "RoktDataset.h"
-#include "Utils.h"  // contient trim(), etc.
 #include "ConditionUtils.h"  // pour Condition, getNestedValue, evaluateConditions
-#include <sstream>
+#include "RequestArena.h"    // pour ROKT::ArenaJson
+#include "RoktTopK.h"
+#include "RoktAggregate.h"
+#include "RoktJoin.h"
+#include "RoktCommand.h"
+#include "QueryProfile.h"
+#include "ResponseStream.h"
 #include <string>
 #include <nlohmann/json.hpp>
 #include <vector>
 #include <algorithm>
 #include <stdexcept>
-#include <cstdlib>
-
 
+#define GET_CURSOR_EXPIRED "Curseur expiré : le dataset a été modifié depuis la page précédente."
 
 class GetCommandHandler : public CommandHandler {
 private:
-    // Structure pour stocker les paramètres extraits de la commande GET.
-    struct GetParams {
-        std::string fields;
-        std::string dataset;
-        std::string alias;
-        std::vector<Condition> conditions;  // Conditions de WHERE
-        std::string groupByKey;
-        std::string orderByKey;
-        bool orderDesc;
-        int limit;
+    struct GetPlan : PreparedPlan {
+        RoktGetQuery query;
     };
 
-    std::string lastError;
-
-    // Parse la commande GET en gérant plusieurs conditions (AND/OR)
-    bool parseCommand(const std::string &command, GetParams* params) {
-        params->orderDesc = false;
-        params->limit = -1;
-        std::istringstream iss(command);
-        std::string token;
-        
-        // Lecture initiale : on attend "GET <fields>"
-        std::string getKeyword;
-        if (!(iss >> getKeyword)) {
-            this->lastError = "Commande vide.";
-            return false;
-        }
-        getKeyword = trim(getKeyword);
-        if (getKeyword != "GET") {
-            this->lastError = "La commande doit commencer par GET.";
-            return false;
-        }
-        if (!(iss >> params->fields)) {
-            this->lastError = "Champ manquant après GET.";
-            return false;
-        }
-        params->fields = trim(params->fields);
-        
-        // Optionnel : alias avec AS
-        if (iss >> token) {
-            token = trim(token);
-            if (token == "AS") {
-                if (!(iss >> params->alias)) {
-                    this->lastError = "Alias manquant après AS.";
-                    return false;
-                }
-                params->alias = trim(params->alias);
-                if (!(iss >> token)) {
-                    this->lastError = "Mot-clé IN manquant après alias.";
-                    return false;
-                }
-                token = trim(token);
-                if (token != "IN") {
-                    this->lastError = "IN manquant après alias.";
-                    return false;
-                }
-            } else if (token != "IN") {
-                this->lastError = "Syntaxe invalide : attendu AS ou IN après le champ.";
-                return false;
-            }
-        } else {
-            this->lastError = "Syntaxe invalide : IN manquant.";
-            return false;
-        }
-        
-        // Lecture du dataset
-        if (!(iss >> params->dataset)) {
-            this->lastError = "Nom du dataset manquant.";
-            return false;
-        }
-        params->dataset = trim(params->dataset);
-        
-        // Analyse des clauses optionnelles
-        // On supporte WHERE avec conditions multiples (séparées par AND ou OR),
-        // GROUP BY, ORDER BY et LIMIT.
-        while (iss >> token) {
-            token = trim(token);
-            if (token == "WHERE") {
-                // Lecture de la première condition
-                Condition cond;
-                if (!(iss >> cond.field >> cond.op >> cond.value)) {
-                    this->lastError = "Clause WHERE incomplète.";
-                    return false;
-                }
-                cond.field = trim(cond.field);
-                cond.op = trim(cond.op);
-                cond.value = trim(cond.value);
-                if (cond.op == "IS")
-                    cond.op = "==";
-                else if (cond.op == "NOT")
-                    cond.op = "!=";
-                else if (cond.op != "==" && cond.op != "!=" && cond.op != "HAS") {
-                    this->lastError = "Opérateur invalide dans WHERE.";
-                    return false;
-                }
-                cond.logic = ""; // première condition, pas de logique
-                params->conditions.push_back(cond);
-                // Lecture de conditions supplémentaires, le cas échéant
-                while (iss >> token) {
-                    token = trim(token);
-                    if (token == "AND" || token == "OR") {
-                        Condition cond2;
-                        cond2.logic = token; // logique reliant à la condition précédente
-                        if (!(iss >> cond2.field >> cond2.op >> cond2.value)){
-                            this->lastError = "Clause WHERE incomplète après " + token;
-                            return false;
-                        }
-                        cond2.field = trim(cond2.field);
-                        cond2.op = trim(cond2.op);
-                        cond2.value = trim(cond2.value);
-                        if (cond2.op == "IS")
-                            cond2.op = "==";
-                        else if (cond2.op == "NOT")
-                            cond2.op = "!=";
-                        else if (cond2.op != "==" && cond2.op != "!=" && cond2.op != "HAS") {
-                            this->lastError = "Opérateur invalide dans WHERE.";
-                            return false;
-                        }
-                        params->conditions.push_back(cond2);
-                    } else {
-                        // Si le token n'est pas AND/OR, on le traite dans les clauses suivantes
-                        // On sort de la boucle de conditions.
-                        break;
-                    }
-                }
-                // Si le token lu n'était pas AND/OR, il sera traité par la suite
-                // (On peut utiliser un putback si nécessaire, mais ici nous continuons)
-            } else if (token == "GROUP") {
-                std::string by;
-                if (!(iss >> by)) {
-                    this->lastError = "Clé manquante après GROUP.";
-                    return false;
-                }
-                by = trim(by);
-                if (by != "BY") {
-                    this->lastError = "Syntaxe invalide pour GROUP BY.";
-                    return false;
-                }
-                if (!(iss >> params->groupByKey)) {
-                    this->lastError = "Clé manquante après GROUP BY.";
-                    return false;
-                }
-                params->groupByKey = trim(params->groupByKey);
-            } else if (token == "ORDER") {
-                std::string by;
-                if (!(iss >> by)) {
-                    this->lastError = "Clé manquante après ORDER.";
-                    return false;
-                }   
-                by = trim(by);
-                if (by != "BY") {
-                    this->lastError = "Syntaxe invalide pour ORDER BY.";
-                    return false;
-                }
-                if (!(iss >> params->orderByKey)) {
-                    this->lastError = "Clé manquante après ORDER BY.";
-                    return false;
-                }
-                params->orderByKey = trim(params->orderByKey);
-                std::string orderOpt;
-                if (iss >> orderOpt) {
-                    orderOpt = trim(orderOpt);
-                    if (orderOpt == "DESC")
-                        params->orderDesc = true;
-                    else if (orderOpt == "ASC")
-                        params->orderDesc = false;
-                }
-            } else if (token == "LIMIT") {
-                std::string limitStr;
-                if (!(iss >> limitStr)) {
-                    this->lastError = "Valeur manquante pour LIMIT.";
-                    return false;
-                }
-                limitStr = trim(limitStr);
-                try {
-                    params->limit = std::stoi(limitStr);
-                } catch(...) {
-                    this->lastError = "Valeur invalide pour LIMIT.";
-                    return false;
-                }
-            } else {
-                // Ignorer les tokens non reconnus
-            }
-        }
-        return true;
-    }
-    
-    // Filtre le tableau selon les conditions multiples.
-    nlohmann::json applyConditions(const nlohmann::json &data, const std::vector<Condition> &conds) {
-        nlohmann::json filtered = nlohmann::json::array();
+    // Fonction groupBy : regroupe les objets par la clé donnée (les lignes sont déplacées, pas copiées).
+    ROKT::ArenaJson groupBy(ROKT::ArenaJson &data, const std::string &groupKey) {
+        ROKT::ArenaJson groups = ROKT::ArenaJson::object();
         for (auto &item : data) {
-            bool result = false;
-            evaluateConditions(item, conds, &result);
-            if (result)
-                filtered.push_back(item);
-        }
-        return filtered;
-    }
-    
-    // Fonction groupBy : regroupe les objets par la clé donnée.
-    nlohmann::json groupBy(const nlohmann::json &data, const std::string &groupKey) {
-        nlohmann::json groups = nlohmann::json::object();
-        for (auto &item : data) {
-            nlohmann::json groupValue;
-            if (groupKey.find('.') != std::string::npos) {
-                groupValue = getNestedValue(item, groupKey);
-            } else {
-                if (item.contains(groupKey))
-                    groupValue = item[groupKey];
-                else
-                    groupValue = "undefined";
-            }
-            std::string groupStr = groupValue.dump();
-            if (groups.find(groupStr) == groups.end()) {
-                groups[groupStr] = nlohmann::json::array();
-            }
-            groups[groupStr].push_back(item);
+            const ROKT::ArenaJson *groupValue = findNestedValue(item, groupKey);
+            std::string groupStr;
+            if (groupValue != nullptr)
+                groupStr = groupValue->dump();
+            else
+                groupStr = (groupKey.find('.') != std::string::npos) ? "null" : "\"undefined\"";
+            groups[groupStr].push_back(std::move(item));
         }
         return groups;
     }
     
-    // Fonction orderBy : trie le tableau selon orderKey en ignorant les éléments sans cette clé.
-    // Renvoie le tableau trié et met à jour ignoredCount.
-    nlohmann::json orderBy(const nlohmann::json &data, const std::string &orderKey, bool desc, int &ignoredCount) {
-        std::vector<nlohmann::json> vec;
-        ignoredCount = 0;
-        for (auto &item : data) {
-            nlohmann::json val;
-            if (orderKey.find('.') != std::string::npos) {
-                val = getNestedValue(item, orderKey);
-            } else {
-                if (item.contains(orderKey))
-                    val = item[orderKey];
-                else
-                    val = nullptr;
-            }
-            if (val.is_null() || val == nullptr) {
-                ignoredCount++;
-            } else {
-                vec.push_back(item);
-            }
+    // Fonction projectInto : déplace dans `out` la projection d'un objet : l'objet entier pour "*",
+    // la valeur d'un champ seul, ou un objet pour une liste de champs ("name, details.city").
+    // Un champ absent n'est pas renvoyé.
+    template <typename BasicJsonType>
+    void projectInto(BasicJsonType &out, BasicJsonType &item, const std::string &fields) {
+        if (fields == "*") {
+            out.push_back(std::move(item));
+            return;
         }
-        std::sort(vec.begin(), vec.end(), [&](const nlohmann::json &a, const nlohmann::json &b) {
-            nlohmann::json valA, valB;
-            if (orderKey.find('.') != std::string::npos) {
-                valA = getNestedValue(a, orderKey);
-                valB = getNestedValue(b, orderKey);
-            } else {
-                if (a.contains(orderKey))
-                    valA = a[orderKey];
-                if (b.contains(orderKey))
-                    valB = b[orderKey];
-            }
-            if(valA.is_number() && valB.is_number()){
-                return desc ? (valA.get<double>() > valB.get<double>()) : (valA.get<double>() < valB.get<double>());
-            }
-            return desc ? (valA.dump() > valB.dump()) : (valA.dump() < valB.dump());
-        });
-        return vec;
-    }
-    
-    // Fonction applyLimit : limite le nombre d'éléments d'un tableau nlohmann::json.
-    nlohmann::json applyLimit(const nlohmann::json &data, int limit) {
-        if (!data.is_array() || limit < 0 || static_cast<int>(data.size()) <= limit)
-            return data;
-        nlohmann::json limited = nlohmann::json::array();
-        for (int i = 0; i < limit; i++) {
-            limited.push_back(data[i]);
+        if (fields.find(',') == std::string::npos) {
+            BasicJsonType *value = findField(item, fields);
+            if (value != nullptr)
+                out.push_back(std::move(*value));
+            return;
         }
-        return limited;
+        BasicJsonType projected = BasicJsonType::object();
+        size_t start = 0;
+        while (start <= fields.size()) {
+            size_t comma = std::min(fields.find(',', start), fields.size());
+            std::string field = fields.substr(start, comma - start);
+            field.erase(0, field.find_first_not_of(' '));
+            field.erase(field.find_last_not_of(' ') + 1);
+            start = comma + 1;
+            BasicJsonType *value = findField(item, field);
+            if (value != nullptr)
+                projected[field] = std::move(*value);
+        }
+        if (!projected.empty())
+            out.push_back(std::move(projected));
     }
-    
-    // Fonction applyProjection : extrait le champ spécifié de chaque objet.
-    nlohmann::json applyProjection(const nlohmann::json &data, const std::string &fields) {
+
+    // Champ de premier niveau, ou chemin imbriqué ("details.city") s'il n'en est pas un
+    template <typename BasicJsonType>
+    BasicJsonType *findField(BasicJsonType &item, const std::string &field) {
+        auto it = item.find(field);
+        if (it != item.end())
+            return &*it;
+        if (field.find('.') == std::string::npos)
+            return nullptr;
+        return const_cast<BasicJsonType *>(findNestedValue(item, field));
+    }
+
+    // Fonction applyProjection : extrait le ou les champs spécifiés de chaque objet.
+    ROKT::ArenaJson applyProjection(ROKT::ArenaJson &data, const std::string &fields) {
         if (!data.is_array() || fields == "*")
-            return data;
-        nlohmann::json projected = nlohmann::json::array();
-        for (auto &item : data) {
-            if (item.contains(fields))
-                projected.push_back(item[fields]);
-        }
+            return std::move(data);
+        ROKT::ArenaJson projected = ROKT::ArenaJson::array();
+        for (auto &item : data)
+            projectInto(projected, item, fields);
         return projected;
     }
     
     // Fonction applyAlias : enveloppe chaque élément dans un objet avec la clé alias.
-    nlohmann::json applyAlias(const nlohmann::json &data, const std::string &alias) {
+    template <typename BasicJsonType>
+    BasicJsonType applyAlias(BasicJsonType &data, const std::string &alias) {
         if (!data.is_array())
-            return data;
-        nlohmann::json aliased = nlohmann::json::array();
+            return std::move(data);
+        BasicJsonType aliased = BasicJsonType::array();
         for (auto &item : data) {
-            nlohmann::json obj;
-            obj[alias] = item;
-            aliased.push_back(obj);
+            BasicJsonType obj;
+            obj[alias] = std::move(item);
+            aliased.push_back(std::move(obj));
         }
         return aliased;
     }
     
 public:
     GetCommandHandler(RoktService *service) : CommandHandler(service) {}
-    std::unique_ptr<ROKT::ResponseObject>handle(const std::string &command) override {
-        if (command.find("GET") != 0)
+
+    bool cacheVersion(const RoktCommand &command, uint64_t *version, std::string *key) override {
+        if (command.getKind() != RoktCommand::Kind::GET)
+            return false;
+        return queryVersion(command.as<RoktGetQuery>(), version);
+    }
+
+    std::shared_ptr<PreparedPlan> prepare(const RoktCommand &command, std::string *error) override {
+        auto plan = std::make_shared<GetPlan>();
+        plan->query = command.as<RoktGetQuery>();
+        plan->parameterCount = countParameters(plan->query.conditions);
+        return plan;
+    }
+
+    std::unique_ptr<ROKT::ResponseObject> execute(const PreparedPlan &plan, const std::vector<std::string> &parameters) override {
+        RoktGetQuery params = static_cast<const GetPlan &>(plan).query;
+        size_t next = 0;
+        bindParameters(params.conditions, parameters, &next);
+        return run(params);
+    }
+
+    bool planVersion(const PreparedPlan &plan, uint64_t *version) override {
+        return queryVersion(static_cast<const GetPlan &>(plan).query, version);
+    }
+
+    bool explain(const RoktCommand &command, nlohmann::json *plan, std::string *error) override {
+        const RoktGetQuery &params = command.as<RoktGetQuery>();
+        if (!params.joinDataset.empty())
+            return explainJoin(params, plan, error);
+        std::shared_ptr<RoktDataset> datasetObj;
+        RoktScanPlan scan;
+        if (this->service->from(params.dataset, datasetObj)->hasError() || !datasetObj->planScan(datasetObj->maxScanPartitions(), &scan)) {
+            *error = "Can't get dataset";
+            return false;
+        }
+        // Même choix d'opérateurs que run()
+        bool distinct = params.distinct;
+        bool aggregated = !distinct && !params.aggregates.empty();
+        bool grouped = !distinct && !aggregated && !params.groupByKey.empty();
+        bool sorted = !distinct && !aggregated && !grouped && !params.orderByKey.empty();
+        bool parallel = distinct || aggregated || sorted;
+        nlohmann::json operators = nlohmann::json::array({"scan"});
+        if (!params.conditions.empty())
+            operators.push_back("filter");
+        if (distinct) {
+            operators.push_back("distinct");
+            operators.push_back("distinct.merge");
+            if (!params.orderByKey.empty())
+                operators.push_back("sort");
+        } else if (aggregated) {
+            operators.push_back("aggregate");
+            operators.push_back("aggregate.merge");
+        } else if (grouped) {
+            operators.push_back("materialize");
+            operators.push_back("group");
+        } else if (sorted) {
+            operators.push_back("sort");
+            operators.push_back("sort.merge");
+            if (params.fields != "*")
+                operators.push_back("project");
+        } else {
+            operators.push_back("materialize");
+            operators.push_back("project");
+        }
+        if (!params.alias.empty() && !aggregated && !grouped)
+            operators.push_back("alias");
+        operators.push_back("serialize");
+
+        (*plan)["command"] = "GET";
+        (*plan)["dataset"] = params.dataset;
+        // Aucun index secondaire : toute lecture est un parcours complet
+        (*plan)["access"] = {{"method", "fullScan"}, {"storage", scan.storage}, {"rows", scan.rows},
+                             {"partitions", parallel ? scan.partitions : 1}};
+        if (scan.runs > 0)
+            (*plan)["access"]["runs"] = scan.runs;
+        (*plan)["pushdown"] = {{"where", !params.conditions.empty()},
+                               {"limit", !distinct && !aggregated && !grouped && !sorted && params.limit > 0},
+                               {"topK", sorted && params.limit > 0},
+                               {"aggregation", aggregated},
+                               {"cursor", params.hasCursor}};
+        if (params.hasCursor)
+            (*plan)["access"]["from"] = params.cursor.row;
+        double fraction;
+        bool estimated = false;
+        datasetObj->statistics([&](const RoktDatasetStats &stats) { estimated = stats.selectivity(params.conditions, &fraction); });
+        if (estimated) {
+            double rows = fraction * static_cast<double>(scan.rows);
+            if (!aggregated && !grouped && params.limit > 0)
+                rows = std::min(rows, static_cast<double>(params.limit));
+            (*plan)["estimatedRows"] = static_cast<uint64_t>(rows + 0.5);
+        }
+        // DISTINCT : nombre de valeurs distinctes estimé par les statistiques de la colonne
+        if (distinct && params.conditions.empty()) {
+            datasetObj->statistics([&](const RoktDatasetStats &stats) {
+                const RoktColumnStats *column = stats.column(params.fields);
+                if (column != nullptr)
+                    (*plan)["estimatedRows"] = column->distinct.estimate();
+            });
+        }
+        (*plan)["operators"] = operators;
+        return true;
+    }
+
+    std::unique_ptr<ROKT::ResponseObject>handle(const RoktCommand &command) override {
+        if (command.getKind() != RoktCommand::Kind::GET)
             return CommandHandler::handle(command);
-        try {
-            GetParams params;
-            if(!parseCommand(command, &params)) {
-                return CommandHandler::handle(command);
+        return run(command.as<RoktGetQuery>());
+    }
+
+private:
+    // Version des données lues ; avec JOIN, la plus récente des deux (horloge commune aux datasets).
+    // Une réponse par blocs n'est jamais mise en cache.
+    bool queryVersion(const RoktGetQuery &params, uint64_t *version) {
+        if (params.stream || !this->service->version(params.dataset, version))
+            return false;
+        uint64_t joined;
+        if (params.joinDataset.empty())
+            return true;
+        if (!this->service->version(params.joinDataset, &joined))
+            return false;
+        *version = std::max(*version, joined);
+        return true;
+    }
+
+    bool explainJoin(const RoktGetQuery &params, nlohmann::json *plan, std::string *error) {
+        JoinSide left;
+        JoinSide right;
+        std::vector<Condition> residual;
+        if (!planJoin(params, &left, &right, &residual, error))
+            return false;
+        bool buildLeft = left.rows < right.rows;
+        const JoinSide &build = buildLeft ? left : right;
+        const JoinSide &probe = buildLeft ? right : left;
+        auto side = [](const JoinSide &s) {
+            return nlohmann::json{{"dataset", s.name}, {"field", s.field}, {"rows", s.rows}, {"where", !s.where.empty()}};
+        };
+        nlohmann::json operators = nlohmann::json::array({"scan", "join.build", "join.probe"});
+        if (!residual.empty())
+            operators.push_back("filter");
+        if (!params.orderByKey.empty())
+            operators.push_back("sort");
+        operators.push_back("project");
+        if (!params.alias.empty())
+            operators.push_back("alias");
+        operators.push_back("serialize");
+
+        (*plan)["command"] = "GET";
+        (*plan)["dataset"] = params.dataset;
+        // Aucun index secondaire : le plus petit côté (d'après les statistiques) est haché
+        (*plan)["access"] = {{"method", "hashJoin"}, {"build", side(build)}, {"probe", side(probe)}};
+        (*plan)["pushdown"] = {{"where", residual.empty() && !params.conditions.empty()},
+                               {"limit", params.orderByKey.empty() && params.limit > 0}};
+        (*plan)["operators"] = operators;
+        return true;
+    }
+
+    // Exécute une commande GET déjà analysée
+    std::unique_ptr<ROKT::ResponseObject> run(const RoktGetQuery &params) {
+        // La réponse par blocs n'est ouverte qu'une fois la requête validée : une requête refusée
+        // reçoit la réponse d'erreur seule
+        ResponseStream *stream = streamFor(params);
+        if (params.offset > 0 && (!params.aggregates.empty() || !params.groupByKey.empty()))
+            return ROKT::ResponseService::response(1, "OFFSET n'est pas accepté avec GROUP BY ou des agrégats.");
+        if (params.hasCursor && (params.distinct || !params.aggregates.empty() || !params.groupByKey.empty() ||
+                                 !params.orderByKey.empty() || !params.joinDataset.empty()))
+            return ROKT::ResponseService::response(1, "CURSOR n'est accepté que sans ORDER BY, GROUP BY, DISTINCT, JOIN ni agrégats.");
+        if (!params.joinDataset.empty()) {
+            try {
+                return runJoin(params);
+            } catch (std::exception &e) {
+                return ROKT::ResponseService::response(1, std::string("Erreur de traitement de la commande GET: ") + e.what());
             }
+        }
+        try {
             int ignoredCount = 0;
             // Récupérer l'objet complet du dataset
             std::shared_ptr<RoktDataset> datasetObj;
             if(this->service->from(params.dataset, datasetObj)->hasError()) {
                     return ROKT::ResponseService::response(1, "Can't get dataset");
             }
-            auto fullData = datasetObj->select({"*"});
-            auto data = fullData;
-            // Appliquer les conditions si présentes
-            if (!params.conditions.empty()) {
-
-                if(!data.where("", "==", "dummy", &data))  // On ignore le where() existant
+            if (params.distinct && (!params.groupByKey.empty() || (!params.orderByKey.empty() && params.orderByKey != params.fields)))
+                return ROKT::ResponseService::response(1, "Avec DISTINCT, ORDER BY ne peut porter que sur le champ distinct et GROUP BY n'est pas accepté.");
+            // Le curseur porte la version des lignes existantes : un ajout en fin de dataset ne
+            // décale pas les rangs et le laisse valide
+            uint64_t version = 0;
+            this->service->version(params.dataset, &version, true);
+            if (params.hasCursor && params.cursor.version != version)
+                return ROKT::ResponseService::response(1, GET_CURSOR_EXPIRED);
+            if (stream != nullptr)
+                stream->open();
+            // Parcours du dataset : le WHERE est évalué sur les lignes stockées et seules les
+            // lignes retenues sont converties. Sans GROUP BY ni ORDER BY, la projection et le
+            // LIMIT sont appliqués au fil du parcours, qui s'arrête dès que LIMIT est atteint.
+            // Les documents intermédiaires (lignes retenues, groupes, projections) sont alloués
+            // dans l'arène de la requête et libérés en bloc à la fin du traitement.
+            ROKT::ArenaJson result = ROKT::ArenaJson::array();
+            bool scanned;
+            // Sous PROFILE, chaque opérateur est mesuré (ligne par ligne pour ceux du parcours)
+            if (params.distinct) {
+                // DISTINCT : ensemble des valeurs déjà vues par partition, seules les nouvelles
+                // valeurs sont converties
+                RoktDistinct distinct(params.fields, datasetObj->maxScanPartitions());
+                {
+                    QueryProfile::Counter counter("distinct", datasetObj->maxScanPartitions());
+                    scanned = datasetObj->scanRows(params.conditions, datasetObj->maxScanPartitions(), [&](const RoktScanRow &row) {
+                        return counter.measure(row.partition, [&]() { return distinct.offer(row); });
+                    });
+                }
+                if (scanned) {
+                    QueryProfile::Timer merge("distinct.merge");
+                    result = distinct.finish();
+                    merge.setRows(0, result.size());
+                    if (!params.orderByKey.empty())
+                        result = sortValues(result, params.orderDesc);
+                    applyOffsetLimit(result, params);
+                }
+            } else if (!params.aggregates.empty()) {
+                // Agrégats : seuls les accumulateurs de chaque groupe sont conservés
+                RoktAggregator aggregator(params.aggregates, params.groupByKey, datasetObj->maxScanPartitions());
+                {
+                    QueryProfile::Counter aggregate("aggregate", datasetObj->maxScanPartitions());
+                    scanned = datasetObj->scanRows(params.conditions, datasetObj->maxScanPartitions(), [&](const RoktScanRow &row) {
+                        return aggregate.measure(row.partition, [&]() { return aggregator.offer(row); });
+                    });
+                }
+                if (scanned) {
+                    QueryProfile::Timer merge("aggregate.merge");
+                    result = aggregator.finish();
+                    merge.setRows(0, result.size());
+                }
+            } else if (!params.groupByKey.empty()) {
+                scanned = datasetObj->scan<ROKT::ArenaJson>(params.conditions, [&](ROKT::ArenaJson &row) {
+                    result.push_back(std::move(row));
+                    return true;
+                });
+                // GROUP BY renvoie un objet : ORDER BY, LIMIT et la projection ne s'appliquent pas
+                if (scanned) {
+                    QueryProfile::Timer group("group");
+                    size_t rows = result.size();
+                    result = groupBy(result, params.groupByKey);
+                    group.setRows(rows, result.size());
+                }
+            } else if (!params.orderByKey.empty()) {
+                // ORDER BY [LIMIT] : tas borné par partition du parcours (parallèle si possible)
+                // Avec OFFSET, le tas garde aussi les lignes des pages précédentes
+                RoktTopK topK(params.orderByKey, params.orderDesc, params.limit > 0 ? params.limit + params.offset : 0,
+                              datasetObj->maxScanPartitions());
                 {
-                    // Ca n'a pas marche
-                    return ROKT::ResponseService::response(3, "Where failed");
+                    QueryProfile::Counter sort("sort", datasetObj->maxScanPartitions());
+                    scanned = datasetObj->scanRows(params.conditions, datasetObj->maxScanPartitions(), [&](const RoktScanRow &row) {
+                        return sort.measure(row.partition, [&]() { return topK.offer(row); });
+                    });
                 }
-                // Nous filtrons manuellement avec evaluateConditions
-                nlohmann::json filtered = nlohmann::json::array();
-                for (auto &item : fullData.raw()) {
-                    bool cond;
-                    if(!evaluateConditions(item, params.conditions, &cond)) {
-                        return ROKT::ResponseService::response(3, "Can't verify condition");
+                if (scanned) {
+                    {
+                        QueryProfile::Timer merge("sort.merge");
+                        result = topK.finish(&ignoredCount);
+                        applyOffsetLimit(result, params);
+                        merge.setRows(0, result.size());
+                    }
+                    if (params.fields != "*") {
+                        QueryProfile::Timer project("project");
+                        result = applyProjection(result, params.fields);
+                        project.setRows(result.size(), result.size());
                     }
-                    if (cond)
-                        filtered.push_back(item);
                 }
-                data = RoktData(filtered);
-            }
-            nlohmann::json result = data.raw();
-            // Appliquer GROUP BY si présent
-            if (!params.groupByKey.empty()) {
-                result = groupBy(result, params.groupByKey);
-            }
-            // Appliquer ORDER BY si présent (uniquement sur tableaux)
-            if (result.is_array() && !params.orderByKey.empty()) {
-                result = orderBy(result, params.orderByKey, params.orderDesc, ignoredCount);
-            }
-            // Appliquer LIMIT si présent
-            if (result.is_array() && params.limit > 0)
-                result = applyLimit(result, params.limit);
-            // Appliquer la projection si nécessaire (si fields n'est pas "*" et sans GROUP BY)
-            if (params.fields != "*" && params.groupByKey.empty() && result.is_array())
-                result = applyProjection(result, params.fields);
-            // Appliquer l'alias si spécifié
-            if (!params.alias.empty() && result.is_array())
-                result = applyAlias(result, params.alias);
-            
-            // Construction finale de la réponse en fonction de la logique "never nester"
-            bool extraClauseUsed = (!params.conditions.empty() || !params.groupByKey.empty() ||
-                                      !params.orderByKey.empty() || params.limit != -1 || !params.alias.empty());
-            nlohmann::json responseObj;
-            if (extraClauseUsed) {
-                responseObj["result"] = result;
-                if (ignoredCount != 0)
-                    responseObj["ignored"] = ignoredCount;
             } else {
-                responseObj = result;
+                // Parcours dans l'ordre du dataset, repris au rang du curseur s'il y en a un. Une
+                // page complète renvoie le curseur de la ligne qui suit sa dernière ligne.
+                int skipped = 0;
+                int matchedCount = 0;
+                RoktScanCursor next{version, 0};
+                QueryProfile::Counter materialize("materialize", 1);
+                QueryProfile::Counter project("project", 1);
+                // Avec STREAM, les lignes du bloc en cours sont allouées hors de l'arène (qui ne
+                // rend sa mémoire qu'à la fin de la requête) et libérées à l'envoi du bloc
+                nlohmann::json streamed = nlohmann::json::array();
+                auto emit = [&](auto &out, const RoktScanRow &scanned) {
+                    using Json = std::decay_t<decltype(out)>;
+                    Json row;
+                    materialize.measure(0, [&]() {
+                        row = scanned.store.materialize<Json>(scanned.row);
+                        return true;
+                    });
+                    project.measure(0, [&]() {
+                        projectInto(out, row, params.fields);
+                        return true;
+                    });
+                };
+                scanned = datasetObj->scanRows(params.conditions, 1, [&](const RoktScanRow &scanned) {
+                    if (skipped < params.offset) {
+                        skipped++;
+                        return true;
+                    }
+                    matchedCount++;
+                    next.row = scanned.sequence + 1;
+                    if (stream == nullptr) {
+                        emit(result, scanned);
+                    } else {
+                        emit(streamed, scanned);
+                        if (streamed.size() >= batchRows(params) && !flush(stream, streamed, params))
+                            return false;
+                    }
+                    return !(params.limit > 0 && matchedCount >= params.limit);
+                }, params.hasCursor ? params.cursor.row : 0);
+                if (scanned && !streamed.empty())
+                    flush(stream, streamed, params);
+                // Une modification pendant la lecture rend le curseur reçu comme celui renvoyé caducs
+                uint64_t after = 0;
+                this->service->version(params.dataset, &after, true);
+                if (scanned && params.hasCursor && after != version)
+                    return ROKT::ResponseService::response(1, GET_CURSOR_EXPIRED);
+                if (scanned && params.limit > 0 && matchedCount >= params.limit)
+                    return respond(params, result, ignoredCount, next.encode());
+            }
+            if (!scanned) {
+                return ROKT::ResponseService::response(3, datasetObj->getLastError());
             }
-            return ROKT::ResponseService::response(0, "OK", responseObj.dump(4));
+            return respond(params, result, ignoredCount);
         } catch (std::exception &e) {
             return ROKT::ResponseService::response(1, std::string("Erreur de traitement de la commande GET: ") + e.what());
         }
     }
+
+    // Flux de la réponse si elle est demandée par blocs (STREAM) et que la connexion le permet
+    static ResponseStream *streamFor(const RoktGetQuery &params) {
+        return params.stream ? ResponseStream::current() : nullptr;
+    }
+
+    static size_t batchRows(const RoktGetQuery &params) {
+        return params.streamBatch > 0 ? static_cast<size_t>(params.streamBatch) : STREAM_DEFAULT_BATCH_ROWS;
+    }
+
+    // Envoie les lignes accumulées (alias appliqué) dans un bloc, puis vide `batch`
+    template <typename BasicJsonType>
+    bool flush(ResponseStream *stream, BasicJsonType &batch, const RoktGetQuery &params) {
+        size_t rows = batch.size();
+        std::string chunk;
+        {
+            QueryProfile::Timer serialize("serialize");
+            if (params.alias.empty()) {
+                chunk = ResponseEncoding::encodeRows(batch);
+            } else {
+                BasicJsonType aliased = applyAlias(batch, params.alias);
+                chunk = ResponseEncoding::encodeRows(aliased);
+            }
+            serialize.addBytes(chunk.size());
+            serialize.setRows(rows, rows);
+        }
+        // Le tableau garde sa capacité : les blocs suivants ne le réallouent pas
+        batch.clear();
+        return stream->write(chunk, rows);
+    }
+
+    // Fin d'une réponse par blocs : lignes restantes, puis résumé renvoyé après le bloc final
+    std::unique_ptr<ROKT::ResponseObject> finishStream(ResponseStream *stream, const RoktGetQuery &params, ROKT::ArenaJson &result,
+                                                       int ignoredCount, const std::string &cursor) {
+        if (result.is_array()) {
+            ROKT::ArenaJson batch = ROKT::ArenaJson::array();
+            for (auto &row : result) {
+                batch.push_back(std::move(row));
+                if (batch.size() >= batchRows(params) && !flush(stream, batch, params))
+                    break;
+            }
+            if (!batch.empty())
+                flush(stream, batch, params);
+        } else {
+            // GROUP BY et agrégats : un seul objet
+            stream->write(ResponseEncoding::encode(result), 1);
+        }
+        if (stream->hasFailed())
+            return ROKT::ResponseService::response(1, "Envoi interrompu");
+        nlohmann::json summary;
+        summary["rows"] = stream->getRows();
+        if (ignoredCount != 0)
+            summary["ignored"] = ignoredCount;
+        if (!cursor.empty())
+            summary["cursor"] = cursor;
+        return ROKT::ResponseService::response(0, "OK", summary.dump());
+    }
+
+    // Applique l'alias puis construit la réponse ; `cursor` est le jeton de la page suivante
+    std::unique_ptr<ROKT::ResponseObject> respond(const RoktGetQuery &params, ROKT::ArenaJson &result, int ignoredCount,
+                                                  const std::string &cursor = std::string()) {
+        ResponseStream *stream = streamFor(params);
+        if (stream != nullptr)
+            return finishStream(stream, params, result, ignoredCount, cursor);
+        // Appliquer l'alias si spécifié
+        if (!params.alias.empty() && result.is_array()) {
+            QueryProfile::Timer alias("alias");
+            result = applyAlias(result, params.alias);
+        }
+
+        // Construction finale de la réponse en fonction de la logique "never nester"
+        bool extraClauseUsed = (!params.conditions.empty() || !params.groupByKey.empty() || !params.joinDataset.empty() ||
+                                  !params.orderByKey.empty() || params.limit != -1 || !params.alias.empty() ||
+                                  params.offset != 0 || params.hasCursor);
+        ROKT::ArenaJson responseObj;
+        if (extraClauseUsed) {
+            responseObj["result"] = std::move(result);
+            if (ignoredCount != 0)
+                responseObj["ignored"] = ignoredCount;
+            if (!cursor.empty())
+                responseObj["cursor"] = cursor;
+        } else {
+            responseObj = std::move(result);
+        }
+        // Données encodées directement dans le format de la connexion (JSON indenté par défaut)
+        QueryProfile::Timer serialize("serialize");
+        std::string datas = ResponseEncoding::encode(responseObj);
+        serialize.addBytes(datas.size());
+        auto response = ROKT::ResponseService::response(0, "OK", datas);
+        response->setDatasEncoded(true);
+        return response;
+    }
+
+    // Côté d'une jointure : son dataset, son champ de jointure et les conditions du WHERE qui ne
+    // portent que sur lui (évaluées pendant son parcours)
+    struct JoinSide {
+        std::string name;
+        std::string field;
+        std::shared_ptr<RoktDataset> dataset;
+        std::vector<Condition> where;
+        uint64_t rows = 0;
+    };
+
+    // Champ qualifié "<dataset>.<champ>" : renvoie le champ sans son préfixe s'il désigne ce côté
+    static bool unqualify(const std::string &field, const JoinSide &side, std::string *out) {
+        if (field.size() <= side.name.size() + 1 || field.compare(0, side.name.size(), side.name) != 0 || field[side.name.size()] != '.')
+            return false;
+        *out = field.substr(side.name.size() + 1);
+        return true;
+    }
+
+    // Prépare les deux côtés d'une jointure et les conditions à évaluer sur les lignes jointes
+    bool planJoin(const RoktGetQuery &params, JoinSide *left, JoinSide *right, std::vector<Condition> *residual, std::string *error) {
+        if (!params.aggregates.empty() || !params.groupByKey.empty() || params.distinct) {
+            *error = "GROUP BY, DISTINCT et agrégats ne sont pas supportés avec JOIN.";
+            return false;
+        }
+        left->name = params.dataset;
+        right->name = params.joinDataset;
+        if (left->name == right->name) {
+            *error = "Un dataset ne peut pas être joint à lui-même.";
+            return false;
+        }
+        if (this->service->from(left->name, left->dataset)->hasError() || this->service->from(right->name, right->dataset)->hasError()) {
+            *error = "Can't get dataset";
+            return false;
+        }
+        // Les deux champs de la condition peuvent être écrits dans un ordre quelconque
+        bool direct = unqualify(params.joinLeft, *left, &left->field) && unqualify(params.joinRight, *right, &right->field);
+        if (!direct && !(unqualify(params.joinRight, *left, &left->field) && unqualify(params.joinLeft, *right, &right->field))) {
+            *error = "Condition de jointure invalide, attendu '" + left->name + ".<champ> = " + right->name + ".<champ>'.";
+            return false;
+        }
+        // Un WHERE fait uniquement de AND est réparti entre les deux parcours ; sinon il est
+        // évalué sur les lignes jointes
+        bool conjunctive = std::all_of(params.conditions.begin(), params.conditions.end(),
+                                       [](const Condition &cond) { return cond.logic.empty() || cond.logic == "AND"; });
+        for (const auto &cond : params.conditions) {
+            Condition pushed = cond;
+            pushed.logic = "AND";
+            bool onLeft = unqualify(cond.field, *left, &pushed.field);
+            if (!onLeft && !unqualify(cond.field, *right, &pushed.field)) {
+                *error = "Champ non qualifié dans WHERE : " + cond.field + " (attendu '<dataset>.<champ>').";
+                return false;
+            }
+            if (!conjunctive)
+                continue;
+            std::vector<Condition> &where = onLeft ? left->where : right->where;
+            if (where.empty())
+                pushed.logic.clear();
+            where.push_back(pushed);
+        }
+        if (!conjunctive)
+            *residual = params.conditions;
+        left->dataset->statistics([&](const RoktDatasetStats &stats) { left->rows = stats.getRowCount(); });
+        right->dataset->statistics([&](const RoktDatasetStats &stats) { right->rows = stats.getRowCount(); });
+        return true;
+    }
+
+    // Exécute un GET ... JOIN : table de hachage sur le plus petit dataset, parcours en flux de l'autre
+    std::unique_ptr<ROKT::ResponseObject> runJoin(const RoktGetQuery &params) {
+        JoinSide left;
+        JoinSide right;
+        std::vector<Condition> residual;
+        std::string error;
+        if (!planJoin(params, &left, &right, &residual, &error))
+            return ROKT::ResponseService::response(1, error);
+        ResponseStream *stream = streamFor(params);
+        if (stream != nullptr)
+            stream->open();
+        bool buildLeft = left.rows < right.rows;
+        JoinSide &build = buildLeft ? left : right;
+        JoinSide &probe = buildLeft ? right : left;
+
+        RoktHashJoin join(build.field, probe.field);
+        bool scanned;
+        {
+            QueryProfile::Counter counter("join.build", 1);
+            scanned = build.dataset->scanRows(build.where, 1, [&](const RoktScanRow &row) {
+                return counter.measure(0, [&]() { return join.build(row); });
+            });
+        }
+        if (!scanned)
+            return ROKT::ResponseService::response(3, build.dataset->getLastError());
+
+        // Sans ORDER BY, la projection et le LIMIT (et l'envoi par blocs) sont appliqués au fil du parcours
+        bool sorted = !params.orderByKey.empty();
+        ROKT::ArenaJson result = ROKT::ArenaJson::array();
+        // Bloc en cours d'un STREAM sans ORDER BY, alloué hors de l'arène comme pour un GET simple
+        nlohmann::json streamed = nlohmann::json::array();
+        int skipped = 0;
+        int matchedCount = 0;
+        bool conditionFailed = false;
+        // Ajoute à `out` les lignes jointes de `row` ; renvoie false pour arrêter le parcours
+        auto emit = [&](auto &out, const RoktScanRow &row, const std::vector<ROKT::ArenaJson> &matches) {
+            using Json = std::decay_t<decltype(out)>;
+            Json probed = row.store.materialize<Json>(row.row);
+            for (const auto &built : matches) {
+                Json joined = Json::object();
+                joined[left.name] = buildLeft ? Json(built) : probed;
+                joined[right.name] = buildLeft ? probed : Json(built);
+                bool keep = true;
+                if (!evaluateConditions(joined, residual, &keep)) {
+                    conditionFailed = true;
+                    return false;
+                }
+                if (!keep)
+                    continue;
+                if (!sorted && skipped < params.offset) {
+                    skipped++;
+                    continue;
+                }
+                matchedCount++;
+                if (sorted)
+                    out.push_back(std::move(joined));
+                else
+                    projectInto(out, joined, params.fields);
+                if (!sorted && stream != nullptr && out.size() >= batchRows(params) && !flush(stream, out, params))
+                    return false;
+                if (!sorted && params.limit > 0 && matchedCount >= params.limit)
+                    return false;
+            }
+            return true;
+        };
+        {
+            QueryProfile::Counter counter("join.probe", 1);
+            scanned = probe.dataset->scanRows(probe.where, 1, [&](const RoktScanRow &row) {
+                const std::vector<ROKT::ArenaJson> *matches = nullptr;
+                counter.measure(0, [&]() {
+                    matches = join.probe(row);
+                    return matches != nullptr;
+                });
+                if (matches == nullptr)
+                    return true;
+                if (stream != nullptr && !sorted)
+                    return emit(streamed, row, *matches);
+                return emit(result, row, *matches);
+            });
+        }
+        if (scanned && !streamed.empty())
+            flush(stream, streamed, params);
+        if (!scanned)
+            return ROKT::ResponseService::response(3, probe.dataset->getLastError());
+        if (conditionFailed)
+            return ROKT::ResponseService::response(3, "Can't verify condition");
+
+        int ignoredCount = 0;
+        if (sorted) {
+            QueryProfile::Timer sort("sort");
+            result = sortJoined(result, params, &ignoredCount);
+            sort.setRows(matchedCount, result.size());
+            result = applyProjection(result, params.fields);
+        }
+        return respond(params, result, ignoredCount);
+    }
+
+    // Retire les OFFSET premières lignes d'un résultat complet, puis applique LIMIT
+    static void applyOffsetLimit(ROKT::ArenaJson &rows, const RoktGetQuery &params) {
+        size_t offset = std::min(rows.size(), static_cast<size_t>(params.offset));
+        rows.erase(rows.begin(), rows.begin() + offset);
+        if (params.limit > 0 && rows.size() > static_cast<size_t>(params.limit))
+            rows.erase(rows.begin() + params.limit, rows.end());
+    }
+
+    // Trie des valeurs scalaires (ORDER BY d'un DISTINCT)
+    ROKT::ArenaJson sortValues(ROKT::ArenaJson &values, bool desc) {
+        std::vector<std::pair<RoktSortKey, size_t>> keys;
+        for (size_t i = 0; i < values.size(); i++)
+            keys.emplace_back(RoktSortKey::fromJson(values[i]), i);
+        std::stable_sort(keys.begin(), keys.end(), [&](const auto &a, const auto &b) {
+            return desc ? RoktSortKey::less(b.first, a.first) : RoktSortKey::less(a.first, b.first);
+        });
+        ROKT::ArenaJson sorted = ROKT::ArenaJson::array();
+        for (const auto &key : keys)
+            sorted.push_back(std::move(values[key.second]));
+        return sorted;
+    }
+
+    // ORDER BY [LIMIT] sur les lignes jointes ; les lignes sans valeur de tri sont ignorées
+    ROKT::ArenaJson sortJoined(ROKT::ArenaJson &rows, const RoktGetQuery &params, int *ignoredCount) {
+        std::vector<std::pair<RoktSortKey, size_t>> keys;
+        for (size_t i = 0; i < rows.size(); i++) {
+            const ROKT::ArenaJson *value = findNestedValue(rows[i], params.orderByKey);
+            if (value == nullptr || value->is_null()) {
+                (*ignoredCount)++;
+                continue;
+            }
+            keys.emplace_back(RoktSortKey::fromJson(*value), i);
+        }
+        std::stable_sort(keys.begin(), keys.end(), [&](const auto &a, const auto &b) {
+            return params.orderDesc ? RoktSortKey::less(b.first, a.first) : RoktSortKey::less(a.first, b.first);
+        });
+        ROKT::ArenaJson sorted = ROKT::ArenaJson::array();
+        for (const auto &key : keys)
+            sorted.push_back(std::move(rows[key.second]));
+        applyOffsetLimit(sorted, params);
+        return sorted;
+    }
 };
 
 #endif // GET_COMMAND_HANDLER_H
@@ -0,0 +1,59 @@
+#ifndef PREPARE_COMMAND_HANDLER_H
+#define PREPARE_COMMAND_HANDLER_H
+
+#include "CommandHandler.h"
+#include "PreparedStatements.h"
+#include "RoktResponseService.h"
+#include "RoktService.h"
+#include "RoktCommand.h"
+#include <nlohmann/json.hpp>
+
+/**
+ * @brief PrepareCommandHandler traite les commandes PREPARE et DEALLOCATE.
+ *
+ * Syntaxe attendue :
+ *   PREPARE <nom> AS <commande>;    ex. PREPARE byId AS GET * IN users WHERE id IS ?;
+ *   DEALLOCATE <nom>;
+ *
+ * La commande est analysée une seule fois et son plan construit par son handler (GET, COUNT,
+ * CHANGE, REMOVE) ; chaque '?' est un paramètre lié par EXECUTE. Préparer à nouveau un nom remplace
+ * la requête existante. La réponse indique le nombre de paramètres attendus.
+ */
+class PrepareCommandHandler : public CommandHandler {
+private:
+    PreparedStatements *statements;
+
+public:
+    PrepareCommandHandler(RoktService *service, PreparedStatements *statements) : CommandHandler(service), statements(statements) {}
+    virtual std::unique_ptr<ROKT::ResponseObject> handle(const RoktCommand &command) override {
+        if (command.getKind() == RoktCommand::Kind::DEALLOCATE) {
+            const std::string &name = command.as<RoktPrepareQuery>().name;
+            if (!statements->remove(name))
+                return ROKT::ResponseService::response(1, "Requête préparée inconnue : " + name);
+            return ROKT::ResponseService::response(0);
+        }
+        if (command.getKind() != RoktCommand::Kind::PREPARE)
+            return CommandHandler::handle(command);
+
+        const RoktPrepareQuery &query = command.as<RoktPrepareQuery>();
+        const RoktCommand &inner = *query.inner;
+        CommandHandler *handler = statements->handlerFor(inner.getKind());
+        if (handler == nullptr)
+            return ROKT::ResponseService::response(423, "Commande non préparable : " + std::string(inner.getKeyword()));
+
+        std::string error;
+        std::shared_ptr<PreparedPlan> plan = handler->prepare(inner, &error);
+        if (!plan)
+            return ROKT::ResponseService::response(423, error);
+        plan->command = inner.getSource();
+        plan->kind = inner.getKind();
+        if (!statements->add(query.name, PreparedStatements::Statement{handler, plan}))
+            return ROKT::ResponseService::response(1, "Trop de requêtes préparées");
+
+        nlohmann::json resp;
+        resp["parameters"] = plan->parameterCount;
+        return ROKT::ResponseService::response(0, "OK", resp.dump());
+    }
+};
+
+#endif // PREPARE_COMMAND_HANDLER_H
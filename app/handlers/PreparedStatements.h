@@ -0,0 +1,68 @@
+#ifndef PREPARED_STATEMENTS_H
+#define PREPARED_STATEMENTS_H
+
+#include "CommandHandler.h"
+#include "RoktCommand.h"
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+#define MAX_PREPARED_STATEMENTS 1024  // Nombre maximal de requêtes préparées conservées
+
+/**
+ * @brief Requêtes préparées du serveur, partagées par toutes les connexions.
+ *
+ * Chaque connexion ne porte qu'une commande : les requêtes sont donc enregistrées pour tout le
+ * serveur, sous le nom donné par PREPARE. Une requête conserve le handler qui l'exécutera et son
+ * plan, analysé une seule fois.
+ */
+class PreparedStatements {
+public:
+    struct Statement {
+        CommandHandler *handler = nullptr;
+        std::shared_ptr<const PreparedPlan> plan;
+    };
+
+private:
+    std::shared_mutex mutex;
+    std::unordered_map<std::string, Statement> statements;
+    std::unordered_map<RoktCommand::Kind, CommandHandler *> handlers;  // handlers des commandes préparables
+
+public:
+    // Enregistre le handler d'un type de commande (au démarrage, avant le traitement des requêtes)
+    void addHandler(RoktCommand::Kind kind, CommandHandler *handler) {
+        handlers[kind] = handler;
+    }
+
+    CommandHandler *handlerFor(RoktCommand::Kind kind) const {
+        auto it = handlers.find(kind);
+        return it == handlers.end() ? nullptr : it->second;
+    }
+
+    // Ajoute ou remplace la requête `name` ; renvoie false si la limite est atteinte
+    bool add(const std::string &name, const Statement &statement) {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        if (statements.size() >= MAX_PREPARED_STATEMENTS && statements.find(name) == statements.end())
+            return false;
+        statements[name] = statement;
+        return true;
+    }
+
+    bool find(const std::string &name, Statement *statement) {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = statements.find(name);
+        if (it == statements.end())
+            return false;
+        *statement = it->second;
+        return true;
+    }
+
+    bool remove(const std::string &name) {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        return statements.erase(name) > 0;
+    }
+};
+
+#endif // PREPARED_STATEMENTS_H
@@ -0,0 +1,63 @@
+#ifndef STATS_COMMAND_HANDLER_H
+#define STATS_COMMAND_HANDLER_H
+
+#include "CommandHandler.h"
+#include "RoktResponseService.h"
+#include "RoktService.h"
+#include "ResultCache.h"
+#include "SingleFlight.h"
+#include "ResponseCompression.h"
+#include "RoktCommand.h"
+#include <nlohmann/json.hpp>
+
+/**
+ * @brief StatsCommandHandler renvoie les compteurs du serveur.
+ *
+ * Syntaxe attendue :
+ *   STATS;
+ *
+ * Réponse : {"cache": {"hits", "misses", "entries", "bytes", "maxBytes"},
+ *            "singleFlight": {"executions", "coalesced"},
+ *            "compression": {"minBytes", "level", "responses", "compressed", "bytesIn", "bytesOut",
+ *                            "ratio", "cpuMs", "nsPerByte"}}.
+ * nsPerByte (temps CPU de compression par octet non compressé) et ratio (octets envoyés par
+ * octet de réponse) servent à régler le seuil et le niveau de compression.
+ */
+class StatsCommandHandler : public CommandHandler {
+private:
+    ResultCache *resultCache;
+    SingleFlight *singleFlight;
+    ResponseCompression *compression;
+public:
+    StatsCommandHandler(RoktService *service, ResultCache *resultCache, SingleFlight *singleFlight, ResponseCompression *compression)
+        : CommandHandler(service), resultCache(resultCache), singleFlight(singleFlight), compression(compression) {}
+    virtual std::unique_ptr<ROKT::ResponseObject> handle(const RoktCommand &command) override {
+        if (command.getKind() != RoktCommand::Kind::STATS)
+            return CommandHandler::handle(command);
+
+        nlohmann::json stats;
+        stats["cache"]["hits"] = resultCache->getHits();
+        stats["cache"]["misses"] = resultCache->getMisses();
+        stats["cache"]["entries"] = resultCache->getEntryCount();
+        stats["cache"]["bytes"] = resultCache->getBytes();
+        stats["cache"]["maxBytes"] = resultCache->getMaxBytes();
+        stats["singleFlight"]["executions"] = singleFlight->getExecutions();
+        stats["singleFlight"]["coalesced"] = singleFlight->getCoalesced();
+        uint64_t bytesIn = compression->getBytesIn();
+        uint64_t bytesOut = compression->getBytesOut();
+        uint64_t cpuNs = compression->getCpuNs();
+        nlohmann::json &cmp = stats["compression"];
+        cmp["minBytes"] = compression->getMinBytes();
+        cmp["level"] = compression->getLevel();
+        cmp["responses"] = compression->getResponses();
+        cmp["compressed"] = compression->getCompressed();
+        cmp["bytesIn"] = bytesIn;
+        cmp["bytesOut"] = bytesOut;
+        cmp["ratio"] = bytesIn > 0 ? static_cast<double>(bytesOut) / static_cast<double>(bytesIn) : 0.0;
+        cmp["cpuMs"] = static_cast<double>(cpuNs) / 1e6;
+        cmp["nsPerByte"] = bytesIn > 0 ? static_cast<double>(cpuNs) / static_cast<double>(bytesIn) : 0.0;
+        return ROKT::ResponseService::response(0, "OK", stats.dump());
+    }
+};
+
+#endif // STATS_COMMAND_HANDLER_H
@@ -0,0 +1,85 @@
+#ifndef TRANSFER_COMMAND_HANDLER_H
+#define TRANSFER_COMMAND_HANDLER_H
+
+#include "CommandHandler.h"
+#include "RoktResponseService.h"
+#include "RoktDataset.h"
+#include "RoktService.h"
+#include "RoktCommand.h"
+#include "RoktTransfer.h"
+#include "QueryProfile.h"
+#include <string>
+#include <nlohmann/json.hpp>
+
+/**
+ * @brief TransferCommandHandler importe ou exporte un dataset depuis ou vers un fichier du serveur.
+ *
+ * Syntaxe attendue :
+ *   IMPORT <fichier> INTO <dataset> [FORMAT NDJSON|CSV];
+ *   EXPORT <dataset> TO <fichier> [FORMAT NDJSON|CSV] [WHERE ...];
+ *
+ * Les fichiers sont lus et écrits dans le répertoire d'échange de la configuration
+ * (transfer.directory) ; sans FORMAT, le format est déduit de l'extension (.csv ou NDJSON).
+ * IMPORT analyse le fichier en parallèle (threads de parcours du dataset) et écrit le dataset
+ * une fois par tranche ; les lignes invalides sont écartées et signalées :
+ * {"imported", "rejected", "bytes", "ms", "errors": [{"line", "reason"}, ...]}.
+ * EXPORT renvoie {"exported", "bytes", "ms", "file"}.
+ */
+class TransferCommandHandler : public CommandHandler {
+private:
+    std::string directory;
+
+public:
+    TransferCommandHandler(RoktService *service, const std::string &directory) : CommandHandler(service), directory(directory) {}
+
+    virtual std::unique_ptr<ROKT::ResponseObject> handle(const RoktCommand &command) override {
+        if (command.getKind() != RoktCommand::Kind::IMPORT && command.getKind() != RoktCommand::Kind::EXPORT)
+            return CommandHandler::handle(command);
+        const RoktTransferQuery &query = command.as<RoktTransferQuery>();
+        std::string path;
+        std::string error;
+        if (!RoktTransfer::resolvePath(directory, query.path, &path, &error))
+            return ROKT::ResponseService::response(1, error);
+        RoktTransfer::Format format = query.hasFormat ? query.format : RoktTransfer::formatOf(query.path);
+        bool importing = command.getKind() == RoktCommand::Kind::IMPORT;
+
+        std::shared_ptr<RoktDataset> dataset;
+        std::unique_ptr<ROKT::ResponseObject> status = this->service->from(query.dataset, dataset, importing);
+        if (status->hasError())
+            return importing ? std::move(status) : ROKT::ResponseService::response(1, "Can't get dataset");
+
+        RoktTransferResult result;
+        uint64_t start = QueryProfile::wallNow();
+        nlohmann::json summary;
+        if (importing) {
+            std::unique_ptr<ROKT::ResponseObject> failure;
+            bool imported = RoktTransfer::importFile(path, format, dataset->maxScanPartitions(), [&](std::vector<nlohmann::json> &rows) {
+                std::unique_ptr<ROKT::ResponseObject> written = dataset->insertRows(rows);
+                if (written->getStatusCode() != 2)
+                    failure = std::move(written);
+                return failure == nullptr;
+            }, &result, &error);
+            if (failure)
+                return failure;
+            if (!imported)
+                return ROKT::ResponseService::response(1, error);
+            summary["imported"] = result.rows;
+            summary["rejected"] = result.rejected;
+            summary["errors"] = result.errors;
+        } else {
+            std::unique_ptr<ROKT::ResponseObject> exported = RoktTransfer::exportDataset(*dataset, query.conditions, format, path, &result);
+            if (exported->hasError())
+                return exported;
+            summary["exported"] = result.rows;
+            summary["file"] = query.path;
+        }
+        summary["bytes"] = result.bytes;
+        summary["ms"] = static_cast<double>(QueryProfile::wallNow() - start) / 1e6;
+        // Aucune ligne importée sur un fichier qui n'en contenait que d'invalides : échec global
+        if (importing && result.rows == 0 && result.rejected > 0)
+            return ROKT::ResponseService::response(1, "Aucune ligne importée", summary.dump());
+        return ROKT::ResponseService::response(importing ? 2 : 0, importing ? "Inserted" : "OK", summary.dump());
+    }
+};
+
+#endif // TRANSFER_COMMAND_HANDLER_H
@@ -0,0 +1,56 @@
+#include "AtomicFile.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace {
+    std::runtime_error failure(const std::string &action, const std::string &path) {
+        return std::runtime_error("Impossible " + action + " " + path + " : " + std::strerror(errno));
+    }
+
+    // Synchronise le dossier contenant `path` (entrée créée ou renommée)
+    void syncDirectory(const std::string &path) {
+        size_t slash = path.find_last_of('/');
+        std::string directory = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+        int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+        if (fd < 0)
+            return;
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+
+void AtomicFile::write(const std::string &path, const std::string &data) {
+    std::string temporary = path + ATOMIC_FILE_SUFFIX;
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw failure("d'écrire", temporary);
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            std::runtime_error error = failure("d'écrire", temporary);
+            ::close(fd);
+            ::unlink(temporary.c_str());
+            throw error;
+        }
+        written += static_cast<size_t>(n);
+    }
+    if (::fsync(fd) != 0) {
+        std::runtime_error error = failure("de synchroniser", temporary);
+        ::close(fd);
+        ::unlink(temporary.c_str());
+        throw error;
+    }
+    ::close(fd);
+    if (::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::runtime_error error = failure("de renommer", temporary);
+        ::unlink(temporary.c_str());
+        throw error;
+    }
+    syncDirectory(path);
+}
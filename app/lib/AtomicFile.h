@@ -0,0 +1,23 @@
+#ifndef ATOMIC_FILE_H
+#define ATOMIC_FILE_H
+
+#include <string>
+
+#define ATOMIC_FILE_SUFFIX ".tmp"
+
+/**
+ * @brief Remplacement atomique d'un fichier.
+ *
+ * Le contenu est écrit dans un fichier temporaire voisin, synchronisé sur le disque puis renommé
+ * sur le fichier cible : après un arrêt brutal, le fichier contient soit l'ancienne version, soit
+ * la nouvelle, jamais un mélange des deux. Le dossier est synchronisé pour rendre le renommage
+ * durable avant toute opération qui en dépend (vidage du journal).
+ */
+class AtomicFile {
+public:
+    // Remplace le contenu de `path` par `data` ; lève une exception si l'écriture a échoué
+    // (le fichier cible est alors inchangé)
+    static void write(const std::string &path, const std::string &data);
+};
+
+#endif // ATOMIC_FILE_H
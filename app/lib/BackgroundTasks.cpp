@@ -0,0 +1,62 @@
+#include "BackgroundTasks.h"
+
+BackgroundTasks::~BackgroundTasks() {
+    stop();
+}
+
+void BackgroundTasks::reap() {
+    for (auto it = tasks.begin(); it != tasks.end();) {
+        if (!it->finished) {
+            ++it;
+            continue;
+        }
+        // La tâche est marquée terminée après la destruction de ses captures : le thread se
+        // termine sans reprendre le verrou
+        it->thread.join();
+        it = tasks.erase(it);
+    }
+}
+
+bool BackgroundTasks::run(const void *owner, std::function<void()> task) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stopped)
+        return false;
+    reap();
+    tasks.emplace_back();
+    Task &entry = tasks.back();
+    entry.owner = owner;
+    entry.thread = std::thread([this, &entry, task = std::move(task)]() mutable {
+        task();
+        task = nullptr;
+        std::lock_guard<std::mutex> done(mutex);
+        entry.finished = true;
+    });
+    return true;
+}
+
+void BackgroundTasks::wait(const void *owner) {
+    std::list<Task> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = tasks.begin(); it != tasks.end();) {
+            auto next = std::next(it);
+            if (it->owner == owner)
+                pending.splice(pending.end(), tasks, it);
+            it = next;
+        }
+    }
+    // Les threads sont joints hors verrou : ils le reprennent pour se déclarer terminés
+    for (auto &task : pending)
+        task.thread.join();
+}
+
+void BackgroundTasks::stop() {
+    std::list<Task> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped = true;
+        pending.splice(pending.end(), tasks);
+    }
+    for (auto &task : pending)
+        task.thread.join();
+}
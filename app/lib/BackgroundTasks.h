@@ -0,0 +1,45 @@
+#ifndef BACKGROUND_TASKS_H
+#define BACKGROUND_TASKS_H
+
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief Threads de fond du serveur (compactage des datasets), rattachés à un propriétaire.
+ *
+ * Chaque tâche s'exécute dans son propre thread, suivi jusqu'à ce qu'il soit joint : les tâches
+ * d'un propriétaire sont attendues avant sa suppression (wait), toutes les tâches à l'arrêt du
+ * serveur (stop). Les threads terminés sont joints au lancement de la tâche suivante.
+ */
+class BackgroundTasks {
+private:
+    struct Task {
+        const void *owner;
+        std::thread thread;
+        bool finished = false;
+    };
+
+    std::mutex mutex;
+    std::list<Task> tasks;
+    bool stopped = false;
+
+    // Joint les threads terminés (verrou pris)
+    void reap();
+
+public:
+    BackgroundTasks() = default;
+    BackgroundTasks(const BackgroundTasks &) = delete;
+    BackgroundTasks &operator=(const BackgroundTasks &) = delete;
+    ~BackgroundTasks();
+
+    // Lance `task` dans un thread de fond ; false après stop() (la tâche n'est pas exécutée)
+    bool run(const void *owner, std::function<void()> task);
+    // Attend la fin des tâches de `owner`
+    void wait(const void *owner);
+    // Refuse les nouvelles tâches et attend la fin de toutes les tâches en cours
+    void stop();
+};
+
+#endif // BACKGROUND_TASKS_H
@@ -17,42 +17,52 @@ struct Condition
     std::string logic; // "AND" ou "OR" (vide pour la première condition)
 };
 
-static nlohmann::json getNestedValue(const nlohmann::json &j, const std::string &compoundKey)
+// Recherche une valeur imbriquée ("details.city") sans copier les objets intermédiaires.
+// Renvoie nullptr si un des segments est absent.
+template <typename BasicJsonType>
+const BasicJsonType *findNestedValue(const BasicJsonType &j, const std::string &compoundKey)
 {
-    std::istringstream iss(compoundKey);
-    std::string token;
-    nlohmann::json current = j;
-    while (std::getline(iss, token, '.'))
+    if (compoundKey.empty())
+        return nullptr;
+    const BasicJsonType *current = &j;
+    size_t start = 0;
+    while (start < compoundKey.size())
     {
-        if (current.contains(token))
-            current = current[token];
-        else
+        size_t dot = compoundKey.find('.', start);
+        if (dot == std::string::npos)
+            dot = compoundKey.size();
+        auto it = current->find(compoundKey.substr(start, dot - start));
+        if (it == current->end())
             return nullptr;
+        current = &*it;
+        start = dot + 1;
     }
     return current;
 }
 
-static bool evaluateCondition(const nlohmann::json &item, const Condition &cond, bool *res)
+template <typename BasicJsonType>
+BasicJsonType getNestedValue(const BasicJsonType &j, const std::string &compoundKey)
 {
-    nlohmann::json fieldValue;
-    if (cond.field.find('.') != std::string::npos)
-        fieldValue = getNestedValue(item, cond.field);
-    else
-    {
-        if (item.contains(cond.field))
-            fieldValue = item[cond.field];
-        else
-            return false;
-    }
-    if (fieldValue.is_null() || fieldValue == nullptr)
+    const BasicJsonType *value = findNestedValue(j, compoundKey);
+    if (value == nullptr)
+        return nullptr;
+    return *value;
+}
+
+template <typename BasicJsonType>
+bool evaluateCondition(const BasicJsonType &item, const Condition &cond, bool *res)
+{
+    const BasicJsonType *found = findNestedValue(item, cond.field);
+    if (found == nullptr || found->is_null())
         return false;
+    const BasicJsonType &fieldValue = *found;
 
     try
     {
         double cmpVal = std::stod(cond.value);
         if (fieldValue.is_number())
         {
-            double val = fieldValue.get<double>();
+            double val = fieldValue.template get<double>();
             if (cond.op == "==")
             {
                 *res = val == cmpVal;
@@ -116,7 +126,7 @@ static bool evaluateCondition(const nlohmann::json &item, const Condition &cond,
     {
         if (fieldValue.is_string())
         {
-            std::string strVal = fieldValue.get<std::string>();
+            std::string strVal = fieldValue.template get<std::string>();
             if (cond.op == "==")
             {
                 *res = strVal == cond.value;
@@ -195,15 +205,24 @@ static bool evaluateCondition(const nlohmann::json &item, const Condition &cond,
     }
 }
 
-static bool evaluateConditions(const nlohmann::json &item, const std::vector<Condition> &conds, bool* result)
+// Évalue les conditions de gauche à droite : une condition dont le champ est absent
+// (ou dont l'opérateur ne s'applique pas) est considérée comme fausse.
+template <typename BasicJsonType>
+bool evaluateConditions(const BasicJsonType &item, const std::vector<Condition> &conds, bool* result)
 {
+    *result = true;
     if (conds.empty())
         return true;
-    *result = evaluateCondition(item, conds[0], result);
+    bool current = false;
+    if (!evaluateCondition(item, conds[0], &current))
+        current = false;
+    *result = current;
     for (size_t i = 1; i < conds.size(); i++)
     {
         const std::string &logic = conds[i].logic;
-        bool current = evaluateCondition(item, conds[i], result);
+        current = false;
+        if (!evaluateCondition(item, conds[i], &current))
+            current = false;
         if (logic == "AND")
             *result = *result && current;
         else if (logic == "OR")
@@ -35,6 +35,42 @@ Config::Config(const std::string& filename) {
             if (thr.contains("maxTaskQueueSize")) {
                 thread.maxTaskQueueSize = thr["maxTaskQueueSize"].get<int>(); // Idem pour "maxTaskQueueSize"
             }
+            if (thr.contains("scanThreads")) {
+                thread.scanThreads = thr["scanThreads"].get<int>();
+            }
+        }
+        if (json.contains("storage")) {
+            auto& sto = json["storage"];
+            if (sto.contains("maxResidentBytes")) {
+                storage.maxResidentBytes = sto["maxResidentBytes"].get<size_t>();
+            }
+            if (sto.contains("compactionRatio")) {
+                storage.compactionRatio = sto["compactionRatio"].get<double>();
+            }
+            if (sto.contains("memtableBytes")) {
+                storage.memtableBytes = sto["memtableBytes"].get<size_t>();
+            }
+        }
+        if (json.contains("cache")) {
+            auto& cch = json["cache"];
+            if (cch.contains("maxBytes")) {
+                cache.maxBytes = cch["maxBytes"].get<size_t>();
+            }
+        }
+        if (json.contains("compression")) {
+            auto& cmp = json["compression"];
+            if (cmp.contains("minBytes")) {
+                compression.minBytes = cmp["minBytes"].get<size_t>();
+            }
+            if (cmp.contains("level")) {
+                compression.level = cmp["level"].get<int>();
+            }
+        }
+        if (json.contains("transfer")) {
+            auto& trf = json["transfer"];
+            if (trf.contains("directory")) {
+                transfer.directory = trf["directory"].get<std::string>();
+            }
         }
     }
 
@@ -72,6 +108,90 @@ void Config::loadFromEnv() {
             LogService::log("Valeur de ROKT_MAX_TASK_QUEUE_SIZE invalide. Conservation de la valeur actuelle.");
         }
     }
+
+    const char* scanThreadsEnv = std::getenv("ROKT_SCAN_THREADS");
+    if (scanThreadsEnv != nullptr) {
+        int envScanThreads = std::atoi(scanThreadsEnv);
+        if (envScanThreads > 0) {
+            thread.scanThreads = envScanThreads;
+        } else {
+            LogService::log("Valeur de ROKT_SCAN_THREADS invalide. Conservation de la valeur actuelle.");
+        }
+    }
+
+    const char* residentEnv = std::getenv("ROKT_MAX_RESIDENT_BYTES");
+    if (residentEnv != nullptr) {
+        char* end = nullptr;
+        unsigned long long envResident = std::strtoull(residentEnv, &end, 10);
+        if (end != residentEnv && *end == '\0') {
+            storage.maxResidentBytes = static_cast<size_t>(envResident);
+        } else {
+            LogService::log("Valeur de ROKT_MAX_RESIDENT_BYTES invalide. Conservation de la valeur actuelle.");
+        }
+    }
+
+    const char* compactionEnv = std::getenv("ROKT_COMPACTION_RATIO");
+    if (compactionEnv != nullptr) {
+        char* end = nullptr;
+        double envCompaction = std::strtod(compactionEnv, &end);
+        if (end != compactionEnv && *end == '\0' && envCompaction >= 0) {
+            storage.compactionRatio = envCompaction;
+        } else {
+            LogService::log("Valeur de ROKT_COMPACTION_RATIO invalide. Conservation de la valeur actuelle.");
+        }
+    }
+
+    const char* memtableEnv = std::getenv("ROKT_MEMTABLE_BYTES");
+    if (memtableEnv != nullptr) {
+        char* end = nullptr;
+        unsigned long long envMemtable = std::strtoull(memtableEnv, &end, 10);
+        if (end != memtableEnv && *end == '\0') {
+            storage.memtableBytes = static_cast<size_t>(envMemtable);
+        } else {
+            LogService::log("Valeur de ROKT_MEMTABLE_BYTES invalide. Conservation de la valeur actuelle.");
+        }
+    }
+
+    const char* cacheEnv = std::getenv("ROKT_RESULT_CACHE_BYTES");
+    if (cacheEnv != nullptr) {
+        char* end = nullptr;
+        unsigned long long envCache = std::strtoull(cacheEnv, &end, 10);
+        if (end != cacheEnv && *end == '\0') {
+            cache.maxBytes = static_cast<size_t>(envCache);
+        } else {
+            LogService::log("Valeur de ROKT_RESULT_CACHE_BYTES invalide. Conservation de la valeur actuelle.");
+        }
+    }
+
+    const char* compressionEnv = std::getenv("ROKT_COMPRESSION_MIN_BYTES");
+    if (compressionEnv != nullptr) {
+        char* end = nullptr;
+        unsigned long long envMinBytes = std::strtoull(compressionEnv, &end, 10);
+        if (end != compressionEnv && *end == '\0') {
+            compression.minBytes = static_cast<size_t>(envMinBytes);
+        } else {
+            LogService::log("Valeur de ROKT_COMPRESSION_MIN_BYTES invalide. Conservation de la valeur actuelle.");
+        }
+    }
+
+    const char* levelEnv = std::getenv("ROKT_COMPRESSION_LEVEL");
+    if (levelEnv != nullptr) {
+        int envLevel = std::atoi(levelEnv);
+        if (envLevel >= 1 && envLevel <= 9) {
+            compression.level = envLevel;
+        } else {
+            LogService::log("Valeur de ROKT_COMPRESSION_LEVEL invalide. Conservation de la valeur actuelle.");
+        }
+    }
+
+    const char* transferEnv = std::getenv("ROKT_TRANSFER_DIR");
+    if (transferEnv != nullptr) {
+        if (transferEnv[0] != '\0') {
+            transfer.directory = transferEnv;
+        } else {
+            LogService::log("Valeur de ROKT_TRANSFER_DIR invalide. Conservation de la valeur actuelle.");
+        }
+    }
 }
 
 bool Config::isValid() const {
@@ -86,7 +206,17 @@ bool Config::isValid() const {
     }
     
     // Vérification des paramètres de threads
-    if (thread.maxWorkers <= 0 || thread.maxTaskQueueSize <= 0) {
+    if (thread.maxWorkers <= 0 || thread.maxTaskQueueSize <= 0 || thread.scanThreads <= 0) {
+        return false;
+    }
+
+    // Vérification du seuil de compactage
+    if (storage.compactionRatio < 0) {
+        return false;
+    }
+
+    // Vérification du niveau de compression
+    if (compression.level < 1 || compression.level > 9) {
         return false;
     }
     
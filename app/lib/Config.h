@@ -3,8 +3,15 @@
 
 #include <string>
 #include "LogService.h"
+#include "ResultCache.h"
+#include "ResponseCompression.h"
 
 #define DEFAULT_BACKLOG 10
+#define DEFAULT_MAX_RESIDENT_BYTES (256 * 1024 * 1024)
+#define DEFAULT_COMPACTION_RATIO 0.25
+#define DEFAULT_MEMTABLE_BYTES (4 * 1024 * 1024)
+#define DEFAULT_SCAN_THREADS 4
+#define DEFAULT_TRANSFER_DIRECTORY "shared/transfer"
 
 class Config {
 public:
@@ -19,11 +26,34 @@ public:
     struct Thread {
         int maxWorkers;
         int maxTaskQueueSize;
+        int scanThreads = DEFAULT_SCAN_THREADS; // threads d'un parcours parallèle (ORDER BY, agrégats)
+    };
+    struct Storage {
+        size_t maxResidentBytes = DEFAULT_MAX_RESIDENT_BYTES; // taille maximale d'un dataset en mémoire (0 : désactivé)
+        double compactionRatio = DEFAULT_COMPACTION_RATIO;    // part obsolète d'un fichier déclenchant son compactage (0 : désactivé)
+        size_t memtableBytes = DEFAULT_MEMTABLE_BYTES;        // taille de la memtable d'un dataset LSM avant son vidage en run
+    };
+
+    struct Cache {
+        size_t maxBytes = DEFAULT_RESULT_CACHE_BYTES; // taille maximale du cache de résultats (0 : désactivé)
+    };
+
+    struct Compression {
+        size_t minBytes = DEFAULT_COMPRESSION_MIN_BYTES; // taille minimale d'une réponse compressée (préfixe COMPRESS)
+        int level = DEFAULT_COMPRESSION_LEVEL;           // niveau zlib, de 1 (rapide) à 9 (compact)
+    };
+
+    struct Transfer {
+        std::string directory = DEFAULT_TRANSFER_DIRECTORY; // répertoire des fichiers d'IMPORT et d'EXPORT
     };
 
     Encryption encryption;
     Network network;
     Thread thread;
+    Storage storage;
+    Cache cache;
+    Compression compression;
+    Transfer transfer;
 
     Config(const std::string& filename);
     bool isValid() const;
@@ -1,4 +1,5 @@
 #include "EncryptService.h"
+#include "QueryProfile.h"
 #include <openssl/evp.h>
 #include <openssl/aes.h>
 #include <stdexcept>
@@ -94,6 +95,62 @@ std::string EncryptService::decrypt(const std::string &ciphertext) {
     return plaintext;
 }
 
+std::unique_ptr<DecryptStreamBuf> EncryptService::decryptStream(std::istream &source) {
+    return std::make_unique<DecryptStreamBuf>(source, key, iv);
+}
+
+DecryptStreamBuf::DecryptStreamBuf(std::istream &source_, const std::string &key, const std::string &iv)
+    : source(source_), ctx(EVP_CIPHER_CTX_new()),
+      cipherChunk(DECRYPT_CHUNK_SIZE), plainChunk(DECRYPT_CHUNK_SIZE + AES_BLOCK_SIZE), finished(false) {
+    if (!ctx)
+        throw std::runtime_error("Échec de création du contexte OpenSSL.");
+    if (EVP_DecryptInit_ex(ctx, EVP_aes_128_ctr(), NULL,
+                           reinterpret_cast<const unsigned char*>(key.data()),
+                           reinterpret_cast<const unsigned char*>(iv.data())) != 1) {
+        EVP_CIPHER_CTX_free(ctx);
+        throw std::runtime_error("EVP_DecryptInit_ex a échoué.");
+    }
+    setg(plainChunk.data(), plainChunk.data(), plainChunk.data());
+}
+
+DecryptStreamBuf::~DecryptStreamBuf() {
+    EVP_CIPHER_CTX_free(ctx);
+}
+
+DecryptStreamBuf::int_type DecryptStreamBuf::underflow() {
+    if (gptr() < egptr())
+        return traits_type::to_int_type(*gptr());
+    while (!finished) {
+        std::streamsize readLen;
+        {
+            QueryProfile::Timer timer("read");
+            source.read(cipherChunk.data(), cipherChunk.size());
+            readLen = source.gcount();
+            timer.addBytes(static_cast<uint64_t>(readLen));
+        }
+        QueryProfile::Timer timer("decrypt");
+        int out_len = 0;
+        unsigned char *out = reinterpret_cast<unsigned char*>(plainChunk.data());
+        if (readLen > 0) {
+            if (EVP_DecryptUpdate(ctx, out, &out_len,
+                                  reinterpret_cast<const unsigned char*>(cipherChunk.data()),
+                                  static_cast<int>(readLen)) != 1)
+                throw std::runtime_error("EVP_DecryptUpdate a échoué.");
+        } else {
+            // Fin du contenu chiffré : on finalise le contexte (aucun octet en mode CTR)
+            if (EVP_DecryptFinal_ex(ctx, out, &out_len) != 1)
+                throw std::runtime_error("EVP_DecryptFinal_ex a échoué.");
+            finished = true;
+        }
+        timer.addBytes(static_cast<uint64_t>(out_len));
+        if (out_len > 0) {
+            setg(plainChunk.data(), plainChunk.data(), plainChunk.data() + out_len);
+            return traits_type::to_int_type(*gptr());
+        }
+    }
+    return traits_type::eof();
+}
+
 std::string EncryptService::encryptFilename(const std::string &filename) {
     // On chiffre le nom à l'aide de encrypt(), puis on encode en hexadécimal
     std::string encrypted = encrypt(filename);
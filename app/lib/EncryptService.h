@@ -3,6 +3,36 @@
 #define ENCRYPTSERVICE_H
 
 #include <string>
+#include <vector>
+#include <memory>
+#include <istream>
+#include <streambuf>
+
+#define DECRYPT_CHUNK_SIZE 65536 // Taille des blocs lus et déchiffrés par DecryptStreamBuf
+
+struct evp_cipher_ctx_st;
+
+/**
+ * @brief Tampon de flux déchiffrant à la volée un contenu chiffré en AES-128-CTR.
+ *
+ * Le contenu chiffré est lu par blocs de DECRYPT_CHUNK_SIZE octets : seul le bloc courant
+ * est présent en mémoire, quelle que soit la taille du fichier.
+ */
+class DecryptStreamBuf : public std::streambuf {
+private:
+    std::istream &source;
+    evp_cipher_ctx_st *ctx;
+    std::vector<char> cipherChunk;
+    std::vector<char> plainChunk;
+    bool finished;
+protected:
+    int_type underflow() override;
+public:
+    DecryptStreamBuf(std::istream &source, const std::string &key, const std::string &iv);
+    DecryptStreamBuf(const DecryptStreamBuf &) = delete;
+    DecryptStreamBuf &operator=(const DecryptStreamBuf &) = delete;
+    ~DecryptStreamBuf() override;
+};
 
 class EncryptService {
 private:
@@ -12,6 +42,8 @@ public:
     EncryptService(const std::string &key_, const std::string &iv_);
     std::string encrypt(const std::string &plaintext);
     std::string decrypt(const std::string &ciphertext);
+    // Déchiffrement en flux : le tampon renvoyé lit `source` par blocs
+    std::unique_ptr<DecryptStreamBuf> decryptStream(std::istream &source);
 
     // Nouveaux utilitaires pour chiffrer/déchiffrer les noms de fichiers/dossiers
     std::string encryptFilename(const std::string &filename);
@@ -0,0 +1,91 @@
+#include "HyperLogLog.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+HyperLogLog::HyperLogLog(int p)
+    : precision(static_cast<uint8_t>(std::min(std::max(p, HLL_MIN_PRECISION), HLL_MAX_PRECISION))),
+      registers(size_t(1) << precision, 0) {}
+
+void HyperLogLog::add(uint64_t hash) {
+    size_t index = hash >> (64 - precision);
+    uint64_t rest = hash << precision;
+    // Rang du premier bit à 1 dans les bits restants
+    uint8_t rank = rest == 0 ? static_cast<uint8_t>(64 - precision + 1) : static_cast<uint8_t>(__builtin_clzll(rest) + 1);
+    if (rank > registers[index])
+        registers[index] = rank;
+}
+
+void HyperLogLog::merge(const HyperLogLog &other) {
+    if (other.precision != precision)
+        throw std::invalid_argument("Précisions HyperLogLog différentes");
+    for (size_t i = 0; i < registers.size(); i++)
+        registers[i] = std::max(registers[i], other.registers[i]);
+}
+
+uint64_t HyperLogLog::estimate() const {
+    double m = static_cast<double>(registers.size());
+    double alpha = registers.size() == 16 ? 0.673 : registers.size() == 32 ? 0.697 : registers.size() == 64 ? 0.709
+                                                                                                           : 0.7213 / (1.0 + 1.079 / m);
+    double sum = 0.0;
+    size_t zeros = 0;
+    for (uint8_t r : registers) {
+        sum += std::ldexp(1.0, -r);
+        if (r == 0)
+            zeros++;
+    }
+    double raw = alpha * m * m / sum;
+    // Correction pour les petites cardinalités : comptage linéaire des registres vides
+    if (raw <= 2.5 * m && zeros > 0)
+        raw = m * std::log(m / static_cast<double>(zeros));
+    return static_cast<uint64_t>(std::llround(raw));
+}
+
+void HyperLogLog::clear() {
+    std::fill(registers.begin(), registers.end(), 0);
+}
+
+uint64_t HyperLogLog::hash(const void *data, size_t size) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        h ^= bytes[i];
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+std::string HyperLogLog::toHex() const {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(registers.size() * 2);
+    for (uint8_t r : registers) {
+        hex.push_back(digits[r >> 4]);
+        hex.push_back(digits[r & 0x0F]);
+    }
+    return hex;
+}
+
+bool HyperLogLog::fromHex(const std::string &hex) {
+    if (hex.size() != registers.size() * 2)
+        return false;
+    auto value = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    };
+    std::vector<uint8_t> decoded(registers.size());
+    for (size_t i = 0; i < decoded.size(); i++) {
+        int high = value(hex[2 * i]), low = value(hex[2 * i + 1]);
+        if (high < 0 || low < 0)
+            return false;
+        decoded[i] = static_cast<uint8_t>((high << 4) | low);
+    }
+    registers = std::move(decoded);
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef HYPERLOGLOG_H
+#define HYPERLOGLOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define HLL_MIN_PRECISION 4
+#define HLL_MAX_PRECISION 18
+#define HLL_DEFAULT_PRECISION 12   // 4096 registres, erreur type d'environ 1,6 %
+
+/**
+ * @brief Estimateur HyperLogLog du nombre de valeurs distinctes.
+ *
+ * 2^precision registres d'un octet : la mémoire est fixe quel que soit le nombre de valeurs,
+ * l'erreur type vaut environ 1,04 / sqrt(2^precision). Deux estimateurs de même précision se
+ * fusionnent (maximum registre par registre), ce qui permet de répartir le calcul entre
+ * plusieurs threads ou de cumuler des statistiques.
+ */
+class HyperLogLog {
+private:
+    uint8_t precision;
+    std::vector<uint8_t> registers;
+public:
+    explicit HyperLogLog(int precision = HLL_DEFAULT_PRECISION);
+
+    // Ajoute une valeur par son empreinte 64 bits (voir hash())
+    void add(uint64_t hash);
+    // Fusionne un estimateur de même précision ; lève std::invalid_argument sinon
+    void merge(const HyperLogLog &other);
+    uint64_t estimate() const;
+    void clear();
+    int getPrecision() const { return precision; }
+
+    // Empreinte stable (FNV-1a puis mélange final de MurmurHash3) : identique d'une exécution à
+    // l'autre, les registres peuvent donc être enregistrés
+    static uint64_t hash(const void *data, size_t size);
+
+    // Registres encodés en hexadécimal pour l'enregistrement
+    std::string toHex() const;
+    // Renvoie false si la chaîne ne correspond pas à un estimateur de cette précision
+    bool fromHex(const std::string &hex);
+};
+
+#endif // HYPERLOGLOG_H
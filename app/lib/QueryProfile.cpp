@@ -0,0 +1,118 @@
+#include "QueryProfile.h"
+#include <time.h>
+
+namespace {
+    thread_local QueryProfile *activeProfile = nullptr;
+
+    uint64_t clockNs(clockid_t clock) {
+        struct timespec ts;
+        clock_gettime(clock, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+    double toMs(uint64_t ns) {
+        return static_cast<double>(ns) / 1e6;
+    }
+}
+
+QueryProfile *QueryProfile::current() {
+    return activeProfile;
+}
+
+uint64_t QueryProfile::wallNow() {
+    return clockNs(CLOCK_MONOTONIC);
+}
+
+uint64_t QueryProfile::cpuNow() {
+    return clockNs(CLOCK_THREAD_CPUTIME_ID);
+}
+
+QueryProfile::Stage &QueryProfile::find(const char *name) {
+    for (auto &stage : stages) {
+        if (stage.name == name)
+            return stage;
+    }
+    stages.push_back(Stage());
+    stages.back().name = name;
+    return stages.back();
+}
+
+void QueryProfile::open(const char *name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    find(name);
+}
+
+void QueryProfile::record(const char *name, uint64_t wallNs, uint64_t cpuNs, uint64_t rowsIn, uint64_t rowsOut, uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stage &stage = find(name);
+    stage.calls++;
+    stage.wallNs += wallNs;
+    stage.cpuNs += cpuNs;
+    stage.rowsIn += rowsIn;
+    stage.rowsOut += rowsOut;
+    stage.bytes += bytes;
+}
+
+nlohmann::json QueryProfile::toJson() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    nlohmann::json result = nlohmann::json::array();
+    for (const auto &stage : stages) {
+        if (stage.calls == 0)
+            continue;
+        nlohmann::json entry;
+        entry["stage"] = stage.name;
+        entry["calls"] = stage.calls;
+        entry["rowsIn"] = stage.rowsIn;
+        entry["rowsOut"] = stage.rowsOut;
+        if (stage.bytes > 0)
+            entry["bytes"] = stage.bytes;
+        entry["wallMs"] = toMs(stage.wallNs);
+        entry["cpuMs"] = toMs(stage.cpuNs);
+        result.push_back(entry);
+    }
+    return result;
+}
+
+QueryProfile::Timer::Timer(const char *stage, QueryProfile *profile)
+    : profile(profile), stage(stage), wallStart(0), cpuStart(0), extraCpuNs(0), rowsIn(0), rowsOut(0), bytes(0) {
+    if (profile == nullptr)
+        return;
+    profile->open(stage);
+    wallStart = wallNow();
+    cpuStart = cpuNow();
+}
+
+QueryProfile::Timer::~Timer() {
+    if (profile == nullptr)
+        return;
+    profile->record(stage, wallNow() - wallStart, cpuNow() - cpuStart + extraCpuNs, rowsIn, rowsOut, bytes);
+}
+
+QueryProfile::Counter::Counter(const char *stage, size_t partitions, QueryProfile *profile)
+    : profile(profile), stage(stage) {
+    if (profile == nullptr)
+        return;
+    profile->open(stage);
+    slots.resize(partitions == 0 ? 1 : partitions);
+}
+
+QueryProfile::Counter::~Counter() {
+    if (profile == nullptr)
+        return;
+    Slot total;
+    for (const auto &slot : slots) {
+        total.ns += slot.ns;
+        total.rowsIn += slot.rowsIn;
+        total.rowsOut += slot.rowsOut;
+    }
+    // Mesure par ligne, sans attente : le temps écoulé sert aussi d'estimation du temps CPU
+    profile->record(stage, total.ns, total.ns, total.rowsIn, total.rowsOut, 0);
+}
+
+QueryProfile::Scope::Scope(QueryProfile *profile) : previous(activeProfile) {
+    activeProfile = profile;
+}
+
+QueryProfile::Scope::~Scope() {
+    activeProfile = previous;
+}
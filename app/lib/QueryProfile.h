@@ -0,0 +1,125 @@
+#ifndef QUERYPROFILE_H
+#define QUERYPROFILE_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+/**
+ * @brief Mesures d'une requête exécutée par PROFILE : une entrée par étape (lecture du fichier,
+ * déchiffrement, décodage, filtre, tri, sérialisation...).
+ *
+ * Le profil est attaché au thread qui exécute la requête (voir Scope) ; sans profil actif, les
+ * chronomètres ne mesurent rien. Les durées d'une étape incluent celles des étapes imbriquées
+ * (le décodage d'une ligne comprend la lecture et le déchiffrement du bloc qui la contient).
+ * Le temps CPU est celui des threads ayant exécuté l'étape, parcours parallèles compris.
+ */
+class QueryProfile {
+public:
+    struct Stage {
+        std::string name;
+        uint64_t calls = 0;
+        uint64_t rowsIn = 0;
+        uint64_t rowsOut = 0;
+        uint64_t bytes = 0;
+        uint64_t wallNs = 0;
+        uint64_t cpuNs = 0;
+    };
+
+    /**
+     * @brief Chronomètre d'une étape, enregistrée à sa destruction.
+     */
+    class Timer {
+    private:
+        QueryProfile *profile;
+        const char *stage;
+        uint64_t wallStart;
+        uint64_t cpuStart;
+        uint64_t extraCpuNs;
+        uint64_t rowsIn;
+        uint64_t rowsOut;
+        uint64_t bytes;
+    public:
+        explicit Timer(const char *stage, QueryProfile *profile = QueryProfile::current());
+        Timer(const Timer &) = delete;
+        Timer &operator=(const Timer &) = delete;
+        ~Timer();
+        bool active() const { return profile != nullptr; }
+        void setRows(uint64_t in, uint64_t out) { rowsIn = in; rowsOut = out; }
+        void addBytes(uint64_t count) { bytes += count; }
+        // Temps CPU consommé par d'autres threads pour cette étape (partitions d'un parcours)
+        void addCpu(uint64_t ns) { extraCpuNs += ns; }
+    };
+
+    /**
+     * @brief Durées mesurées ligne par ligne, cumulées par partition d'un parcours puis
+     * enregistrées en une fois (aucun verrou par ligne).
+     */
+    class Counter {
+    private:
+        struct Slot {
+            uint64_t ns = 0;
+            uint64_t rowsIn = 0;
+            uint64_t rowsOut = 0;
+        };
+        QueryProfile *profile;
+        const char *stage;
+        std::vector<Slot> slots;
+    public:
+        Counter(const char *stage, size_t partitions, QueryProfile *profile = QueryProfile::current());
+        Counter(const Counter &) = delete;
+        Counter &operator=(const Counter &) = delete;
+        ~Counter();
+        bool active() const { return profile != nullptr; }
+        // Exécute `step` pour une ligne de la partition ; une ligne est comptée en sortie si
+        // `step` renvoie true
+        template <typename Step>
+        bool measure(size_t partition, Step &&step) {
+            if (profile == nullptr)
+                return step();
+            uint64_t start = QueryProfile::wallNow();
+            bool kept = step();
+            Slot &slot = slots[partition];
+            slot.ns += QueryProfile::wallNow() - start;
+            slot.rowsIn++;
+            slot.rowsOut += kept ? 1 : 0;
+            return kept;
+        }
+    };
+
+    /**
+     * @brief Attache un profil au thread courant pour la durée du bloc.
+     */
+    class Scope {
+    private:
+        QueryProfile *previous;
+    public:
+        explicit Scope(QueryProfile *profile);
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+        ~Scope();
+    };
+
+private:
+    mutable std::mutex mutex;
+    std::vector<Stage> stages;  // dans l'ordre de leur première apparition
+
+    Stage &find(const char *name);
+
+public:
+    // Profil actif sur le thread courant (nullptr si la requête n'est pas profilée)
+    static QueryProfile *current();
+    static uint64_t wallNow();
+    // Temps CPU du thread courant
+    static uint64_t cpuNow();
+
+    // Réserve la place d'une étape pour que l'ordre du résultat suive celui des débuts d'étape
+    void open(const char *name);
+    void record(const char *name, uint64_t wallNs, uint64_t cpuNs, uint64_t rowsIn, uint64_t rowsOut, uint64_t bytes);
+    // [{"stage", "calls", "rowsIn", "rowsOut", "bytes", "wallMs", "cpuMs"}, ...]
+    nlohmann::json toJson() const;
+};
+
+#endif // QUERYPROFILE_H
@@ -0,0 +1,107 @@
+#include "RequestArena.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+namespace ROKT {
+
+thread_local RequestArena *RequestArena::active = nullptr;
+
+namespace {
+    // Provenance d'un noeud d'ArenaAllocator, écrite dans son en-tête
+    const uint32_t NODE_FROM_ARENA = 0x41524e41;
+    const uint32_t NODE_FROM_HEAP = 0x48454150;
+}
+
+RequestArena::RequestArena() : offset(0) {}
+
+RequestArena::~RequestArena() {
+    for (auto &chunk : chunks)
+        ::operator delete(chunk.data);
+}
+
+void RequestArena::addChunk(size_t minSize) {
+    size_t size = chunks.empty() ? ARENA_FIRST_CHUNK_SIZE : chunks.back().size * 2;
+    size = std::max(size, minSize);
+    chunks.push_back({static_cast<char *>(::operator new(size)), size});
+    offset = 0;
+}
+
+void *RequestArena::allocate(size_t bytes, size_t alignment) {
+    if (!chunks.empty()) {
+        Chunk &chunk = chunks.back();
+        size_t aligned = (offset + alignment - 1) & ~(alignment - 1);
+        if (aligned + bytes <= chunk.size) {
+            offset = aligned + bytes;
+            return chunk.data + aligned;
+        }
+    }
+    // Le début d'un bloc est aligné par ::operator new
+    addChunk(bytes);
+    offset = bytes;
+    return chunks.back().data;
+}
+
+void *RequestArena::allocateNode(size_t bytes, size_t alignment) {
+    // L'en-tête garde l'alignement du noeud : il ne peut pas servir un alignement plus fort
+    if (alignment > ARENA_NODE_HEADER_SIZE)
+        throw std::bad_alloc();
+    char *header;
+    if (active) {
+        header = static_cast<char *>(active->allocate(bytes + ARENA_NODE_HEADER_SIZE, ARENA_NODE_HEADER_SIZE));
+        *reinterpret_cast<uint32_t *>(header) = NODE_FROM_ARENA;
+    } else {
+        header = static_cast<char *>(::operator new(bytes + ARENA_NODE_HEADER_SIZE));
+        *reinterpret_cast<uint32_t *>(header) = NODE_FROM_HEAP;
+    }
+    return header + ARENA_NODE_HEADER_SIZE;
+}
+
+void RequestArena::releaseNode(void *p) noexcept {
+    if (p == nullptr)
+        return;
+    char *header = static_cast<char *>(p) - ARENA_NODE_HEADER_SIZE;
+    uint32_t origin = *reinterpret_cast<const uint32_t *>(header);
+    // Mémoire d'arène (ce thread, un autre, ou une portée terminée) : rendue avec son arène
+    if (origin == NODE_FROM_ARENA)
+        return;
+    if (origin != NODE_FROM_HEAP) {
+        std::fprintf(stderr, "RequestArena : libération d'un noeud à l'en-tête inconnu (%p)\n", p);
+        std::abort();
+    }
+    ::operator delete(header);
+}
+
+void RequestArena::reset() {
+    if (chunks.empty())
+        return;
+    // On conserve le plus grand bloc (s'il reste raisonnable) pour la requête suivante
+    auto largest = std::max_element(chunks.begin(), chunks.end(),
+                                    [](const Chunk &a, const Chunk &b) { return a.size < b.size; });
+    Chunk kept = *largest;
+    bool keep = kept.size <= ARENA_MAX_RETAINED_SIZE;
+    for (auto &chunk : chunks) {
+        if (!keep || chunk.data != kept.data)
+            ::operator delete(chunk.data);
+    }
+    chunks.clear();
+    if (keep)
+        chunks.push_back(kept);
+    offset = 0;
+}
+
+ArenaScope::ArenaScope() : nested(RequestArena::active != nullptr) {
+    if (!nested) {
+        static thread_local RequestArena workerArena;
+        RequestArena::active = &workerArena;
+    }
+}
+
+ArenaScope::~ArenaScope() {
+    if (!nested) {
+        RequestArena::active->reset();
+        RequestArena::active = nullptr;
+    }
+}
+
+} // namespace ROKT
@@ -0,0 +1,136 @@
+#ifndef REQUEST_ARENA_H
+#define REQUEST_ARENA_H
+
+#include <nlohmann/json.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+#define ARENA_FIRST_CHUNK_SIZE (64 * 1024)          // Taille du premier bloc alloué par l'arène
+#define ARENA_MAX_RETAINED_SIZE (4 * 1024 * 1024)   // Taille maximale conservée entre deux requêtes
+#define ARENA_NODE_HEADER_SIZE alignof(std::max_align_t)  // En-tête placé devant chaque allocation d'ArenaAllocator
+
+namespace ROKT {
+    /**
+     * @brief Arène monotone utilisée pour les allocations temporaires d'une requête.
+     *
+     * Les allocations avancent un pointeur dans des blocs de taille croissante ; aucune
+     * libération individuelle n'est effectuée. reset() libère toute la requête d'un coup et
+     * conserve un bloc pour la requête suivante. Chaque worker possède sa propre arène, les
+     * workers ne se disputent donc plus l'allocateur global.
+     */
+    class RequestArena {
+    private:
+        struct Chunk {
+            char *data;
+            size_t size;
+        };
+        std::vector<Chunk> chunks;  ///< Blocs alloués, le dernier est le bloc courant
+        size_t offset;              ///< Position libre dans le bloc courant
+
+        static thread_local RequestArena *active;
+        friend class ArenaScope;
+
+        void addChunk(size_t minSize);
+    public:
+        RequestArena();
+        RequestArena(const RequestArena &) = delete;
+        RequestArena &operator=(const RequestArena &) = delete;
+        ~RequestArena();
+
+        /**
+         * @brief Alloue `bytes` octets alignés sur `alignment` dans le bloc courant.
+         */
+        void *allocate(size_t bytes, size_t alignment);
+
+        /**
+         * @brief Alloue un noeud d'ArenaAllocator : dans l'arène active, sinon avec l'allocateur
+         * global. Un en-tête placé devant le noeud indique sa provenance.
+         * @throws std::bad_alloc si l'alignement dépasse celui de l'en-tête.
+         */
+        static void *allocateNode(size_t bytes, size_t alignment);
+
+        /**
+         * @brief Libère un noeud alloué par allocateNode(), quel que soit le thread : la mémoire
+         * d'arène est rendue avec son arène, seule la mémoire globale atteint ::operator delete.
+         * Un en-tête inconnu (noeud d'une autre provenance, mémoire écrasée) arrête le serveur.
+         */
+        static void releaseNode(void *p) noexcept;
+
+        /**
+         * @brief Libère toutes les allocations de la requête en une seule opération.
+         */
+        void reset();
+
+        /**
+         * @brief Retourne l'arène de la requête en cours sur ce thread (nullptr hors requête).
+         */
+        static RequestArena *current() { return active; }
+    };
+
+    /**
+     * @brief Active l'arène du thread courant pour la durée d'une requête (RAII).
+     *
+     * À la sortie du scope, l'arène est remise à zéro. Une portée imbriquée réutilise
+     * l'arène déjà active sans la réinitialiser.
+     */
+    class ArenaScope {
+    private:
+        bool nested;
+    public:
+        ArenaScope();
+        ArenaScope(const ArenaScope &) = delete;
+        ArenaScope &operator=(const ArenaScope &) = delete;
+        ~ArenaScope();
+    };
+
+    /**
+     * @brief Allocateur STL servant les allocations depuis l'arène active.
+     *
+     * Hors requête (aucune arène active, threads de scan parallèle...), il se replie sur
+     * l'allocateur global. Une libération n'est effective que pour la mémoire globale : une
+     * valeur construite dans l'arène d'un worker peut être libérée par un autre thread, elle
+     * ne doit pas atteindre ::operator delete. nlohmann::json construit un allocateur neuf pour
+     * chaque noeud : l'arène d'origine ne peut pas être conservée dans l'allocateur, la
+     * provenance est lue dans l'en-tête du noeud (RequestArena::allocateNode).
+     */
+    template <typename T>
+    class ArenaAllocator {
+    public:
+        using value_type = T;
+
+        ArenaAllocator() noexcept = default;
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U> &) noexcept {}
+
+        T *allocate(size_t n) {
+            static_assert(alignof(T) <= ARENA_NODE_HEADER_SIZE, "alignement supérieur à l'en-tête d'un noeud d'arène");
+            if (n > (SIZE_MAX - ARENA_NODE_HEADER_SIZE) / sizeof(T))
+                throw std::bad_array_new_length();
+            return static_cast<T *>(RequestArena::allocateNode(n * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T *p, size_t) noexcept {
+            RequestArena::releaseNode(p);
+        }
+
+        template <typename U>
+        bool operator==(const ArenaAllocator<U> &) const noexcept { return true; }
+        template <typename U>
+        bool operator!=(const ArenaAllocator<U> &) const noexcept { return false; }
+    };
+
+    /**
+     * @brief Document JSON dont les noeuds (objets, tableaux) sont alloués dans l'arène de la requête.
+     *
+     * Les chaînes restent des std::string (allocation globale au-delà du SSO). Une valeur
+     * ArenaJson ne doit pas survivre au ArenaScope dans lequel elle a été construite.
+     */
+    using ArenaJson = nlohmann::basic_json<std::map, std::vector, std::string, bool,
+                                           std::int64_t, std::uint64_t, double, ArenaAllocator>;
+} // namespace ROKT
+
+#endif // REQUEST_ARENA_H
@@ -0,0 +1,77 @@
+#include "RequestInput.h"
+#include <sys/socket.h>
+
+#define REQUEST_INPUT_READ_BYTES 65536
+
+namespace {
+    thread_local RequestInput *activeInput = nullptr;
+}
+
+RequestInput::RequestInput(int socket) : socket(socket), pos(0), closed(socket < 0), failed(false), bytes(0) {}
+
+RequestInput *RequestInput::current() {
+    return activeInput;
+}
+
+void RequestInput::begin(std::string_view received) {
+    buffer.insert(pos, received.data(), received.size());
+}
+
+bool RequestInput::fill() {
+    if (closed)
+        return false;
+    // Les lignes déjà rendues sont retirées du tampon avant d'y ajouter la suite
+    buffer.erase(0, pos);
+    pos = 0;
+    size_t used = buffer.size();
+    buffer.resize(used + REQUEST_INPUT_READ_BYTES);
+    ssize_t received = recv(socket, &buffer[used], REQUEST_INPUT_READ_BYTES, 0);
+    buffer.resize(used + (received > 0 ? static_cast<size_t>(received) : 0));
+    if (received <= 0) {
+        closed = true;
+        failed = received < 0;
+        return false;
+    }
+    bytes += static_cast<uint64_t>(received);
+    return true;
+}
+
+bool RequestInput::isTerminator(std::string_view line, std::string_view terminator) {
+    size_t begin = line.find_first_not_of(" \t\r");
+    size_t end = line.find_last_not_of(" \t\r;");
+    if (terminator.empty() || begin == std::string_view::npos || end == std::string_view::npos || end < begin)
+        return false;
+    return line.substr(begin, end + 1 - begin) == terminator;
+}
+
+bool RequestInput::readLine(std::string *line, std::string_view terminator) {
+    size_t searched = pos;
+    size_t end;
+    while ((end = buffer.find('\n', searched)) == std::string::npos) {
+        searched = buffer.size() - pos;
+        if (isTerminator(std::string_view(buffer).substr(pos), terminator)) {
+            end = buffer.size();
+            break;
+        }
+        if (!fill()) {
+            // Dernière ligne sans retour à la ligne
+            if (pos >= buffer.size())
+                return false;
+            end = buffer.size();
+            break;
+        }
+    }
+    line->assign(buffer, pos, end - pos);
+    pos = end < buffer.size() ? end + 1 : end;
+    if (!line->empty() && line->back() == '\r')
+        line->pop_back();
+    return true;
+}
+
+RequestInput::Scope::Scope(RequestInput *input) : previous(activeInput) {
+    activeInput = input;
+}
+
+RequestInput::Scope::~Scope() {
+    activeInput = previous;
+}
@@ -0,0 +1,64 @@
+#ifndef REQUESTINPUT_H
+#define REQUESTINPUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Suite d'une requête lue par le handler pendant son exécution (BULK ADD).
+ *
+ * Le serveur ne lit que l'en-tête d'une requête BULK ADD avant de la confier à un worker : les
+ * lignes de données sont lues ensuite, au fil de leur arrivée, par le handler qui les insère par
+ * lots. Le worker attache à son thread l'entrée de sa connexion (voir Scope) ; le handler la
+ * commence avec les lignes déjà reçues avec l'en-tête, puis lit les suivantes sur la socket.
+ */
+class RequestInput {
+private:
+    int socket;
+    std::string buffer;
+    size_t pos;
+    bool closed;
+    bool failed;
+    uint64_t bytes;
+
+    // Lit la suite de la requête dans le tampon ; false en fin de flux ou en cas d'erreur
+    bool fill();
+
+public:
+    explicit RequestInput(int socket);
+    RequestInput(const RequestInput &) = delete;
+    RequestInput &operator=(const RequestInput &) = delete;
+
+    /**
+     * @brief Attache une entrée au thread courant pour la durée du bloc (nullptr : aucune).
+     */
+    class Scope {
+    private:
+        RequestInput *previous;
+    public:
+        explicit Scope(RequestInput *input);
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+        ~Scope();
+    };
+
+    // Entrée du thread courant (nullptr si la requête ne peut pas être lue au-delà de sa réception)
+    static RequestInput *current();
+
+    // Place en tête les données déjà reçues avec la requête
+    void begin(std::string_view received);
+    // Ligne suivante, sans '\n' ni '\r' final ; false quand la requête est entièrement lue. Une
+    // dernière ligne égale à `terminator` est rendue sans attendre son retour à la ligne (le
+    // client attend alors la réponse)
+    bool readLine(std::string *line, std::string_view terminator = {});
+    // Vrai si la ligne est `terminator`, aux espaces et au ';' final près
+    static bool isTerminator(std::string_view line, std::string_view terminator);
+    // Vrai si la lecture s'est arrêtée sur une erreur (délai dépassé, connexion rompue)
+    bool hasFailed() const { return failed; }
+    // Octets lus sur la socket par le handler
+    uint64_t getBytes() const { return bytes; }
+};
+
+#endif // REQUESTINPUT_H
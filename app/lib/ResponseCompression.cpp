@@ -0,0 +1,63 @@
+#include "ResponseCompression.h"
+#include "QueryProfile.h"
+
+namespace {
+    const char DEFLATE_HEADER[] = "deflate\r\n";
+    const char IDENTITY_HEADER[] = "identity\r\n";
+}
+
+ResponseCompression::ResponseCompression(size_t minBytes, int level)
+    : minBytes(minBytes), level(level < Z_BEST_SPEED || level > Z_BEST_COMPRESSION ? DEFAULT_COMPRESSION_LEVEL : level),
+      responses(0), compressed(0), bytesIn(0), bytesOut(0), cpuNs(0) {}
+
+ResponseCompression::Deflater::Deflater(ResponseCompression &owner) : owner(owner), zs(), ready(false), in(0), out(0), cpu(0) {
+    ready = deflateInit(&zs, owner.level) == Z_OK;
+}
+
+ResponseCompression::Deflater::~Deflater() {
+    if (ready)
+        deflateEnd(&zs);
+    owner.responses++;
+    owner.compressed++;
+    owner.bytesIn += in;
+    owner.bytesOut += out;
+    owner.cpuNs += cpu;
+}
+
+bool ResponseCompression::Deflater::deflate(const char *data, size_t size, bool finish, std::string *output) {
+    if (!ready)
+        return false;
+    uint64_t start = QueryProfile::cpuNow();
+    zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    zs.avail_in = static_cast<uInt>(size);
+    size_t begin = output->size();
+    int result;
+    do {
+        // deflateBound borne la taille de sortie ; la boucle couvre les vidages successifs
+        size_t used = output->size();
+        output->resize(used + deflateBound(&zs, zs.avail_in) + 16);
+        zs.next_out = reinterpret_cast<Bytef *>(&(*output)[used]);
+        zs.avail_out = static_cast<uInt>(output->size() - used);
+        result = ::deflate(&zs, finish ? Z_FINISH : Z_SYNC_FLUSH);
+        output->resize(output->size() - zs.avail_out);
+    } while (result == Z_OK && (zs.avail_in > 0 || zs.avail_out == 0 || finish));
+    cpu += QueryProfile::cpuNow() - start;
+    in += size;
+    out += output->size() - begin;
+    ready = !finish && (result == Z_OK || result == Z_BUF_ERROR);
+    return finish ? result == Z_STREAM_END : ready;
+}
+
+std::string ResponseCompression::encode(const std::string &response) {
+    if (response.size() < minBytes) {
+        responses++;
+        return IDENTITY_HEADER + response;
+    }
+    std::string output(DEFLATE_HEADER);
+    {
+        Deflater deflater(*this);
+        if (deflater.deflate(response.data(), response.size(), true, &output))
+            return output;
+    }
+    return IDENTITY_HEADER + response;
+}
@@ -0,0 +1,76 @@
+#ifndef RESPONSECOMPRESSION_H
+#define RESPONSECOMPRESSION_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <zlib.h>
+
+#define DEFAULT_COMPRESSION_MIN_BYTES 4096   // taille à partir de laquelle une réponse est compressée
+#define DEFAULT_COMPRESSION_LEVEL 1          // niveau zlib (1 : le plus rapide, 9 : le plus compact)
+
+/**
+ * @brief Compression deflate (zlib) des réponses, demandée par la requête avec le préfixe COMPRESS.
+ *
+ * Une réponse compressée commence par la ligne "deflate\r\n", suivie d'un flux zlib qui contient
+ * la réponse habituelle ; une réponse plus petite que le seuil est précédée de "identity\r\n" et
+ * envoyée telle quelle. Une réponse par blocs (STREAM) est toujours compressée : tout ce qui suit
+ * la ligne d'en-tête (blocs, bloc final, réponse de fin) forme un seul flux zlib, vidé
+ * (Z_SYNC_FLUSH) après chaque bloc pour que le client puisse le décompresser au fil de l'eau.
+ *
+ * Les compteurs (octets avant et après compression, temps CPU passé à compresser) sont partagés
+ * par tous les workers et exposés par STATS pour régler le seuil et le niveau.
+ */
+class ResponseCompression {
+private:
+    size_t minBytes;
+    int level;
+    std::atomic<uint64_t> responses;    // réponses de requêtes ayant demandé la compression
+    std::atomic<uint64_t> compressed;   // dont réponses effectivement compressées
+    std::atomic<uint64_t> bytesIn;
+    std::atomic<uint64_t> bytesOut;
+    std::atomic<uint64_t> cpuNs;
+
+public:
+    /**
+     * @brief Flux deflate d'une réponse ; les octets et le temps CPU sont ajoutés aux compteurs
+     * à sa destruction.
+     */
+    class Deflater {
+    private:
+        ResponseCompression &owner;
+        z_stream zs;
+        bool ready;
+        uint64_t in;
+        uint64_t out;
+        uint64_t cpu;
+    public:
+        explicit Deflater(ResponseCompression &owner);
+        Deflater(const Deflater &) = delete;
+        Deflater &operator=(const Deflater &) = delete;
+        ~Deflater();
+
+        // Compresse `size` octets ; `finish` termine le flux, sinon les données sont vidées
+        // (Z_SYNC_FLUSH) pour être décompressables dès leur réception
+        bool deflate(const char *data, size_t size, bool finish, std::string *output);
+    };
+
+    explicit ResponseCompression(size_t minBytes = DEFAULT_COMPRESSION_MIN_BYTES, int level = DEFAULT_COMPRESSION_LEVEL);
+
+    /**
+     * @brief Réponse complète à envoyer : en-tête puis réponse compressée si elle atteint le
+     * seuil, sinon en-tête "identity" et réponse inchangée.
+     */
+    std::string encode(const std::string &response);
+
+    size_t getMinBytes() const { return minBytes; }
+    int getLevel() const { return level; }
+    uint64_t getResponses() const { return responses; }
+    uint64_t getCompressed() const { return compressed; }
+    uint64_t getBytesIn() const { return bytesIn; }
+    uint64_t getBytesOut() const { return bytesOut; }
+    uint64_t getCpuNs() const { return cpuNs; }
+};
+
+#endif // RESPONSECOMPRESSION_H
@@ -0,0 +1,90 @@
+#include "ResponseEncoding.h"
+#include <sstream>
+
+namespace {
+    thread_local ResponseEncoding::Format activeFormat = ResponseEncoding::Format::PRETTY;
+
+    struct FormatName {
+        const char *name;
+        ResponseEncoding::Format format;
+    };
+    const FormatName FORMAT_NAMES[] = {
+        {"pretty", ResponseEncoding::Format::PRETTY}, {"json", ResponseEncoding::Format::JSON},
+        {"ndjson", ResponseEncoding::Format::NDJSON}, {"msgpack", ResponseEncoding::Format::MSGPACK},
+        {"cbor", ResponseEncoding::Format::CBOR},
+    };
+
+    // Données JSON d'un handler ; un texte qui n'est pas du JSON est transmis comme une chaîne
+    nlohmann::json parseDatas(const std::string &datas) {
+        nlohmann::json value = nlohmann::json::parse(datas, nullptr, false);
+        return value.is_discarded() ? nlohmann::json(datas) : value;
+    }
+
+    // Valeur scalaire encodée en binaire, pour assembler l'enveloppe sans recopier les données
+    std::string binary(const nlohmann::json &value, ResponseEncoding::Format format) {
+        return ResponseEncoding::encode(value, format);
+    }
+}
+
+ResponseEncoding::Scope::Scope(Format format) : previous(activeFormat) {
+    activeFormat = format;
+}
+
+ResponseEncoding::Scope::~Scope() {
+    activeFormat = previous;
+}
+
+bool ResponseEncoding::parse(std::string_view name, Format *format) {
+    for (const auto &entry : FORMAT_NAMES) {
+        if (name == entry.name) {
+            *format = entry.format;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *ResponseEncoding::name(Format format) {
+    for (const auto &entry : FORMAT_NAMES) {
+        if (entry.format == format)
+            return entry.name;
+    }
+    return "pretty";
+}
+
+ResponseEncoding::Format ResponseEncoding::current() {
+    return activeFormat;
+}
+
+std::string ResponseEncoding::envelope(int code, const std::string &reason, const std::string &datas, bool datasEncoded, Format format) {
+    // Les données accompagnent aussi un statut autre que 0 (détail des lignes d'un ajout multiple)
+    bool withDatas = !datas.empty();
+    if (format == Format::PRETTY) {
+        // Présentation historique, conservée à l'octet près
+        std::ostringstream response;
+        response << "{\"status\": " << code << ", \"reason\": \"" << reason << "\"";
+        if (withDatas)
+            response << ", \"datas\": " << datas;
+        response << "}";
+        return response.str();
+    }
+    if (!isBinary(format)) {
+        std::string response = "{\"status\":" + std::to_string(code) + ",\"reason\":" + nlohmann::json(reason).dump();
+        if (withDatas)
+            response += ",\"datas\":" + (datasEncoded ? datas : parseDatas(datas).dump(-1, ' ', false, nlohmann::json::error_handler_t::replace));
+        response += "}";
+        return response;
+    }
+    if (withDatas && !datasEncoded) {
+        nlohmann::json response = {{"status", code}, {"reason", reason}, {"datas", parseDatas(datas)}};
+        return encode(response, format);
+    }
+    // Tableau associatif de 2 ou 3 entrées (fixmap MessagePack, map CBOR), les données déjà
+    // encodées étant ajoutées telles quelles
+    size_t entries = withDatas ? 3 : 2;
+    std::string response(1, static_cast<char>((format == Format::MSGPACK ? 0x80 : 0xA0) | entries));
+    response += binary("status", format) + binary(code, format) + binary("reason", format) + binary(reason, format);
+    if (withDatas)
+        response += binary("datas", format) + datas;
+    return response;
+}
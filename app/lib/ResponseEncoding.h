@@ -0,0 +1,88 @@
+#ifndef RESPONSEENCODING_H
+#define RESPONSEENCODING_H
+
+#include <string>
+#include <string_view>
+#include <nlohmann/json.hpp>
+
+/**
+ * @brief Format des réponses d'une connexion, choisi par le client en tête de sa requête :
+ *   FORMAT <pretty|json|ndjson|msgpack|cbor> <commande>;
+ *
+ * - pretty (par défaut) : JSON indenté, la présentation historique ;
+ * - json : JSON compact ;
+ * - ndjson : JSON compact, et une ligne par ligne de résultat dans les blocs d'un GET ... STREAM ;
+ * - msgpack, cbor : la réponse {"status", "reason", "datas"} est encodée en binaire
+ *   (MessagePack ou CBOR), les données n'étant jamais mises en forme en texte.
+ *
+ * Le format est attaché au thread qui traite la requête (voir Scope). Les handlers qui
+ * produisent de gros résultats (GET) encodent directement leurs données dans ce format ; les
+ * autres renvoient du JSON, converti au moment de construire la réponse.
+ */
+class ResponseEncoding {
+public:
+    enum class Format { PRETTY, JSON, NDJSON, MSGPACK, CBOR };
+
+    /**
+     * @brief Attache un format au thread courant pour la durée du bloc.
+     */
+    class Scope {
+    private:
+        Format previous;
+    public:
+        explicit Scope(Format format);
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+        ~Scope();
+    };
+
+    // Renvoie false si le nom ne désigne aucun format
+    static bool parse(std::string_view name, Format *format);
+    static const char *name(Format format);
+    // Format du thread courant (PRETTY hors requête)
+    static Format current();
+    static bool isBinary(Format format) { return format == Format::MSGPACK || format == Format::CBOR; }
+
+    // Données d'une réponse encodées dans le format demandé
+    template <typename BasicJsonType>
+    static std::string encode(const BasicJsonType &value, Format format = current()) {
+        std::string out;
+        switch (format) {
+            case Format::PRETTY:
+                return value.dump(4);
+            case Format::JSON:
+            case Format::NDJSON:
+                return value.dump();
+            case Format::MSGPACK:
+                BasicJsonType::to_msgpack(value, out);
+                return out;
+            case Format::CBOR:
+                BasicJsonType::to_cbor(value, out);
+                return out;
+        }
+        return out;
+    }
+
+    // Contenu d'un bloc de lignes (GET ... STREAM) : un tableau, ou une ligne de texte par
+    // élément en NDJSON
+    template <typename BasicJsonType>
+    static std::string encodeRows(const BasicJsonType &rows, Format format = current()) {
+        if (format == Format::PRETTY)
+            return rows.dump();
+        if (format != Format::NDJSON || !rows.is_array())
+            return encode(rows, format);
+        std::string out;
+        for (const auto &row : rows) {
+            out += row.dump();
+            out += '\n';
+        }
+        return out;
+    }
+
+    // Réponse complète {"status", "reason", "datas"} ; `datas` est soit déjà encodé dans le
+    // format (`datasEncoded`), soit du texte JSON
+    static std::string envelope(int code, const std::string &reason, const std::string &datas, bool datasEncoded,
+                                Format format = current());
+};
+
+#endif // RESPONSEENCODING_H
@@ -0,0 +1,76 @@
+#include "ResponseStream.h"
+#include <cstdio>
+#include <sys/socket.h>
+
+namespace {
+    thread_local ResponseStream *activeStream = nullptr;
+}
+
+ResponseStream::ResponseStream(int socket, ResponseCompression *compression)
+    : socket(socket), compression(compression), opened(false), failed(false), chunks(0), rows(0), bytes(0) {}
+
+ResponseStream *ResponseStream::current() {
+    return activeStream;
+}
+
+bool ResponseStream::sendAll(const char *data, size_t size) {
+    while (!failed && size > 0) {
+        // MSG_NOSIGNAL : un client déconnecté ne doit pas interrompre le serveur (SIGPIPE)
+        ssize_t sent = send(socket, data, size, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            failed = true;
+            break;
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return !failed;
+}
+
+bool ResponseStream::emit(const std::string &data, bool last) {
+    if (failed)
+        return false;
+    if (!deflater) {
+        deflater = std::make_unique<ResponseCompression::Deflater>(*compression);
+        if (!sendAll("deflate\r\n", 9))
+            return false;
+    }
+    std::string output;
+    if (!deflater->deflate(data.data(), data.size(), last, &output))
+        failed = true;
+    return sendAll(output.data(), output.size());
+}
+
+bool ResponseStream::write(const std::string &chunk, size_t count) {
+    if (chunk.empty())
+        return !failed;
+    char header[24];
+    int length = std::snprintf(header, sizeof(header), "%zx\r\n", chunk.size());
+    if (compression != nullptr) {
+        std::string frame;
+        frame.reserve(static_cast<size_t>(length) + chunk.size() + 2);
+        frame.append(header, static_cast<size_t>(length)).append(chunk).append("\r\n", 2);
+        if (!emit(frame, false))
+            return false;
+    } else if (!sendAll(header, static_cast<size_t>(length)) || !sendAll(chunk.data(), chunk.size()) || !sendAll("\r\n", 2)) {
+        return false;
+    }
+    chunks++;
+    rows += count;
+    bytes += chunk.size();
+    return true;
+}
+
+bool ResponseStream::finish(const std::string &response) {
+    if (compression != nullptr)
+        return emit("0\r\n" + response, true);
+    return sendAll("0\r\n", 3) && sendAll(response.data(), response.size());
+}
+
+ResponseStream::Scope::Scope(ResponseStream *stream) : previous(activeStream) {
+    activeStream = stream;
+}
+
+ResponseStream::Scope::~Scope() {
+    activeStream = previous;
+}
@@ -0,0 +1,78 @@
+#ifndef RESPONSESTREAM_H
+#define RESPONSESTREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "ResponseCompression.h"
+
+#define STREAM_DEFAULT_BATCH_ROWS 1000   // lignes par bloc d'une réponse STREAM
+
+/**
+ * @brief Réponse envoyée au client par blocs pendant l'exécution d'une lecture (GET ... STREAM).
+ *
+ * Chaque bloc est encadré comme en HTTP/1.1 chunked : sa taille en hexadécimal, "\r\n", son
+ * contenu (un tableau JSON de lignes), "\r\n". Un bloc de taille nulle termine les données ; il
+ * est suivi de la réponse habituelle {"status", "reason", "datas"}, qui donne le statut final
+ * et un résumé. Un client peut ainsi traiter les premières lignes pendant que le serveur lit
+ * les suivantes, et le serveur ne garde en mémoire qu'un bloc à la fois.
+ *
+ * Le worker attache un flux à son thread pour chaque connexion (voir Scope) ; le handler
+ * l'ouvre s'il répond par blocs. Si l'envoi échoue (client déconnecté), les écritures suivantes
+ * sont ignorées et le handler peut arrêter son parcours.
+ *
+ * Si la requête a demandé la compression (COMPRESS), la ligne "deflate\r\n" précède le premier
+ * bloc et tout ce qui suit est envoyé dans un seul flux zlib, vidé après chaque bloc.
+ */
+class ResponseStream {
+private:
+    int socket;
+    ResponseCompression *compression;
+    std::unique_ptr<ResponseCompression::Deflater> deflater;
+    bool opened;
+    bool failed;
+    uint64_t chunks;
+    uint64_t rows;
+    uint64_t bytes;
+
+    bool sendAll(const char *data, size_t size);
+    // Envoie des données de la réponse, compressées si la requête l'a demandé
+    bool emit(const std::string &data, bool last);
+
+public:
+    // `compression` : compression demandée par la requête (nullptr sinon)
+    explicit ResponseStream(int socket, ResponseCompression *compression = nullptr);
+    ResponseStream(const ResponseStream &) = delete;
+    ResponseStream &operator=(const ResponseStream &) = delete;
+
+    /**
+     * @brief Attache un flux au thread courant pour la durée du bloc (nullptr : aucun flux).
+     */
+    class Scope {
+    private:
+        ResponseStream *previous;
+    public:
+        explicit Scope(ResponseStream *stream);
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+        ~Scope();
+    };
+
+    // Flux du thread courant (nullptr si la réponse ne peut pas être envoyée par blocs)
+    static ResponseStream *current();
+
+    // Annonce une réponse par blocs : la réponse du handler sera envoyée après le bloc final
+    void open() { opened = true; }
+    bool isOpen() const { return opened; }
+    // Envoie un bloc de `rows` lignes ; renvoie false si le client ne reçoit plus
+    bool write(const std::string &chunk, size_t rows);
+    // Envoie le bloc final puis la réponse de fin
+    bool finish(const std::string &response);
+    bool hasFailed() const { return failed; }
+    uint64_t getChunks() const { return chunks; }
+    uint64_t getRows() const { return rows; }
+    uint64_t getBytes() const { return bytes; }
+};
+
+#endif // RESPONSESTREAM_H
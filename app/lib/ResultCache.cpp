@@ -0,0 +1,83 @@
+#include "ResultCache.h"
+#include <cctype>
+
+ResultCache::ResultCache(size_t maxBytes) : bytes(0), maxBytes(maxBytes), hits(0), misses(0) {}
+
+std::string ResultCache::normalize(const std::string &command) {
+    std::string result;
+    result.reserve(command.size());
+    bool quoted = false;
+    bool pendingSpace = false;
+    for (size_t i = 0; i < command.size(); i++) {
+        char c = command[i];
+        if (!quoted && std::isspace(static_cast<unsigned char>(c))) {
+            pendingSpace = !result.empty();
+            continue;
+        }
+        if (pendingSpace) {
+            result += ' ';
+            pendingSpace = false;
+        }
+        result += c;
+        if (c == '"' && (i == 0 || command[i - 1] != '\\'))
+            quoted = !quoted;
+    }
+    while (!result.empty() && (result.back() == ';' || result.back() == ' '))
+        result.pop_back();
+    return result;
+}
+
+void ResultCache::erase(std::list<Entry>::iterator it) {
+    bytes -= entrySize(*it);
+    index.erase(it->key);
+    entries.erase(it);
+}
+
+bool ResultCache::lookup(const std::string &key, uint64_t version, std::string *response) {
+    if (!enabled())
+        return false;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = index.find(key);
+    if (found == index.end()) {
+        misses++;
+        return false;
+    }
+    if (found->second->version != version) {
+        // Le dataset a été modifié depuis le calcul de la réponse
+        erase(found->second);
+        misses++;
+        return false;
+    }
+    entries.splice(entries.begin(), entries, found->second);
+    *response = found->second->response;
+    hits++;
+    return true;
+}
+
+void ResultCache::store(const std::string &key, uint64_t version, const std::string &response) {
+    if (!enabled())
+        return;
+    Entry entry{key, version, response};
+    size_t size = entrySize(entry);
+    if (size > maxBytes)
+        return;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = index.find(key);
+    if (found != index.end())
+        erase(found->second);
+    while (bytes + size > maxBytes && !entries.empty())
+        erase(std::prev(entries.end()));
+    entries.push_front(std::move(entry));
+    index[key] = entries.begin();
+    bytes += size;
+}
+
+size_t ResultCache::getEntryCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+size_t ResultCache::getBytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytes;
+}
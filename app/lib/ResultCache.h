@@ -0,0 +1,71 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#define DEFAULT_RESULT_CACHE_BYTES (64 * 1024 * 1024)  // Taille maximale par défaut du cache de résultats
+#define RESULT_CACHE_ENTRY_OVERHEAD 128                // Coût estimé d'une entrée (nœud de liste, index)
+
+/**
+ * @brief Cache LRU des réponses aux lectures, borné en octets.
+ *
+ * Une entrée est indexée par la commande normalisée et associée à la version du dataset lu
+ * au moment de l'exécution. Une écriture change la version du dataset : l'entrée ne
+ * correspond plus et est supprimée à la lecture suivante. Les réponses mises en cache sont
+ * les chaînes déjà sérialisées, une lecture répétée ne coûte qu'une recherche dans l'index.
+ */
+class ResultCache {
+private:
+    struct Entry {
+        std::string key;
+        uint64_t version;
+        std::string response;
+    };
+    std::list<Entry> entries;  ///< de la plus récemment utilisée à la plus ancienne
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    size_t bytes;
+    size_t maxBytes;
+    std::mutex mutex;
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+
+    static size_t entrySize(const Entry &entry) { return entry.key.size() + entry.response.size() + RESULT_CACHE_ENTRY_OVERHEAD; }
+    void erase(std::list<Entry>::iterator it);
+
+public:
+    explicit ResultCache(size_t maxBytes = DEFAULT_RESULT_CACHE_BYTES);
+
+    /**
+     * @brief Forme canonique d'une commande : espaces consécutifs réduits (hors chaînes entre
+     * guillemets), espaces et ';' terminaux retirés.
+     */
+    static std::string normalize(const std::string &command);
+
+    bool enabled() const { return maxBytes > 0; }
+
+    /**
+     * @brief Recherche la réponse de `key` calculée pour `version` ; une entrée d'une autre
+     * version est supprimée.
+     * @return true si la réponse a été trouvée (copiée dans `response`).
+     */
+    bool lookup(const std::string &key, uint64_t version, std::string *response);
+
+    /**
+     * @brief Enregistre la réponse de `key` pour `version`, en évinçant les entrées les moins
+     * récemment utilisées si nécessaire.
+     */
+    void store(const std::string &key, uint64_t version, const std::string &response);
+
+    uint64_t getHits() const { return hits; }
+    uint64_t getMisses() const { return misses; }
+    size_t getEntryCount();
+    size_t getBytes();
+    size_t getMaxBytes() const { return maxBytes; }
+};
+
+#endif // RESULT_CACHE_H
@@ -0,0 +1,31 @@
+#include "SingleFlight.h"
+
+std::string SingleFlight::run(const std::string &key, const std::function<std::string()> &fn) {
+    std::promise<std::string> promise;
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = calls.find(key);
+    if (it != calls.end()) {
+        // Une exécution identique est en cours : attente de sa réponse, verrou relâché
+        std::shared_future<std::string> pending = it->second;
+        lock.unlock();
+        coalesced++;
+        return pending.get();
+    }
+    calls.emplace(key, promise.get_future().share());
+    lock.unlock();
+
+    executions++;
+    std::string result;
+    try {
+        result = fn();
+    } catch (...) {
+        promise.set_exception(std::current_exception());
+        lock.lock();
+        calls.erase(key);
+        throw;
+    }
+    promise.set_value(result);
+    lock.lock();
+    calls.erase(key);
+    return result;
+}
@@ -0,0 +1,39 @@
+#ifndef SINGLE_FLIGHT_H
+#define SINGLE_FLIGHT_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * @brief Regroupement des exécutions identiques simultanées (single-flight).
+ *
+ * Le premier appel d'une clé exécute la fonction ; les appels de la même clé arrivés avant
+ * la fin de cette exécution attendent et reçoivent la même réponse sérialisée, sans
+ * recharger ni reparcourir le dataset.
+ */
+class SingleFlight {
+private:
+    std::mutex mutex;
+    std::unordered_map<std::string, std::shared_future<std::string>> calls; ///< exécutions en cours
+    std::atomic<uint64_t> executions;
+    std::atomic<uint64_t> coalesced;
+
+public:
+    SingleFlight() : executions(0), coalesced(0) {}
+
+    /**
+     * @brief Exécute `fn` pour `key`, ou attend l'exécution déjà en cours pour cette clé.
+     * Une exception levée par `fn` est transmise à tous les appelants.
+     */
+    std::string run(const std::string &key, const std::function<std::string()> &fn);
+
+    uint64_t getExecutions() const { return executions; }
+    uint64_t getCoalesced() const { return coalesced; }
+};
+
+#endif // SINGLE_FLIGHT_H
@@ -7,9 +7,14 @@
  * @param handlers Table de dispatch associant les commandes aux handlers.
  * @param maxWorkers Nombre maximum de threads workers.
  * @param maxTaskQueueSize Taille maximale de la file d'attente des tâches.
+ * @param resultCache Cache des réponses aux lectures (nullptr pour le désactiver).
+ * @param singleFlight Regroupement des lectures identiques simultanées (nullptr pour le désactiver).
+ * @param compression Compression des réponses demandée par COMPRESS (nullptr : réponses jamais compressées).
  */
-SyncService::SyncService(int server_fd, HandlerMap& handlers, int maxWorkers, int maxTaskQueueSize)
-    : server_fd_(server_fd), handlers_(handlers), running_(true), maxWorkers_(maxWorkers), maxTaskQueueSize_(maxTaskQueueSize) {
+SyncService::SyncService(int server_fd, HandlerMap& handlers, int maxWorkers, int maxTaskQueueSize, ResultCache* resultCache,
+                         SingleFlight* singleFlight, ResponseCompression* compression)
+    : server_fd_(server_fd), handlers_(handlers), running_(true), maxWorkers_(maxWorkers), maxTaskQueueSize_(maxTaskQueueSize),
+      resultCache_(resultCache), singleFlight_(singleFlight), compression_(compression) {
     // Limite le nombre de workers à un maximum raisonnable
     bool max_workers_exceeded = (maxWorkers_ > 64);
     if (max_workers_exceeded) {
@@ -111,35 +116,40 @@ void SyncService::workerLoop() {
         bool task_is_valid = (task.socket >= 0);
         if (task_is_valid) {
             std::ostringstream logMsg;
-            logMsg << "Traitement de la commande dans thread: " << task.request;
+            logMsg << "Traitement de la commande dans thread: " << task.command->getSource();
             LogService::log(logMsg.str());
 
-            // Mesure du temps de traitement
-            auto startTime = std::chrono::steady_clock::now();
-            std::string command = task.request.substr(0, task.request.find(' '));
-            auto it = handlers_.find(command);
-            bool handler_found = (it != handlers_.end());
-            std::unique_ptr<ROKT::ResponseObject> response;
-            if (handler_found) {
-                response = it->second->handle(task.request);
-            } else {
-                response = ROKT::ResponseService::response(1, "Commande non reconnue : " + command);
-            }
-            auto endTime = std::chrono::steady_clock::now();
-            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
-
-            bool processing_timeout_exceeded = (duration > PROCESSING_TIMEOUT_MS);
-            if (processing_timeout_exceeded) {
-                LogService::log("Traitement trop long (> " + std::to_string(PROCESSING_TIMEOUT_MS) + "ms).");
-                response = ROKT::ResponseService::response(504, "Request timeout");
+            // Un handler peut envoyer sa réponse par blocs pendant son exécution (GET ... STREAM) :
+            // la réponse qu'il renvoie est alors transmise après le bloc final
+            // La compression s'applique à l'envoi : le cache conserve les réponses non compressées
+            ResponseStream stream(task.socket, task.command->isCompressed() ? compression_ : nullptr);
+            // Les lignes de données d'un BULK ADD sont lues par le handler au fil de leur arrivée
+            RequestInput input(task.socket);
+            std::string responseStr;
+            {
+                ResponseStream::Scope streamScope(&stream);
+                RequestInput::Scope inputScope(&input);
+                ResponseEncoding::Scope encodingScope(task.command->getFormat());
+                responseStr = executeCommand(*task.command);
             }
-
-            std::string responseStr = response->getResponse();
             logMsg.str("");
-            logMsg << "Réponse générée dans thread: " << responseStr;
+            if (ResponseEncoding::isBinary(task.command->getFormat()))
+                logMsg << "Réponse générée dans thread: " << responseStr.size() << " octets " << ResponseEncoding::name(task.command->getFormat());
+            else
+                logMsg << "Réponse générée dans thread: " << responseStr;
+            if (stream.isOpen())
+                logMsg << " (" << stream.getChunks() << " blocs, " << stream.getBytes() << " octets envoyés)";
+            if (input.getBytes() > 0)
+                logMsg << " (" << input.getBytes() << " octets de données lus)";
             LogService::log(logMsg.str());
 
-            bool send_failed = (send(task.socket, responseStr.c_str(), responseStr.size(), 0) < 0);
+            bool send_failed;
+            if (stream.isOpen()) {
+                send_failed = !stream.finish(responseStr);
+            } else {
+                std::string wire = wireResponse(*task.command, responseStr);
+                send_failed = (send(task.socket, wire.c_str(), wire.size(), 0) < 0);
+            }
             if (send_failed) {
                 LogService::log("Erreur lors de l'envoi de la réponse dans thread.");
             }
@@ -148,6 +158,98 @@ void SyncService::workerLoop() {
     }
 }
 
+/**
+ * @brief Prépare une réponse non découpée en blocs pour l'envoi. Si la requête a demandé
+ * COMPRESS, la réponse est précédée de son en-tête ("deflate" ou "identity" sous le seuil).
+ * @param command Requête analysée.
+ * @param response Réponse sérialisée.
+ * @return Les octets à envoyer au client.
+ */
+std::string SyncService::wireResponse(const RoktCommand& command, const std::string& response) {
+    bool compression_requested = (command.isCompressed() && compression_ != nullptr);
+    return compression_requested ? compression_->encode(response) : response;
+}
+
+/**
+ * @brief Exécute une commande avec son handler, en passant par le cache de résultats pour les lectures.
+ * La version du dataset est lue avant l'exécution : une écriture concurrente rend l'entrée
+ * enregistrée obsolète, elle ne sera jamais servie. Les lectures identiques simultanées sur la
+ * même version ne sont exécutées qu'une fois, tous les appelants recevant la même réponse.
+ * @param command Requête analysée.
+ * @return La réponse sérialisée à envoyer au client.
+ */
+std::string SyncService::executeCommand(const RoktCommand& command) {
+    auto it = handlers_.find(command.getKind());
+    bool handler_found = (it != handlers_.end());
+    if (!handler_found)
+        return ROKT::ResponseService::response(1, "Commande non reconnue : " + std::string(command.getKeyword()))->getResponse();
+    bool syntax_error = command.hasError();
+    if (syntax_error)
+        return ROKT::ResponseService::response(423, command.getError())->getResponse();
+
+    uint64_t version = 0;
+    std::string key;
+    bool is_versioned_read = it->second->cacheVersion(command, &version, &key);
+    if (!is_versioned_read)
+        return runHandler(*it->second, command, nullptr);
+    if (key.empty())
+        key = ResultCache::normalize(command.getSource());
+    // Une même lecture demandée dans un autre format a sa propre entrée
+    if (command.getFormat() != ResponseEncoding::Format::PRETTY)
+        key = std::string("FORMAT ") + ResponseEncoding::name(command.getFormat()) + '\x1f' + key;
+
+    bool cache_enabled = (resultCache_ != nullptr && resultCache_->enabled());
+    std::string cached;
+    if (cache_enabled && resultCache_->lookup(key, version, &cached))
+        return cached;
+
+    auto execute = [&]() {
+        int status = 0;
+        std::string responseStr = runHandler(*it->second, command, &status);
+        // Seules les réponses réussies sont conservées
+        if (cache_enabled && status == 0)
+            resultCache_->store(key, version, responseStr);
+        return responseStr;
+    };
+    if (singleFlight_ == nullptr)
+        return execute();
+    return singleFlight_->run(key + '\n' + std::to_string(version), execute);
+}
+
+/**
+ * @brief Exécute le handler et applique le contrôle du temps de traitement.
+ * @param handler Handler associé à la commande.
+ * @param command Requête analysée.
+ * @param status Reçoit le code de statut de la réponse (peut être nul).
+ * @return La réponse sérialisée.
+ */
+std::string SyncService::runHandler(CommandHandler& handler, const RoktCommand& command, int* status) {
+    // Les documents temporaires de la requête sont alloués dans l'arène du worker,
+    // libérée en une fois à la fin du bloc
+    ROKT::ArenaScope arenaScope;
+
+    // Mesure du temps de traitement
+    auto startTime = std::chrono::steady_clock::now();
+    std::unique_ptr<ROKT::ResponseObject> response = handler.handle(command);
+    auto endTime = std::chrono::steady_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
+
+    // Les lignes d'une réponse par blocs ont déjà été envoyées, et les lots d'un BULK ADD ou d'un
+    // IMPORT écrits à mesure de leur lecture (comme le fichier d'un EXPORT) : leur statut est conservé
+    ResponseStream* stream = ResponseStream::current();
+    bool is_batch_transfer = (command.getKind() == RoktCommand::Kind::BULK_ADD || command.getKind() == RoktCommand::Kind::IMPORT ||
+                              command.getKind() == RoktCommand::Kind::EXPORT);
+    bool processing_timeout_exceeded = (duration > PROCESSING_TIMEOUT_MS) && !(stream != nullptr && stream->isOpen()) &&
+                                       !is_batch_transfer;
+    if (processing_timeout_exceeded) {
+        LogService::log("Traitement trop long (> " + std::to_string(PROCESSING_TIMEOUT_MS) + "ms).");
+        response = ROKT::ResponseService::response(504, "Request timeout");
+    }
+    if (status != nullptr)
+        *status = response->getStatusCode();
+    return response->getResponse();
+}
+
 /**
  * @brief Surveille les événements réseau avec epoll et dispatche les tâches aux workers.
  * Gère les nouvelles connexions et les données des clients existants.
@@ -176,6 +278,7 @@ void SyncService::processEpollEvents() {
                 handleClientData(fd);
             }
         }
+        expireIdleConnections();
     }
 }
 
@@ -199,6 +302,10 @@ void SyncService::handleNewConnection(struct sockaddr_in& address, socklen_t add
     setsockopt(new_socket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
     setsockopt(new_socket, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
 
+    // La requête est lue sans blocage par le thread epoll, à mesure de son arrivée ; le socket
+    // redevient bloquant (avec les délais ci-dessus) lorsqu'il est confié à un worker
+    fcntl(new_socket, F_SETFL, fcntl(new_socket, F_GETFL, 0) | O_NONBLOCK);
+
     struct epoll_event ev;
     ev.events = EPOLLIN | EPOLLONESHOT;
     ev.data.fd = new_socket;
@@ -206,32 +313,148 @@ void SyncService::handleNewConnection(struct sockaddr_in& address, socklen_t add
     if (epoll_add_failed) {
         LogService::log("Échec de l'ajout du nouveau socket à epoll.");
         close(new_socket);
+        return;
+    }
+    pending_[new_socket].lastActivity = std::chrono::steady_clock::now();
+}
+
+/**
+ * @brief Lit les données disponibles d'un socket client non bloquant et les ajoute à la requête en
+ * cours : jusqu'au ';' terminal, ou jusqu'à la fin des données reçues hors chaîne et hors bloc
+ * JSON. Un ADD de plusieurs lignes peut ainsi arriver en plusieurs fois sans bloquer les autres
+ * connexions.
+ * @param client_socket Descripteur du socket client.
+ * @param pending Requête en cours de réception sur ce socket.
+ * @return L'état de la requête après la lecture.
+ */
+SyncService::ReadStatus SyncService::readRequest(int client_socket, PendingRequest& pending) {
+    char buffer[READ_BUFFER_SIZE];
+    std::string& request = pending.data;
+    while (true) {
+        ssize_t valread = read(client_socket, buffer, sizeof(buffer));
+        if (valread < 0 && errno == EINTR)
+            continue;
+        if (valread <= 0) {
+            bool no_more_data = (valread < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+            if (!no_more_data)
+                return request.empty() ? ReadStatus::CLOSED : ReadStatus::COMPLETE; // La requête reçue est traitée telle quelle
+            // Hors chaîne et hors bloc JSON, les données reçues forment la requête (';' facultatif)
+            bool request_complete = (!request.empty() && pending.depth == 0 && !pending.quoted);
+            return request_complete ? ReadStatus::COMPLETE : ReadStatus::INCOMPLETE;
+        }
+        request.append(buffer, static_cast<size_t>(valread));
+        for (size_t i = pending.scanned; i < request.size(); i++) {
+            char c = request[i];
+            if (pending.quoted) {
+                if (pending.escaped)
+                    pending.escaped = false;
+                else if (c == '\\')
+                    pending.escaped = true;
+                else if (c == '"')
+                    pending.quoted = false;
+            } else if (c == '"') {
+                pending.quoted = true;
+            } else if (c == '{' || c == '[') {
+                pending.depth++;
+            } else if ((c == '}' || c == ']') && pending.depth > 0) {
+                pending.depth--;
+            } else if (pending.depth == 0 && c == ';') {
+                return ReadStatus::COMPLETE;
+            } else if (pending.depth == 0 && c == '\n' && !pending.firstLineChecked) {
+                // Un BULK ADD est transmis au worker dès son en-tête
+                pending.firstLineChecked = true;
+                if (RoktCommand::isBulkHeader(std::string_view(request).substr(0, i)))
+                    return ReadStatus::COMPLETE;
+            }
+        }
+        pending.scanned = request.size();
+        if (request.size() > MAX_REQUEST_BYTES)
+            return ReadStatus::TOO_LARGE;
+    }
+}
+
+/**
+ * @brief Ferme une connexion dont la requête est en cours de réception.
+ * @param client_socket Descripteur du socket client.
+ */
+void SyncService::closePending(int client_socket) {
+    pending_.erase(client_socket);
+    close(client_socket);
+}
+
+/**
+ * @brief Ferme les connexions sans données reçues depuis SOCKET_TIMEOUT_SEC. La recherche est
+ * faite au plus une fois par seconde.
+ */
+void SyncService::expireIdleConnections() {
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastExpiry_ < std::chrono::seconds(1))
+        return;
+    lastExpiry_ = now;
+    for (auto it = pending_.begin(); it != pending_.end();) {
+        bool idle_timeout = (now - it->second.lastActivity > std::chrono::seconds(SOCKET_TIMEOUT_SEC));
+        if (!idle_timeout) {
+            ++it;
+            continue;
+        }
+        LogService::log("Requête incomplète après " + std::to_string(SOCKET_TIMEOUT_SEC) + "s. Fermeture de la connexion.");
+        close(it->first);
+        it = pending_.erase(it);
     }
 }
 
 /**
  * @brief Lit et traite les données reçues d'un socket client.
- * Ajoute les tâches à la file d'attente prioritaire si possible.
+ * Ajoute les tâches à la file d'attente prioritaire lorsque la requête est complète ; sinon la
+ * connexion est réarmée dans epoll pour la suite de la requête.
  * @param client_socket Descripteur du socket client.
  */
 void SyncService::handleClientData(int client_socket) {
-    char buffer[2048] = {0};
-    int valread = read(client_socket, buffer, 2048);
-    bool read_failed_or_timeout = (valread <= 0);
-    if (read_failed_or_timeout) {
+    auto it = pending_.find(client_socket);
+    if (it == pending_.end()) {
         close(client_socket);
         return;
     }
+    ReadStatus status = readRequest(client_socket, it->second);
+    if (status == ReadStatus::CLOSED) {
+        closePending(client_socket);
+        return;
+    }
+    if (status == ReadStatus::TOO_LARGE) {
+        LogService::log("Requête trop volumineuse (> " + std::to_string(MAX_REQUEST_BYTES) + " octets). Rejet.");
+        std::string response = ROKT::ResponseService::response(413, "Request too large")->getResponse();
+        send(client_socket, response.c_str(), response.size(), 0);
+        closePending(client_socket);
+        return;
+    }
+    if (status == ReadStatus::INCOMPLETE) {
+        it->second.lastActivity = std::chrono::steady_clock::now();
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLONESHOT;
+        ev.data.fd = client_socket;
+        bool epoll_rearm_failed = (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, client_socket, &ev) < 0);
+        if (epoll_rearm_failed) {
+            LogService::log("Échec du réarmement du socket dans epoll.");
+            closePending(client_socket);
+        }
+        return;
+    }
+    std::string request = std::move(it->second.data);
+    pending_.erase(it);
+    // Le worker lit (BULK ADD) et écrit sur le socket en mode bloquant, avec les délais du socket
+    fcntl(client_socket, F_SETFL, fcntl(client_socket, F_GETFL, 0) & ~O_NONBLOCK);
 
-    std::string request(buffer, valread);
-    int priority = getCommandPriority(request);
+    // Analyse unique de la requête : le dispatch, la priorité et le handler utilisent la commande obtenue
+    std::shared_ptr<const RoktCommand> command = RoktCommand::parse(std::move(request));
+    int priority = getCommandPriority(*command);
 
     std::lock_guard<std::mutex> lock(queueMutex_);
     size_t queueSize = taskQueue_.size();
     bool queue_is_full = ((int)queueSize >= maxTaskQueueSize_);
     if (queue_is_full) {
         LogService::log("File d'attente pleine. Rejet de la requête.");
-        std::string response = ROKT::ResponseService::response(503, "Server overloaded")->getResponse();
+        ResponseEncoding::Scope encodingScope(command->getFormat());
+        std::string response = wireResponse(*command, ROKT::ResponseService::response(503, "Server overloaded")->getResponse());
         send(client_socket, response.c_str(), response.size(), 0);
         close(client_socket);
         return;
@@ -244,7 +467,7 @@ void SyncService::handleClientData(int client_socket) {
         std::this_thread::sleep_for(std::chrono::milliseconds(BACKPRESSURE_DELAY_MS));
     }
 
-    taskQueue_.push(Task(client_socket, request, priority));
+    taskQueue_.push(Task(client_socket, std::move(command), priority));
     queueCond_.notify_one();
 
     bool queue_is_long = (queueSize > BACKPRESSURE_THRESHOLD);
@@ -256,16 +479,46 @@ void SyncService::handleClientData(int client_socket) {
 }
 
 /**
- * @brief Détermine la priorité d'une commande à partir de sa chaîne de caractères.
- * @param command Requête complète reçue.
+ * @brief Détermine la priorité d'une commande à partir de son type.
+ * @param command Requête analysée.
  * @return Priorité numérique (10 pour CREATE/DELETE, 5 pour ADD/REMOVE/CHANGE, 1 pour GET/COUNT/EMPTY).
+ * PROFILE et EXECUTE prennent celle de la commande qu'ils exécutent.
  */
-int SyncService::getCommandPriority(const std::string& command) {
-    size_t spacePos = command.find(' ');
-    std::string cmd = (spacePos != std::string::npos) ? command.substr(0, spacePos) : command;
-
-    if (cmd == "CREATE" || cmd == "DELETE") return 10; // Haute priorité
-    if (cmd == "ADD" || cmd == "REMOVE" || cmd == "CHANGE") return 5; // Moyenne
-    if (cmd == "GET" || cmd == "COUNT" || cmd == "EMPTY") return 1; // Basse
-    return 0; // Par défaut
-}
\ No newline at end of file
+int SyncService::getCommandPriority(const RoktCommand& command) {
+    switch (command.getKind()) {
+        case RoktCommand::Kind::PROFILE:
+            return getCommandPriority(*command.as<RoktExplainQuery>().inner); // Celle de la commande exécutée
+        case RoktCommand::Kind::EXECUTE: {
+            // Celle de la commande préparée, connue du handler d'EXECUTE
+            auto it = handlers_.find(RoktCommand::Kind::EXECUTE);
+            return it == handlers_.end() ? 0 : getKindPriority(it->second->executedKind(command));
+        }
+        default:
+            return getKindPriority(command.getKind());
+    }
+}
+
+/**
+ * @brief Priorité d'un type de commande (voir getCommandPriority).
+ */
+int SyncService::getKindPriority(RoktCommand::Kind kind) {
+    switch (kind) {
+        case RoktCommand::Kind::CREATE:
+        case RoktCommand::Kind::CREATE_VIEW:
+        case RoktCommand::Kind::DELETE:
+            return 10; // Haute priorité
+        case RoktCommand::Kind::ADD:
+        case RoktCommand::Kind::BULK_ADD:
+        case RoktCommand::Kind::IMPORT:
+        case RoktCommand::Kind::REMOVE:
+        case RoktCommand::Kind::CHANGE:
+            return 5; // Moyenne
+        case RoktCommand::Kind::GET:
+        case RoktCommand::Kind::COUNT:
+        case RoktCommand::Kind::EXPORT:
+        case RoktCommand::Kind::EMPTY:
+            return 1; // Basse
+        default:
+            return 0; // Par défaut
+    }
+}
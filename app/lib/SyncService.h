@@ -2,6 +2,7 @@
 #define SYNC_SERVICE_H
 
 #include <sys/epoll.h>
+#include <fcntl.h>
 #include <thread>
 #include <queue>
 #include <mutex>
@@ -16,8 +17,15 @@
 #include <chrono>
 #include <functional>
 #include "CommandHandler.h"
+#include "RoktCommand.h"
 #include "LogService.h"
 #include "RoktResponseService.h"
+#include "RequestArena.h"
+#include "ResultCache.h"
+#include "SingleFlight.h"
+#include "ResponseStream.h"
+#include "ResponseCompression.h"
+#include "RequestInput.h"
 
 // Définition des constantes absolues pour la configuration du service
 #define DEFAULT_MAX_WORKERS 8              // Nombre maximum de workers par défaut
@@ -26,34 +34,56 @@
 #define SOCKET_TIMEOUT_SEC 10             // Timeout en secondes pour les opérations de lecture/écriture sur socket
 #define PROCESSING_TIMEOUT_MS 5000        // Timeout maximal en millisecondes pour traiter une commande
 #define BACKPRESSURE_DELAY_MS 100         // Délai en millisecondes appliqué lors de la temporisation en cas de surcharge
+#define READ_BUFFER_SIZE 65536            // Taille d'une lecture sur le socket client
+#define MAX_REQUEST_BYTES (64 * 1024 * 1024) // Taille maximale d'une requête (ADD d'un tableau de lignes)
 
 /**
  * @brief Classe SyncService gérant la synchronisation des connexions réseau et le traitement des commandes.
  *
  * Cette classe utilise epoll pour surveiller les sockets et un pool de threads workers pour traiter les
- * commandes en parallèle selon leurs priorités. Elle associe chaque commande à un handler via une
- * table de dispatch (HandlerMap) pour une exécution rapide.
+ * commandes en parallèle selon leurs priorités. Chaque requête est analysée une seule fois à sa
+ * réception ; le type de la commande obtenue détermine sa priorité et son handler, via une table
+ * de dispatch (HandlerMap).
  */
 class SyncService {
 public:
     // Structure représentant une tâche dans la file d'attente
     struct Task {
-        int socket;           // Socket client associé à la tâche
-        std::string request;  // Requête complète à traiter
-        int priority;         // Priorité de la tâche (plus élevé = traité en premier)
+        int socket;                                    // Socket client associé à la tâche
+        std::shared_ptr<const RoktCommand> command;    // Requête analysée à la réception
+        int priority;                                  // Priorité de la tâche (plus élevé = traité en premier)
         
         /**
          * @brief Constructeur personnalisé pour une tâche.
          * @param s Socket client.
-         * @param r Requête à traiter.
+         * @param c Commande à traiter.
          * @param p Priorité de la tâche.
          */
-        Task(int s, const std::string& r, int p) : socket(s), request(r), priority(p) {}
+        Task(int s, std::shared_ptr<const RoktCommand> c, int p) : socket(s), command(std::move(c)), priority(p) {}
         
         /**
          * @brief Constructeur par défaut pour une tâche vide.
          */
-        Task() : socket(-1), request(""), priority(0) {}
+        Task() : socket(-1), command(nullptr), priority(0) {}
+    };
+
+    // Requête en cours de réception sur une connexion (lue par le thread epoll, sans blocage)
+    struct PendingRequest {
+        std::string data;               // octets reçus
+        size_t scanned = 0;             // octets déjà analysés
+        int depth = 0;                  // blocs JSON ouverts
+        bool quoted = false;            // dans une chaîne
+        bool escaped = false;           // caractère précédent '\' dans une chaîne
+        bool firstLineChecked = false;  // en-tête BULK ADD recherché sur la première ligne
+        std::chrono::steady_clock::time_point lastActivity;
+    };
+
+    // Issue d'une lecture de requête
+    enum class ReadStatus {
+        INCOMPLETE,  // requête à compléter : la connexion est réarmée dans epoll
+        COMPLETE,    // requête prête à être traitée
+        TOO_LARGE,   // requête supérieure à MAX_REQUEST_BYTES
+        CLOSED       // connexion fermée ou en erreur sans requête
     };
 
     // Comparateur pour trier les tâches par priorité décroissante dans la priority_queue
@@ -69,8 +99,8 @@ public:
         }
     };
 
-    // Définition du type HandlerMap pour associer les commandes aux handlers
-    using HandlerMap = std::unordered_map<std::string, std::unique_ptr<CommandHandler>>;
+    // Définition du type HandlerMap pour associer les types de commandes aux handlers
+    using HandlerMap = std::unordered_map<RoktCommand::Kind, std::unique_ptr<CommandHandler>>;
 
     /**
      * @brief Constructeur de SyncService.
@@ -78,8 +108,12 @@ public:
      * @param handlers Table de dispatch associant les commandes aux handlers.
      * @param maxWorkers Nombre maximum de threads workers (par défaut DEFAULT_MAX_WORKERS).
      * @param maxTaskQueueSize Taille maximale de la file d'attente (par défaut DEFAULT_MAX_TASK_QUEUE_SIZE).
+     * @param resultCache Cache des réponses aux lectures (nullptr pour le désactiver).
+     * @param singleFlight Regroupement des lectures identiques simultanées (nullptr pour le désactiver).
+     * @param compression Compression des réponses demandée par COMPRESS (nullptr : réponses jamais compressées).
      */
-    SyncService(int server_fd, HandlerMap& handlers, int maxWorkers = DEFAULT_MAX_WORKERS, int maxTaskQueueSize = DEFAULT_MAX_TASK_QUEUE_SIZE);
+    SyncService(int server_fd, HandlerMap& handlers, int maxWorkers = DEFAULT_MAX_WORKERS, int maxTaskQueueSize = DEFAULT_MAX_TASK_QUEUE_SIZE,
+                ResultCache* resultCache = nullptr, SingleFlight* singleFlight = nullptr, ResponseCompression* compression = nullptr);
 
     /**
      * @brief Destructeur de SyncService.
@@ -108,6 +142,20 @@ private:
     volatile bool running_;                                         // Indicateur de l'état d'exécution du service
     int maxWorkers_;                                                // Nombre maximum de threads workers
     int maxTaskQueueSize_;                                          // Taille maximale de la file d'attente
+    ResultCache* resultCache_;                                      // Cache des réponses aux lectures (peut être nul)
+    SingleFlight* singleFlight_;                                    // Lectures identiques en cours (peut être nul)
+    ResponseCompression* compression_;                              // Compression des réponses (peut être nul)
+    std::unordered_map<int, PendingRequest> pending_;               // Requêtes en réception (thread epoll uniquement)
+    std::chrono::steady_clock::time_point lastExpiry_;              // Dernière recherche des connexions inactives
+
+    /**
+     * @brief Prépare une réponse non découpée en blocs pour l'envoi : en-tête et compression si la
+     * requête a demandé COMPRESS, réponse inchangée sinon.
+     * @param command Requête analysée.
+     * @param response Réponse sérialisée.
+     * @return Les octets à envoyer au client.
+     */
+    std::string wireResponse(const RoktCommand& command, const std::string& response);
 
     /**
      * @brief Boucle de traitement exécutée par chaque thread worker.
@@ -115,6 +163,22 @@ private:
      */
     void workerLoop();
 
+    /**
+     * @brief Exécute une commande avec son handler, en passant par le cache de résultats pour les lectures.
+     * @param command Requête analysée.
+     * @return La réponse sérialisée à envoyer au client.
+     */
+    std::string executeCommand(const RoktCommand& command);
+
+    /**
+     * @brief Exécute le handler et applique le contrôle du temps de traitement.
+     * @param handler Handler associé à la commande.
+     * @param command Requête analysée.
+     * @param status Reçoit le code de statut de la réponse (peut être nul).
+     * @return La réponse sérialisée.
+     */
+    std::string runHandler(CommandHandler& handler, const RoktCommand& command, int* status);
+
     /**
      * @brief Surveille les événements réseau avec epoll et dispatche les tâches aux workers.
      */
@@ -127,6 +191,29 @@ private:
      */
     void handleNewConnection(struct sockaddr_in& address, socklen_t addrlen);
 
+    /**
+     * @brief Lit les données disponibles d'un socket client non bloquant et les ajoute à la requête
+     * en cours. La requête est complète au ';' terminal, ou à la fin des données reçues hors chaîne
+     * et hors bloc JSON ; la première ligne d'un BULK ADD suffit (ses lignes de données sont lues
+     * par le handler).
+     * @param client_socket Descripteur du socket client.
+     * @param pending Requête en cours de réception sur ce socket.
+     * @return L'état de la requête après la lecture.
+     */
+    ReadStatus readRequest(int client_socket, PendingRequest& pending);
+
+    /**
+     * @brief Ferme une connexion dont la requête est en cours de réception.
+     * @param client_socket Descripteur du socket client.
+     */
+    void closePending(int client_socket);
+
+    /**
+     * @brief Ferme les connexions sans données reçues depuis SOCKET_TIMEOUT_SEC : un client qui
+     * n'achève pas sa requête n'occupe ni le thread epoll ni un worker.
+     */
+    void expireIdleConnections();
+
     /**
      * @brief Lit et traite les données reçues d'un socket client.
      * @param client_socket Descripteur du socket client.
@@ -134,11 +221,13 @@ private:
     void handleClientData(int client_socket);
 
     /**
-     * @brief Détermine la priorité d'une commande à partir de sa chaîne de caractères.
-     * @param command Requête complète reçue.
-     * @return Priorité numérique (ex. 10 pour CREATE, 5 pour ADD, 1 pour GET).
+     * @brief Détermine la priorité d'une commande à partir de son type.
+     * @param command Requête analysée.
+     * @return Priorité numérique (ex. 10 pour CREATE, 5 pour ADD, 1 pour GET). PROFILE et EXECUTE
+     * prennent celle de la commande qu'ils exécutent.
      */
-    int getCommandPriority(const std::string& command);
+    int getCommandPriority(const RoktCommand& command);
+    int getKindPriority(RoktCommand::Kind kind);
 };
 
 #endif // SYNC_SERVICE_H
\ No newline at end of file
@@ -0,0 +1,331 @@
+// RoktAggregate.cpp
+#include "RoktAggregate.h"
+#include "Utils.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+
+namespace {
+    // Taille initiale de la table d'un groupe (puissance de deux)
+    const size_t AGGREGATE_INITIAL_SLOTS = 16;
+}
+
+bool RoktAggregator::parse(const std::string &fields, std::vector<Aggregate> *aggregates, std::string *error) {
+    error->clear();
+    if (fields.find('(') == std::string::npos)
+        return false;
+    size_t start = 0;
+    while (start <= fields.size()) {
+        // Les virgules entre parenthèses séparent les arguments d'un agrégat
+        size_t comma = start;
+        for (int depth = 0; comma < fields.size() && (fields[comma] != ',' || depth > 0); comma++) {
+            if (fields[comma] == '(')
+                depth++;
+            else if (fields[comma] == ')')
+                depth--;
+        }
+        std::string item = trim(fields.substr(start, comma - start));
+        start = comma + 1;
+        size_t open = item.find('(');
+        if (open == std::string::npos || item.back() != ')') {
+            *error = "Agrégat invalide : " + item;
+            return false;
+        }
+        std::string name = trim(item.substr(0, open));
+        std::string field = trim(item.substr(open + 1, item.size() - open - 2));
+        Aggregate aggregate;
+        if (name == "COUNT")
+            aggregate.function = Function::COUNT;
+        else if (name == "SUM")
+            aggregate.function = Function::SUM;
+        else if (name == "AVG")
+            aggregate.function = Function::AVG;
+        else if (name == "MIN")
+            aggregate.function = Function::MIN;
+        else if (name == "MAX")
+            aggregate.function = Function::MAX;
+        else if (name == "APPROX_COUNT_DISTINCT")
+            aggregate.function = Function::APPROX_COUNT_DISTINCT;
+        else {
+            *error = "Fonction d'agrégat inconnue : " + name;
+            return false;
+        }
+        aggregate.label = name + "(" + field + ")";
+        if (aggregate.function == Function::COUNT && field.compare(0, 9, "DISTINCT ") == 0) {
+            aggregate.function = Function::COUNT_DISTINCT;
+            field = trim(field.substr(9));
+        }
+        if (aggregate.function == Function::APPROX_COUNT_DISTINCT) {
+            // Précision optionnelle : APPROX_COUNT_DISTINCT(champ, 14)
+            size_t separator = field.find(',');
+            if (separator != std::string::npos) {
+                std::string precision = trim(field.substr(separator + 1));
+                field = trim(field.substr(0, separator));
+                char *end = nullptr;
+                long value = std::strtol(precision.c_str(), &end, 10);
+                if (precision.empty() || *end != '\0' || value < HLL_MIN_PRECISION || value > HLL_MAX_PRECISION) {
+                    *error = "Précision invalide pour " + name + " (attendu entre " + std::to_string(HLL_MIN_PRECISION) +
+                             " et " + std::to_string(HLL_MAX_PRECISION) + ")";
+                    return false;
+                }
+                aggregate.precision = static_cast<int>(value);
+            }
+        }
+        if (field.empty() || (field == "*" && aggregate.function != Function::COUNT)) {
+            *error = "Champ invalide pour " + name;
+            return false;
+        }
+        aggregate.field = field == "*" ? "" : field;
+        aggregates->push_back(aggregate);
+    }
+    return true;
+}
+
+RoktAggregator::RoktAggregator(const std::vector<Aggregate> &aggregates, const std::string &groupKey, size_t partitions)
+    : aggregates(aggregates), groupKey(groupKey), partitions(std::max<size_t>(partitions, 1)) {}
+
+RoktAggregator::Group &RoktAggregator::findOrInsert(Partition &partition, const std::string &key, uint64_t hash) {
+    // Agrandissement dès que la table est à moitié pleine
+    if ((partition.groups.size() + 1) * 2 > partition.slots.size()) {
+        size_t capacity = std::max(AGGREGATE_INITIAL_SLOTS, partition.slots.size() * 2);
+        partition.slots.assign(capacity, 0);
+        for (size_t g = 0; g < partition.groups.size(); g++) {
+            size_t i = partition.groups[g].hash & (capacity - 1);
+            while (partition.slots[i] != 0)
+                i = (i + 1) & (capacity - 1);
+            partition.slots[i] = static_cast<uint32_t>(g + 1);
+        }
+    }
+    size_t mask = partition.slots.size() - 1;
+    size_t i = hash & mask;
+    while (partition.slots[i] != 0) {
+        Group &group = partition.groups[partition.slots[i] - 1];
+        if (group.hash == hash && group.key == key)
+            return group;
+        i = (i + 1) & mask;
+    }
+    partition.groups.push_back(Group{key, hash, std::vector<Accumulator>(aggregates.size())});
+    partition.slots[i] = static_cast<uint32_t>(partition.groups.size());
+    return partition.groups.back();
+}
+
+void RoktAggregator::groupKeyText(const std::string &groupKey, const RoktRowStore &store, size_t pos, std::string &out) {
+    out.clear();
+    if (pos == RoktRowStore::npos) {
+        out = (groupKey.find('.') != std::string::npos) ? "null" : "\"undefined\"";
+        return;
+    }
+    if (store.tag(pos) == RoktRowStore::TAG_STRING) {
+        std::string_view str = store.string(pos);
+        bool needsEscape = std::any_of(str.begin(), str.end(), [](char c) {
+            return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+        });
+        if (needsEscape) {
+            out = nlohmann::json(std::string(str)).dump();
+        } else {
+            out.append(1, '"').append(str).append(1, '"');
+        }
+        return;
+    }
+    nlohmann::json value = store.materializeValue<nlohmann::json>(pos);
+    if (value.is_number_unsigned())
+        out = std::to_string(value.get<uint64_t>());
+    else if (value.is_number_integer())
+        out = std::to_string(value.get<int64_t>());
+    else
+        out = value.dump();
+}
+
+bool RoktAggregator::distinctKey(const RoktRowStore &store, size_t pos, std::string &out) {
+    if (pos == RoktRowStore::npos || store.tag(pos) == RoktRowStore::TAG_NULL)
+        return false;
+    if (store.tag(pos) == RoktRowStore::TAG_DOUBLE) {
+        // Un décimal entier prend la forme de l'entier correspondant
+        double value = store.number(pos);
+        if (std::trunc(value) == value && std::fabs(value) < 9.0e15) {
+            out = std::to_string(static_cast<int64_t>(value));
+            return true;
+        }
+    }
+    groupKeyText(std::string(), store, pos, out);
+    return true;
+}
+
+void RoktAggregator::accumulate(Accumulator &acc, const Aggregate &aggregate, const RoktRowStore &store, size_t pos) const {
+    bool present = pos != RoktRowStore::npos && store.tag(pos) != RoktRowStore::TAG_NULL;
+    switch (aggregate.function) {
+        case Function::COUNT:
+            if (aggregate.field.empty() || present)
+                acc.count++;
+            break;
+        case Function::SUM:
+        case Function::AVG: {
+            if (!present || !store.isNumber(pos))
+                break;
+            acc.count++;
+            acc.sum += store.number(pos);
+            if (!acc.integral)
+                break;
+            nlohmann::json value = store.materializeValue<nlohmann::json>(pos);
+            if (!value.is_number_integer() || (value.is_number_unsigned() && value.get<uint64_t>() > static_cast<uint64_t>(INT64_MAX)) ||
+                __builtin_add_overflow(acc.integerSum, value.get<int64_t>(), &acc.integerSum))
+                acc.integral = false;
+            break;
+        }
+        case Function::MIN:
+        case Function::MAX: {
+            if (!present)
+                break;
+            RoktSortKey key = RoktSortKey::fromTape(store, pos);
+            bool better = aggregate.function == Function::MIN ? RoktSortKey::less(key, acc.best) : RoktSortKey::less(acc.best, key);
+            if (!acc.hasBest || better) {
+                acc.best = std::move(key);
+                acc.hasBest = true;
+            }
+            break;
+        }
+        case Function::COUNT_DISTINCT: {
+            std::string key;
+            if (distinctKey(store, pos, key))
+                acc.distinct.insert(std::move(key));
+            break;
+        }
+        case Function::APPROX_COUNT_DISTINCT: {
+            std::string key;
+            if (!distinctKey(store, pos, key))
+                break;
+            if (!acc.sketch)
+                acc.sketch = std::make_unique<HyperLogLog>(aggregate.precision);
+            acc.sketch->add(HyperLogLog::hash(key.data(), key.size()));
+            break;
+        }
+    }
+}
+
+void RoktAggregator::merge(Accumulator &into, Accumulator &from, const Aggregate &aggregate) const {
+    into.count += from.count;
+    into.sum += from.sum;
+    if (!from.integral || __builtin_add_overflow(into.integerSum, from.integerSum, &into.integerSum))
+        into.integral = false;
+    if (from.hasBest) {
+        // À égalité, la valeur de la partition précédente (rencontrée en premier) est conservée
+        bool better = aggregate.function == Function::MIN ? RoktSortKey::less(from.best, into.best) : RoktSortKey::less(into.best, from.best);
+        if (!into.hasBest || better) {
+            into.best = std::move(from.best);
+            into.hasBest = true;
+        }
+    }
+    if (into.distinct.empty())
+        into.distinct.swap(from.distinct);
+    else
+        into.distinct.insert(from.distinct.begin(), from.distinct.end());
+    if (from.sketch) {
+        if (into.sketch)
+            into.sketch->merge(*from.sketch);
+        else
+            into.sketch = std::move(from.sketch);
+    }
+}
+
+bool RoktAggregator::offer(const RoktScanRow &row) {
+    Partition &partition = partitions[row.partition];
+    if (partition.paths.empty()) {
+        if (!groupKey.empty())
+            partition.groupPath = std::make_unique<RoktFieldPath>(groupKey, row.store.dictionary());
+        for (auto &aggregate : aggregates) {
+            partition.paths.push_back(aggregate.field.empty() ? nullptr
+                                                              : std::make_unique<RoktFieldPath>(aggregate.field, row.store.dictionary()));
+        }
+    }
+    if (partition.groupPath)
+        groupKeyText(groupKey, row.store, partition.groupPath->lookup(row.store, row.row), partition.keyBuffer);
+    uint64_t hash = std::hash<std::string>{}(partition.keyBuffer);
+    Group &group = findOrInsert(partition, partition.keyBuffer, hash);
+    for (size_t i = 0; i < aggregates.size(); i++) {
+        size_t pos = partition.paths[i] ? partition.paths[i]->lookup(row.store, row.row) : RoktRowStore::npos;
+        accumulate(group.accumulators[i], aggregates[i], row.store, pos);
+    }
+    return true;
+}
+
+ROKT::ArenaJson RoktAggregator::output(const Group *group) const {
+    ROKT::ArenaJson result = ROKT::ArenaJson::object();
+    for (size_t i = 0; i < aggregates.size(); i++) {
+        Accumulator empty;
+        const Accumulator &acc = group ? group->accumulators[i] : empty;
+        ROKT::ArenaJson &value = result[aggregates[i].label];
+        switch (aggregates[i].function) {
+            case Function::COUNT:
+                value = acc.count;
+                break;
+            case Function::SUM:
+                if (acc.count > 0)
+                    value = acc.integral ? ROKT::ArenaJson(acc.integerSum) : ROKT::ArenaJson(acc.sum);
+                break;
+            case Function::AVG:
+                if (acc.count > 0)
+                    value = (acc.integral ? static_cast<double>(acc.integerSum) : acc.sum) / static_cast<double>(acc.count);
+                break;
+            case Function::MIN:
+            case Function::MAX:
+                if (acc.hasBest)
+                    value = ROKT::ArenaJson(acc.best.toJson());
+                break;
+            case Function::COUNT_DISTINCT:
+                value = acc.distinct.size();
+                break;
+            case Function::APPROX_COUNT_DISTINCT:
+                value = acc.sketch ? acc.sketch->estimate() : 0;
+                break;
+        }
+    }
+    return result;
+}
+
+ROKT::ArenaJson RoktAggregator::finish() {
+    Partition &first = partitions[0];
+    for (size_t p = 1; p < partitions.size(); p++) {
+        for (auto &group : partitions[p].groups) {
+            Group &into = findOrInsert(first, group.key, group.hash);
+            for (size_t i = 0; i < aggregates.size(); i++)
+                merge(into.accumulators[i], group.accumulators[i], aggregates[i]);
+        }
+    }
+    if (groupKey.empty())
+        return output(first.groups.empty() ? nullptr : &first.groups[0]);
+    ROKT::ArenaJson result = ROKT::ArenaJson::object();
+    for (auto &group : first.groups)
+        result[group.key] = output(&group);
+    return result;
+}
+
+RoktDistinct::RoktDistinct(const std::string &field, size_t partitions)
+    : field(field), partitions(std::max<size_t>(partitions, 1)) {}
+
+bool RoktDistinct::offer(const RoktScanRow &row) {
+    Partition &partition = partitions[row.partition];
+    if (!partition.path)
+        partition.path = std::make_unique<RoktFieldPath>(field, row.store.dictionary());
+    size_t pos = partition.path->lookup(row.store, row.row);
+    if (!RoktAggregator::distinctKey(row.store, pos, partition.keyBuffer))
+        return true;
+    if (partition.seen.insert(partition.keyBuffer).second)
+        partition.values.emplace_back(partition.keyBuffer, row.store.materializeValue<nlohmann::json>(pos));
+    return true;
+}
+
+ROKT::ArenaJson RoktDistinct::finish() {
+    Partition &first = partitions[0];
+    for (size_t p = 1; p < partitions.size(); p++) {
+        for (auto &value : partitions[p].values) {
+            if (first.seen.insert(value.first).second)
+                first.values.push_back(std::move(value));
+        }
+    }
+    ROKT::ArenaJson result = ROKT::ArenaJson::array();
+    for (auto &value : first.values)
+        result.push_back(ROKT::ArenaJson(value.second));
+    return result;
+}
@@ -0,0 +1,118 @@
+#ifndef ROKTAGGREGATE_H
+#define ROKTAGGREGATE_H
+
+#include "RoktRowStore.h"
+#include "RoktTopK.h"
+#include "RequestArena.h"
+#include "HyperLogLog.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+/**
+ * @brief Agrégation en flux : COUNT, SUM, AVG, MIN, MAX, COUNT(DISTINCT) et
+ * APPROX_COUNT_DISTINCT, avec ou sans GROUP BY.
+ *
+ * Les lignes ne sont jamais conservées : chaque partition du parcours tient une table de
+ * hachage à adressage ouvert (sondage linéaire) qui associe la clé d'un groupe à ses
+ * accumulateurs. La mémoire utilisée est proportionnelle au nombre de groupes. Les tables des
+ * partitions sont fusionnées à la fin du parcours.
+ *
+ * Les clés de groupe reprennent celles de GROUP BY : forme JSON de la valeur, "null" pour un
+ * chemin imbriqué absent et "\"undefined\"" pour un champ de premier niveau absent.
+ *
+ * COUNT(DISTINCT champ) conserve l'ensemble exact des valeurs de chaque groupe.
+ * APPROX_COUNT_DISTINCT(champ[, précision]) le remplace par un estimateur HyperLogLog de
+ * 2^précision registres : mémoire fixe par groupe, estimateurs des partitions fusionnés à la fin.
+ */
+class RoktAggregator {
+public:
+    enum class Function { COUNT, SUM, AVG, MIN, MAX, COUNT_DISTINCT, APPROX_COUNT_DISTINCT };
+    struct Aggregate {
+        Function function;
+        std::string field;  // vide pour COUNT(*)
+        std::string label;  // nom de la colonne dans le résultat, ex. "AVG(age)"
+        int precision = HLL_DEFAULT_PRECISION;  // APPROX_COUNT_DISTINCT uniquement
+    };
+
+    // Analyse une liste "COUNT(*), AVG(age)". Renvoie false si `fields` n'est pas une liste
+    // d'agrégats ; `error` est renseigné si la liste est mal formée.
+    static bool parse(const std::string &fields, std::vector<Aggregate> *aggregates, std::string *error);
+    // Clé du groupe d'une ligne pour GROUP BY `groupKey`, `pos` étant la position de sa valeur
+    static void groupKeyText(const std::string &groupKey, const RoktRowStore &store, size_t pos, std::string &out);
+    // Forme d'une valeur pour DISTINCT et les jointures ; renvoie false si elle est absente ou
+    // null. Un nombre entier et le même nombre écrit en décimal (1 et 1.0) ont la même forme.
+    static bool distinctKey(const RoktRowStore &store, size_t pos, std::string &out);
+
+private:
+    struct Accumulator {
+        uint64_t count = 0;
+        double sum = 0.0;
+        int64_t integerSum = 0;
+        bool integral = true;    // toutes les valeurs additionnées sont entières
+        bool hasBest = false;
+        RoktSortKey best;        // MIN ou MAX courant
+        std::unordered_set<std::string> distinct;  // COUNT(DISTINCT)
+        std::unique_ptr<HyperLogLog> sketch;       // APPROX_COUNT_DISTINCT, créé à la première valeur
+    };
+    struct Group {
+        std::string key;
+        uint64_t hash;
+        std::vector<Accumulator> accumulators;
+    };
+    struct Partition {
+        std::unique_ptr<RoktFieldPath> groupPath;
+        std::vector<std::unique_ptr<RoktFieldPath>> paths;
+        std::vector<Group> groups;
+        std::vector<uint32_t> slots;  // indice du groupe + 1 (0 : case vide)
+        std::string keyBuffer;        // réutilisé pour la clé de chaque ligne
+    };
+
+    std::vector<Aggregate> aggregates;
+    std::string groupKey;
+    std::vector<Partition> partitions;
+
+    Group &findOrInsert(Partition &partition, const std::string &key, uint64_t hash);
+    void accumulate(Accumulator &acc, const Aggregate &aggregate, const RoktRowStore &store, size_t pos) const;
+    void merge(Accumulator &into, Accumulator &from, const Aggregate &aggregate) const;
+    ROKT::ArenaJson output(const Group *group) const;
+
+public:
+    RoktAggregator(const std::vector<Aggregate> &aggregates, const std::string &groupKey, size_t partitions);
+    // Prend en compte une ligne retenue par le parcours ; sûr entre partitions distinctes
+    bool offer(const RoktScanRow &row);
+    // Fusionne les partitions : un objet d'agrégats, ou un objet par groupe avec GROUP BY
+    ROKT::ArenaJson finish();
+};
+
+/**
+ * @brief GET DISTINCT champ : valeurs distinctes d'un champ, dans l'ordre de première rencontre.
+ *
+ * Chaque partition du parcours tient un ensemble de hachage des formes déjà vues (voir
+ * RoktAggregator::distinctKey) et ne convertit que les nouvelles valeurs. Les partitions sont
+ * fusionnées dans leur ordre. Les valeurs absentes ou null sont ignorées.
+ */
+class RoktDistinct {
+private:
+    struct Partition {
+        std::unique_ptr<RoktFieldPath> path;
+        std::unordered_set<std::string> seen;
+        std::vector<std::pair<std::string, nlohmann::json>> values;
+        std::string keyBuffer;
+    };
+
+    std::string field;
+    std::vector<Partition> partitions;
+
+public:
+    RoktDistinct(const std::string &field, size_t partitions);
+    // Prend en compte une ligne retenue par le parcours ; sûr entre partitions distinctes
+    bool offer(const RoktScanRow &row);
+    // Fusionne les partitions : tableau des valeurs distinctes
+    ROKT::ArenaJson finish();
+};
+
+#endif // ROKTAGGREGATE_H
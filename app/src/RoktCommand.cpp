@@ -0,0 +1,897 @@
+// RoktCommand.cpp
+#include "RoktCommand.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    // Caractères qui terminent un mot en plus des espaces
+    const char *const WORD_BREAKERS = "(),\";{";
+
+    bool isSpace(char c) {
+        return std::isspace(static_cast<unsigned char>(c)) != 0;
+    }
+
+    bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+        if (a.size() != b.size())
+            return false;
+        for (size_t i = 0; i < a.size(); i++) {
+            if (std::toupper(static_cast<unsigned char>(a[i])) != std::toupper(static_cast<unsigned char>(b[i])))
+                return false;
+        }
+        return true;
+    }
+
+    // Valeur d'un jeton : le contenu d'une chaîne, sans ses échappements (\" et \\)
+    std::string tokenValue(const RoktToken &token) {
+        if (token.type != RoktToken::Type::STRING)
+            return std::string(token.text);
+        std::string value;
+        value.reserve(token.text.size());
+        for (size_t i = 0; i < token.text.size(); i++) {
+            char c = token.text[i];
+            if (c == '\\' && i + 1 < token.text.size() && (token.text[i + 1] == '"' || token.text[i + 1] == '\\'))
+                c = token.text[++i];
+            value += c;
+        }
+        return value;
+    }
+
+    bool readWord(RoktLexer &lexer, std::string *out) {
+        RoktToken token = lexer.next();
+        if (token.type != RoktToken::Type::WORD)
+            return false;
+        *out = std::string(token.text);
+        return true;
+    }
+
+    // Valeur d'une condition ou d'une affectation : un mot ou une chaîne entre guillemets
+    bool readValue(RoktLexer &lexer, std::string *out) {
+        RoktToken token = lexer.next();
+        if (token.type != RoktToken::Type::WORD && token.type != RoktToken::Type::STRING)
+            return false;
+        *out = tokenValue(token);
+        return true;
+    }
+
+    bool expectEnd(RoktLexer &lexer, std::string *error) {
+        const RoktToken &token = lexer.peek();
+        if (token.type == RoktToken::Type::END)
+            return true;
+        *error = "Élément inattendu : " + std::string(token.text);
+        return false;
+    }
+
+    // Conditions d'une clause WHERE, reliées par AND ou OR. Le mot suivant la dernière condition
+    // n'est pas consommé.
+    bool parseConditions(RoktLexer &lexer, std::vector<Condition> *conditions, std::string *error) {
+        std::string logic;
+        while (true) {
+            Condition cond;
+            cond.logic = logic;  // vide pour la première condition
+            if (!readWord(lexer, &cond.field) || !readWord(lexer, &cond.op) || !readValue(lexer, &cond.value)) {
+                *error = logic.empty() ? "Clause WHERE incomplète." : "Clause WHERE incomplète après " + logic;
+                return false;
+            }
+            if (cond.op == "IS")
+                cond.op = "==";
+            else if (cond.op == "NOT")
+                cond.op = "!=";
+            else if (cond.op != "==" && cond.op != "!=" && cond.op != "HAS") {
+                *error = "Opérateur invalide dans WHERE.";
+                return false;
+            }
+            conditions->push_back(cond);
+            const RoktToken &token = lexer.peek();
+            if (!token.isWord("AND") && !token.isWord("OR"))
+                return true;
+            logic = std::string(token.text);
+            lexer.next();
+        }
+    }
+
+    bool parseDataset(RoktLexer &lexer, RoktDatasetQuery *query, std::string *error) {
+        if (!readWord(lexer, &query->dataset)) {
+            *error = "Nom du dataset manquant.";
+            return false;
+        }
+        return expectEnd(lexer, error);
+    }
+
+    // CREATE TABLE <dataset> [LSM [KEY <champ>]] ; LSM et KEY sont acceptés quelle que soit leur casse
+    bool parseCreateTable(RoktLexer &lexer, RoktDatasetQuery *query, std::string *error) {
+        if (!readWord(lexer, &query->dataset)) {
+            *error = "Nom du dataset manquant.";
+            return false;
+        }
+        if (lexer.peek().type != RoktToken::Type::WORD || !equalsIgnoreCase(lexer.peek().text, "LSM"))
+            return expectEnd(lexer, error);
+        lexer.next();
+        query->storage = "LSM";
+        if (lexer.peek().type == RoktToken::Type::WORD && equalsIgnoreCase(lexer.peek().text, "KEY")) {
+            lexer.next();
+            if (!readWord(lexer, &query->key)) {
+                *error = "Champ manquant après KEY.";
+                return false;
+            }
+        }
+        return expectEnd(lexer, error);
+    }
+
+    // UNIQUE <champ> [ON CONFLICT UPDATE] facultatif d'ADD et de BULK ADD ; `token` reçoit le mot
+    // suivant la clause
+    bool parseUnique(RoktLexer &lexer, RoktToken *token, std::string *uniqueField, bool *onConflictUpdate, std::string *error) {
+        // UNIQUE et IN sont acceptés quelle que soit leur casse
+        if (token->type != RoktToken::Type::WORD || !equalsIgnoreCase(token->text, "UNIQUE"))
+            return true;
+        if (!readWord(lexer, uniqueField)) {
+            *error = "Champ manquant après UNIQUE.";
+            return false;
+        }
+        *token = lexer.next();
+        if (token->isWord("ON")) {
+            if (!lexer.next().isWord("CONFLICT") || !lexer.next().isWord("UPDATE")) {
+                *error = "Clause ON CONFLICT invalide, attendu 'UNIQUE <champ> ON CONFLICT UPDATE'.";
+                return false;
+            }
+            *onConflictUpdate = true;
+            *token = lexer.next();
+        }
+        return true;
+    }
+
+    bool parseAdd(RoktLexer &lexer, RoktAddQuery *query, std::string *error) {
+        RoktToken token = lexer.next();
+        if (token.type != RoktToken::Type::JSON) {
+            *error = "Bloc JSON manquant après ADD.";
+            return false;
+        }
+        query->json = token.text;
+        token = lexer.next();
+        if (!parseUnique(lexer, &token, &query->uniqueField, &query->onConflictUpdate, error))
+            return false;
+        if (token.type != RoktToken::Type::WORD || !equalsIgnoreCase(token.text, "IN")) {
+            *error = "Syntaxe ADD invalide, attendu 'ADD { ... } | [ {...}, ... ] [UNIQUE <champ> [ON CONFLICT UPDATE]] IN <dataset>'.";
+            return false;
+        }
+        if (!readWord(lexer, &query->dataset)) {
+            *error = "Nom du dataset manquant.";
+            return false;
+        }
+        return expectEnd(lexer, error);
+    }
+
+    // En-tête de BULK ADD, après le mot BULK : ADD [UNIQUE <champ>] IN <dataset> [BATCH <lignes>]
+    bool parseBulkAdd(RoktLexer &lexer, RoktBulkAddQuery *query, std::string *error) {
+        const char *syntax = "Syntaxe BULK ADD invalide, attendu 'BULK ADD [UNIQUE <champ> [ON CONFLICT UPDATE]] IN <dataset> "
+                             "[BATCH <lignes>]' "
+                             "suivi d'un objet JSON par ligne et d'une ligne END.";
+        if (!lexer.next().isWord("ADD")) {
+            *error = syntax;
+            return false;
+        }
+        RoktToken token = lexer.next();
+        if (!parseUnique(lexer, &token, &query->uniqueField, &query->onConflictUpdate, error))
+            return false;
+        if (token.type != RoktToken::Type::WORD || !equalsIgnoreCase(token.text, "IN") || !readWord(lexer, &query->dataset)) {
+            *error = syntax;
+            return false;
+        }
+        if (lexer.peek().isWord("BATCH")) {
+            lexer.next();
+            std::string rows;
+            char *end = nullptr;
+            long long value = readWord(lexer, &rows) ? std::strtoll(rows.c_str(), &end, 10) : 0;
+            if (end == nullptr || *end != '\0' || value <= 0) {
+                *error = "BATCH attend un nombre de lignes strictement positif.";
+                return false;
+            }
+            query->batchRows = static_cast<size_t>(value);
+        }
+        return expectEnd(lexer, error);
+    }
+
+    // FORMAT NDJSON|CSV facultatif d'IMPORT et d'EXPORT
+    bool parseTransferFormat(RoktLexer &lexer, RoktTransferQuery *query, std::string *error) {
+        if (!lexer.peek().isWord("FORMAT"))
+            return true;
+        lexer.next();
+        RoktToken name = lexer.next();
+        if (name.type != RoktToken::Type::WORD || !RoktTransfer::parseFormat(name.text, &query->format)) {
+            *error = "Format de fichier inconnu : " + std::string(name.text) + " (attendu NDJSON ou CSV).";
+            return false;
+        }
+        query->hasFormat = true;
+        return true;
+    }
+
+    bool parseImport(RoktLexer &lexer, RoktTransferQuery *query, std::string *error) {
+        RoktToken into;
+        if (!readValue(lexer, &query->path) || (into = lexer.next()).type != RoktToken::Type::WORD ||
+            !equalsIgnoreCase(into.text, "INTO") || !readWord(lexer, &query->dataset)) {
+            *error = "Syntaxe IMPORT invalide, attendu 'IMPORT <fichier> INTO <dataset> [FORMAT NDJSON|CSV]'.";
+            return false;
+        }
+        return parseTransferFormat(lexer, query, error) && expectEnd(lexer, error);
+    }
+
+    bool parseExport(RoktLexer &lexer, RoktTransferQuery *query, std::string *error) {
+        RoktToken to;
+        if (!readWord(lexer, &query->dataset) || (to = lexer.next()).type != RoktToken::Type::WORD ||
+            !equalsIgnoreCase(to.text, "TO") || !readValue(lexer, &query->path)) {
+            *error = "Syntaxe EXPORT invalide, attendu 'EXPORT <dataset> TO <fichier> [FORMAT NDJSON|CSV] [WHERE ...]'.";
+            return false;
+        }
+        if (!parseTransferFormat(lexer, query, error))
+            return false;
+        if (lexer.peek().isWord("WHERE")) {
+            lexer.next();
+            if (!parseConditions(lexer, &query->conditions, error))
+                return false;
+        }
+        return expectEnd(lexer, error);
+    }
+
+    // JOIN <dataset> ON <champ> = <champ>, le '=' pouvant être accolé aux champs
+    bool parseJoin(RoktLexer &lexer, RoktGetQuery *query, std::string *error) {
+        std::string condition;
+        if (!readWord(lexer, &query->joinDataset) || !lexer.next().isWord("ON") || !readWord(lexer, &condition)) {
+            *error = "Syntaxe JOIN invalide, attendu 'JOIN <dataset> ON <dataset>.<champ> = <dataset>.<champ>'.";
+            return false;
+        }
+        while (condition.back() == '=' || condition.find('=') == std::string::npos) {
+            std::string next;
+            if (!readWord(lexer, &next)) {
+                *error = "Condition de jointure incomplète.";
+                return false;
+            }
+            condition += next;
+        }
+        size_t equal = condition.find('=');
+        size_t right = condition.find_first_not_of('=', equal);
+        if (equal == 0 || right == std::string::npos || right - equal > 2) {
+            *error = "Condition de jointure invalide : " + condition;
+            return false;
+        }
+        query->joinLeft = condition.substr(0, equal);
+        query->joinRight = condition.substr(right);
+        return true;
+    }
+
+    bool parseGet(RoktLexer &lexer, RoktGetQuery *query, std::string *error) {
+        RoktToken token = lexer.next();
+        // DISTINCT suivi de AS ou IN est le nom d'un champ
+        if (token.isWord("DISTINCT") && lexer.peek().type == RoktToken::Type::WORD && !lexer.peek().isWord("AS") &&
+            !lexer.peek().isWord("IN")) {
+            query->distinct = true;
+            token = lexer.next();
+        }
+        if (token.type != RoktToken::Type::WORD) {
+            *error = "Champ manquant après GET.";
+            return false;
+        }
+        // Une liste d'agrégats peut contenir des espaces : "COUNT(*), AVG(age)". Elle s'étend
+        // tant qu'une parenthèse est ouverte ou qu'une virgule annonce un élément suivant.
+        size_t begin = token.begin;
+        size_t end = token.end;
+        int depth = 0;
+        bool expectItem = false;
+        while (true) {
+            const RoktToken &next = lexer.peek();
+            if (next.type == RoktToken::Type::END)
+                break;
+            if (next.isSymbol('(')) {
+                depth++;
+            } else if (next.isSymbol(')')) {
+                if (depth == 0)
+                    break;
+                depth--;
+            } else if (next.isSymbol(',')) {
+                expectItem = expectItem || depth == 0;
+            } else if (depth == 0) {
+                if (!expectItem)
+                    break;
+                expectItem = false;
+            }
+            end = next.end;
+            lexer.next();
+        }
+        if (depth > 0) {
+            *error = "Parenthèse fermante manquante dans la liste des champs.";
+            return false;
+        }
+        query->fields = std::string(lexer.slice(begin, end));
+        std::string aggregateError;
+        if (!RoktAggregator::parse(query->fields, &query->aggregates, &aggregateError) && !aggregateError.empty()) {
+            *error = aggregateError;
+            return false;
+        }
+        if (query->distinct && (!query->aggregates.empty() || query->fields == "*" || query->fields.find(',') != std::string::npos)) {
+            *error = "DISTINCT porte sur un seul champ.";
+            return false;
+        }
+
+        // Optionnel : alias avec AS
+        token = lexer.next();
+        if (token.isWord("AS")) {
+            if (!readWord(lexer, &query->alias)) {
+                *error = "Alias manquant après AS.";
+                return false;
+            }
+            if (!lexer.next().isWord("IN")) {
+                *error = "IN manquant après alias.";
+                return false;
+            }
+        } else if (token.type == RoktToken::Type::END) {
+            *error = "Syntaxe invalide : IN manquant.";
+            return false;
+        } else if (!token.isWord("IN")) {
+            *error = "Syntaxe invalide : attendu AS ou IN après le champ.";
+            return false;
+        }
+        if (!readWord(lexer, &query->dataset)) {
+            *error = "Nom du dataset manquant.";
+            return false;
+        }
+
+        // Clauses optionnelles, dans un ordre quelconque
+        while (lexer.peek().type != RoktToken::Type::END) {
+            token = lexer.next();
+            if (token.isWord("WHERE")) {
+                if (!parseConditions(lexer, &query->conditions, error))
+                    return false;
+            } else if (token.isWord("JOIN")) {
+                if (!parseJoin(lexer, query, error))
+                    return false;
+            } else if (token.isWord("GROUP")) {
+                if (!lexer.next().isWord("BY")) {
+                    *error = "Syntaxe invalide pour GROUP BY.";
+                    return false;
+                }
+                if (!readWord(lexer, &query->groupByKey)) {
+                    *error = "Clé manquante après GROUP BY.";
+                    return false;
+                }
+            } else if (token.isWord("ORDER")) {
+                if (!lexer.next().isWord("BY")) {
+                    *error = "Syntaxe invalide pour ORDER BY.";
+                    return false;
+                }
+                if (!readWord(lexer, &query->orderByKey)) {
+                    *error = "Clé manquante après ORDER BY.";
+                    return false;
+                }
+                const RoktToken &direction = lexer.peek();
+                if (direction.isWord("DESC") || direction.isWord("ASC")) {
+                    query->orderDesc = direction.isWord("DESC");
+                    lexer.next();
+                }
+            } else if (token.isWord("LIMIT") || token.isWord("OFFSET")) {
+                std::string clause(token.text);
+                std::string value;
+                if (!readWord(lexer, &value)) {
+                    *error = "Valeur manquante pour " + clause + ".";
+                    return false;
+                }
+                try {
+                    size_t used = 0;
+                    int number = std::stoi(value, &used);
+                    if (used != value.size() || (clause == "OFFSET" && number < 0))
+                        throw std::invalid_argument(value);
+                    (clause == "LIMIT" ? query->limit : query->offset) = number;
+                } catch (...) {
+                    *error = "Valeur invalide pour " + clause + ".";
+                    return false;
+                }
+            } else if (token.isWord("CURSOR")) {
+                std::string cursor;
+                if (!readWord(lexer, &cursor) || !RoktScanCursor::decode(cursor, &query->cursor)) {
+                    *error = "Curseur invalide.";
+                    return false;
+                }
+                query->hasCursor = true;
+            } else if (token.isWord("STREAM")) {
+                query->stream = true;
+                // Nombre de lignes par bloc, optionnel
+                const RoktToken &batch = lexer.peek();
+                if (batch.type == RoktToken::Type::WORD && !batch.text.empty() &&
+                    std::all_of(batch.text.begin(), batch.text.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); })) {
+                    query->streamBatch = std::atoi(std::string(batch.text).c_str());
+                    lexer.next();
+                    if (query->streamBatch <= 0) {
+                        *error = "Valeur invalide pour STREAM.";
+                        return false;
+                    }
+                }
+            } else {
+                *error = "Clause inconnue : " + std::string(token.text);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool parseCount(RoktLexer &lexer, RoktCountQuery *query, std::string *error) {
+        if (!readWord(lexer, &query->dataset)) {
+            *error = "Syntaxe COUNT invalide";
+            return false;
+        }
+        if (lexer.peek().type == RoktToken::Type::END)
+            return true;
+        // Condition attendue : "key:value", la valeur pouvant être entre guillemets
+        RoktToken token = lexer.next();
+        size_t colon = token.type == RoktToken::Type::WORD ? token.text.find(':') : std::string_view::npos;
+        if (colon == std::string_view::npos) {
+            *error = "Condition COUNT invalide, format attendu 'key:value'";
+            return false;
+        }
+        size_t end = token.end;
+        query->key = std::string(token.text.substr(0, colon));
+        query->value = std::string(token.text.substr(colon + 1));
+        if (query->value.empty() && lexer.peek().type == RoktToken::Type::STRING) {
+            RoktToken value = lexer.next();
+            query->value = tokenValue(value);
+            end = value.end;
+        }
+        query->condition = std::string(lexer.slice(token.begin, end));
+        return expectEnd(lexer, error);
+    }
+
+    bool parseChange(RoktLexer &lexer, RoktChangeQuery *query, std::string *error) {
+        if (!readWord(lexer, &query->field)) {
+            *error = "Champ manquant";
+            return false;
+        }
+        RoktToken op = lexer.next();
+        if (!op.isWord("=") && !op.isWord("+=") && !op.isWord("-=")) {
+            *error = "Symbole '=' manquant";
+            return false;
+        }
+        query->op = std::string(op.text);
+        if (!readValue(lexer, &query->newValue)) {
+            *error = "Nouvelle valeur manquante";
+            return false;
+        }
+        RoktToken token = lexer.next();
+        if (token.isWord("WHERE")) {
+            if (!parseConditions(lexer, &query->conditions, error))
+                return false;
+            if (!lexer.next().isWord("IN")) {
+                *error = "IN attendu après WHERE";
+                return false;
+            }
+        } else if (!token.isWord("IN")) {
+            *error = "Syntaxe CHANGE invalide";
+            return false;
+        }
+        if (!readWord(lexer, &query->dataset)) {
+            *error = "Dataset manquant";
+            return false;
+        }
+        return expectEnd(lexer, error);
+    }
+
+    bool parseRemove(RoktLexer &lexer, RoktRemoveQuery *query, std::string *error) {
+        RoktToken token = lexer.next();
+        if (token.isWord("WHERE")) {
+            if (!parseConditions(lexer, &query->conditions, error))
+                return false;
+            if (!lexer.next().isWord("IN")) {
+                *error = "Syntaxe invalide pour REMOVE, attendu IN après WHERE clause.";
+                return false;
+            }
+        } else if (token.type == RoktToken::Type::WORD || token.type == RoktToken::Type::STRING) {
+            // Forme simple : le jeton est la valeur à comparer pour le champ par défaut "name"
+            Condition cond;
+            cond.field = "name";
+            cond.op = "==";
+            cond.value = tokenValue(token);
+            cond.logic = "";
+            query->conditions.push_back(cond);
+            if (!lexer.next().isWord("IN")) {
+                *error = "Syntaxe invalide pour REMOVE, attendu IN.";
+                return false;
+            }
+        } else {
+            *error = "Syntaxe invalide pour REMOVE.";
+            return false;
+        }
+        if (!readWord(lexer, &query->dataset)) {
+            *error = "Nom du dataset manquant.";
+            return false;
+        }
+        return expectEnd(lexer, error);
+    }
+
+    bool parsePrepare(RoktLexer &lexer, RoktPrepareQuery *query, std::string *error) {
+        if (!readWord(lexer, &query->name) || !lexer.next().isWord("AS")) {
+            *error = "Syntaxe PREPARE invalide, attendu 'PREPARE <nom> AS <commande>'";
+            return false;
+        }
+        query->inner = RoktCommand::parse(std::string(lexer.rest()));
+        if (query->inner->hasError()) {
+            *error = query->inner->getError();
+            return false;
+        }
+        return true;
+    }
+
+    bool parseView(RoktLexer &lexer, RoktViewQuery *query, std::string *error) {
+        if (!readWord(lexer, &query->name) || !lexer.next().isWord("AS")) {
+            *error = "Syntaxe CREATE VIEW invalide, attendu 'CREATE VIEW <nom> AS GET ...'";
+            return false;
+        }
+        query->inner = RoktCommand::parse(std::string(lexer.rest()));
+        if (query->inner->hasError()) {
+            *error = query->inner->getError();
+            return false;
+        }
+        return true;
+    }
+
+    bool parseDeallocate(RoktLexer &lexer, RoktPrepareQuery *query, std::string *error) {
+        if (!readWord(lexer, &query->name)) {
+            *error = "Nom de la requête préparée manquant.";
+            return false;
+        }
+        return expectEnd(lexer, error);
+    }
+
+    bool parseExplain(RoktLexer &lexer, RoktExplainQuery *query, std::string *error) {
+        if (lexer.peek().type == RoktToken::Type::END) {
+            *error = "Commande manquante.";
+            return false;
+        }
+        query->inner = RoktCommand::parse(std::string(lexer.rest()));
+        if (query->inner->hasError()) {
+            *error = query->inner->getError();
+            return false;
+        }
+        return true;
+    }
+
+    // Les valeurs sont séparées par des virgules ; une valeur est une chaîne entre guillemets ou
+    // le texte compris entre deux séparateurs, espaces intérieurs conservés
+    bool parseExecute(RoktLexer &lexer, RoktExecuteQuery *query, std::string *error) {
+        if (!readWord(lexer, &query->name)) {
+            *error = "Nom de la requête préparée manquant.";
+            return false;
+        }
+        if (lexer.peek().type == RoktToken::Type::END)
+            return true;
+        if (!lexer.next().isSymbol('(')) {
+            *error = "Syntaxe EXECUTE invalide, attendu 'EXECUTE <nom> [(<valeur>, ...)]'";
+            return false;
+        }
+        if (lexer.peek().isSymbol(')')) {
+            lexer.next();
+            return expectEnd(lexer, error);
+        }
+        while (true) {
+            RoktToken first;
+            size_t tokens = 0;
+            size_t end = 0;
+            RoktToken token = lexer.next();
+            while (token.type == RoktToken::Type::WORD || token.type == RoktToken::Type::STRING || token.type == RoktToken::Type::JSON) {
+                if (tokens++ == 0)
+                    first = token;
+                end = token.end;
+                token = lexer.next();
+            }
+            if (tokens == 0)
+                query->parameters.push_back("");
+            else if (tokens == 1)
+                query->parameters.push_back(tokenValue(first));
+            else
+                query->parameters.push_back(std::string(lexer.slice(first.begin, end)));
+            if (token.isSymbol(')'))
+                break;
+            if (!token.isSymbol(',')) {
+                *error = "Parenthèse fermante manquante dans EXECUTE.";
+                return false;
+            }
+        }
+        return expectEnd(lexer, error);
+    }
+
+    struct KeywordKind {
+        const char *keyword;
+        RoktCommand::Kind kind;
+    };
+    const KeywordKind KEYWORDS[] = {
+        {"CREATE", RoktCommand::Kind::CREATE},   {"ADD", RoktCommand::Kind::ADD},
+        {"GET", RoktCommand::Kind::GET},         {"REMOVE", RoktCommand::Kind::REMOVE},
+        {"EMPTY", RoktCommand::Kind::EMPTY},     {"DELETE", RoktCommand::Kind::DELETE},
+        {"COUNT", RoktCommand::Kind::COUNT},     {"CHANGE", RoktCommand::Kind::CHANGE},
+        {"STATS", RoktCommand::Kind::STATS},     {"PREPARE", RoktCommand::Kind::PREPARE},
+        {"DEALLOCATE", RoktCommand::Kind::DEALLOCATE}, {"EXECUTE", RoktCommand::Kind::EXECUTE},
+        {"EXPLAIN", RoktCommand::Kind::EXPLAIN},       {"PROFILE", RoktCommand::Kind::PROFILE},
+        {"BULK", RoktCommand::Kind::BULK_ADD},   {"IMPORT", RoktCommand::Kind::IMPORT},
+        {"EXPORT", RoktCommand::Kind::EXPORT},
+    };
+}
+
+RoktLexer::RoktLexer(std::string_view input) : input(input), pos(0), hasLookahead(false) {}
+
+RoktToken RoktLexer::make(RoktToken::Type type, size_t begin, size_t textBegin, size_t textEnd, size_t end) {
+    RoktToken token;
+    token.type = type;
+    token.text = input.substr(textBegin, textEnd - textBegin);
+    token.begin = begin;
+    token.end = end;
+    pos = end;
+    return token;
+}
+
+RoktToken RoktLexer::scan() {
+    while (pos < input.size() && isSpace(input[pos]))
+        pos++;
+    if (pos >= input.size() || input[pos] == ';') {
+        // Le ';' termine la commande : la suite est ignorée
+        pos = input.size();
+        return make(RoktToken::Type::END, pos, pos, pos, pos);
+    }
+    size_t begin = pos;
+    char c = input[pos];
+    if (c == '(' || c == ')' || c == ',')
+        return make(RoktToken::Type::SYMBOL, begin, begin, begin + 1, begin + 1);
+    if (c == '"') {
+        size_t i = begin + 1;
+        while (i < input.size() && input[i] != '"')
+            i += (input[i] == '\\') ? 2 : 1;
+        if (i >= input.size()) {
+            error = "Guillemet fermant manquant.";
+            return make(RoktToken::Type::END, input.size(), input.size(), input.size(), input.size());
+        }
+        return make(RoktToken::Type::STRING, begin, begin + 1, i, i + 1);
+    }
+    if (c == '{' || c == '[') {
+        int depth = 0;
+        bool quoted = false;
+        for (size_t i = begin; i < input.size(); i++) {
+            char d = input[i];
+            if (quoted) {
+                if (d == '\\')
+                    i++;
+                else if (d == '"')
+                    quoted = false;
+            } else if (d == '"') {
+                quoted = true;
+            } else if (d == '{' || d == '[') {
+                depth++;
+            } else if ((d == '}' || d == ']') && --depth == 0) {
+                return make(RoktToken::Type::JSON, begin, begin, i + 1, i + 1);
+            }
+        }
+        error = "Bloc JSON non fermé.";
+        return make(RoktToken::Type::END, input.size(), input.size(), input.size(), input.size());
+    }
+    size_t i = begin;
+    while (i < input.size() && !isSpace(input[i]) && std::strchr(WORD_BREAKERS, input[i]) == nullptr)
+        i++;
+    return make(RoktToken::Type::WORD, begin, begin, i, i);
+}
+
+RoktToken RoktLexer::next() {
+    if (hasLookahead) {
+        hasLookahead = false;
+        return lookahead;
+    }
+    return scan();
+}
+
+const RoktToken &RoktLexer::peek() {
+    if (!hasLookahead) {
+        lookahead = scan();
+        hasLookahead = true;
+    }
+    return lookahead;
+}
+
+std::string_view RoktLexer::rest() {
+    return input.substr(peek().begin);
+}
+
+std::string RoktScanCursor::encode() const {
+    // 16 chiffres hexadécimaux pour la version, puis 16 pour le rang
+    char buffer[33];
+    std::snprintf(buffer, sizeof(buffer), "%016llx%016llx", static_cast<unsigned long long>(version),
+                  static_cast<unsigned long long>(row));
+    return std::string(buffer, 32);
+}
+
+bool RoktScanCursor::decode(const std::string &token, RoktScanCursor *cursor) {
+    if (token.size() != 32 || !std::all_of(token.begin(), token.end(), [](char c) { return std::isxdigit(static_cast<unsigned char>(c)); }))
+        return false;
+    cursor->version = std::stoull(token.substr(0, 16), nullptr, 16);
+    cursor->row = std::stoull(token.substr(16), nullptr, 16);
+    return true;
+}
+
+RoktCommand::RoktCommand(std::string source)
+    : source(std::move(source)), kind(Kind::UNKNOWN), format(ResponseEncoding::Format::PRETTY), compressed(false) {}
+
+std::shared_ptr<const RoktCommand> RoktCommand::parse(std::string source) {
+    std::shared_ptr<RoktCommand> command(new RoktCommand(std::move(source)));
+    command->analyze();
+    return command;
+}
+
+bool RoktCommand::isBulkHeader(std::string_view line) {
+    RoktLexer lexer(line);
+    RoktToken first = lexer.next();
+    // Mêmes préfixes que analyze()
+    for (;;) {
+        if (first.isWord("FORMAT")) {
+            lexer.next();
+            first = lexer.next();
+        } else if (first.isWord("COMPRESS")) {
+            first = lexer.next();
+            if (first.isWord("deflate"))
+                first = lexer.next();
+        } else {
+            return first.isWord("BULK");
+        }
+    }
+}
+
+void RoktCommand::analyze() {
+    RoktLexer lexer(source);
+    RoktToken first = lexer.next();
+    // Préfixes optionnels, dans un ordre quelconque : FORMAT <nom>, COMPRESS [deflate]
+    std::string formatError;
+    for (;;) {
+        if (first.isWord("FORMAT")) {
+            RoktToken name = lexer.next();
+            if (name.type != RoktToken::Type::WORD || !ResponseEncoding::parse(name.text, &format))
+                formatError = "Format de réponse inconnu : " + std::string(name.text) + " (attendu pretty, json, ndjson, msgpack ou cbor).";
+            first = lexer.next();
+        } else if (first.isWord("COMPRESS")) {
+            compressed = true;
+            first = lexer.next();
+            // deflate est le seul algorithme proposé, son nom est facultatif
+            if (first.isWord("deflate"))
+                first = lexer.next();
+        } else {
+            break;
+        }
+    }
+    if (first.type != RoktToken::Type::WORD)
+        return;
+    keyword = first.text;
+    for (const auto &entry : KEYWORDS) {
+        if (keyword == entry.keyword) {
+            kind = entry.kind;
+            break;
+        }
+    }
+    bool parsed = true;
+    switch (kind) {
+        case Kind::CREATE: {
+            RoktToken object = lexer.next();
+            if (object.isWord("VIEW")) {
+                // Forme distincte de CREATE TABLE, traitée par son propre handler
+                kind = Kind::CREATE_VIEW;
+                RoktViewQuery node;
+                parsed = parseView(lexer, &node, &error);
+                query = std::move(node);
+                break;
+            }
+            RoktDatasetQuery node;
+            if (!object.isWord("TABLE")) {
+                error = "Syntaxe invalide, attendu 'CREATE TABLE <dataset>' ou 'CREATE VIEW <nom> AS GET ...'.";
+                parsed = false;
+            } else {
+                parsed = parseCreateTable(lexer, &node, &error);
+            }
+            query = std::move(node);
+            break;
+        }
+        case Kind::DELETE:
+        case Kind::EMPTY: {
+            RoktDatasetQuery node;
+            parsed = parseDataset(lexer, &node, &error);
+            query = std::move(node);
+            break;
+        }
+        case Kind::ADD: {
+            RoktAddQuery node;
+            parsed = parseAdd(lexer, &node, &error);
+            query = std::move(node);
+            break;
+        }
+        case Kind::BULK_ADD: {
+            // L'en-tête occupe la première ligne : les suivantes sont des données, lues par le handler
+            size_t lineEnd = source.find('\n', first.end);
+            if (lineEnd == std::string::npos)
+                lineEnd = source.size();
+            RoktLexer header(std::string_view(source).substr(first.end, lineEnd - first.end));
+            RoktBulkAddQuery node;
+            parsed = parseBulkAdd(header, &node, &error);
+            if (parsed && !header.getError().empty()) {
+                error = header.getError();
+                parsed = false;
+            }
+            node.body = std::string_view(source).substr(std::min(lineEnd + 1, source.size()));
+            query = std::move(node);
+            break;
+        }
+        case Kind::GET: {
+            RoktGetQuery node;
+            parsed = parseGet(lexer, &node, &error);
+            query = std::move(node);
+            break;
+        }
+        case Kind::COUNT: {
+            RoktCountQuery node;
+            parsed = parseCount(lexer, &node, &error);
+            query = std::move(node);
+            break;
+        }
+        case Kind::CHANGE: {
+            RoktChangeQuery node;
+            parsed = parseChange(lexer, &node, &error);
+            query = std::move(node);
+            break;
+        }
+        case Kind::REMOVE: {
+            RoktRemoveQuery node;
+            parsed = parseRemove(lexer, &node, &error);
+            query = std::move(node);
+            break;
+        }
+        case Kind::PREPARE: {
+            RoktPrepareQuery node;
+            parsed = parsePrepare(lexer, &node, &error);
+            query = std::move(node);
+            break;
+        }
+        case Kind::DEALLOCATE: {
+            RoktPrepareQuery node;
+            parsed = parseDeallocate(lexer, &node, &error);
+            query = std::move(node);
+            break;
+        }
+        case Kind::EXECUTE: {
+            RoktExecuteQuery node;
+            parsed = parseExecute(lexer, &node, &error);
+            query = std::move(node);
+            break;
+        }
+        case Kind::EXPLAIN:
+        case Kind::PROFILE: {
+            RoktExplainQuery node;
+            parsed = parseExplain(lexer, &node, &error);
+            query = std::move(node);
+            break;
+        }
+        case Kind::IMPORT: {
+            RoktTransferQuery node;
+            parsed = parseImport(lexer, &node, &error);
+            query = std::move(node);
+            break;
+        }
+        case Kind::EXPORT: {
+            RoktTransferQuery node;
+            parsed = parseExport(lexer, &node, &error);
+            query = std::move(node);
+            break;
+        }
+        case Kind::STATS:
+            parsed = expectEnd(lexer, &error);
+            break;
+        case Kind::CREATE_VIEW:
+        case Kind::UNKNOWN:
+            break;
+    }
+    // Une chaîne ou un bloc JSON non fermé prime sur l'erreur de syntaxe qui en découle
+    if (!lexer.getError().empty())
+        error = lexer.getError();
+    else if (!parsed && error.empty())
+        error = "Syntaxe invalide";
+    if (!formatError.empty() && error.empty())
+        error = formatError;
+}
@@ -0,0 +1,235 @@
+#ifndef ROKTCOMMAND_H
+#define ROKTCOMMAND_H
+
+#include "ConditionUtils.h"
+#include "RoktAggregate.h"
+#include "ResponseEncoding.h"
+#include "RoktTransfer.h"
+#include <memory>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+/**
+ * @brief Jeton produit par RoktLexer : une vue sur la requête, sans copie.
+ */
+struct RoktToken {
+    enum class Type {
+        WORD,    // suite de caractères sans espace ni séparateur
+        STRING,  // chaîne entre guillemets (la vue exclut les guillemets, échappements non traités)
+        JSON,    // bloc { ... } ou [ ... ] équilibré, guillemets et échappements compris
+        SYMBOL,  // '(' ')' ','
+        END      // fin de la requête ou ';' terminal
+    };
+    Type type = Type::END;
+    std::string_view text;
+    size_t begin = 0;  // position du jeton dans la requête (guillemet ouvrant compris)
+    size_t end = 0;    // position suivant le jeton
+
+    bool isWord(std::string_view word) const { return type == Type::WORD && text == word; }
+    bool isSymbol(char symbol) const { return type == Type::SYMBOL && text[0] == symbol; }
+};
+
+/**
+ * @brief Analyseur lexical des commandes, en un seul passage sur un std::string_view.
+ *
+ * Les mots sont séparés par des espaces ou par les symboles '(' ')' ',' ; un '"' ouvre une
+ * chaîne, un '{' ou un '[' en début de jeton un bloc JSON, lus jusqu'à leur fin. Un ';' hors chaîne termine la commande :
+ * la suite est ignorée. Aucun jeton n'est copié.
+ */
+class RoktLexer {
+private:
+    std::string_view input;
+    size_t pos;
+    RoktToken lookahead;
+    bool hasLookahead;
+    std::string error;
+
+    RoktToken scan();
+    RoktToken make(RoktToken::Type type, size_t begin, size_t textBegin, size_t textEnd, size_t end);
+
+public:
+    explicit RoktLexer(std::string_view input);
+    RoktToken next();
+    const RoktToken &peek();
+    // Texte restant à partir du prochain jeton (';' terminal compris)
+    std::string_view rest();
+    std::string_view slice(size_t begin, size_t end) const { return input.substr(begin, end - begin); }
+    // Renseigné si la requête contient une chaîne ou un bloc JSON non fermé
+    const std::string &getError() const { return error; }
+};
+
+// Nœuds de l'arbre syntaxique, un par forme de commande
+
+// CREATE TABLE <dataset> [LSM [KEY <champ>]] / DELETE <dataset> / EMPTY <dataset>
+struct RoktDatasetQuery {
+    std::string dataset;
+    std::string storage;  // CREATE TABLE : "LSM", vide pour un dataset SIMPLE
+    std::string key;      // CREATE TABLE ... LSM KEY <champ>
+};
+
+// ADD <json> [UNIQUE <champ>] IN <dataset>, <json> étant un objet ou un tableau d'objets
+struct RoktAddQuery {
+    std::string_view json;  // vue sur la requête
+    std::string uniqueField;
+    bool onConflictUpdate = false;  // UNIQUE <champ> ON CONFLICT UPDATE : fusion dans la ligne existante
+    std::string dataset;
+};
+
+// BULK ADD [UNIQUE <champ> [ON CONFLICT UPDATE]] IN <dataset> [BATCH <lignes>], sur la première
+// ligne de la requête, suivi d'un objet JSON par ligne (NDJSON) jusqu'à une ligne END
+struct RoktBulkAddQuery {
+    std::string uniqueField;
+    bool onConflictUpdate = false;
+    std::string dataset;
+    size_t batchRows = 0;   // lignes par écriture (0 : valeur par défaut du handler)
+    std::string_view body;  // lignes reçues avec l'en-tête (vue sur la requête)
+};
+
+// Position de reprise d'un GET paginé : version du dataset lue et rang de la première ligne
+// de la page suivante. Transmise au client sous forme opaque (CURSOR <jeton>).
+struct RoktScanCursor {
+    uint64_t version = 0;
+    uint64_t row = 0;
+
+    std::string encode() const;
+    // Renvoie false si le jeton n'a pas été produit par encode()
+    static bool decode(const std::string &token, RoktScanCursor *cursor);
+};
+
+// GET [DISTINCT] <champs> [AS <alias>] IN <dataset> [JOIN <dataset> ON <champ> = <champ>] [WHERE ...]
+//     [GROUP BY <clé>] [ORDER BY <clé> [ASC|DESC]] [LIMIT <n>] [OFFSET <n>] [CURSOR <jeton>]
+//     [STREAM [<lignes par bloc>]]
+struct RoktGetQuery {
+    bool distinct = false;
+    std::string fields;
+    std::vector<RoktAggregator::Aggregate> aggregates;  // COUNT(*), AVG(age)...
+    std::string dataset;
+    std::string joinDataset;
+    std::string joinLeft;   // champs de la condition de jointure, préfixés par le nom de leur
+    std::string joinRight;  // dataset ("users.id")
+    std::string alias;
+    std::vector<Condition> conditions;
+    std::string groupByKey;
+    std::string orderByKey;
+    bool orderDesc = false;
+    int limit = -1;
+    int offset = 0;
+    bool hasCursor = false;
+    RoktScanCursor cursor;
+    bool stream = false;
+    int streamBatch = 0;  // 0 : STREAM_DEFAULT_BATCH_ROWS
+};
+
+// COUNT <dataset> [<clé>:<valeur>]
+struct RoktCountQuery {
+    std::string dataset;
+    std::string condition;  // "key:value" tel que reçu (vide : toutes les lignes)
+    std::string key;
+    std::string value;
+};
+
+// CHANGE <champ> = <valeur> [WHERE ...] IN <dataset>
+struct RoktChangeQuery {
+    std::string field;
+    std::string op = "=";  // "=", ou "+=" / "-=" pour un champ numérique
+    std::string newValue;
+    std::vector<Condition> conditions;
+    std::string dataset;
+};
+
+// REMOVE WHERE ... IN <dataset> / REMOVE <nom> IN <dataset>
+struct RoktRemoveQuery {
+    std::vector<Condition> conditions;
+    std::string dataset;
+};
+
+class RoktCommand;
+
+// PREPARE <nom> AS <commande> / DEALLOCATE <nom>
+struct RoktPrepareQuery {
+    std::string name;
+    std::shared_ptr<const RoktCommand> inner;  // nul pour DEALLOCATE
+};
+
+// CREATE VIEW <nom> AS GET <agrégats> IN <dataset> [WHERE ...] [GROUP BY <clé>]
+struct RoktViewQuery {
+    std::string name;
+    std::shared_ptr<const RoktCommand> inner;
+};
+
+// EXPLAIN <commande> / PROFILE <commande>
+struct RoktExplainQuery {
+    std::shared_ptr<const RoktCommand> inner;
+};
+
+// EXECUTE <nom> [(<valeur>, <valeur>...)]
+struct RoktExecuteQuery {
+    std::string name;
+    std::vector<std::string> parameters;
+};
+
+// IMPORT <fichier> INTO <dataset> [FORMAT NDJSON|CSV]
+// EXPORT <dataset> TO <fichier> [FORMAT NDJSON|CSV] [WHERE ...]
+struct RoktTransferQuery {
+    std::string path;     // relatif au répertoire d'échange
+    std::string dataset;
+    bool hasFormat = false;  // sinon déduit de l'extension du fichier
+    RoktTransfer::Format format = RoktTransfer::Format::NDJSON;
+    std::vector<Condition> conditions;  // EXPORT uniquement
+};
+
+/**
+ * @brief Commande analysée une seule fois, à la réception de la requête.
+ *
+ * L'arbre obtenu sert au dispatch vers le handler, au calcul de la priorité et à l'exécution.
+ * La commande conserve le texte d'origine, sur lequel pointent ses vues : elle n'est ni
+ * copiable ni déplaçable et circule sous forme de std::shared_ptr.
+ */
+class RoktCommand {
+public:
+    enum class Kind { UNKNOWN, CREATE, ADD, GET, REMOVE, EMPTY, DELETE, COUNT, CHANGE, STATS, PREPARE, DEALLOCATE, EXECUTE, EXPLAIN, PROFILE,
+                      CREATE_VIEW, BULK_ADD, IMPORT, EXPORT };
+
+private:
+    std::string source;
+    Kind kind;
+    std::string_view keyword;
+    std::string error;
+    ResponseEncoding::Format format;
+    bool compressed;
+    std::variant<std::monostate, RoktDatasetQuery, RoktAddQuery, RoktBulkAddQuery, RoktGetQuery, RoktCountQuery, RoktChangeQuery, RoktRemoveQuery,
+                 RoktPrepareQuery, RoktExecuteQuery, RoktExplainQuery, RoktViewQuery, RoktTransferQuery> query;
+
+    explicit RoktCommand(std::string source);
+    void analyze();
+
+public:
+    // Analyse la requête ; la commande renvoyée n'est jamais nulle (voir getKind() et hasError())
+    static std::shared_ptr<const RoktCommand> parse(std::string source);
+    // Vrai si la ligne est l'en-tête d'un BULK ADD : seuls les préfixes et le premier mot-clé
+    // sont lus (contrôle fait à la réception, avant l'analyse de la requête complète)
+    static bool isBulkHeader(std::string_view line);
+
+    RoktCommand(const RoktCommand &) = delete;
+    RoktCommand &operator=(const RoktCommand &) = delete;
+
+    const std::string &getSource() const { return source; }
+    Kind getKind() const { return kind; }
+    // Premier mot de la requête (ex. "GET"), reconnu ou non, après les préfixes FORMAT et COMPRESS
+    std::string_view getKeyword() const { return keyword; }
+    // Format de la réponse demandé par le préfixe FORMAT <nom> (PRETTY par défaut)
+    ResponseEncoding::Format getFormat() const { return format; }
+    // Compression deflate de la réponse demandée par le préfixe COMPRESS [deflate]
+    bool isCompressed() const { return compressed; }
+    // Vrai si le mot-clé est reconnu mais la suite de la commande invalide
+    bool hasError() const { return !error.empty(); }
+    const std::string &getError() const { return error; }
+
+    // Nœud correspondant au type de la commande (ex. as<RoktGetQuery>() pour GET)
+    template <typename Query>
+    const Query &as() const { return std::get<Query>(query); }
+};
+
+#endif // ROKTCOMMAND_H
@@ -1,120 +1,792 @@
 #include "RoktDataset.h"
+#include "RequestArena.h"
+#include "QueryProfile.h"
+#include "LogService.h"
+#include "AtomicFile.h"
 #include <fstream>
-#include <sstream>
 #include <stdexcept>
 #include <filesystem>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <unordered_set>
 #include <nlohmann/json.hpp>
 
+namespace {
+    // Levée depuis le callback de parsing pour interrompre un scan (LIMIT atteint, erreur)
+    struct ScanStopped {};
 
+    // Fréquence (en lignes) du contrôle de la taille résidente pendant le chargement
+    const size_t RESIDENT_CHECK_INTERVAL = 256;
 
-// Constructeur pour un dataset SIMPLE
-RoktDataset::RoktDataset(DatasetConfigType t, const std::string &p, const std::string &ds, std::shared_ptr<EncryptService> enc)
-    : type(t), path(p), encryptService(enc) {
-    if (t == DatasetConfigType::DATASET)
+    // Nombre minimal de lignes par partition pour répartir un parcours sur plusieurs threads
+    const size_t SCAN_MIN_PARTITION_ROWS = 16384;
+
+    // Lignes lues en flux avant d'être appliquées au recalcul d'une vue
+    const size_t VIEW_REBUILD_BATCH_ROWS = 1024;
+}
+
+uint64_t RoktDatasetState::nextVersion() {
+    // Démarre à l'heure de lancement (en microsecondes) : une version n'est pas reprise après un
+    // redémarrage du serveur, un curseur de pagination émis avant est donc refusé
+    static std::atomic<uint64_t> clock(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count()));
+    return ++clock;
+}
+
+// Constructeur pour un dataset SIMPLE ou LSM (dont le fichier n'est pas utilisé : voir RoktLsmTree)
+RoktDataset::RoktDataset(DatasetConfigType t, const std::string &p, const std::string &ds, std::shared_ptr<EncryptService> enc,
+                         std::shared_ptr<RoktDatasetState> st)
+    : type(t), path(p), encryptService(enc), state(st) {
+    if (t == DatasetConfigType::DATASET || t == DatasetConfigType::LSM)
         datasetFiles.push_back(ds);
 }
 
 // Constructeur pour un dataset ROTATE
-RoktDataset::RoktDataset(DatasetConfigType t, const std::string &p, const std::vector<std::string> &ds, std::shared_ptr<EncryptService> enc)
-    : type(t), path(p), datasetFiles(ds), encryptService(enc) {}
+RoktDataset::RoktDataset(DatasetConfigType t, const std::string &p, const std::vector<std::string> &ds, std::shared_ptr<EncryptService> enc,
+                         std::shared_ptr<RoktDatasetState> st)
+    : type(t), path(p), datasetFiles(ds), encryptService(enc), state(st) {}
 
-// Fonction interne pour lire le dataset à partir d'un fichier
-bool RoktDataset::readDataset(const std::string &filename, nlohmann::json *result) {
-    std::string fullPath = path + "/" + filename;
-    std::ifstream file(fullPath, std::ios::binary);
-    if (!file) {
-        // Si le fichier n'existe pas, on crée un fichier vide
-        nlohmann::json empty = nlohmann::json::array();
-        writeDataset(filename, empty);
-        file.open(fullPath, std::ios::binary);
-        if (!file) {
-            this->lastError = "Impossible d'ouvrir le fichier dataset : " + filename;
-            return false;
-        }
-    }
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string encryptedData = buffer.str();
-    std::string decryptedData;
-    try {
-        decryptedData = encryptService->decrypt(encryptedData);
-    } catch (std::exception &e) {
-        // En cas d'erreur de décryptage, on recrée un fichier vide
-        nlohmann::json empty = nlohmann::json::array();
-        writeDataset(filename, empty);
-        *result = empty;
-        return true;
-    }
-    try {
-        *result = nlohmann::json::parse(decryptedData);
+// Fonction interne pour lire le dataset à partir de ses fichiers
+bool RoktDataset::readDataset(nlohmann::json *result) {
+    RoktRowStore scratch;
+    *result = nlohmann::json::array();
+    // Un fichier illisible n'est jamais réécrit : l'écriture qui voulait le lire échoue
+    bool readable = streamRows(scratch, [&](size_t row) {
+        result->push_back(scratch.materialize<nlohmann::json>(row));
+        scratch.clear();
         return true;
-    } catch (nlohmann::json::parse_error &e) {
-        // En cas d'erreur de parsing, recréer le fichier vide
-        nlohmann::json empty = nlohmann::json::array();
-        writeDataset(filename, empty);
-        *result = empty;
-        return true;
-    }
+    });
+    if (!readable)
+        lastError = "Can't read dataset";
+    return readable;
 }
 
 // Fonction interne pour lire le dataset à partir d'un fichier
 nlohmann::json RoktDataset::readData() {
-    // Construire le chemin complet du fichier dataset.
-    // On utilise le premier fichier de la liste datasetFiles.
     if (datasetFiles.empty()) {
         throw std::runtime_error("Aucun fichier de dataset défini.");
     }
-    std::string filename = datasetFiles[0];
-    std::string fullPath = path + "/" + filename;
+    nlohmann::json data;
+    if (!readAll(&data))
+        throw std::runtime_error(lastError);
+    return data;
+}
 
-    // Ouvrir le fichier en mode binaire.
-    std::ifstream file(fullPath, std::ios::binary);
+// Parcours en flux : le fichier est déchiffré par blocs et chaque ligne est ajoutée à `store` dès
+// qu'elle est complète, puis transmise à `onRow`. Les fichiers au format ruban sont lus mot à mot
+// après leur en-tête (le dictionnaire remplace celui de `store`) ; les anciens fichiers contenant
+// un tableau JSON sont parsés en flux puis encodés. La mémoire utilisée dépend uniquement de ce
+// que conserve `onRow` (qui peut vider `store` à chaque ligne).
+bool RoktDataset::streamFile(const std::string &filename, RoktRowStore &store, const std::function<bool(size_t row)> &onRow,
+                             std::vector<size_t> *ranks) {
+    std::ifstream file(path + "/" + filename, std::ios::binary);
     if (!file) {
-        // Si le fichier n'existe pas, créer un tableau nlohmann::json vide et l'écrire.
-        nlohmann::json emptyData = nlohmann::json::array();
-        writeDataset(filename, emptyData);
-        return emptyData;
+        // Si le fichier n'existe pas, le dataset est vide (il est créé par la première écriture)
+        return true;
     }
 
-    // Lire le contenu du fichier.
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string encryptedData = buffer.str();
+    // Les modifications du journal sont appliquées aux lignes qu'elles désignent (rang dans le
+    // fichier) ; seuls les enregistrements de la génération lue dans l'en-tête sont rejoués
+    bool journaled = filename == datasetFiles[0];
+    std::vector<nlohmann::json> records = journaled ? journal().read() : std::vector<nlohmann::json>();
+    RoktJournal::Replay replay({});
+    auto startReplay = [&](uint64_t generation) {
+        if (!journaled)
+            return;
+        if (state)
+            state->fileGeneration = generation;
+        replay = RoktJournal::Replay(RoktJournal::ofGeneration(std::move(records), generation));
+    };
+    size_t sequence = 0;
+    size_t delivered = 0;
+    std::exception_ptr rowError;
+    auto deliver = [&](size_t row) -> bool {
+        try {
+            size_t rank = sequence++;
+            if (!replay.empty() && replay.concerns(rank)) {
+                nlohmann::json patched = store.materialize<nlohmann::json>(row);
+                if (!replay.apply(rank, patched)) {
+                    // Ligne supprimée : retirée du store, le parcours continue
+                    store.erase({row});
+                    if (ranks != nullptr && ranks->empty())
+                        for (size_t i = 0; i < delivered; i++)
+                            ranks->push_back(i);
+                    return true;
+                }
+                store.replace(row, patched);
+            }
+            if (ranks != nullptr && delivered != rank)
+                ranks->push_back(rank);
+            delivered++;
+            return onRow(row);
+        } catch (...) {
+            rowError = std::current_exception();
+            return false;
+        }
+    };
+    auto callback = [&](int depth, nlohmann::json::parse_event_t event, nlohmann::json &parsed) -> bool {
+        // Une ligne est complète lorsqu'une valeur de profondeur 1 (élément du tableau racine) se termine
+        bool rowCompleted = depth == 1 && (event == nlohmann::json::parse_event_t::object_end ||
+                                           event == nlohmann::json::parse_event_t::array_end ||
+                                           event == nlohmann::json::parse_event_t::value);
+        if (!rowCompleted)
+            return true;
+        store.append(parsed);
+        if (!deliver(store.size() - 1))
+            throw ScanStopped();
+        // La ligne n'est jamais ajoutée au tableau racine
+        return false;
+    };
 
-    // Déchiffrer le contenu.
-    std::string decryptedData;
     try {
-        decryptedData = encryptService->decrypt(encryptedData);
+        std::unique_ptr<DecryptStreamBuf> decrypted = encryptService->decryptStream(file);
+        std::istream plain(decrypted.get());
+        if (RoktRowStore::isTapeStream(plain)) {
+            startReplay(store.readHeader(plain));
+            QueryProfile::Counter decode("decode", 1);
+            while (decode.measure(0, [&]() { return store.readRow(plain); }) && deliver(store.size() - 1)) {
+            }
+        } else {
+            // Ancien format : le parsing et le traitement des lignes sont mesurés ensemble
+            QueryProfile::Timer decode("decode");
+            startReplay(0);
+            nlohmann::json root = nlohmann::json::parse(plain, callback); // reste un tableau vide
+        }
+    } catch (const ScanStopped &) {
+        // Parcours interrompu volontairement
     } catch (std::exception &e) {
-        // En cas d'erreur de décryptage, on recrée un tableau vide.
-        nlohmann::json emptyData = nlohmann::json::array();
-        writeDataset(filename, emptyData);
-        return emptyData;
+        // Erreur de déchiffrement ou de parsing : le fichier est laissé tel quel (la lecture peut
+        // se faire sous verrou partagé, et le réécrire effacerait le dataset)
+        LogService::log("Fichier du dataset illisible : " + std::string(e.what()));
+        return false;
+    }
+    if (rowError)
+        std::rethrow_exception(rowError);
+    return true;
+}
+
+// Les runs d'un dataset LSM sont lus à la suite dans `store` (le dictionnaire de chaque run
+// prolonge celui du précédent), puis les lignes de la memtable sont relues depuis le journal
+bool RoktDataset::streamRows(RoktRowStore &store, const std::function<bool(size_t row)> &onRow, std::vector<size_t> *ranks,
+                             const std::function<bool(const RoktLsmRun &run)> &skipRun) {
+    if (!isLsm())
+        return streamFile(datasetFiles[0], store, onRow, ranks);
+    loadLsm();
+    // Comme pour l'ancien format, la lecture et le traitement des lignes sont mesurés ensemble
+    QueryProfile::Timer decode("decode");
+    bool readable = true;
+    bool stopped = false;
+    for (const auto &run : state->lsm->getRuns()) {
+        if (skipRun && skipRun(run))
+            continue;
+        // Un run illisible est conservé tel quel : ses lignes sont absentes du parcours
+        bool read = state->lsm->readRun(run, store, [&](size_t row) {
+            stopped = !onRow(row);
+            return !stopped;
+        });
+        if (!read) {
+            LogService::log("Run " + std::to_string(run.id) + " du dataset illisible.");
+            readable = false;
+        }
+        if (stopped)
+            return readable;
+    }
+    for (const auto &record : memtableRecords()) {
+        for (const auto &row : record["values"]) {
+            store.append(row);
+            if (!onRow(store.size() - 1))
+                return readable;
+        }
     }
+    return readable;
+}
+
+std::vector<nlohmann::json> RoktDataset::memtableRecords() const {
+    std::vector<nlohmann::json> records = RoktJournal::ofGeneration(journal().read(), state->lsm->memtableGeneration());
+    records.erase(std::remove_if(records.begin(), records.end(), [](const nlohmann::json &record) { return !RoktJournal::isAdd(record); }),
+                  records.end());
+    return records;
+}
 
-    // Parser le nlohmann::json déchiffré.
+void RoktDataset::checkJournal() {
+    if (!state || state->journalChecked)
+        return;
+    state->journalChecked = true;
+    RoktJournal current = journal();
+    current.repair();
+    if (current.size() == 0)
+        return;
+    // Un journal d'une autre génération que le fichier (ou que la memtable d'un dataset LSM) date
+    // d'avant la dernière réécriture ou le dernier vidage (arrêt entre l'écriture du fichier et le
+    // vidage du journal) : ses effets sont déjà dans le fichier ou dans les runs
+    uint64_t generation;
+    if (isLsm()) {
+        loadLsm();
+        generation = state->lsm->memtableGeneration();
+    } else {
+        generation = readGeneration(datasetFiles[0]);
+    }
+    for (const auto &record : current.read()) {
+        if (RoktJournal::generationOf(record) != generation) {
+            LogService::log("Journal du dataset antérieur à la dernière réécriture de son fichier : ignoré.");
+            current.clear();
+            return;
+        }
+    }
+}
+
+uint64_t RoktDataset::readGeneration(const std::string &filename) const {
+    std::ifstream file(path + "/" + filename, std::ios::binary);
+    if (!file)
+        return 0;
     try {
-        return nlohmann::json::parse(decryptedData);
-    } catch (nlohmann::json::parse_error &e) {
-        // En cas d'erreur de parsing, on écrase le fichier avec un tableau vide.
-        nlohmann::json emptyData = nlohmann::json::array();
-        writeDataset(filename, emptyData);
-        return emptyData;
+        std::unique_ptr<DecryptStreamBuf> decrypted = encryptService->decryptStream(file);
+        std::istream plain(decrypted.get());
+        if (!RoktRowStore::isTapeStream(plain))
+            return 0;
+        RoktRowStore header;
+        return header.readHeader(plain);
+    } catch (std::exception &) {
+        return 0;
+    }
+}
+
+// Chargement des lignes dans le store résident, abandonné si la taille maximale est dépassée
+void RoktDataset::loadResident() {
+    checkJournal();
+    if (!state || state->rows || state->oversized || state->maxResidentBytes == 0 || datasetFiles.empty())
+        return;
+    QueryProfile::Timer timer("load");
+    auto store = std::make_unique<RoktRowStore>();
+    std::vector<size_t> ranks;
+    bool tooLarge = false;
+    bool readable = streamRows(*store, [&](size_t row) {
+        if ((row + 1) % RESIDENT_CHECK_INTERVAL == 0 && store->memoryUsage() > state->maxResidentBytes)
+            tooLarge = true;
+        return !tooLarge;
+    }, &ranks);
+    if (tooLarge || store->memoryUsage() > state->maxResidentBytes) {
+        state->oversized = true;
+        return;
+    }
+    if (!readable) {
+        // Un fichier ou un run illisible est conservé : le dataset reste lu en flux, et chaque
+        // parcours signale l'erreur au lieu de renvoyer (ou de réécrire) une partie des lignes
+        state->oversized = true;
+        return;
+    }
+    timer.setRows(store->size(), store->size());
+    state->rows = std::move(store);
+    state->fileRanks = std::move(ranks);
+}
+
+void RoktDataset::loadLsm() {
+    if (!isLsm() || state->lsm)
+        return;
+    auto tree = std::make_unique<RoktLsmTree>(path, encryptService, state->lsmKey);
+    tree->load();
+    state->lsm = std::move(tree);
+}
+
+// Adopte le store d'un dataset qui vient d'être réécrit, s'il respecte la taille résidente
+void RoktDataset::adoptResident(std::unique_ptr<RoktRowStore> store) {
+    state->rows.reset();
+    state->oversized = false;
+    if (state->maxResidentBytes == 0)
+        return;
+    if (store->memoryUsage() > state->maxResidentBytes) {
+        state->oversized = true;
+        return;
+    }
+    state->rows = std::move(store);
+}
+
+// Les lignes sont encodées une seule fois : le même store sert à l'écriture du fichier, au
+// calcul des statistiques et devient le store résident
+template <typename BasicJsonType>
+void RoktDataset::replaceRows(const BasicJsonType &rows, const RoktRowDelta *delta) {
+    auto store = std::make_unique<RoktRowStore>();
+    if (rows.is_array()) {
+        for (auto &row : rows)
+            store->append(row);
+    }
+    writeAll(*store);
+    if (!state)
+        return;
+    state->version = RoktDatasetState::nextVersion();
+    state->prefixVersion = state->version.load();
+    // La version continue de croître à partir de celle du manifeste existant
+    if (!state->stats && !readManifest())
+        state->stats = std::make_unique<RoktDatasetStats>();
+    state->stats->rebuild(*store);
+    writeManifest();
+    updateViews(delta, store.get());
+    adoptResident(std::move(store));
+}
+
+// Libère le store s'il dépasse la taille maximale ; le dataset sera alors lu en flux
+void RoktDataset::checkResidentSize() {
+    if (isResident() && state->rows->memoryUsage() > state->maxResidentBytes) {
+        state->rows.reset();
+        state->oversized = true;
+    }
+}
+
+// Réécrit le fichier à partir des lignes résidentes, sans repasser par JSON
+void RoktDataset::writeResident() {
+    writeAll(*state->rows);
+}
+
+void RoktDataset::writeAll(const RoktRowStore &store) {
+    if (!isLsm()) {
+        writeStore(datasetFiles[0], store);
+        return;
+    }
+    loadLsm();
+    state->lsm->rewrite(store);
+    journal().clear();
+}
+
+bool RoktDataset::storedBytes(uint64_t *bytes) {
+    if (isLsm()) {
+        loadLsm();
+        *bytes = state->lsm->bytes();
+        return true;
     }
+    std::error_code ec;
+    uintmax_t size = std::filesystem::file_size(path + "/" + datasetFiles[0], ec);
+    *bytes = ec ? 0 : static_cast<uint64_t>(size);
+    return !ec;
 }
 
+bool RoktDataset::readManifest() {
+    std::ifstream file(path + "/" + encryptService->encryptFilename(DATASET_MANIFEST_FILENAME), std::ios::binary);
+    if (!file)
+        return false;
+    std::string encrypted((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    nlohmann::json manifest = nlohmann::json::parse(encryptService->decrypt(encrypted), nullptr, false);
+    auto stats = std::make_unique<RoktDatasetStats>();
+    if (manifest.is_discarded() || !stats->fromJson(manifest))
+        return false;
+    // Un fichier dataset modifié sans le manifeste (arrêt entre les deux écritures, copie
+    // manuelle) invalide les statistiques
+    uint64_t size;
+    if (!storedBytes(&size) || !manifest.contains("datasetBytes") || manifest["datasetBytes"] != size)
+        return false;
+    // De même pour le journal (arrêt entre l'ajout d'un enregistrement et le manifeste)
+    if (manifest.value("journalBytes", uint64_t(0)) != journal().size())
+        return false;
+    state->stats = std::move(stats);
+    return true;
+}
 
-// Fonction interne pour écrire le nlohmann::json dans le fichier dataset
-void RoktDataset::writeDataset(const std::string &filename, const nlohmann::json &j) {
-    std::string fullPath = path + "/" + filename;
-    std::string plaintext = j.dump();
-    std::string encryptedData = encryptService->encrypt(plaintext);
+void RoktDataset::writeManifest() {
+    std::string fullPath = path + "/" + encryptService->encryptFilename(DATASET_MANIFEST_FILENAME);
+    nlohmann::json manifest = state->stats->toJson();
+    uint64_t size;
+    storedBytes(&size);
+    manifest["datasetBytes"] = size;
+    manifest["journalBytes"] = journal().size();
+    std::string encryptedData = encryptService->encrypt(manifest.dump());
     std::ofstream file(fullPath, std::ios::binary);
     if (!file)
-        throw std::runtime_error("Impossible d'écrire dans le fichier dataset : " + filename);
+        throw std::runtime_error("Impossible d'écrire le manifeste du dataset");
     file.write(encryptedData.data(), encryptedData.size());
 }
 
+void RoktDataset::loadStats() {
+    if (state->stats)
+        return;
+    // Un journal réparé ne correspond plus au manifeste : les statistiques sont alors recalculées
+    checkJournal();
+    if (readManifest())
+        return;
+    // Dataset antérieur au manifeste (ou manifeste corrompu) : un parcours complet suffit
+    auto stats = std::make_unique<RoktDatasetStats>();
+    loadResident();
+    if (isResident()) {
+        stats->rebuild(*state->rows);
+    } else {
+        RoktRowStore scratch;
+        bool readable = streamRows(scratch, [&](size_t row) {
+            stats->addRow(scratch, row);
+            scratch.clear();
+            return true;
+        });
+        if (!readable) {
+            // Statistiques partielles : gardées en mémoire, mais pas dans le manifeste
+            state->stats = std::move(stats);
+            return;
+        }
+    }
+    state->stats = std::move(stats);
+    writeManifest();
+}
+
+std::shared_lock<std::shared_mutex> RoktDataset::lockStats() {
+    std::shared_lock<std::shared_mutex> readLock(state->mutex);
+    while (!state->stats) {
+        // Le test est refait verrou exclusif pris : un autre thread a pu charger entre-temps
+        readLock.unlock();
+        {
+            std::unique_lock<std::shared_mutex> writeLock(state->mutex);
+            loadStats();
+        }
+        readLock.lock();
+    }
+    return readLock;
+}
+
+bool RoktDataset::statistics(const std::function<void(const RoktDatasetStats &stats)> &reader) {
+    if (!state || datasetFiles.empty())
+        return false;
+    std::shared_lock<std::shared_mutex> readLock = lockStats();
+    reader(*state->stats);
+    return true;
+}
+
+size_t RoktDataset::scanPartitions(size_t rows, size_t maxPartitions) const {
+    size_t partitions = std::min(std::max<size_t>(maxPartitions, 1), static_cast<size_t>(std::max(state->scanThreads, 1)));
+    return std::max<size_t>(1, std::min(partitions, rows / SCAN_MIN_PARTITION_ROWS));
+}
+
+bool RoktDataset::planScan(size_t maxPartitions, RoktScanPlan *plan) {
+    if (!state || datasetFiles.empty())
+        return false;
+    std::shared_lock<std::shared_mutex> readLock = lockStats();
+    plan->rows = state->stats->getRowCount();
+    if (isResident())
+        plan->storage = "resident";
+    else if (!state->oversized && state->maxResidentBytes > 0)
+        plan->storage = "load";
+    else
+        plan->storage = "stream";
+    plan->partitions = plan->storage == "stream" ? 1 : scanPartitions(plan->rows, maxPartitions);
+    plan->runs = isLsm() && state->lsm ? state->lsm->getRuns().size() : 0;
+    return true;
+}
+
+bool RoktDataset::scanRows(const std::vector<Condition> &where, size_t maxPartitions, const std::function<bool(const RoktScanRow &row)> &visitor,
+                           size_t from) {
+    if (datasetFiles.empty()) {
+        this->lastError = "Aucun fichier de dataset défini.";
+        return false;
+    }
+    std::shared_lock<std::shared_mutex> readLock;
+    if (state) {
+        if ((!state->rows && !state->oversized && state->maxResidentBytes > 0) || (isLsm() && !state->lsm)) {
+            std::unique_lock<std::shared_mutex> writeLock(state->mutex);
+            loadLsm();
+            loadResident();
+        }
+        readLock = std::shared_lock<std::shared_mutex>(state->mutex);
+    }
+
+    // Profil de la requête (PROFILE), transmis explicitement aux threads du parcours
+    QueryProfile *profile = QueryProfile::current();
+    QueryProfile::Timer scanTimer("scan", profile);
+    std::atomic<uint64_t> scanned(0);
+    std::atomic<uint64_t> matched(0);
+    std::atomic<bool> conditionFailed(false);
+    bool readable = true;
+    if (isResident()) {
+        // Le WHERE est évalué sur le store ; les lignes sont réparties en plages contiguës
+        const RoktRowStore &store = *state->rows;
+        size_t first = std::min(from, store.size());
+        size_t partitions = scanPartitions(store.size() - first, maxPartitions);
+        std::vector<std::exception_ptr> errors(partitions);
+        std::atomic<uint64_t> workerCpuNs(0);
+        QueryProfile::Counter filter("filter", partitions, where.empty() ? nullptr : profile);
+        auto run = [&](size_t partition) {
+            size_t begin = first + (store.size() - first) * partition / partitions;
+            size_t end = first + (store.size() - first) * (partition + 1) / partitions;
+            uint64_t cpuStart = (profile != nullptr && partition > 0) ? QueryProfile::cpuNow() : 0;
+            size_t i = begin;
+            size_t kept = 0;
+            // Chaque partition a son propre prédicat (les indices de recherche sont modifiés)
+            RoktPredicate predicate(where, store.dictionary());
+            try {
+                for (; i < end && !conditionFailed; i++) {
+                    bool matches = true;
+                    bool evaluated = true;
+                    filter.measure(partition, [&]() {
+                        evaluated = predicate.matches(store, i, &matches);
+                        return evaluated && matches;
+                    });
+                    if (!evaluated) {
+                        conditionFailed = true;
+                        break;
+                    }
+                    if (!matches)
+                        continue;
+                    kept++;
+                    if (!visitor(RoktScanRow{store, i, i, partition})) {
+                        i++;
+                        break;
+                    }
+                }
+            } catch (...) {
+                errors[partition] = std::current_exception();
+            }
+            scanned += i - begin;
+            matched += kept;
+            if (profile != nullptr && partition > 0)
+                workerCpuNs += QueryProfile::cpuNow() - cpuStart;
+        };
+        std::vector<std::thread> workers;
+        for (size_t partition = 1; partition < partitions; partition++)
+            workers.emplace_back(run, partition);
+        run(0);
+        for (auto &worker : workers)
+            worker.join();
+        scanTimer.addCpu(workerCpuNs);
+        for (auto &error : errors) {
+            if (error)
+                std::rethrow_exception(error);
+        }
+    } else {
+        // Lecture en flux : une seule ligne est conservée à la fois dans le store temporaire
+        RoktRowStore scratch;
+        RoktPredicate predicate(where, scratch.dictionary());
+        size_t sequence = 0;
+        QueryProfile::Counter filter("filter", 1, where.empty() ? nullptr : profile);
+        // Run d'un dataset LSM entièrement avant la reprise, ou dont le filtre de Bloom exclut la
+        // valeur de clé cherchée : il n'est pas lu
+        auto skipRun = [&](const RoktLsmRun &run) {
+            if (sequence + run.rows > from && state->lsm->mayMatch(run, where))
+                return false;
+            sequence += run.rows;
+            return true;
+        };
+        readable = streamRows(scratch, [&](size_t i) {
+            if (sequence < from) {
+                sequence++;
+                scratch.clear();
+                return true;
+            }
+            bool matches = true;
+            bool evaluated = true;
+            filter.measure(0, [&]() {
+                evaluated = predicate.matches(scratch, i, &matches);
+                return evaluated && matches;
+            });
+            if (!evaluated) {
+                conditionFailed = true;
+                return false;
+            }
+            scanned++;
+            matched += matches ? 1 : 0;
+            bool keepGoing = !matches || visitor(RoktScanRow{scratch, i, sequence, 0});
+            sequence++;
+            scratch.clear();
+            return keepGoing;
+        }, nullptr, skipRun);
+    }
+    scanTimer.setRows(scanned, matched);
+    if (conditionFailed) {
+        this->lastError = "Can't verify condition";
+        return false;
+    }
+    if (!readable) {
+        this->lastError = "Can't read dataset";
+        return false;
+    }
+    return true;
+}
+
+template <typename BasicJsonType>
+bool RoktDataset::scan(const std::vector<Condition> &where, const std::function<bool(BasicJsonType &row)> &visitor) {
+    // Parcours séquentiel : seules les lignes retenues sont converties en JSON
+    QueryProfile::Counter materialize("materialize", 1);
+    return scanRows(where, 1, [&](const RoktScanRow &scanned) {
+        BasicJsonType row;
+        materialize.measure(0, [&]() {
+            row = scanned.store.materialize<BasicJsonType>(scanned.row);
+            return true;
+        });
+        return visitor(row);
+    });
+}
+
+template bool RoktDataset::scan<nlohmann::json>(const std::vector<Condition> &where, const std::function<bool(nlohmann::json &row)> &visitor);
+template bool RoktDataset::scan<ROKT::ArenaJson>(const std::vector<Condition> &where, const std::function<bool(ROKT::ArenaJson &row)> &visitor);
+
+// Lecture complète : depuis le store résident, sinon déchiffrée en flux et parsée directement
+// dans le type cible
+template <typename BasicJsonType>
+bool RoktDataset::readAll(BasicJsonType *rows) {
+    if (datasetFiles.empty()) {
+        this->lastError = "Aucun fichier de dataset défini.";
+        return false;
+    }
+    std::shared_lock<std::shared_mutex> readLock;
+    if (state) {
+        if ((!state->rows && !state->oversized && state->maxResidentBytes > 0) || (isLsm() && !state->lsm)) {
+            std::unique_lock<std::shared_mutex> writeLock(state->mutex);
+            loadLsm();
+            loadResident();
+        }
+        readLock = std::shared_lock<std::shared_mutex>(state->mutex);
+    }
+    QueryProfile::Timer timer("materialize");
+    if (isResident()) {
+        const RoktRowStore &store = *state->rows;
+        timer.setRows(store.size(), store.size());
+        *rows = BasicJsonType::array();
+        rows->template get_ref<typename BasicJsonType::array_t &>().reserve(store.size());
+        for (size_t i = 0; i < store.size(); i++)
+            rows->push_back(store.materialize<BasicJsonType>(i));
+        return true;
+    }
+
+    RoktRowStore scratch;
+    *rows = BasicJsonType::array();
+    bool readable = streamRows(scratch, [&](size_t row) {
+        rows->push_back(scratch.materialize<BasicJsonType>(row));
+        scratch.clear();
+        return true;
+    });
+    timer.setRows(rows->size(), rows->size());
+    if (!readable)
+        lastError = "Can't read dataset";
+    return readable;
+}
+
+template bool RoktDataset::readAll<nlohmann::json>(nlohmann::json *rows);
+template bool RoktDataset::readAll<ROKT::ArenaJson>(ROKT::ArenaJson *rows);
+
+// Fonction interne pour écrire le nlohmann::json dans le fichier dataset (format ruban)
+template <typename BasicJsonType>
+void RoktDataset::writeDataset(const std::string &filename, const BasicJsonType &j) {
+    RoktRowStore store;
+    if (j.is_array()) {
+        for (auto &row : j)
+            store.append(row);
+    }
+    writeStore(filename, store);
+}
+
+// Chiffre et écrit le store dans le fichier dataset : en-tête avec le dictionnaire puis les lignes
+void RoktDataset::writeStore(const std::string &filename, const RoktRowStore &store) {
+    // Le fichier est remplacé d'un bloc avant que le journal soit vidé : après un arrêt entre les
+    // deux, le journal restant porte l'ancienne génération et n'est pas rejoué sur le nouveau fichier
+    // (l'horloge des versions ne reprend jamais une valeur, même après un redémarrage)
+    uint64_t generation = RoktDatasetState::nextVersion();
+    std::string plaintext;
+    store.serialize(plaintext, generation);
+    AtomicFile::write(path + "/" + filename, encryptService->encrypt(plaintext));
+    if (!datasetFiles.empty() && filename == datasetFiles[0]) {
+        if (state)
+            state->fileGeneration = generation;
+        journal().clear();
+        if (state)
+            state->fileRanks.clear();
+    }
+}
+
+RoktJournal RoktDataset::journal() const {
+    return RoktJournal(path + "/" + encryptService->encryptFilename(DATASET_JOURNAL_FILENAME), encryptService);
+}
+
+double RoktDataset::garbageRatio(uint64_t *garbageBytes) const {
+    // Le chiffrement (AES-CTR) conserve la taille : le fichier compacté ferait la taille du ruban
+    // sérialisé ; l'écart et le journal sont obsolètes
+    std::error_code ec;
+    uint64_t datasetBytes = static_cast<uint64_t>(std::filesystem::file_size(path + "/" + datasetFiles[0], ec));
+    if (ec)
+        datasetBytes = 0;
+    uint64_t current = isResident() ? state->rows->serializedSize() : datasetBytes;
+    *garbageBytes = journal().size() + (datasetBytes > current ? datasetBytes - current : 0);
+    return static_cast<double>(*garbageBytes) / static_cast<double>(std::max<uint64_t>(datasetBytes, 1));
+}
+
+void RoktDataset::scheduleCompaction() {
+    if (!state || !state->backgroundTasks || state->closed)
+        return;
+    if (isLsm()) {
+        if (!state->lsm->canMerge() || state->compacting.exchange(true))
+            return;
+    } else {
+        if (!isResident() || state->compactionRatio <= 0 || state->compacting)
+            return;
+        uint64_t garbageBytes;
+        if (garbageRatio(&garbageBytes) < state->compactionRatio || garbageBytes < COMPACTION_MIN_GARBAGE_BYTES ||
+            state->compacting.exchange(true))
+            return;
+    }
+    // Le compactage attend le verrou exclusif : il commence après la réponse à la requête courante
+    RoktDataset dataset(*this);
+    if (!state->backgroundTasks->run(state.get(), [dataset]() mutable { dataset.compact(); }))
+        state->compacting = false;
+}
+
+void RoktDataset::waitCompaction() {
+    if (state && state->backgroundTasks)
+        state->backgroundTasks->wait(state.get());
+}
+
+void RoktDataset::compact() {
+    try {
+        if (isLsm()) {
+            mergeRuns();
+        } else {
+            std::unique_lock<std::shared_mutex> writeLock(state->mutex);
+            uint64_t garbageBytes;
+            if (!state->closed && isResident() && garbageRatio(&garbageBytes) >= state->compactionRatio) {
+                writeResident();
+                writeManifest();
+            }
+        }
+    } catch (std::exception &e) {
+        LogService::log(std::string("Compactage du dataset impossible : ") + e.what());
+    }
+    state->compacting = false;
+}
+
+void RoktDataset::mergeRuns() {
+    RoktLsmTree::Merge merge;
+    while (true) {
+        {
+            std::unique_lock<std::shared_mutex> writeLock(state->mutex);
+            if (state->closed || !state->lsm->planMerge(&merge))
+                return;
+        }
+        // Les runs sources sont immuables : lectures et écritures continuent pendant la fusion
+        bool written;
+        try {
+            written = state->lsm->writeMerge(merge);
+        } catch (...) {
+            std::unique_lock<std::shared_mutex> writeLock(state->mutex);
+            state->lsm->abortMerge(merge);
+            if (!state->lsm->isCurrent(merge))
+                return;
+            throw;
+        }
+        std::unique_lock<std::shared_mutex> writeLock(state->mutex);
+        // Une réécriture concurrente (CHANGE, REMOVE, EMPTY) a supprimé les runs sources : la
+        // fusion est abandonnée, qu'elle ait pu les lire ou non
+        if (state->closed || !state->lsm->isCurrent(merge)) {
+            state->lsm->abortMerge(merge);
+            return;
+        }
+        if (!written) {
+            state->lsm->abortMerge(merge);
+            LogService::log("Fusion des runs du dataset impossible : run illisible.");
+            return;
+        }
+        // Les lignes et leur ordre sont inchangés : seule la taille des fichiers est mise à jour
+        if (!state->lsm->commitMerge(merge))
+            return;
+        if (state->stats)
+            writeManifest();
+    }
+}
+
 // Méthode update (non modifiée ici, on suppose qu'elle suit la logique précédente)
 std::unique_ptr<ROKT::ResponseObject>RoktDataset::update(const nlohmann::json &set, const nlohmann::json &value, const std::vector<nlohmann::json> &where) {
     // Implémentation similaire à celle précédemment proposée (non détaillée ici)
@@ -123,8 +795,11 @@ std::unique_ptr<ROKT::ResponseObject>RoktDataset::update(const nlohmann::json &s
 
 // Méthode remove (non modifiée ici, on suppose qu'elle suit la logique précédente)
 std::unique_ptr<ROKT::ResponseObject>RoktDataset::remove(const std::string &set, const std::string &op, const nlohmann::json &compare) {
+    std::unique_lock<std::shared_mutex> writeLock;
+    if (state)
+        writeLock = std::unique_lock<std::shared_mutex>(state->mutex);
     nlohmann::json data;
-    if(!readDataset(datasetFiles[0], &data)) {
+    if(!readDataset(&data)) {
         return ROKT::ResponseService::response(3, "Can't read dataset");
     }
     nlohmann::json newData = nlohmann::json::array();
@@ -135,30 +810,459 @@ std::unique_ptr<ROKT::ResponseObject>RoktDataset::remove(const std::string &set,
         if (!(row.contains(set) && row[set] == compare))
             newData.push_back(row);
     }
-    writeDataset(datasetFiles[0], newData);
+    replaceRows(newData, nullptr);
     return ROKT::ResponseService::response(0);
 }
 
-// Méthode insert
+// Méthode insert : la ligne est ajoutée au store résident, le fichier est réécrit à partir du store
 std::unique_ptr<ROKT::ResponseObject>RoktDataset::insert(const nlohmann::json &newData) {
+    return insertRows(std::vector<nlohmann::json>{newData});
+}
+
+namespace {
+    // Forme comparable d'une valeur unique : 1 et 1.0 sont égaux, comme pour '=='. Les entiers
+    // gardent leur texte (au-delà de 2^53, deux entiers distincts ont le même double) ; seul un
+    // double entier représentable en entier 64 bits est ramené à cette forme
+    std::string uniqueKey(const nlohmann::json &value) {
+        if (!value.is_number_float())
+            return value.dump();
+        double number = value.get<double>();
+        if (std::trunc(number) != number)
+            return value.dump();
+        if (number >= -9223372036854775808.0 && number < 9223372036854775808.0)
+            return std::to_string(static_cast<int64_t>(number));
+        if (number > 0 && number < 18446744073709551616.0)
+            return std::to_string(static_cast<uint64_t>(number));
+        return value.dump();
+    }
+}
+
+// Le champ unique est lu par son chemin ("a.b"), comme sur les lignes du dataset (RoktFieldPath)
+std::unique_ptr<ROKT::ResponseObject> RoktDataset::checkUniqueField(const std::vector<nlohmann::json> &rows, const std::string &uniqueField) {
+    for (const auto &row : rows) {
+        if (findNestedValue(row, uniqueField) == nullptr)
+            return ROKT::ResponseService::response(12, "Champ unique '" + uniqueField + "' absent");
+    }
+    return nullptr;
+}
+
+bool RoktDataset::collectUniqueKeys(const std::string &uniqueField, std::unordered_set<std::string> *keys) {
+    // Seule la valeur du champ unique est convertie, lue directement sur le ruban
+    if (isResident()) {
+        const RoktRowStore &store = *state->rows;
+        RoktFieldPath path(uniqueField, store.dictionary());
+        for (size_t row = 0; row < store.size(); row++) {
+            size_t pos = path.lookup(store, row);
+            if (pos != RoktRowStore::npos)
+                keys->insert(uniqueKey(store.materializeValue<nlohmann::json>(pos)));
+        }
+        return true;
+    }
+    RoktRowStore scratch;
+    std::unique_ptr<RoktFieldPath> path;
+    return streamRows(scratch, [&](size_t row) {
+        if (!path)
+            path = std::make_unique<RoktFieldPath>(uniqueField, scratch.dictionary());
+        size_t pos = path->lookup(scratch, row);
+        if (pos != RoktRowStore::npos)
+            keys->insert(uniqueKey(scratch.materializeValue<nlohmann::json>(pos)));
+        scratch.clear();
+        return true;
+    });
+}
+
+std::unique_ptr<ROKT::ResponseObject>RoktDataset::insertRows(const std::vector<nlohmann::json> &rows, const std::string &uniqueField,
+                                                             std::vector<size_t> *duplicates) {
+    std::unique_lock<std::shared_mutex> writeLock;
+    if (state) {
+        writeLock = std::unique_lock<std::shared_mutex>(state->mutex);
+        loadResident();
+        // Chargées avant l'ajout : les nouvelles lignes ne doivent être comptées qu'une fois
+        loadStats();
+    }
+    if (uniqueField.empty())
+        return appendRows(rows);
+    if (auto missing = checkUniqueField(rows, uniqueField))
+        return missing;
+    // Recherche des valeurs existantes et ajout sous le même verrou : deux ajouts simultanés ne
+    // peuvent pas insérer la même valeur
+    std::unordered_set<std::string> keys;
+    if (!collectUniqueKeys(uniqueField, &keys))
+        return ROKT::ResponseService::response(3, "Can't read dataset");
+    std::vector<nlohmann::json> accepted;
+    accepted.reserve(rows.size());
+    for (size_t i = 0; i < rows.size(); i++) {
+        if (!keys.insert(uniqueKey(*findNestedValue(rows[i], uniqueField))).second) {
+            if (duplicates)
+                duplicates->push_back(i);
+            continue;
+        }
+        accepted.push_back(rows[i]);
+    }
+    return appendRows(accepted);
+}
+
+std::unique_ptr<ROKT::ResponseObject>RoktDataset::appendRows(const std::vector<nlohmann::json> &rows) {
+    if (rows.empty())
+        return ROKT::ResponseService::response(2);
+    if (isLsm())
+        return appendMemtable(rows);
+    if (isResident()) {
+        size_t first = state->rows->size();
+        for (const auto &row : rows)
+            state->rows->append(row);
+        writeResident();
+        state->version = RoktDatasetState::nextVersion();
+        for (size_t i = first; i < state->rows->size(); i++)
+            state->stats->addRow(*state->rows, i);
+        writeManifest();
+        if (!state->views.empty()) {
+            RoktRowDelta delta;
+            for (const auto &row : rows)
+                delta.added.append(row);
+            updateViews(&delta, nullptr);
+        }
+        checkResidentSize();
+        return ROKT::ResponseService::response(2);
+    }
     nlohmann::json data;
     std::ifstream infile(path + "/" + datasetFiles[0], std::ios::binary);
     if (infile) {
-        if(!readDataset(datasetFiles[0], &data)) {
+        if(!readDataset(&data)) {
             return ROKT::ResponseService::response(3, "Can't read dataset");
         }
     }
     else
         data = nlohmann::json::array();
-    data.push_back(newData);
+    for (const auto &row : rows)
+        data.push_back(row);
     writeDataset(datasetFiles[0], data);
+    if (state) {
+        state->version = RoktDatasetState::nextVersion();
+        RoktRowDelta delta;
+        for (const auto &row : rows)
+            delta.added.append(row);
+        for (size_t i = 0; i < delta.added.size(); i++)
+            state->stats->addRow(delta.added, i);
+        writeManifest();
+        updateViews(&delta, nullptr);
+    }
+    return ROKT::ResponseService::response(2);
+}
+
+std::unique_ptr<ROKT::ResponseObject>RoktDataset::appendMemtable(const std::vector<nlohmann::json> &rows) {
+    loadLsm();
+    // Seules les nouvelles lignes sont écrites : les runs ne sont pas relus
+    nlohmann::json record = RoktJournal::addOperation(rows);
+    RoktJournal::stamp(record, state->lsm->memtableGeneration());
+    if (!journal().append(record))
+        return ROKT::ResponseService::response(3, "Can't write dataset");
+    state->version = RoktDatasetState::nextVersion();
+    RoktRowDelta delta;
+    if (isResident()) {
+        size_t first = state->rows->size();
+        for (const auto &row : rows)
+            state->rows->append(row);
+        for (size_t i = first; i < state->rows->size(); i++)
+            state->stats->addRow(*state->rows, i);
+        if (!state->views.empty()) {
+            for (const auto &row : rows)
+                delta.added.append(row);
+        }
+    } else {
+        for (const auto &row : rows)
+            delta.added.append(row);
+        for (size_t i = 0; i < delta.added.size(); i++)
+            state->stats->addRow(delta.added, i);
+    }
+    if (journal().size() >= state->memtableBytes)
+        flushMemtable();
+    writeManifest();
+    if (!state->views.empty())
+        updateViews(&delta, nullptr);
+    checkResidentSize();
+    scheduleCompaction();
+    return ROKT::ResponseService::response(2);
+}
+
+void RoktDataset::flushMemtable() {
+    RoktLsmTree &tree = *state->lsm;
+    if (isResident() && state->rows->size() >= tree.rows()) {
+        // La memtable forme la fin du store résident, après les lignes des runs
+        tree.flush(*state->rows, tree.rows(), state->rows->size());
+    } else {
+        // Lignes relues depuis le journal et encodées avec le dictionnaire du run le plus récent,
+        // que le nouveau run doit prolonger
+        RoktRowStore memtable;
+        if (!tree.getRuns().empty() && !tree.readRun(tree.getRuns().back(), memtable, [](size_t) { return false; })) {
+            LogService::log("Vidage de la memtable impossible : run illisible.");
+            return;
+        }
+        memtable.clear();
+        for (const auto &record : memtableRecords()) {
+            for (const auto &row : record["values"])
+                memtable.append(row);
+        }
+        tree.flush(memtable, 0, memtable.size());
+    }
+    journal().clear();
+}
+
+std::unique_ptr<ROKT::ResponseObject>RoktDataset::increment(const std::string &field, const nlohmann::json &by,
+                                                            const std::vector<Condition> &where, size_t *changed) {
+    return modifyRows(RoktJournal::incrementOperation(field, by), where, changed);
+}
+
+std::unique_ptr<ROKT::ResponseObject>RoktDataset::assign(const std::string &field, const nlohmann::json &value,
+                                                         const std::vector<Condition> &where, size_t *changed) {
+    return modifyRows(RoktJournal::setOperation(field, value), where, changed);
+}
+
+std::unique_ptr<ROKT::ResponseObject>RoktDataset::erase(const std::vector<Condition> &where, size_t *removed) {
+    return modifyRows(RoktJournal::deleteOperation(), where, removed);
+}
+
+std::unique_ptr<ROKT::ResponseObject>RoktDataset::modifyRows(const nlohmann::json &operation, const std::vector<Condition> &where,
+                                                             size_t *changed) {
+    *changed = 0;
+    if (datasetFiles.empty())
+        return ROKT::ResponseService::response(567);
+    std::unique_lock<std::shared_mutex> writeLock;
+    if (state) {
+        writeLock = std::unique_lock<std::shared_mutex>(state->mutex);
+        loadResident();
+        loadStats();
+    }
+    bool trackDelta = state && !state->views.empty();
+    bool erasing = RoktJournal::isDelete(operation);
+    std::string field = operation.value("field", std::string());
+    RoktRowDelta delta;
+
+    if (!isResident() || isLsm()) {
+        // Lignes lues en flux, ou runs d'un dataset LSM (immuables) : le dataset est réécrit
+        nlohmann::json data;
+        if (!readDataset(&data))
+            return ROKT::ResponseService::response(3, "Can't read dataset");
+        nlohmann::json kept = nlohmann::json::array();
+        for (auto &row : data) {
+            bool matched;
+            if (!evaluateConditions(row, where, &matched))
+                return ROKT::ResponseService::response(3, "Can't verify condition");
+            if (matched && erasing) {
+                if (trackDelta)
+                    delta.removed.append(row);
+                (*changed)++;
+                continue;
+            }
+            nlohmann::json value;
+            if (matched && row.is_object()) {
+                auto found = row.find(field);
+                if (RoktJournal::fieldValue(operation, found == row.end() ? nullptr : &*found, &value)) {
+                    if (trackDelta)
+                        delta.removed.append(row);
+                    row[field] = std::move(value);
+                    if (trackDelta)
+                        delta.added.append(row);
+                    (*changed)++;
+                }
+            }
+            kept.push_back(std::move(row));
+        }
+        if (*changed > 0)
+            replaceRows(kept, trackDelta ? &delta : nullptr);
+        return ROKT::ResponseService::response(0);
+    }
+
+    RoktRowStore &store = *state->rows;
+    RoktPredicate predicate(where, store.dictionary());
+    uint32_t keyId;
+    bool knownField = !erasing && store.dictionary().find(field, &keyId);
+    uint32_t hint = 0;
+    std::vector<size_t> rows;
+    bool reshaped = erasing;  // lignes supprimées ou champ ajouté : les statistiques sont recalculées
+    for (size_t row = 0; row < store.size(); row++) {
+        bool matched;
+        if (!predicate.matches(store, row, &matched))
+            return ROKT::ResponseService::response(3, "Can't verify condition");
+        if (!matched)
+            continue;
+        if (erasing) {
+            if (trackDelta)
+                delta.removed.append(store.materialize<nlohmann::json>(row));
+            rows.push_back(row);
+            continue;
+        }
+        size_t rowPos = store.rowPosition(row);
+        if (store.tag(rowPos) != RoktRowStore::TAG_OBJECT)
+            continue;
+        size_t pos = knownField ? store.find(rowPos, keyId, &hint) : RoktRowStore::npos;
+        nlohmann::json current;
+        if (pos != RoktRowStore::npos)
+            current = store.materializeValue<nlohmann::json>(pos);
+        nlohmann::json value;
+        if (!RoktJournal::fieldValue(operation, pos == RoktRowStore::npos ? nullptr : &current, &value))
+            continue;
+        if (trackDelta)
+            delta.removed.append(store.materialize<nlohmann::json>(row));
+        // Une valeur de même taille (un compteur en général) est réécrite directement sur le ruban
+        if (pos == RoktRowStore::npos || !store.assign(pos, value)) {
+            nlohmann::json updated = store.materialize<nlohmann::json>(row);
+            updated[field] = value;
+            store.replace(row, updated);
+            reshaped = reshaped || pos == RoktRowStore::npos;
+        }
+        if (trackDelta)
+            delta.added.append(store.materialize<nlohmann::json>(row));
+        rows.push_back(row);
+    }
+    *changed = rows.size();
+    if (rows.empty())
+        return ROKT::ResponseService::response(0);
+
+    // Seule l'opération est écrite, avec le rang des lignes dans le fichier
+    nlohmann::json record = operation;
+    RoktJournal::stamp(record, state->fileGeneration);
+    nlohmann::json &ranks = record["rows"] = nlohmann::json::array();
+    for (size_t row : rows)
+        ranks.push_back(state->fileRanks.empty() ? row : state->fileRanks[row]);
+    if (erasing) {
+        if (state->fileRanks.empty()) {
+            state->fileRanks.resize(store.size());
+            for (size_t row = 0; row < store.size(); row++)
+                state->fileRanks[row] = row;
+        }
+        store.erase(rows);
+        // Même suppression sur les rangs : la ligne i du store reste la ligne fileRanks[i] du fichier
+        size_t kept = 0;
+        size_t next = 0;
+        for (size_t row = 0; row < state->fileRanks.size(); row++) {
+            if (next < rows.size() && rows[next] == row)
+                next++;
+            else
+                state->fileRanks[kept++] = state->fileRanks[row];
+        }
+        state->fileRanks.resize(kept);
+    }
+    // Sans journal, le fichier est réécrit
+    if (!journal().append(record))
+        writeResident();
+    state->version = RoktDatasetState::nextVersion();
+    state->prefixVersion = state->version.load();
+    if (reshaped)
+        state->stats->rebuild(store);
+    else
+        state->stats->updateColumn(store, field, rows);
+    writeManifest();
+    updateViews(trackDelta ? &delta : nullptr, nullptr);
+    checkResidentSize();
+    scheduleCompaction();
+    return ROKT::ResponseService::response(0);
+}
+
+std::unique_ptr<ROKT::ResponseObject>RoktDataset::upsertRows(const std::vector<nlohmann::json> &rows, const std::string &uniqueField,
+                                                             size_t *inserted, size_t *updated) {
+    *inserted = 0;
+    *updated = 0;
+    if (auto missing = checkUniqueField(rows, uniqueField))
+        return missing;
+    std::unique_lock<std::shared_mutex> writeLock;
+    if (state) {
+        writeLock = std::unique_lock<std::shared_mutex>(state->mutex);
+        loadResident();
+        loadStats();
+    }
+    // Rang de chaque valeur unique ; les lignes ajoutées par l'appel y sont aussi enregistrées,
+    // pour qu'un doublon de la même requête soit fusionné et non ajouté deux fois
+    std::unordered_map<std::string, size_t> positions;
+    RoktRowDelta delta;
+    bool trackDelta = state && !state->views.empty();
+
+    if (isResident()) {
+        RoktRowStore &store = *state->rows;
+        // Seule la valeur du champ unique est convertie, lue directement sur le ruban
+        RoktFieldPath path(uniqueField, store.dictionary());
+        for (size_t row = 0; row < store.size(); row++) {
+            size_t pos = path.lookup(store, row);
+            if (pos != RoktRowStore::npos)
+                positions.emplace(uniqueKey(store.materializeValue<nlohmann::json>(pos)), row);
+        }
+        std::vector<nlohmann::json> added;
+        std::vector<size_t> addedRows;  // rang de chaque ligne ajoutée, une fois le store complété
+        for (const auto &row : rows) {
+            std::string key = uniqueKey(*findNestedValue(row, uniqueField));
+            auto found = positions.find(key);
+            if (found == positions.end()) {
+                positions.emplace(key, store.size() + added.size());
+                added.push_back(row);
+                continue;
+            }
+            if (found->second >= store.size()) {
+                added[found->second - store.size()].update(row);
+            } else {
+                nlohmann::json merged = store.materialize<nlohmann::json>(found->second);
+                if (trackDelta)
+                    delta.removed.append(merged);
+                merged.update(row);
+                store.replace(found->second, merged);
+                if (trackDelta)
+                    delta.added.append(merged);
+            }
+            (*updated)++;
+        }
+        *inserted = added.size();
+        if (*updated == 0)
+            return appendRows(added);
+        // Une ligne modifiée ne peut être retirée des statistiques : elles sont recalculées sur
+        // le ruban, comme après un CHANGE
+        for (const auto &row : added) {
+            store.append(row);
+            if (trackDelta)
+                delta.added.append(row);
+        }
+        writeResident();
+        state->version = RoktDatasetState::nextVersion();
+        state->prefixVersion = state->version.load();
+        state->stats->rebuild(store);
+        writeManifest();
+        updateViews(trackDelta ? &delta : nullptr, nullptr);
+        checkResidentSize();
+        return ROKT::ResponseService::response(2);
+    }
+
+    nlohmann::json data;
+    if (!readDataset(&data))
+        return ROKT::ResponseService::response(3, "Can't read dataset");
+    for (size_t row = 0; row < data.size(); row++) {
+        const nlohmann::json *field = findNestedValue(data[row], uniqueField);
+        if (field != nullptr)
+            positions.emplace(uniqueKey(*field), row);
+    }
+    for (const auto &row : rows) {
+        std::string key = uniqueKey(*findNestedValue(row, uniqueField));
+        auto found = positions.find(key);
+        if (found == positions.end()) {
+            positions.emplace(key, data.size());
+            data.push_back(row);
+            if (trackDelta)
+                delta.added.append(row);
+            (*inserted)++;
+            continue;
+        }
+        if (trackDelta)
+            delta.removed.append(data[found->second]);
+        data[found->second].update(row);
+        if (trackDelta)
+            delta.added.append(data[found->second]);
+        (*updated)++;
+    }
+    replaceRows(data, trackDelta ? &delta : nullptr);
     return ROKT::ResponseService::response(2);
 }
 
 // Méthode select : renvoie un RoktData à partir d'une sélection de champs.
 RoktData RoktDataset::select(const std::vector<std::string> &keys) {
     nlohmann::json data;
-    if(!readDataset(datasetFiles[0], &data)) {
+    if(!readAll(&data)) {
         return RoktData(nlohmann::json::array());
     }
     // Si le premier champ est "*", renvoyer les données complètes
@@ -179,16 +1283,85 @@ RoktData RoktDataset::select(const std::vector<std::string> &keys) {
 }
 
 std::unique_ptr<ROKT::ResponseObject>RoktDataset::clear() {
-    nlohmann::json empty = nlohmann::json::array();
-    writeDataset(datasetFiles[0], empty);
+    std::unique_lock<std::shared_mutex> writeLock;
+    if (state)
+        writeLock = std::unique_lock<std::shared_mutex>(state->mutex);
+    replaceRows(nlohmann::json::array(), nullptr);
     return ROKT::ResponseService::response(0); // 0 correspond à "OK"
 }
 
 // Méthode overwrite : remplace le contenu du dataset par newData.
-std::unique_ptr<ROKT::ResponseObject>RoktDataset::overwrite(const nlohmann::json &newData) {
+template <typename BasicJsonType>
+std::unique_ptr<ROKT::ResponseObject>RoktDataset::overwrite(const BasicJsonType &newData, const RoktRowDelta *delta) {
     if (datasetFiles.empty())
         return ROKT::ResponseService::response(567);
-    std::string filename = datasetFiles[0];
-    writeDataset(filename, newData);
+    std::unique_lock<std::shared_mutex> writeLock;
+    if (state)
+        writeLock = std::unique_lock<std::shared_mutex>(state->mutex);
+    replaceRows(newData, delta);
     return ROKT::ResponseService::response(0);
 }
+
+template std::unique_ptr<ROKT::ResponseObject>RoktDataset::overwrite<nlohmann::json>(const nlohmann::json &newData, const RoktRowDelta *delta);
+template std::unique_ptr<ROKT::ResponseObject>RoktDataset::overwrite<ROKT::ArenaJson>(const ROKT::ArenaJson &newData, const RoktRowDelta *delta);
+
+bool RoktDataset::rebuildView(RoktView &view, const RoktRowStore *rows) {
+    view.reset();
+    if (rows == nullptr && isResident())
+        rows = state->rows.get();
+    if (rows != nullptr) {
+        view.apply(*rows, 0, rows->size(), 1);
+        return true;
+    }
+    // Lecture en flux, par lots de lignes
+    RoktRowStore scratch;
+    bool readable = streamRows(scratch, [&](size_t row) {
+        if (scratch.size() >= VIEW_REBUILD_BATCH_ROWS) {
+            view.apply(scratch, 0, scratch.size(), 1);
+            scratch.clear();
+        }
+        return true;
+    });
+    if (!readable) {
+        // Une vue calculée sur une partie des lignes n'est pas écrite
+        LogService::log("Vue " + view.getName() + " non recalculée : dataset source illisible.");
+        view.invalidate();
+        return false;
+    }
+    view.apply(scratch, 0, scratch.size(), 1);
+    return true;
+}
+
+void RoktDataset::updateViews(const RoktRowDelta *delta, const RoktRowStore *rows) {
+    if (!state)
+        return;
+    for (auto &view : state->views) {
+        if (delta != nullptr && view->isReady())
+            view->apply(*delta);
+        else if (!rebuildView(*view, rows))
+            continue;
+        view->getStorage()->overwrite(view->rows());
+    }
+}
+
+void RoktDataset::attachView(const std::shared_ptr<RoktView> &view) {
+    std::unique_lock<std::shared_mutex> writeLock(state->mutex);
+    loadResident();
+    if (rebuildView(*view, nullptr))
+        view->getStorage()->overwrite(view->rows());
+    state->views.push_back(view);
+}
+
+void RoktDataset::detachView(const std::string &name) {
+    std::unique_lock<std::shared_mutex> writeLock(state->mutex);
+    state->views.erase(std::remove_if(state->views.begin(), state->views.end(),
+                                      [&](const std::shared_ptr<RoktView> &view) { return view->getName() == name; }),
+                       state->views.end());
+}
+
+bool RoktDataset::hasViews() {
+    if (!state)
+        return false;
+    std::shared_lock<std::shared_mutex> readLock(state->mutex);
+    return !state->views.empty();
+}
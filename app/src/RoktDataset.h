@@ -4,13 +4,79 @@
 #include "RoktData.h"
 #include "EncryptService.h"
 #include "RoktResponseService.h"
+#include "ConditionUtils.h"
+#include "RoktRowStore.h"
+#include "RoktStats.h"
+#include "RoktView.h"
+#include "RoktJournal.h"
+#include "RoktLsmTree.h"
+#include "BackgroundTasks.h"
 #include <string>
 #include <vector>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <shared_mutex>
+#include <atomic>
+#include <unordered_set>
 #include <nlohmann/json.hpp>
 
+// Manifeste du dataset (statistiques), chiffré dans le dossier du dataset
+#define DATASET_MANIFEST_FILENAME "manifest.json"
+// Journal des modifications en place (RoktJournal), vidé à chaque réécriture du fichier dataset
+#define DATASET_JOURNAL_FILENAME "journal.log"
+#define COMPACTION_MIN_GARBAGE_BYTES (1024 * 1024)    // en deçà, le fichier n'est jamais compacté
+
 enum class DatasetConfigType {
     ROTATE,
-    DATASET
+    DATASET,
+    LSM      // lignes ajoutées dans une memtable puis vidées en runs immuables (RoktLsmTree)
+};
+
+/**
+ * @brief État partagé d'un dataset entre les requêtes : lignes résidentes en mémoire.
+ *
+ * Les lignes sont chargées au premier accès dans un RoktRowStore et maintenues à jour par les
+ * écritures. Si le dataset dépasse `maxResidentBytes`, il reste lu en flux depuis le fichier.
+ * Les statistiques du manifeste sont chargées au premier besoin puis tenues à jour par les écritures,
+ * de même que les vues matérialisées définies sur le dataset.
+ * Le verrou protège le store, les statistiques et les fichiers (lectures partagées, écritures
+ * exclusives).
+ */
+struct RoktDatasetState {
+    std::shared_mutex mutex;
+    std::unique_ptr<RoktRowStore> rows; ///< nullptr tant que le dataset n'est pas chargé
+    bool oversized = false;             ///< true si le dataset dépasse la taille résidente
+    size_t maxResidentBytes = 0;        ///< 0 désactive le chargement en mémoire
+    int scanThreads = 1;                ///< nombre maximal de threads d'un parcours parallèle
+    double compactionRatio = 0;         ///< part obsolète du fichier déclenchant le compactage (0 : désactivé)
+    std::vector<size_t> fileRanks;      ///< rang dans le fichier de chaque ligne résidente (vide : même rang)
+    std::atomic<bool> compacting{false}; ///< compactage en arrière-plan en cours
+    BackgroundTasks *backgroundTasks = nullptr; ///< threads de compactage (nullptr : pas de compactage)
+    bool closed = false;                ///< dataset supprimé : plus de compactage (verrou exclusif)
+    bool journalChecked = false;        ///< journal relu et réparé si besoin au premier accès (verrou exclusif)
+    std::atomic<uint64_t> fileGeneration{0}; ///< génération du fichier dataset, reportée dans chaque enregistrement du journal
+    std::string lsmKey;                 ///< champ clé d'un dataset LSM (filtres de Bloom des runs)
+    size_t memtableBytes = 0;           ///< taille du journal d'un dataset LSM déclenchant son vidage (0 : à chaque écriture)
+    std::unique_ptr<RoktLsmTree> lsm;   ///< runs d'un dataset LSM, nullptr tant qu'ils ne sont pas chargés
+    std::unique_ptr<RoktDatasetStats> stats; ///< nullptr tant que le manifeste n'est pas chargé
+    std::atomic<uint64_t> version{nextVersion()}; ///< change à chaque écriture (cache de résultats)
+    std::atomic<uint64_t> prefixVersion{nextVersion()}; ///< change quand des lignes existantes changent ; un ajout en fin de dataset la conserve (curseurs)
+    std::vector<std::shared_ptr<RoktView>> views; ///< vues matérialisées alimentées par ce dataset
+
+    // Valeurs tirées d'une horloge commune à tous les datasets : un dataset supprimé puis
+    // recréé (ou rechargé après un redémarrage) ne reprend jamais une version déjà utilisée
+    static uint64_t nextVersion();
+};
+
+/**
+ * @brief Plan d'un parcours du dataset, décrit sans l'exécuter (EXPLAIN).
+ */
+struct RoktScanPlan {
+    std::string storage;    ///< "resident", "load" (chargé en mémoire au premier parcours) ou "stream"
+    size_t rows = 0;        ///< nombre de lignes d'après les statistiques
+    size_t partitions = 1;  ///< threads d'un parcours parallèle
+    size_t runs = 0;        ///< runs d'un dataset LSM
 };
 
 class RoktDataset {
@@ -19,29 +85,181 @@ private:
     std::string path; // chemin vers le dossier du dataset
     std::vector<std::string> datasetFiles; // pour DATASET, un seul fichier ; pour ROTATE, plusieurs fichiers
     std::shared_ptr<EncryptService> encryptService;
+    std::shared_ptr<RoktDatasetState> state;
     std::string lastError;
 
-    // Fonction interne pour lire et déchiffrer le fichier dataset
-    bool readDataset(const std::string &filename, nlohmann::json *json);
+    // Fonction interne pour lire et déchiffrer tout le dataset
+    bool readDataset(nlohmann::json *json);
     // Fonction interne pour chiffrer et écrire le nlohmann::json dans le fichier dataset
-    void writeDataset(const std::string &filename, const nlohmann::json &j);
+    template <typename BasicJsonType>
+    void writeDataset(const std::string &filename, const BasicJsonType &j);
+    // Chiffre et écrit le store (en-tête avec génération et dictionnaire, puis lignes) dans un
+    // fichier temporaire renommé sur le fichier dataset, puis vide le journal dont il contient les effets
+    void writeStore(const std::string &filename, const RoktRowStore &store);
+    // Déchiffre et lit le fichier en flux ; chaque ligne est ajoutée à `store` (après relecture
+    // du journal, les lignes supprimées étant ignorées) puis son indice est transmis à `onRow`,
+    // qui renvoie false pour arrêter. `ranks` reçoit, si des lignes ont été ignorées, le rang
+    // dans le fichier de chaque ligne transmise. Renvoie false si le fichier est illisible (il
+    // n'est jamais réécrit : la lecture peut se faire sous verrou partagé).
+    bool streamFile(const std::string &filename, RoktRowStore &store, const std::function<bool(size_t row)> &onRow,
+                    std::vector<size_t> *ranks = nullptr);
+    // Enregistrements "add" de la memtable courante d'un dataset LSM (runs chargés)
+    std::vector<nlohmann::json> memtableRecords() const;
+    // Génération inscrite dans l'en-tête du fichier (0 : ancien format, fichier absent ou illisible)
+    uint64_t readGeneration(const std::string &filename) const;
+    // Lit en flux tout le dataset, comme streamFile : son fichier, ou pour un dataset LSM ses runs
+    // du plus ancien au plus récent puis sa memtable. `skipRun` écarte un run sans le lire.
+    bool streamRows(RoktRowStore &store, const std::function<bool(size_t row)> &onRow, std::vector<size_t> *ranks = nullptr,
+                    const std::function<bool(const RoktLsmRun &run)> &skipRun = nullptr);
+    // Taille des fichiers du dataset (enregistrée dans le manifeste) ; false si elle est inconnue
+    bool storedBytes(uint64_t *bytes);
+    // Réécrit tout le dataset à partir de `store` : son fichier, ou un run unique pour un dataset LSM
+    void writeAll(const RoktRowStore &store);
+
+    // Dataset LSM (appelées verrou exclusif pris)
+    bool isLsm() const { return type == DatasetConfigType::LSM && state; }
+    void loadLsm();
+    // Ajoute les lignes à la memtable (journal), vidée dans un run au-delà de memtableBytes
+    std::unique_ptr<ROKT::ResponseObject> appendMemtable(const std::vector<nlohmann::json> &rows);
+    void flushMemtable();
+    // Fusionne les runs tant qu'un niveau est complet (compactage en arrière-plan, sans verrou
+    // pendant l'écriture du run fusionné)
+    void mergeRuns();
+
+    // Gestion des lignes résidentes (appelées verrou pris)
+    bool isResident() const { return state && state->rows; }
+    void loadResident();
+    // Premier accès au dataset : un journal corrompu est tronqué avant toute relecture ou tout ajout
+    void checkJournal();
+    void adoptResident(std::unique_ptr<RoktRowStore> store);
+    void checkResidentSize();
+    // Nombre de partitions d'un parcours résident de `rows` lignes
+    size_t scanPartitions(size_t rows, size_t maxPartitions) const;
+    void writeResident();
+    // Réécrit tout le dataset : fichier, statistiques et lignes résidentes
+    template <typename BasicJsonType>
+    void replaceRows(const BasicJsonType &rows, const RoktRowDelta *delta);
+    // Ajoute des lignes (appelée verrou exclusif pris, lignes résidentes et statistiques chargées)
+    std::unique_ptr<ROKT::ResponseObject> appendRows(const std::vector<nlohmann::json> &rows);
+
+    // Gestion des vues (appelées verrou exclusif pris) : le delta de l'écriture est appliqué aux
+    // vues à jour ; les autres sont recalculées à partir de `rows` (toutes les lignes, si elles
+    // sont connues) ou d'un parcours du dataset. Une vue dont le recalcul échoue (dataset illisible)
+    // n'est pas réécrite
+    void updateViews(const RoktRowDelta *delta, const RoktRowStore *rows);
+    bool rebuildView(RoktView &view, const RoktRowStore *rows);
+
+    RoktJournal journal() const;
+    // Modifie ou supprime les lignes vérifiant `where` selon une opération du journal. Les lignes
+    // résidentes sont modifiées en place et l'opération est ajoutée au journal ; sinon le fichier
+    // est réécrit.
+    std::unique_ptr<ROKT::ResponseObject> modifyRows(const nlohmann::json &operation, const std::vector<Condition> &where,
+                                                     size_t *changed);
+    // Compactage (appelées verrou exclusif pris) : part obsolète du fichier (journal et lignes
+    // supprimées ou remplacées), et réécriture en arrière-plan quand elle dépasse compactionRatio ;
+    // pour un dataset LSM, fusion en arrière-plan des runs d'un niveau complet
+    double garbageRatio(uint64_t *garbageBytes) const;
+    void scheduleCompaction();
+
+    // Erreur 12 si une ligne ne contient pas le champ unique (chemin "a.b"), nullptr sinon
+    static std::unique_ptr<ROKT::ResponseObject> checkUniqueField(const std::vector<nlohmann::json> &rows, const std::string &uniqueField);
+    // Valeurs présentes du champ unique (forme comparée par '==', verrou exclusif pris) ; false
+    // si le dataset est illisible
+    bool collectUniqueKeys(const std::string &uniqueField, std::unordered_set<std::string> *keys);
+
+    // Gestion du manifeste (appelées verrou exclusif pris)
+    bool readManifest();
+    void writeManifest();
+    // Charge le manifeste ; s'il est absent ou illisible, les statistiques sont recalculées
+    void loadStats();
+    // Verrou partagé pris une fois les statistiques chargées (par loadStats, verrou exclusif pris)
+    std::shared_lock<std::shared_mutex> lockStats();
     
 public:
-    RoktDataset(DatasetConfigType t, const std::string &p, const std::string &ds, std::shared_ptr<EncryptService> enc);
-    RoktDataset(DatasetConfigType t, const std::string &p, const std::vector<std::string> &ds, std::shared_ptr<EncryptService> enc);
+    RoktDataset(DatasetConfigType t, const std::string &p, const std::string &ds, std::shared_ptr<EncryptService> enc,
+                std::shared_ptr<RoktDatasetState> st = nullptr);
+    RoktDataset(DatasetConfigType t, const std::string &p, const std::vector<std::string> &ds, std::shared_ptr<EncryptService> enc,
+                std::shared_ptr<RoktDatasetState> st = nullptr);
     
     nlohmann::json readData();
+
+    // Lit toutes les lignes du dataset directement dans le type de document demandé
+    // (nlohmann::json ou ROKT::ArenaJson pour les documents alloués dans l'arène de la requête).
+    template <typename BasicJsonType>
+    bool readAll(BasicJsonType *rows);
+
+    // Parcourt le dataset ligne par ligne sans construire le tableau complet. Si les lignes sont
+    // résidentes, `where` est évalué directement sur le store et seules les lignes retenues sont
+    // converties ; sinon le fichier est déchiffré par blocs et parsé en flux. Les lignes retenues
+    // sont transmises au visiteur (qui peut les déplacer) ; il renvoie false pour interrompre.
+    template <typename BasicJsonType>
+    bool scan(const std::vector<Condition> &where, const std::function<bool(BasicJsonType &row)> &visitor);
+
+    // Parcourt les lignes retenues directement sur le ruban. Si les lignes sont résidentes et
+    // nombreuses, le parcours est réparti sur au plus `maxPartitions` threads : le visiteur est
+    // alors appelé en parallèle, chaque partition recevant ses lignes dans l'ordre. Renvoyer
+    // false n'interrompt que la partition courante. Le parcours commence au rang `from` (reprise
+    // d'un curseur) : les lignes résidentes précédentes ne sont pas lues, celles d'un fichier lu
+    // en flux sont décodées sans être évaluées.
+    bool scanRows(const std::vector<Condition> &where, size_t maxPartitions, const std::function<bool(const RoktScanRow &row)> &visitor,
+                  size_t from = 0);
+    // Donne accès aux statistiques à jour du dataset (lecture partagée) ; renvoie false si le
+    // dataset n'a pas d'état partagé
+    bool statistics(const std::function<void(const RoktDatasetStats &stats)> &reader);
+    // Décrit le parcours qu'exécuterait scanRows ; renvoie false si le dataset n'a pas d'état partagé
+    bool planScan(size_t maxPartitions, RoktScanPlan *plan);
+    // Nombre maximal de partitions d'un parcours parallèle
+    size_t maxScanPartitions() const { return state ? static_cast<size_t>(std::max(state->scanThreads, 1)) : 1; }
     
+    // Réécrit le fichier à partir des lignes résidentes, journal compris, si la part obsolète
+    // dépasse toujours le seuil, ou fusionne les runs d'un dataset LSM (appelée par le
+    // compactage en arrière-plan)
+    void compact();
+    // Attend la fin des compactages en cours du dataset (appelée sans verrou, ex. avant EMPTY)
+    void waitCompaction();
+
     // Méthodes de mise à jour, suppression, insertion et sélection
     std::unique_ptr<ROKT::ResponseObject>update(const nlohmann::json &set, const nlohmann::json &value, const std::vector<nlohmann::json> &where = {});
     std::unique_ptr<ROKT::ResponseObject>remove(const std::string &set, const std::string &op, const nlohmann::json &compare);
+    // Ajoute `by` au champ numérique `field` des lignes vérifiant `where` (un champ absent prend
+    // la valeur `by`, une valeur non numérique est conservée). Les lignes résidentes sont
+    // modifiées en place et l'opération est ajoutée au journal, sans réécrire le fichier.
+    std::unique_ptr<ROKT::ResponseObject>increment(const std::string &field, const nlohmann::json &by, const std::vector<Condition> &where,
+                                                   size_t *changed);
+    // CHANGE <champ> = <valeur> et REMOVE : mêmes écritures que increment (en place et journal)
+    std::unique_ptr<ROKT::ResponseObject>assign(const std::string &field, const nlohmann::json &value, const std::vector<Condition> &where,
+                                                size_t *changed);
+    std::unique_ptr<ROKT::ResponseObject>erase(const std::vector<Condition> &where, size_t *removed);
     std::unique_ptr<ROKT::ResponseObject>insert(const nlohmann::json &newData);
+    // Ajoute plusieurs lignes en une seule écriture du fichier, du manifeste et des vues. Avec
+    // `uniqueField` (un chemin, "a.b"), une ligne dont la valeur de ce champ existe déjà (dans le
+    // dataset ou plus haut dans `rows`) est écartée et son indice ajouté à `duplicates` ; la
+    // recherche et l'ajout se font sous le même verrou d'écriture. Chaque ligne doit contenir
+    // `uniqueField` (erreur 12 sinon, rien n'est ajouté)
+    std::unique_ptr<ROKT::ResponseObject>insertRows(const std::vector<nlohmann::json> &rows, const std::string &uniqueField = "",
+                                                    std::vector<size_t> *duplicates = nullptr);
+    // Ajoute chaque ligne, ou fusionne ses champs de premier niveau dans la ligne dont le champ
+    // `uniqueField` a la même valeur (1 et 1.0 sont égaux), sous un seul verrou d'écriture et en
+    // une seule écriture ; chaque ligne doit contenir `uniqueField` (erreur 12 sinon)
+    std::unique_ptr<ROKT::ResponseObject>upsertRows(const std::vector<nlohmann::json> &rows, const std::string &uniqueField,
+                                                    size_t *inserted, size_t *updated);
     RoktData select(const std::vector<std::string> &keys);
     
     std::unique_ptr<ROKT::ResponseObject>clear();
     
     // Nouvelle méthode pour écraser (overwrite) le fichier dataset avec de nouvelles données.
-    std::unique_ptr<ROKT::ResponseObject>overwrite(const nlohmann::json &newData);
+    // `delta` décrit les lignes modifiées pour la mise à jour incrémentale des vues (nullptr : les
+    // vues sont recalculées)
+    template <typename BasicJsonType>
+    std::unique_ptr<ROKT::ResponseObject>overwrite(const BasicJsonType &newData, const RoktRowDelta *delta = nullptr);
+
+    // Vues matérialisées : attachView calcule la vue puis l'enregistre auprès du dataset source
+    void attachView(const std::shared_ptr<RoktView> &view);
+    void detachView(const std::string &name);
+    // Vrai si une écriture doit décrire ses lignes modifiées (voir overwrite)
+    bool hasViews();
+
+    const std::string &getLastError() const { return lastError; }
 };
 
 #endif // ROKTDATASET_H
@@ -0,0 +1,27 @@
+// RoktJoin.cpp
+#include "RoktJoin.h"
+#include "RoktAggregate.h"
+
+RoktHashJoin::RoktHashJoin(const std::string &buildField, const std::string &probeField)
+    : buildField(buildField), probeField(probeField), buildRows(0) {}
+
+bool RoktHashJoin::build(const RoktScanRow &row) {
+    if (!buildPath)
+        buildPath = std::make_unique<RoktFieldPath>(buildField, row.store.dictionary());
+    if (!RoktAggregator::distinctKey(row.store, buildPath->lookup(row.store, row.row), keyBuffer))
+        return true;
+    table[keyBuffer].push_back(row.store.materialize<ROKT::ArenaJson>(row.row));
+    buildRows++;
+    return true;
+}
+
+const std::vector<ROKT::ArenaJson> *RoktHashJoin::probe(const RoktScanRow &row) {
+    if (table.empty())
+        return nullptr;
+    if (!probePath)
+        probePath = std::make_unique<RoktFieldPath>(probeField, row.store.dictionary());
+    if (!RoktAggregator::distinctKey(row.store, probePath->lookup(row.store, row.row), keyBuffer))
+        return nullptr;
+    auto it = table.find(keyBuffer);
+    return it == table.end() ? nullptr : &it->second;
+}
@@ -0,0 +1,40 @@
+#ifndef ROKTJOIN_H
+#define ROKTJOIN_H
+
+#include "RoktRowStore.h"
+#include "RequestArena.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Jointure par hachage (JOIN ... ON a.champ = b.champ) entre deux datasets.
+ *
+ * Les lignes du plus petit côté sont converties une seule fois et rangées dans une table de
+ * hachage indexée par la valeur du champ de jointure. L'autre côté est lu en flux : sa clé est
+ * calculée directement sur le ruban, et seules les lignes qui trouvent une correspondance sont
+ * converties en JSON. Les clés sont celles de DISTINCT (RoktAggregator::distinctKey) : une
+ * valeur absente ou null ne correspond à aucune ligne, 1 et 1.0 sont égaux comme pour '=='.
+ */
+class RoktHashJoin {
+private:
+    std::string buildField;
+    std::string probeField;
+    std::unique_ptr<RoktFieldPath> buildPath;
+    std::unique_ptr<RoktFieldPath> probePath;
+    std::unordered_map<std::string, std::vector<ROKT::ArenaJson>> table;
+    size_t buildRows;
+    std::string keyBuffer;
+
+public:
+    RoktHashJoin(const std::string &buildField, const std::string &probeField);
+
+    // Ajoute une ligne du côté construction (parcours séquentiel)
+    bool build(const RoktScanRow &row);
+    // Lignes du côté construction ayant la même clé que la ligne sondée (nullptr si aucune)
+    const std::vector<ROKT::ArenaJson> *probe(const RoktScanRow &row);
+    size_t getBuildRows() const { return buildRows; }
+};
+
+#endif // ROKTJOIN_H
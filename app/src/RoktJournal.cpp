@@ -0,0 +1,192 @@
+// RoktJournal.cpp
+#include "RoktJournal.h"
+#include "LogService.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+    void appendU32(std::string &out, uint32_t value) {
+        for (int i = 0; i < 4; i++)
+            out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+RoktJournal::Replay::Replay(std::vector<nlohmann::json> records) : records(std::move(records)) {
+    for (size_t i = 0; i < this->records.size(); i++) {
+        auto target = this->records[i].find("rows");
+        if (target == this->records[i].end() || !target->is_array())
+            continue;
+        for (const auto &row : *target) {
+            if (row.is_number_unsigned())
+                rows[row.get<size_t>()].push_back(i);
+        }
+    }
+}
+
+bool RoktJournal::Replay::apply(size_t row, nlohmann::json &value) const {
+    auto found = rows.find(row);
+    if (found == rows.end())
+        return false;
+    for (size_t record : found->second) {
+        if (!RoktJournal::apply(records[record], value))
+            return false;
+    }
+    return true;
+}
+
+RoktJournal::RoktJournal(const std::string &filename, std::shared_ptr<EncryptService> encryptService)
+    : filename(filename), encryptService(std::move(encryptService)) {}
+
+bool RoktJournal::append(const nlohmann::json &record) {
+    std::string encrypted = encryptService->encrypt(record.dump());
+    std::string frame;
+    frame.reserve(4 + encrypted.size());
+    appendU32(frame, static_cast<uint32_t>(encrypted.size()));
+    frame += encrypted;
+    std::ofstream file(filename, std::ios::binary | std::ios::app);
+    if (!file)
+        return false;
+    file.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+    file.flush();
+    return static_cast<bool>(file);
+}
+
+std::vector<nlohmann::json> RoktJournal::read(uint64_t *validBytes) const {
+    std::vector<nlohmann::json> records;
+    if (validBytes != nullptr)
+        *validBytes = 0;
+    std::ifstream file(filename, std::ios::binary);
+    if (!file)
+        return records;
+    uint64_t total = size();
+    uint64_t offset = 0;
+    std::string problem;
+    unsigned char header[4];
+    while (offset < total) {
+        if (!file.read(reinterpret_cast<char *>(header), sizeof(header))) {
+            problem = "en-tête tronqué";
+            break;
+        }
+        uint32_t length = static_cast<uint32_t>(header[0]) | (static_cast<uint32_t>(header[1]) << 8) |
+                          (static_cast<uint32_t>(header[2]) << 16) | (static_cast<uint32_t>(header[3]) << 24);
+        // Une taille corrompue ne doit pas provoquer une allocation démesurée
+        if (length > total - offset - sizeof(header)) {
+            problem = "enregistrement tronqué";
+            break;
+        }
+        std::string encrypted(length, '\0');
+        if (!file.read(&encrypted[0], length)) {
+            problem = "enregistrement tronqué";
+            break;
+        }
+        nlohmann::json record = nlohmann::json::parse(encryptService->decrypt(encrypted), nullptr, false);
+        if (record.is_discarded() || !record.is_object() || !record.contains("op")) {
+            problem = "enregistrement illisible";
+            break;
+        }
+        records.push_back(std::move(record));
+        offset += sizeof(header) + length;
+    }
+    if (validBytes != nullptr)
+        *validBytes = offset;
+    if (!problem.empty())
+        LogService::log("Journal " + filename + " : " + problem + " à l'octet " + std::to_string(offset) + ", " +
+                        std::to_string(records.size()) + " enregistrement(s) relu(s), la suite est ignorée.");
+    return records;
+}
+
+bool RoktJournal::repair() {
+    uint64_t validBytes;
+    read(&validBytes);
+    if (validBytes >= size())
+        return false;
+    // La version corrompue est conservée pour examen, puis le journal est tronqué après son dernier
+    // enregistrement lisible : les ajouts suivants seront relus
+    std::error_code ec;
+    std::filesystem::copy_file(filename, filename + JOURNAL_CORRUPT_SUFFIX,
+                               std::filesystem::copy_options::overwrite_existing, ec);
+    std::filesystem::resize_file(filename, validBytes, ec);
+    if (ec) {
+        LogService::log("Journal " + filename + " : réparation impossible (" + ec.message() + ").");
+        return false;
+    }
+    LogService::log("Journal " + filename + " tronqué à " + std::to_string(validBytes) + " octets, copie conservée : " +
+                    filename + JOURNAL_CORRUPT_SUFFIX);
+    return true;
+}
+
+uint64_t RoktJournal::size() const {
+    std::error_code ec;
+    uintmax_t bytes = std::filesystem::file_size(filename, ec);
+    return ec ? 0 : static_cast<uint64_t>(bytes);
+}
+
+void RoktJournal::clear() {
+    std::error_code ec;
+    std::filesystem::remove(filename, ec);
+}
+
+nlohmann::json RoktJournal::incrementOperation(const std::string &field, const nlohmann::json &by) {
+    return {{"op", "incr"}, {"field", field}, {"by", by}};
+}
+
+nlohmann::json RoktJournal::setOperation(const std::string &field, const nlohmann::json &value) {
+    return {{"op", "set"}, {"field", field}, {"value", value}};
+}
+
+nlohmann::json RoktJournal::deleteOperation() {
+    return {{"op", "del"}};
+}
+
+std::vector<nlohmann::json> RoktJournal::ofGeneration(std::vector<nlohmann::json> records, uint64_t generation) {
+    records.erase(std::remove_if(records.begin(), records.end(),
+                                 [generation](const nlohmann::json &record) { return generationOf(record) != generation; }),
+                  records.end());
+    return records;
+}
+
+nlohmann::json RoktJournal::addOperation(const std::vector<nlohmann::json> &rows) {
+    return {{"op", "add"}, {"values", rows}};
+}
+
+bool RoktJournal::increment(const nlohmann::json *current, const nlohmann::json &by, nlohmann::json *result) {
+    if (current == nullptr) {
+        *result = by;
+        return true;
+    }
+    if (!current->is_number())
+        return false;
+    if (current->is_number_integer() && by.is_number_integer()) {
+        int64_t sum;
+        if (!__builtin_add_overflow(current->get<int64_t>(), by.get<int64_t>(), &sum)) {
+            *result = sum;
+            return true;
+        }
+    }
+    *result = current->get<double>() + by.get<double>();
+    return true;
+}
+
+bool RoktJournal::fieldValue(const nlohmann::json &operation, const nlohmann::json *current, nlohmann::json *result) {
+    std::string op = operation.value("op", "");
+    if (op == "incr")
+        return increment(current, operation.value("by", nlohmann::json(0)), result);
+    if (op != "set")
+        return false;
+    *result = operation.value("value", nlohmann::json());
+    return true;
+}
+
+bool RoktJournal::apply(const nlohmann::json &record, nlohmann::json &row) {
+    if (isDelete(record))
+        return false;
+    if (!row.is_object())
+        return true;
+    std::string field = record.value("field", std::string());
+    auto found = row.find(field);
+    nlohmann::json value;
+    if (fieldValue(record, found == row.end() ? nullptr : &*found, &value))
+        row[field] = std::move(value);
+    return true;
+}
@@ -0,0 +1,94 @@
+#ifndef ROKTJOURNAL_H
+#define ROKTJOURNAL_H
+
+#include "EncryptService.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#define JOURNAL_CORRUPT_SUFFIX ".corrupt"
+
+/**
+ * @brief Journal des modifications d'un dataset qui ne réécrivent pas son fichier.
+ *
+ * Chaque enregistrement (un objet JSON, chiffré séparément et précédé de sa taille) décrit une
+ * opération sur des lignes désignées par leur rang dans le fichier dataset. Le journal est relu
+ * à chaque lecture du fichier et vidé à chaque réécriture complète, qui en contient les effets :
+ * les rangs désignent donc toujours les lignes du fichier courant. La relecture s'arrête au premier
+ * enregistrement tronqué (arrêt pendant son écriture) ou illisible, ce qui est journalisé ; repair()
+ * tronque alors le journal pour que les enregistrements ajoutés ensuite soient relus.
+ *
+ * Un fichier réécrit reçoit une nouvelle génération (en-tête du ruban), reportée dans chaque
+ * enregistrement ("gen") : un journal qui n'a pas pu être vidé après le remplacement du fichier
+ * (arrêt entre les deux) n'est pas rejoué sur le nouveau fichier. Un enregistrement sans "gen"
+ * appartient à la génération 0 (anciens fichiers).
+ *
+ * Opérations, complétées par "rows": [<rang>, ...] :
+ *   {"op": "incr", "field": <champ>, "by": <nombre>}   CHANGE <champ> += <nombre>
+ *   {"op": "set", "field": <champ>, "value": <valeur>} CHANGE <champ> = <valeur>
+ *   {"op": "del"}                                      REMOVE (pierre tombale : la ligne est ignorée)
+ *
+ * Dans un dataset LSM, le journal contient la memtable : des enregistrements sans rang
+ * {"op": "add", "values": [<ligne>, ...]}, lus après les runs puis vidés dans un nouveau run. Leur
+ * "gen" est alors la génération de la memtable (voir RoktLsmTree).
+ */
+class RoktJournal {
+private:
+    std::string filename;  // chemin complet du journal
+    std::shared_ptr<EncryptService> encryptService;
+
+public:
+    /**
+     * @brief Enregistrements du journal indexés par rang de ligne, pour la relecture en flux.
+     */
+    class Replay {
+    private:
+        std::vector<nlohmann::json> records;
+        std::unordered_map<size_t, std::vector<size_t>> rows;  // rang -> enregistrements, dans l'ordre
+    public:
+        explicit Replay(std::vector<nlohmann::json> records);
+        bool empty() const { return rows.empty(); }
+        bool concerns(size_t row) const { return rows.count(row) > 0; }
+        // Applique à la ligne de rang `row` les enregistrements qui la concernent ; renvoie false
+        // si la ligne a été supprimée
+        bool apply(size_t row, nlohmann::json &value) const;
+    };
+
+    RoktJournal(const std::string &filename, std::shared_ptr<EncryptService> encryptService);
+
+    // Ajoute un enregistrement à la fin du journal ; renvoie false si l'écriture a échoué
+    bool append(const nlohmann::json &record);
+    // Relit les enregistrements jusqu'au premier enregistrement tronqué ou illisible (signalé dans
+    // les logs) ; `validBytes` reçoit la taille de la partie lisible
+    std::vector<nlohmann::json> read(uint64_t *validBytes = nullptr) const;
+    // Tronque le journal après son dernier enregistrement lisible, en conservant une copie de la
+    // version corrompue ; renvoie true si le journal a été réparé
+    bool repair();
+    uint64_t size() const;
+    void clear();
+
+    static nlohmann::json incrementOperation(const std::string &field, const nlohmann::json &by);
+    static nlohmann::json setOperation(const std::string &field, const nlohmann::json &value);
+    static nlohmann::json deleteOperation();
+    static nlohmann::json addOperation(const std::vector<nlohmann::json> &rows);
+    static bool isDelete(const nlohmann::json &operation) { return operation.value("op", "") == "del"; }
+    // Génération du fichier (ou de la memtable) à laquelle s'applique un enregistrement
+    static void stamp(nlohmann::json &record, uint64_t generation) { record["gen"] = generation; }
+    static uint64_t generationOf(const nlohmann::json &record) { return record.value("gen", static_cast<uint64_t>(0)); }
+    // Enregistrements de la génération `generation`
+    static std::vector<nlohmann::json> ofGeneration(std::vector<nlohmann::json> records, uint64_t generation);
+    static bool isAdd(const nlohmann::json &operation) { return operation.value("op", "") == "add" && operation.contains("values"); }
+
+    // Valeur incrémentée d'un champ (`current` nullptr : champ absent, qui vaut alors `by`). Deux
+    // entiers donnent un entier, sauf dépassement ; renvoie false si la valeur n'est pas un nombre.
+    static bool increment(const nlohmann::json *current, const nlohmann::json &by, nlohmann::json *result);
+    // Nouvelle valeur du champ d'une opération "incr" ou "set" ; false si la ligne est inchangée
+    static bool fieldValue(const nlohmann::json &operation, const nlohmann::json *current, nlohmann::json *result);
+    // Rejoue un enregistrement sur une ligne ; renvoie false si la ligne est supprimée
+    static bool apply(const nlohmann::json &record, nlohmann::json &row);
+};
+
+#endif // ROKTJOURNAL_H
@@ -0,0 +1,352 @@
+// RoktLsmTree.cpp
+#include "RoktLsmTree.h"
+#include "AtomicFile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <nlohmann/json.hpp>
+
+namespace {
+    // FNV-1a 64 bits : les filtres sont enregistrés, le hachage ne doit pas dépendre du compilateur
+    uint64_t fnv1a(std::string_view key) {
+        uint64_t hash = 14695981039346656037ULL;
+        for (unsigned char c : key) {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    // Second hachage (double hachage de Kirsch et Mitzenmacher), toujours impair
+    uint64_t remix(uint64_t hash) {
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        return hash | 1;
+    }
+}
+
+RoktBloomFilter::RoktBloomFilter(size_t keys)
+    : bits(std::max<size_t>(1, (keys * LSM_BLOOM_BITS_PER_KEY + 63) / 64), 0) {}
+
+void RoktBloomFilter::add(std::string_view key) {
+    uint64_t h1 = fnv1a(key);
+    uint64_t h2 = remix(h1);
+    uint64_t size = bits.size() * 64;
+    for (int i = 0; i < LSM_BLOOM_HASHES; i++) {
+        uint64_t bit = (h1 + i * h2) % size;
+        bits[bit / 64] |= 1ULL << (bit % 64);
+    }
+}
+
+bool RoktBloomFilter::mayContain(std::string_view key) const {
+    if (bits.empty())
+        return true;
+    uint64_t h1 = fnv1a(key);
+    uint64_t h2 = remix(h1);
+    uint64_t size = bits.size() * 64;
+    for (int i = 0; i < LSM_BLOOM_HASHES; i++) {
+        uint64_t bit = (h1 + i * h2) % size;
+        if ((bits[bit / 64] & (1ULL << (bit % 64))) == 0)
+            return false;
+    }
+    return true;
+}
+
+std::string RoktBloomFilter::serialize() const {
+    return std::string(reinterpret_cast<const char *>(bits.data()), bits.size() * sizeof(uint64_t));
+}
+
+void RoktBloomFilter::deserialize(const std::string &data) {
+    bits.assign(data.size() / sizeof(uint64_t), 0);
+    if (!bits.empty())
+        std::memcpy(bits.data(), data.data(), bits.size() * sizeof(uint64_t));
+}
+
+std::string RoktBloomFilter::valueKey(const RoktRowStore &store, size_t pos) {
+    if (store.isNumber(pos))
+        return "n:" + nlohmann::json(store.number(pos)).dump();
+    if (store.tag(pos) == RoktRowStore::TAG_STRING)
+        return "s:" + std::string(store.string(pos));
+    return "s:" + store.materializeValue<nlohmann::json>(pos).dump();
+}
+
+std::vector<std::string> RoktBloomFilter::conditionKeys(const std::string &value) {
+    // Une valeur numérique est comparée comme nombre à un champ numérique, comme chaîne sinon
+    std::vector<std::string> keys = {"s:" + value};
+    try {
+        double number = std::stod(value);
+        if (!std::isnan(number))
+            keys.push_back("n:" + nlohmann::json(number).dump());
+    } catch (...) {
+        // Valeur non numérique
+    }
+    return keys;
+}
+
+RoktLsmTree::RoktLsmTree(const std::string &path, std::shared_ptr<EncryptService> encryptService, const std::string &keyField)
+    : path(path), encryptService(std::move(encryptService)), keyField(keyField) {}
+
+std::string RoktLsmTree::runFile(uint64_t id) const {
+    return encryptService->encryptFilename("run-" + std::to_string(id) + ".rokt");
+}
+
+std::string RoktLsmTree::bloomFile(uint64_t id) const {
+    return encryptService->encryptFilename("run-" + std::to_string(id) + ".bloom");
+}
+
+void RoktLsmTree::writeFile(const std::string &filename, const std::string &plaintext) const {
+    AtomicFile::write(path + "/" + filename, encryptService->encrypt(plaintext));
+}
+
+void RoktLsmTree::removeRun(uint64_t id) const {
+    std::error_code ec;
+    std::filesystem::remove(path + "/" + runFile(id), ec);
+    std::filesystem::remove(path + "/" + bloomFile(id), ec);
+}
+
+void RoktLsmTree::writeRun(const RoktLsmRun &run, const std::string &plaintext) const {
+    writeFile(runFile(run.id), plaintext);
+    if (!run.bloom.empty())
+        writeFile(bloomFile(run.id), run.bloom.serialize());
+}
+
+RoktBloomFilter RoktLsmTree::bloomOf(const RoktRowStore &store, size_t first, size_t end) const {
+    if (keyField.empty())
+        return RoktBloomFilter();
+    RoktBloomFilter bloom(end - first);
+    RoktFieldPath key(keyField, store.dictionary());
+    for (size_t row = first; row < end; row++) {
+        size_t pos = key.lookup(store, row);
+        if (pos != RoktRowStore::npos)
+            bloom.add(RoktBloomFilter::valueKey(store, pos));
+    }
+    return bloom;
+}
+
+void RoktLsmTree::load() {
+    runs.clear();
+    std::ifstream file(path + "/" + encryptService->encryptFilename(LSM_MANIFEST_FILENAME), std::ios::binary);
+    if (!file)
+        return;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    nlohmann::json manifest = nlohmann::json::parse(encryptService->decrypt(buffer.str()), nullptr, false);
+    if (manifest.is_discarded() || !manifest.contains("runs"))
+        throw std::runtime_error("Liste des runs du dataset illisible");
+    nextRun = manifest.value("nextRun", uint64_t(1));
+    memtable = manifest.value("memtable", uint64_t(0));
+    for (const auto &entry : manifest["runs"]) {
+        RoktLsmRun run;
+        run.id = entry.value("id", uint64_t(0));
+        run.level = entry.value("level", 0);
+        run.rows = entry.value("rows", size_t(0));
+        // Un filtre absent laisse le run toujours lu
+        std::ifstream bloom(path + "/" + bloomFile(run.id), std::ios::binary);
+        if (!keyField.empty() && bloom) {
+            std::stringstream bits;
+            bits << bloom.rdbuf();
+            run.bloom.deserialize(encryptService->decrypt(bits.str()));
+        }
+        runs.push_back(std::move(run));
+    }
+}
+
+void RoktLsmTree::save() const {
+    nlohmann::json manifest;
+    manifest["nextRun"] = nextRun;
+    manifest["memtable"] = memtable;
+    manifest["runs"] = nlohmann::json::array();
+    for (const auto &run : runs)
+        manifest["runs"].push_back({{"id", run.id}, {"level", run.level}, {"rows", run.rows}});
+    writeFile(encryptService->encryptFilename(LSM_MANIFEST_FILENAME), manifest.dump());
+}
+
+size_t RoktLsmTree::rows() const {
+    size_t total = 0;
+    for (const auto &run : runs)
+        total += run.rows;
+    return total;
+}
+
+uint64_t RoktLsmTree::bytes() const {
+    uint64_t total = 0;
+    for (const auto &run : runs) {
+        std::error_code ec;
+        uintmax_t size = std::filesystem::file_size(path + "/" + runFile(run.id), ec);
+        if (!ec)
+            total += static_cast<uint64_t>(size);
+    }
+    return total;
+}
+
+bool RoktLsmTree::readRun(const RoktLsmRun &run, RoktRowStore &store, const std::function<bool(size_t row)> &onRow) const {
+    std::ifstream file(path + "/" + runFile(run.id), std::ios::binary);
+    if (!file)
+        return false;
+    std::unique_ptr<DecryptStreamBuf> decrypted = encryptService->decryptStream(file);
+    std::istream plain(decrypted.get());
+    try {
+        store.readHeader(plain);
+    } catch (std::exception &) {
+        return false;
+    }
+    // Seule la lecture est protégée : une exception levée par `onRow` est propagée
+    while (true) {
+        bool read;
+        try {
+            read = store.readRow(plain);
+        } catch (std::exception &) {
+            return false;
+        }
+        if (!read || !onRow(store.size() - 1))
+            return true;
+    }
+}
+
+bool RoktLsmTree::mayMatch(const RoktLsmRun &run, const std::vector<Condition> &where) const {
+    if (run.bloom.empty())
+        return true;
+    // Seule une conjonction de conditions permet d'écarter un run
+    for (const auto &cond : where) {
+        if (cond.logic == "OR")
+            return true;
+    }
+    for (const auto &cond : where) {
+        if (cond.field != keyField || cond.op != "==")
+            continue;
+        std::vector<std::string> keys = RoktBloomFilter::conditionKeys(cond.value);
+        if (std::none_of(keys.begin(), keys.end(), [&](const std::string &key) { return run.bloom.mayContain(key); }))
+            return false;
+    }
+    return true;
+}
+
+void RoktLsmTree::flush(const RoktRowStore &store, size_t first, size_t end) {
+    if (end <= first)
+        return;
+    RoktLsmRun run;
+    run.id = nextRun++;
+    run.rows = end - first;
+    run.bloom = bloomOf(store, first, end);
+    std::string plaintext;
+    store.serializeHeader(plaintext);
+    store.serializeRows(plaintext, first, end);
+    writeRun(run, plaintext);
+    runs.push_back(std::move(run));
+    memtable++;
+    save();
+}
+
+void RoktLsmTree::rewrite(const RoktRowStore &store) {
+    std::vector<RoktLsmRun> previous = std::move(runs);
+    runs.clear();
+    generation++;
+    if (store.size() > 0) {
+        // Le run unique garde le niveau le plus élevé : il ne sera pas fusionné avec les prochains vidages
+        RoktLsmRun run;
+        run.id = nextRun++;
+        for (const auto &old : previous)
+            run.level = std::max(run.level, old.level);
+        run.rows = store.size();
+        run.bloom = bloomOf(store, 0, store.size());
+        std::string plaintext;
+        store.serialize(plaintext);
+        writeRun(run, plaintext);
+        runs.push_back(std::move(run));
+    }
+    memtable++;
+    save();
+    for (const auto &old : previous)
+        removeRun(old.id);
+}
+
+bool RoktLsmTree::canMerge() const {
+    if (runs.size() < LSM_RUNS_PER_LEVEL)
+        return false;
+    int level = runs.back().level;
+    return std::all_of(runs.end() - LSM_RUNS_PER_LEVEL, runs.end(), [&](const RoktLsmRun &run) { return run.level == level; });
+}
+
+bool RoktLsmTree::planMerge(Merge *merge) {
+    if (!canMerge())
+        return false;
+    merge->sources.clear();
+    merge->result = RoktLsmRun();
+    for (auto run = runs.end() - LSM_RUNS_PER_LEVEL; run != runs.end(); ++run) {
+        RoktLsmRun source;
+        source.id = run->id;
+        source.level = run->level;
+        source.rows = run->rows;
+        merge->result.rows += run->rows;
+        merge->sources.push_back(std::move(source));
+    }
+    merge->result.id = nextRun++;
+    merge->result.level = merge->sources.back().level + 1;
+    merge->generation = generation;
+    // L'identifiant réservé n'est jamais repris, même après un redémarrage
+    save();
+    return true;
+}
+
+bool RoktLsmTree::writeMerge(Merge &merge) const {
+    // Les runs sont lus à la suite dans le même store : le dernier en-tête lu, celui du run le
+    // plus récent, contient toutes les clés et devient l'en-tête du run fusionné
+    RoktRowStore scratch;
+    std::string body;
+    std::unique_ptr<RoktFieldPath> key;
+    if (!keyField.empty()) {
+        merge.result.bloom = RoktBloomFilter(merge.result.rows);
+        key = std::make_unique<RoktFieldPath>(keyField, scratch.dictionary());
+    }
+    size_t rows = 0;
+    for (const auto &source : merge.sources) {
+        bool readable = readRun(source, scratch, [&](size_t row) {
+            scratch.serializeRows(body, row, row + 1);
+            if (key) {
+                size_t pos = key->lookup(scratch, row);
+                if (pos != RoktRowStore::npos)
+                    merge.result.bloom.add(RoktBloomFilter::valueKey(scratch, pos));
+            }
+            rows++;
+            scratch.clear();
+            return true;
+        });
+        if (!readable)
+            return false;
+    }
+    merge.result.rows = rows;
+    std::string plaintext;
+    scratch.serializeHeader(plaintext);
+    plaintext.reserve(plaintext.size() + body.size());
+    plaintext += body;
+    body.clear();
+    body.shrink_to_fit();
+    writeRun(merge.result, plaintext);
+    return true;
+}
+
+bool RoktLsmTree::commitMerge(const Merge &merge) {
+    if (!isCurrent(merge)) {
+        abortMerge(merge);
+        return false;
+    }
+    // Sans réécriture, les sources sont toujours à leur place : seuls des vidages ont pu être
+    // ajoutés après elles (une seule fusion à la fois par dataset)
+    auto first = std::find_if(runs.begin(), runs.end(), [&](const RoktLsmRun &run) { return run.id == merge.sources.front().id; });
+    size_t at = static_cast<size_t>(first - runs.begin());
+    runs.erase(first, first + merge.sources.size());
+    runs.insert(runs.begin() + at, merge.result);
+    save();
+    for (const auto &source : merge.sources)
+        removeRun(source.id);
+    return true;
+}
+
+void RoktLsmTree::abortMerge(const Merge &merge) const {
+    removeRun(merge.result.id);
+}
@@ -0,0 +1,150 @@
+#ifndef ROKTLSMTREE_H
+#define ROKTLSMTREE_H
+
+#include "EncryptService.h"
+#include "ConditionUtils.h"
+#include "RoktRowStore.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Liste des runs d'un dataset LSM, chiffrée dans le dossier du dataset
+#define LSM_MANIFEST_FILENAME "lsm.json"
+#define LSM_RUNS_PER_LEVEL 4        // runs d'un même niveau fusionnés en un run du niveau suivant
+#define LSM_BLOOM_BITS_PER_KEY 10   // environ 1 % de faux positifs
+#define LSM_BLOOM_HASHES 7
+
+/**
+ * @brief Filtre de Bloom des valeurs du champ clé d'un run.
+ *
+ * Les valeurs sont enregistrées sous la forme comparée par '==' (voir RoktPredicate) : un nombre
+ * par sa valeur, une chaîne telle quelle, une autre valeur par son texte JSON.
+ */
+class RoktBloomFilter {
+private:
+    std::vector<uint64_t> bits;
+
+public:
+    RoktBloomFilter() = default;
+    // Filtre dimensionné pour `keys` valeurs
+    explicit RoktBloomFilter(size_t keys);
+
+    bool empty() const { return bits.empty(); }
+    void add(std::string_view key);
+    bool mayContain(std::string_view key) const;
+
+    std::string serialize() const;
+    void deserialize(const std::string &data);
+
+    // Forme enregistrée de la valeur située à `pos` dans le ruban
+    static std::string valueKey(const RoktRowStore &store, size_t pos);
+    // Formes des valeurs égales à la valeur d'une condition '==' (nombre et chaîne)
+    static std::vector<std::string> conditionKeys(const std::string &value);
+};
+
+/**
+ * @brief Run d'un dataset LSM : fichier immuable de lignes au format ruban.
+ */
+struct RoktLsmRun {
+    uint64_t id = 0;
+    int level = 0;         ///< 0 pour un vidage de la memtable, +1 à chaque fusion
+    size_t rows = 0;
+    RoktBloomFilter bloom; ///< vide si le dataset n'a pas de champ clé
+};
+
+/**
+ * @brief Runs d'un dataset LSM (stockage des datasets créés par "CREATE TABLE <nom> LSM").
+ *
+ * Les lignes ajoutées sont écrites dans le journal du dataset (la memtable), puis vidées dans un
+ * nouveau run de niveau 0 lorsqu'il dépasse la taille de la memtable. Les runs sont rangés du
+ * plus ancien au plus récent : les lignes d'un dataset LSM gardent ainsi leur ordre d'ajout,
+ * qui est aussi l'ordre de tri des runs. Chaque run est écrit avec le dictionnaire de clés du
+ * run suivant ou d'un sur-ensemble : les runs peuvent être lus à la suite dans un même store.
+ *
+ * Compactage par paliers : dès que les LSM_RUNS_PER_LEVEL runs les plus récents ont le même
+ * niveau, ils sont fusionnés en un run du niveau suivant. La fusion lit et écrit des fichiers
+ * immuables ; seul le remplacement des runs dans la liste doit être fait verrou pris.
+ *
+ * Chaque enregistrement de la memtable porte sa génération, inscrite dans la liste des runs : un
+ * vidage ou une réécriture enregistre la liste avec la génération suivante avant que le journal
+ * soit vidé. Après un arrêt entre les deux, les enregistrements restants, déjà contenus dans les
+ * runs, ne sont pas relus. La liste et les runs sont écrits par remplacement atomique.
+ *
+ * Si le dataset a un champ clé, chaque run a un filtre de Bloom de ses valeurs : un parcours
+ * en flux dont le WHERE exige une valeur de la clé ne lit pas les runs qui ne la contiennent pas.
+ */
+class RoktLsmTree {
+public:
+    // Fusion préparée par planMerge, écrite par writeMerge puis appliquée par commitMerge
+    struct Merge {
+        std::vector<RoktLsmRun> sources;
+        RoktLsmRun result;
+        uint64_t generation = 0;  // génération des runs lors de la préparation
+    };
+
+private:
+    std::string path;  // dossier du dataset
+    std::shared_ptr<EncryptService> encryptService;
+    std::string keyField;
+    std::vector<RoktLsmRun> runs;  // du plus ancien au plus récent
+    uint64_t nextRun = 1;
+    uint64_t generation = 0;  // incrémentée à chaque réécriture : les runs antérieurs n'existent plus
+    uint64_t memtable = 0;    // génération de la memtable, incrémentée à chaque vidage ou réécriture
+
+    std::string runFile(uint64_t id) const;
+    std::string bloomFile(uint64_t id) const;
+    void writeFile(const std::string &filename, const std::string &plaintext) const;
+    void removeRun(uint64_t id) const;
+    // Écrit le run `run` (en-tête et lignes dans `plaintext`) et son filtre de Bloom
+    void writeRun(const RoktLsmRun &run, const std::string &plaintext) const;
+    // Filtre de Bloom des lignes [first, end) de `store`
+    RoktBloomFilter bloomOf(const RoktRowStore &store, size_t first, size_t end) const;
+
+public:
+    RoktLsmTree(const std::string &path, std::shared_ptr<EncryptService> encryptService, const std::string &keyField);
+
+    // Lit la liste des runs et leurs filtres ; un dataset sans liste n'a pas encore de run
+    void load();
+    void save() const;
+
+    const std::vector<RoktLsmRun> &getRuns() const { return runs; }
+    const std::string &getKeyField() const { return keyField; }
+    // Génération des enregistrements de la memtable courante (voir RoktJournal::stamp)
+    uint64_t memtableGeneration() const { return memtable; }
+    size_t rows() const;
+    uint64_t bytes() const;
+
+    // Lit un run : chaque ligne est ajoutée à `store` puis son indice transmis à `onRow`, qui
+    // renvoie false pour arrêter. Renvoie false si le run est illisible.
+    bool readRun(const RoktLsmRun &run, RoktRowStore &store, const std::function<bool(size_t row)> &onRow) const;
+    // Faux si le filtre de Bloom du run exclut toute ligne vérifiant `where`
+    bool mayMatch(const RoktLsmRun &run, const std::vector<Condition> &where) const;
+
+    // Ajoute un run de niveau 0 formé des lignes [first, end) de `store` (vidage de la memtable) ;
+    // les enregistrements de la memtable courante sont ensuite ignorés
+    void flush(const RoktRowStore &store, size_t first, size_t end);
+    // Remplace tous les runs par un seul run contenant `store` (réécriture complète du dataset,
+    // memtable comprise)
+    void rewrite(const RoktRowStore &store);
+
+    // Vrai si les runs les plus récents forment un niveau complet
+    bool canMerge() const;
+    // Choisit les runs à fusionner et réserve l'identifiant du run fusionné (verrou pris)
+    bool planMerge(Merge *merge);
+    // Écrit le run fusionné à partir des fichiers des runs sources (sans verrou : seuls le
+    // dossier et le champ clé sont lus) ; renvoie false si un run source est illisible
+    bool writeMerge(Merge &merge) const;
+    // Faux si le dataset a été réécrit depuis la préparation de la fusion : ses runs sources
+    // n'existent plus (verrou pris)
+    bool isCurrent(const Merge &merge) const { return merge.generation == generation; }
+    // Remplace les runs sources par le run fusionné (verrou pris). Si la fusion n'est plus
+    // d'actualité (voir isCurrent), le run fusionné est supprimé et false est renvoyé.
+    bool commitMerge(const Merge &merge);
+    // Abandonne une fusion préparée : le run fusionné est supprimé
+    void abortMerge(const Merge &merge) const;
+};
+
+#endif // ROKTLSMTREE_H
@@ -4,6 +4,7 @@
 #include <string>
 #include <sstream>
 #include "LogService.h"
+#include "ResponseEncoding.h"
 
 namespace ROKT {
     /**
@@ -17,6 +18,7 @@ namespace ROKT {
         int code;              ///< Code de statut (0 pour OK, autre valeur pour erreur)
         std::string reason;    ///< Message ou raison associée à la réponse
         std::string datas;     ///< Données associées à la réponse
+        bool datasEncoded = false; ///< Données déjà encodées dans le format de la connexion (sinon JSON)
 
         /**
          * @brief Assigne un message par défaut si aucun message n'est spécifié.
@@ -105,18 +107,17 @@ namespace ROKT {
         const std::string& getDatas() const noexcept { return datas; }
 
         /**
-         * @brief Retourne soit le message, soit les données si présentes.
-         * @return Une référence constante vers la chaîne appropriée.
+         * @brief Indique que les données sont déjà encodées dans le format de la connexion
+         * (voir ResponseEncoding::encode) et doivent être transmises telles quelles.
          */
-        std::string getResponse() const noexcept {
-            std::ostringstream response;
-            response << "{\"status\": " << code << ", \"reason\": \"" << reason << "\"";
-            bool is_success = (code == 0);
-            if (is_success && !datas.empty()) {
-                response << ", \"datas\": " << datas;
-            }
-            response << "}";
-            return response.str();
+        void setDatasEncoded(bool encoded) noexcept { datasEncoded = encoded; }
+
+        /**
+         * @brief Retourne la réponse complète, dans le format de la connexion (ResponseEncoding).
+         * @return La réponse sérialisée.
+         */
+        std::string getResponse() const {
+            return ResponseEncoding::envelope(code, reason, datas, datasEncoded);
         }
 
         /**
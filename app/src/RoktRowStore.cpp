@@ -0,0 +1,603 @@
+// RoktRowStore.cpp
+#include "RoktRowStore.h"
+#include "RequestArena.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    // Taille maximale acceptée pour une ligne lue depuis un fichier (protection contre un en-tête corrompu)
+    const uint64_t MAX_ROW_WORDS = UINT64_C(1) << 32;
+
+    void appendU32(std::string &out, uint32_t value) {
+        out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    uint32_t readU32(std::istream &in) {
+        uint32_t value;
+        if (!in.read(reinterpret_cast<char *>(&value), sizeof(value)))
+            throw std::runtime_error("En-tête du dataset tronqué");
+        return value;
+    }
+
+    void appendU64(std::string &out, uint64_t value) {
+        out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    uint64_t readU64(std::istream &in) {
+        uint64_t value;
+        if (!in.read(reinterpret_cast<char *>(&value), sizeof(value)))
+            throw std::runtime_error("En-tête du dataset tronqué");
+        return value;
+    }
+}
+
+uint32_t RoktKeyDictionary::intern(const std::string &name) {
+    auto it = ids.find(name);
+    if (it != ids.end())
+        return it->second;
+    uint32_t id = static_cast<uint32_t>(names.size());
+    names.push_back(name);
+    ids.emplace(name, id);
+    return id;
+}
+
+bool RoktKeyDictionary::find(const std::string &name, uint32_t *id) const {
+    auto it = ids.find(name);
+    if (it == ids.end())
+        return false;
+    *id = it->second;
+    return true;
+}
+
+uint32_t RoktKeyDictionary::internPath(uint32_t parent, uint32_t key) {
+    if (parent == NO_PATH)
+        return NO_PATH;
+    uint64_t edge = (static_cast<uint64_t>(parent) << 32) | key;
+    auto it = children.find(edge);
+    if (it != children.end())
+        return it->second;
+    // Une clé vide ou contenant un '.' n'est pas adressable par un chemin composé
+    if (names[key].empty() || names[key].find('.') != std::string::npos) {
+        children.emplace(edge, NO_PATH);
+        return NO_PATH;
+    }
+    uint32_t id = static_cast<uint32_t>(paths.size());
+    Path path{parent, key, {}, {}};
+    if (parent != ROOT_PATH) {
+        path.keyIds = paths[parent].keyIds;
+        path.name = paths[parent].name + ".";
+    }
+    path.keyIds.push_back(key);
+    path.name += names[key];
+    pathIds.emplace(path.name, id);
+    paths.push_back(std::move(path));
+    children.emplace(edge, id);
+    return id;
+}
+
+uint32_t RoktKeyDictionary::findChild(uint32_t parent, uint32_t key) const {
+    if (parent == NO_PATH)
+        return NO_PATH;
+    auto it = children.find((static_cast<uint64_t>(parent) << 32) | key);
+    return it == children.end() ? NO_PATH : it->second;
+}
+
+bool RoktKeyDictionary::findPath(const std::string &compoundKey, uint32_t *pathId) const {
+    auto it = pathIds.find(compoundKey);
+    if (it == pathIds.end())
+        return false;
+    *pathId = it->second;
+    return true;
+}
+
+size_t RoktKeyDictionary::memoryUsage() const {
+    size_t total = names.capacity() * sizeof(std::string);
+    for (auto &name : names)
+        total += 2 * name.capacity() + sizeof(std::pair<std::string, uint32_t>);
+    for (auto &path : paths)
+        total += sizeof(Path) + path.keyIds.capacity() * sizeof(uint32_t) + path.name.capacity() + sizeof(std::pair<uint64_t, uint32_t>);
+    for (auto &entry : pathIds)
+        total += entry.first.capacity() + sizeof(entry);
+    return total;
+}
+
+void RoktKeyDictionary::serialize(std::string &out) const {
+    appendU32(out, static_cast<uint32_t>(names.size()));
+    for (auto &name : names) {
+        appendU32(out, static_cast<uint32_t>(name.size()));
+        out.append(name);
+    }
+    appendU32(out, static_cast<uint32_t>(paths.size()));
+    for (auto &path : paths) {
+        appendU32(out, path.parent);
+        appendU32(out, path.key);
+    }
+}
+
+void RoktKeyDictionary::deserialize(std::istream &in) {
+    names.clear();
+    ids.clear();
+    paths.clear();
+    children.clear();
+    pathIds.clear();
+    uint32_t keyCount = readU32(in);
+    for (uint32_t i = 0; i < keyCount; i++) {
+        std::string name(readU32(in), '\0');
+        if (!in.read(&name[0], name.size()))
+            throw std::runtime_error("En-tête du dataset tronqué");
+        intern(name);
+    }
+    // Les chemins sont enregistrés après leur parent : ils sont recréés dans le même ordre
+    uint32_t pathCount = readU32(in);
+    for (uint32_t i = 0; i < pathCount; i++) {
+        uint32_t parent = readU32(in);
+        uint32_t key = readU32(in);
+        if (key >= names.size() || (parent != ROOT_PATH && parent >= paths.size()) || internPath(parent, key) != i)
+            throw std::runtime_error("Dictionnaire du dataset invalide");
+    }
+}
+
+size_t RoktRowStore::memoryUsage() const {
+    return (tape.capacity() + rows.capacity()) * sizeof(uint64_t) + keys.memoryUsage();
+}
+
+void RoktRowStore::clear() {
+    tape.clear();
+    rows.clear();
+}
+
+template <typename BasicJsonType>
+void RoktRowStore::append(const BasicJsonType &row) {
+    rows.push_back(tape.size());
+    encode(row, RoktKeyDictionary::ROOT_PATH);
+}
+
+template <typename BasicJsonType>
+void RoktRowStore::replace(size_t row, const BasicJsonType &value) {
+    // Encodée à la fin du ruban, puis déplacée à la place de l'ancienne ligne (les positions
+    // internes d'une ligne sont relatives à son début)
+    size_t end = tape.size();
+    encode(value, RoktKeyDictionary::ROOT_PATH);
+    std::vector<uint64_t> encoded(tape.begin() + static_cast<std::ptrdiff_t>(end), tape.end());
+    tape.resize(end);
+    size_t start = rows[row];
+    size_t previous = span(start);
+    if (encoded.size() > previous)
+        tape.insert(tape.begin() + static_cast<std::ptrdiff_t>(start + previous), encoded.size() - previous, 0);
+    else
+        tape.erase(tape.begin() + static_cast<std::ptrdiff_t>(start + encoded.size()),
+                   tape.begin() + static_cast<std::ptrdiff_t>(start + previous));
+    std::copy(encoded.begin(), encoded.end(), tape.begin() + static_cast<std::ptrdiff_t>(start));
+    for (size_t i = row + 1; i < rows.size(); i++)
+        rows[i] = rows[i] + encoded.size() - previous;
+}
+
+bool RoktRowStore::assign(size_t pos, const nlohmann::json &value) {
+    if (value.is_structured())
+        return false;
+    size_t end = tape.size();
+    encode(value, RoktKeyDictionary::NO_PATH);
+    bool fits = tape.size() - end == span(pos);
+    if (fits)
+        std::copy(tape.begin() + static_cast<std::ptrdiff_t>(end), tape.end(), tape.begin() + static_cast<std::ptrdiff_t>(pos));
+    tape.resize(end);
+    return fits;
+}
+
+void RoktRowStore::erase(const std::vector<size_t> &sorted) {
+    // Les lignes étant contiguës, celles conservées sont ramenées vers le début du ruban
+    size_t write = 0;
+    size_t kept = 0;
+    size_t next = 0;
+    for (size_t row = 0; row < rows.size(); row++) {
+        if (next < sorted.size() && sorted[next] == row) {
+            next++;
+            continue;
+        }
+        size_t start = rows[row];
+        size_t length = span(start);
+        if (start != write)
+            std::copy(tape.begin() + static_cast<std::ptrdiff_t>(start), tape.begin() + static_cast<std::ptrdiff_t>(start + length),
+                      tape.begin() + static_cast<std::ptrdiff_t>(write));
+        rows[kept++] = write;
+        write += length;
+    }
+    rows.resize(kept);
+    tape.resize(write);
+}
+
+size_t RoktRowStore::serializedSize() const {
+    std::string dictionary;
+    keys.serialize(dictionary);
+    return ROKT_TAPE_MAGIC_SIZE + sizeof(uint32_t) + sizeof(uint64_t) + dictionary.size() + tape.size() * sizeof(uint64_t);
+}
+
+void RoktRowStore::serialize(std::string &out, uint64_t generation) const {
+    out.reserve(out.size() + ROKT_TAPE_MAGIC_SIZE + sizeof(uint32_t) + sizeof(uint64_t) + tape.size() * sizeof(uint64_t));
+    serializeHeader(out, generation);
+    serializeRows(out, 0, rows.size());
+}
+
+void RoktRowStore::serializeHeader(std::string &out, uint64_t generation) const {
+    out.append(ROKT_TAPE_MAGIC, ROKT_TAPE_MAGIC_SIZE);
+    appendU32(out, ROKT_TAPE_VERSION);
+    appendU64(out, generation);
+    keys.serialize(out);
+}
+
+void RoktRowStore::serializeRows(std::string &out, size_t first, size_t end) const {
+    // Les lignes sont contiguës dans le ruban : elles sont écrites d'un bloc
+    size_t begin = first < rows.size() ? rows[first] : tape.size();
+    size_t stop = end < rows.size() ? rows[end] : tape.size();
+    if (stop > begin)
+        out.append(reinterpret_cast<const char *>(tape.data() + begin), (stop - begin) * sizeof(uint64_t));
+}
+
+bool RoktRowStore::isTapeStream(std::istream &in) {
+    // Un tableau JSON commence par '[' ou un blanc, jamais par la première lettre de l'en-tête
+    return in.peek() == ROKT_TAPE_MAGIC[0];
+}
+
+uint64_t RoktRowStore::readHeader(std::istream &in) {
+    char magic[ROKT_TAPE_MAGIC_SIZE];
+    if (!in.read(magic, ROKT_TAPE_MAGIC_SIZE) || std::memcmp(magic, ROKT_TAPE_MAGIC, ROKT_TAPE_MAGIC_SIZE) != 0)
+        throw std::runtime_error("En-tête du dataset invalide");
+    uint32_t version = readU32(in);
+    if (version != ROKT_TAPE_VERSION && version != ROKT_TAPE_VERSION_NO_GENERATION)
+        throw std::runtime_error("Version du dataset non supportée");
+    uint64_t generation = version == ROKT_TAPE_VERSION ? readU64(in) : 0;
+    keys.deserialize(in);
+    return generation;
+}
+
+bool RoktRowStore::readRow(std::istream &in) {
+    uint64_t first;
+    if (!in.read(reinterpret_cast<char *>(&first), sizeof(first))) {
+        if (in.gcount() != 0)
+            throw std::runtime_error("Ligne du dataset tronquée");
+        return false;
+    }
+    size_t at = tape.size();
+    tape.push_back(first);
+    uint64_t words = span(at);
+    if (words == 0 || words > MAX_ROW_WORDS) {
+        tape.resize(at);
+        throw std::runtime_error("Ligne du dataset invalide");
+    }
+    tape.resize(at + words);
+    if (words > 1 && !in.read(reinterpret_cast<char *>(&tape[at + 1]), (words - 1) * sizeof(uint64_t))) {
+        tape.resize(at);
+        throw std::runtime_error("Ligne du dataset tronquée");
+    }
+    rows.push_back(at);
+    return true;
+}
+
+template <typename BasicJsonType>
+void RoktRowStore::encode(const BasicJsonType &value, uint32_t path) {
+    switch (value.type()) {
+        case nlohmann::detail::value_t::boolean:
+            tape.push_back(header(value.template get<bool>() ? TAG_TRUE : TAG_FALSE, 0));
+            break;
+        case nlohmann::detail::value_t::number_integer: {
+            int64_t v = value.template get<int64_t>();
+            if (v >= -(INT64_C(1) << 55) && v < (INT64_C(1) << 55)) {
+                tape.push_back(header(TAG_INT, static_cast<uint64_t>(v)));
+            } else {
+                tape.push_back(header(TAG_INT64, 0));
+                tape.push_back(static_cast<uint64_t>(v));
+            }
+            break;
+        }
+        case nlohmann::detail::value_t::number_unsigned: {
+            uint64_t v = value.template get<uint64_t>();
+            if (v < (UINT64_C(1) << 56)) {
+                tape.push_back(header(TAG_UINT, v));
+            } else {
+                tape.push_back(header(TAG_UINT64, 0));
+                tape.push_back(v);
+            }
+            break;
+        }
+        case nlohmann::detail::value_t::number_float: {
+            double d = value.template get<double>();
+            uint64_t bits;
+            std::memcpy(&bits, &d, sizeof(bits));
+            tape.push_back(header(TAG_DOUBLE, 0));
+            tape.push_back(bits);
+            break;
+        }
+        case nlohmann::detail::value_t::string: {
+            const auto &str = value.template get_ref<const typename BasicJsonType::string_t &>();
+            tape.push_back(header(TAG_STRING, str.size()));
+            size_t at = tape.size();
+            tape.resize(at + (str.size() + 7) / 8, 0);
+            if (!str.empty())
+                std::memcpy(&tape[at], str.data(), str.size());
+            break;
+        }
+        case nlohmann::detail::value_t::array: {
+            size_t start = tape.size();
+            tape.push_back(0);
+            tape.push_back(value.size());
+            for (auto &element : value)
+                encode(element, RoktKeyDictionary::NO_PATH);
+            tape[start] = header(TAG_ARRAY, tape.size() - start);
+            break;
+        }
+        case nlohmann::detail::value_t::object: {
+            // Les entrées sont triées par identifiant de clé pour la recherche dichotomique
+            std::vector<std::pair<uint32_t, const BasicJsonType *>> entries;
+            entries.reserve(value.size());
+            for (auto it = value.begin(); it != value.end(); ++it)
+                entries.emplace_back(keys.intern(it.key()), &it.value());
+            std::sort(entries.begin(), entries.end(),
+                      [](const auto &a, const auto &b) { return a.first < b.first; });
+            size_t start = tape.size();
+            tape.push_back(0);
+            tape.push_back(entries.size());
+            size_t table = tape.size();
+            tape.resize(table + entries.size(), 0);
+            for (size_t i = 0; i < entries.size(); i++) {
+                tape[table + i] = (static_cast<uint64_t>(entries[i].first) << 32) | (tape.size() - start);
+                encode(*entries[i].second, keys.internPath(path, entries[i].first));
+            }
+            tape[start] = header(TAG_OBJECT, tape.size() - start);
+            break;
+        }
+        default:
+            // null, binaire et valeurs rejetées sont stockés comme null
+            tape.push_back(header(TAG_NULL, 0));
+            break;
+    }
+}
+
+template <typename BasicJsonType>
+BasicJsonType RoktRowStore::decode(size_t pos) const {
+    switch (tag(pos)) {
+        case TAG_TRUE:
+            return true;
+        case TAG_FALSE:
+            return false;
+        case TAG_INT:
+            // Extension du signe des 56 bits de charge utile
+            return static_cast<int64_t>(tape[pos] << 8) >> 8;
+        case TAG_INT64:
+            return static_cast<int64_t>(tape[pos + 1]);
+        case TAG_UINT:
+            return payload(pos);
+        case TAG_UINT64:
+            return tape[pos + 1];
+        case TAG_DOUBLE:
+            return number(pos);
+        case TAG_STRING:
+            return std::string(string(pos));
+        case TAG_ARRAY: {
+            BasicJsonType array = BasicJsonType::array();
+            size_t n = count(pos);
+            array.template get_ref<typename BasicJsonType::array_t &>().reserve(n);
+            size_t element = firstElement(pos);
+            for (size_t i = 0; i < n; i++) {
+                array.push_back(decode<BasicJsonType>(element));
+                element += span(element);
+            }
+            return array;
+        }
+        case TAG_OBJECT: {
+            BasicJsonType object = BasicJsonType::object();
+            size_t n = count(pos);
+            for (size_t i = 0; i < n; i++) {
+                uint64_t entry = tape[pos + 2 + i];
+                object.emplace(keys.name(static_cast<uint32_t>(entry >> 32)),
+                               decode<BasicJsonType>(pos + static_cast<uint32_t>(entry)));
+            }
+            return object;
+        }
+        default:
+            return nullptr;
+    }
+}
+
+size_t RoktRowStore::span(size_t pos) const {
+    switch (tag(pos)) {
+        case TAG_INT64:
+        case TAG_UINT64:
+        case TAG_DOUBLE:
+            return 2;
+        case TAG_STRING:
+            return 1 + (payload(pos) + 7) / 8;
+        case TAG_ARRAY:
+        case TAG_OBJECT:
+            return payload(pos);
+        default:
+            return 1;
+    }
+}
+
+bool RoktRowStore::isNumber(size_t pos) const {
+    Tag t = tag(pos);
+    return t == TAG_INT || t == TAG_INT64 || t == TAG_UINT || t == TAG_UINT64 || t == TAG_DOUBLE;
+}
+
+double RoktRowStore::number(size_t pos) const {
+    switch (tag(pos)) {
+        case TAG_INT:
+            return static_cast<double>(static_cast<int64_t>(tape[pos] << 8) >> 8);
+        case TAG_INT64:
+            return static_cast<double>(static_cast<int64_t>(tape[pos + 1]));
+        case TAG_UINT:
+            return static_cast<double>(payload(pos));
+        case TAG_UINT64:
+            return static_cast<double>(tape[pos + 1]);
+        case TAG_DOUBLE: {
+            double d;
+            std::memcpy(&d, &tape[pos + 1], sizeof(d));
+            return d;
+        }
+        default:
+            return 0.0;
+    }
+}
+
+std::string_view RoktRowStore::string(size_t pos) const {
+    return std::string_view(reinterpret_cast<const char *>(&tape[pos + 1]), payload(pos));
+}
+
+size_t RoktRowStore::find(size_t pos, uint32_t keyId, uint32_t *hint) const {
+    if (tag(pos) != TAG_OBJECT)
+        return npos;
+    size_t n = count(pos);
+    size_t table = pos + 2;
+    if (*hint < n && static_cast<uint32_t>(tape[table + *hint] >> 32) == keyId)
+        return pos + static_cast<uint32_t>(tape[table + *hint]);
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        uint32_t id = static_cast<uint32_t>(tape[table + mid] >> 32);
+        if (id == keyId) {
+            *hint = static_cast<uint32_t>(mid);
+            return pos + static_cast<uint32_t>(tape[table + mid]);
+        }
+        if (id < keyId)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return npos;
+}
+
+template void RoktRowStore::append<nlohmann::json>(const nlohmann::json &row);
+template void RoktRowStore::append<ROKT::ArenaJson>(const ROKT::ArenaJson &row);
+template void RoktRowStore::replace<nlohmann::json>(size_t row, const nlohmann::json &value);
+template nlohmann::json RoktRowStore::decode<nlohmann::json>(size_t pos) const;
+template ROKT::ArenaJson RoktRowStore::decode<ROKT::ArenaJson>(size_t pos) const;
+
+RoktFieldPath::RoktFieldPath(const std::string &compoundKey, const RoktKeyDictionary &keys)
+    : compoundKey(compoundKey), resolved(false), knownEntries(0) {
+    resolve(keys);
+}
+
+void RoktFieldPath::resolve(const RoktKeyDictionary &keys) {
+    knownEntries = keys.size() + keys.pathCount();
+    keyIds.clear();
+    uint32_t pathId;
+    if (!compoundKey.empty() && keys.findPath(compoundKey, &pathId)) {
+        keyIds = keys.pathKeys(pathId);
+        resolved = true;
+    } else {
+        // Chemin jamais enregistré (clé vide, '.' final...) : résolution segment par segment,
+        // comme findNestedValue
+        resolved = !compoundKey.empty();
+        size_t start = 0;
+        while (resolved && start < compoundKey.size()) {
+            size_t dot = compoundKey.find('.', start);
+            if (dot == std::string::npos)
+                dot = compoundKey.size();
+            uint32_t id;
+            // Une clé jamais rencontrée ne peut être présente dans aucune ligne
+            resolved = keys.find(compoundKey.substr(start, dot - start), &id);
+            keyIds.push_back(id);
+            start = dot + 1;
+        }
+    }
+    hints.assign(keyIds.size(), 0);
+}
+
+size_t RoktFieldPath::lookup(const RoktRowStore &store, size_t row) {
+    const RoktKeyDictionary &keys = store.dictionary();
+    if (!resolved && keys.size() + keys.pathCount() != knownEntries)
+        resolve(store.dictionary());
+    if (!resolved)
+        return RoktRowStore::npos;
+    size_t pos = store.rowPosition(row);
+    for (size_t i = 0; i < keyIds.size() && pos != RoktRowStore::npos; i++)
+        pos = store.find(pos, keyIds[i], &hints[i]);
+    return pos;
+}
+
+RoktPredicate::RoktPredicate(const std::vector<Condition> &conds, const RoktKeyDictionary &keys) {
+    for (auto &cond : conds) {
+        CompiledCondition compiled{RoktFieldPath(cond.field, keys), cond.op, cond.value, false, 0.0, cond.logic};
+        try {
+            compiled.number = std::stod(cond.value);
+            compiled.numeric = true;
+        } catch (...) {
+            // Valeur non numérique : comparaison en chaîne
+        }
+        conditions.push_back(std::move(compiled));
+    }
+}
+
+bool RoktPredicate::evaluate(const RoktRowStore &store, size_t row, CompiledCondition &cond, bool *res) {
+    size_t pos = cond.path.lookup(store, row);
+    if (pos == RoktRowStore::npos || store.tag(pos) == RoktRowStore::TAG_NULL)
+        return false;
+
+    if (cond.numeric && store.isNumber(pos)) {
+        double val = store.number(pos);
+        if (cond.op == "==") *res = val == cond.number;
+        else if (cond.op == "!=") *res = val != cond.number;
+        else if (cond.op == "<") *res = val < cond.number;
+        else if (cond.op == "<=") *res = val <= cond.number;
+        else if (cond.op == ">") *res = val > cond.number;
+        else if (cond.op == ">=") *res = val >= cond.number;
+        else return false;
+        return true;
+    }
+    if (cond.op == "HAS") {
+        *res = false;
+        if (store.tag(pos) != RoktRowStore::TAG_ARRAY)
+            return true;
+        size_t element = store.firstElement(pos);
+        for (size_t i = 0; i < store.count(pos); i++) {
+            if (store.tag(element) == RoktRowStore::TAG_STRING && store.string(element) == cond.value) {
+                *res = true;
+                return true;
+            }
+            element += store.span(element);
+        }
+        return true;
+    }
+    // Les chaînes sont comparées sans copie ; les autres valeurs via leur forme JSON
+    std::string dumped;
+    std::string_view strVal;
+    if (store.tag(pos) == RoktRowStore::TAG_STRING) {
+        strVal = store.string(pos);
+    } else {
+        dumped = store.materializeValue<nlohmann::json>(pos).dump();
+        strVal = dumped;
+    }
+    std::string_view cmpVal = cond.value;
+    if (cond.op == "==") *res = strVal == cmpVal;
+    else if (cond.op == "!=") *res = strVal != cmpVal;
+    else if (cond.op == "<") *res = strVal < cmpVal;
+    else if (cond.op == "<=") *res = strVal <= cmpVal;
+    else if (cond.op == ">") *res = strVal > cmpVal;
+    else if (cond.op == ">=") *res = strVal >= cmpVal;
+    else return false;
+    return true;
+}
+
+bool RoktPredicate::matches(const RoktRowStore &store, size_t row, bool *result) {
+    *result = true;
+    if (conditions.empty())
+        return true;
+    bool current = false;
+    if (!evaluate(store, row, conditions[0], &current))
+        current = false;
+    *result = current;
+    for (size_t i = 1; i < conditions.size(); i++) {
+        const std::string &logic = conditions[i].logic;
+        current = false;
+        if (!evaluate(store, row, conditions[i], &current))
+            current = false;
+        if (logic == "AND")
+            *result = *result && current;
+        else if (logic == "OR")
+            *result = *result || current;
+        else
+            return false;
+    }
+    return true;
+}
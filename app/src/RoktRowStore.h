@@ -0,0 +1,236 @@
+#ifndef ROKTROWSTORE_H
+#define ROKTROWSTORE_H
+
+#include "ConditionUtils.h"
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+// Format du fichier dataset (texte clair avant chiffrement) :
+//   "ROKTTAPE" | version (u32) | nombre de clés (u32) | clés (longueur u32 + octets)
+//   | nombre de chemins (u32) | chemins (chemin parent u32 + clé u32) | lignes (mots du ruban)
+// Les entiers sont écrits dans l'ordre de la machine (little-endian). Les fichiers plus anciens
+// contenant un tableau JSON restent lisibles.
+#define ROKT_TAPE_MAGIC "ROKTTAPE"
+#define ROKT_TAPE_MAGIC_SIZE 8
+#define ROKT_TAPE_VERSION 3
+#define ROKT_TAPE_VERSION_NO_GENERATION 2   // en-tête sans génération (fichiers antérieurs)
+
+/**
+ * @brief Dictionnaire des noms de champs : chaque clé reçoit un identifiant entier.
+ *
+ * Les lignes stockées ne conservent que ces identifiants, le nom n'est présent qu'une fois.
+ * Chaque chemin de champs imbriqués ("details.city") reçoit aussi un identifiant : sa
+ * résolution en suite d'identifiants de clés est une simple recherche dans une table.
+ * Le dictionnaire est enregistré une seule fois dans l'en-tête du fichier dataset.
+ */
+class RoktKeyDictionary {
+public:
+    static constexpr uint32_t ROOT_PATH = 0xFFFFFFFF;  // parent des champs de premier niveau
+    static constexpr uint32_t NO_PATH = 0xFFFFFFFE;    // valeur non adressable par un chemin (élément de tableau)
+
+private:
+    struct Path {
+        uint32_t parent;
+        uint32_t key;
+        std::vector<uint32_t> keyIds;  // identifiants des clés depuis la racine
+        std::string name;              // "details.city"
+    };
+    std::vector<std::string> names;
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<Path> paths;
+    std::unordered_map<uint64_t, uint32_t> children;        // (chemin parent, clé) -> chemin
+    std::unordered_map<std::string, uint32_t> pathIds;      // "details.city" -> chemin
+public:
+    // Renvoie l'identifiant de la clé, en l'ajoutant si nécessaire
+    uint32_t intern(const std::string &name);
+    // Renvoie false si la clé n'a jamais été rencontrée
+    bool find(const std::string &name, uint32_t *id) const;
+    const std::string &name(uint32_t id) const { return names[id]; }
+    size_t size() const { return names.size(); }
+
+    // Renvoie l'identifiant du chemin `parent`.`key`, en l'ajoutant si nécessaire
+    // (NO_PATH si le parent n'est pas adressable ou si la clé contient un '.')
+    uint32_t internPath(uint32_t parent, uint32_t key);
+    // Renvoie false si aucun champ n'a jamais été rencontré à ce chemin
+    bool findPath(const std::string &compoundKey, uint32_t *pathId) const;
+    // Chemin `parent`.`key` déjà enregistré (NO_PATH sinon)
+    uint32_t findChild(uint32_t parent, uint32_t key) const;
+    const std::vector<uint32_t> &pathKeys(uint32_t pathId) const { return paths[pathId].keyIds; }
+    const std::string &pathName(uint32_t pathId) const { return paths[pathId].name; }
+    size_t pathCount() const { return paths.size(); }
+
+    size_t memoryUsage() const;
+    void serialize(std::string &out) const;
+    // Lit le dictionnaire depuis l'en-tête ; lève std::runtime_error si celui-ci est tronqué
+    void deserialize(std::istream &in);
+};
+
+/**
+ * @brief Stockage compact des lignes d'un dataset sous forme de ruban (tape) de mots de 64 bits.
+ *
+ * Chaque valeur commence par un mot d'en-tête : 8 bits d'étiquette et 56 bits de charge utile.
+ * - null / true / false : en-tête seul ;
+ * - entiers tenant sur 56 bits : valeur directement dans l'en-tête, sinon un mot supplémentaire ;
+ * - double : un mot supplémentaire ;
+ * - chaîne : longueur dans l'en-tête, octets dans les mots suivants ;
+ * - tableau : taille totale (en mots) dans l'en-tête, puis le nombre d'éléments et les éléments ;
+ * - objet : taille totale dans l'en-tête, le nombre d'entrées, une table triée
+ *   (identifiant de clé sur 32 bits, position relative sur 32 bits), puis les valeurs.
+ *
+ * Une valeur occupe une zone contiguë : elle peut être sautée en O(1) et un champ d'objet
+ * est retrouvé sans parcourir les autres. La conversion vers JSON n'a lieu que pour les
+ * lignes effectivement renvoyées.
+ */
+class RoktRowStore {
+public:
+    enum Tag : uint8_t {
+        TAG_NULL,
+        TAG_TRUE,
+        TAG_FALSE,
+        TAG_INT,     // entier signé sur 56 bits dans l'en-tête
+        TAG_INT64,   // entier signé dans le mot suivant
+        TAG_UINT,    // entier non signé sur 56 bits dans l'en-tête
+        TAG_UINT64,  // entier non signé dans le mot suivant
+        TAG_DOUBLE,  // double dans le mot suivant
+        TAG_STRING,
+        TAG_ARRAY,
+        TAG_OBJECT
+    };
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+private:
+    std::vector<uint64_t> tape;   ///< Ruban contenant toutes les lignes
+    std::vector<uint64_t> rows;   ///< Position de chaque ligne dans le ruban
+    RoktKeyDictionary keys;
+
+    static uint64_t header(Tag tag, uint64_t payload) { return (static_cast<uint64_t>(tag) << 56) | (payload & 0x00FFFFFFFFFFFFFFULL); }
+    uint64_t payload(size_t pos) const { return tape[pos] & 0x00FFFFFFFFFFFFFFULL; }
+
+    template <typename BasicJsonType>
+    void encode(const BasicJsonType &value, uint32_t path);
+    template <typename BasicJsonType>
+    BasicJsonType decode(size_t pos) const;
+
+public:
+    size_t size() const { return rows.size(); }
+    size_t memoryUsage() const;
+    // Vide les lignes en conservant le dictionnaire
+    void clear();
+
+    RoktKeyDictionary &dictionary() { return keys; }
+    const RoktKeyDictionary &dictionary() const { return keys; }
+
+    // Ajoute une ligne à la fin du ruban
+    template <typename BasicJsonType>
+    void append(const BasicJsonType &row);
+    // Remplace une ligne en place : le ruban reste contigu, les lignes suivantes sont décalées
+    template <typename BasicJsonType>
+    void replace(size_t row, const BasicJsonType &value);
+    // Remplace la valeur scalaire située à `pos` si son encodage occupe la même place (un
+    // compteur entier qui reste entier, un double) ; renvoie false sinon, sans rien modifier
+    bool assign(size_t pos, const nlohmann::json &value);
+    // Supprime les lignes `sorted` (indices croissants) ; les suivantes sont renumérotées
+    void erase(const std::vector<size_t> &sorted);
+
+    // Écrit l'en-tête (génération du fichier, dictionnaire) puis les lignes au format ROKT_TAPE
+    void serialize(std::string &out, uint64_t generation = 0) const;
+    // Parties de serialize : l'en-tête seul, puis les lignes [first, end) sans en-tête
+    void serializeHeader(std::string &out, uint64_t generation = 0) const;
+    void serializeRows(std::string &out, size_t first, size_t end) const;
+    // Taille du résultat de serialize, sans le produire
+    size_t serializedSize() const;
+    // Indique si le flux commence par un en-tête ROKT_TAPE (sans rien consommer d'autre)
+    static bool isTapeStream(std::istream &in);
+    // Lit l'en-tête : le dictionnaire remplace celui du store, qui doit être vide ou dont les clés
+    // et les chemins doivent être un préfixe de ceux de l'en-tête (runs d'un dataset LSM). Renvoie
+    // la génération du fichier (0 pour un en-tête de version 2)
+    uint64_t readHeader(std::istream &in);
+    // Lit la ligne suivante et l'ajoute au store ; renvoie false en fin de flux
+    bool readRow(std::istream &in);
+    // Convertit la ligne `row` en document JSON
+    template <typename BasicJsonType>
+    BasicJsonType materialize(size_t row) const { return decode<BasicJsonType>(rows[row]); }
+    // Convertit la valeur située à `pos` en document JSON
+    template <typename BasicJsonType>
+    BasicJsonType materializeValue(size_t pos) const { return decode<BasicJsonType>(pos); }
+
+    // Accès bas niveau aux valeurs du ruban
+    size_t rowPosition(size_t row) const { return rows[row]; }
+    Tag tag(size_t pos) const { return static_cast<Tag>(tape[pos] >> 56); }
+    size_t span(size_t pos) const;
+    bool isNumber(size_t pos) const;
+    double number(size_t pos) const;
+    std::string_view string(size_t pos) const;
+    // Nombre d'éléments d'un tableau ou d'entrées d'un objet
+    size_t count(size_t pos) const { return static_cast<size_t>(tape[pos + 1]); }
+    // Premier élément d'un tableau ; l'élément suivant est à `pos + span(pos)`
+    size_t firstElement(size_t pos) const { return pos + 2; }
+    // Clé et position de la valeur de la i-ème entrée de l'objet situé à `pos`
+    uint32_t entryKey(size_t pos, size_t i) const { return static_cast<uint32_t>(tape[pos + 2 + i] >> 32); }
+    size_t entryValue(size_t pos, size_t i) const { return pos + static_cast<uint32_t>(tape[pos + 2 + i]); }
+    // Position de la valeur associée à la clé `keyId` dans l'objet situé à `pos` (npos si absente).
+    // `hint` mémorise l'indice de l'entrée trouvée : les lignes ayant la même forme, la
+    // recherche suivante aboutit en général du premier coup.
+    size_t find(size_t pos, uint32_t keyId, uint32_t *hint) const;
+};
+
+/**
+ * @brief Ligne retenue par un parcours, transmise sans conversion en JSON.
+ */
+struct RoktScanRow {
+    const RoktRowStore &store;
+    size_t row;        ///< indice de la ligne dans `store`
+    size_t sequence;   ///< rang de la ligne dans le dataset (ordre de parcours)
+    size_t partition;  ///< partition du parcours parallèle (0 pour un parcours séquentiel)
+};
+
+/**
+ * @brief Chemin de champ précompilé ("details.city") exprimé en identifiants de clés.
+ */
+class RoktFieldPath {
+private:
+    std::string compoundKey;
+    std::vector<uint32_t> keyIds;
+    std::vector<uint32_t> hints;
+    bool resolved;
+    size_t knownEntries;  // taille du dictionnaire (clés et chemins) lors de la dernière résolution
+
+    void resolve(const RoktKeyDictionary &keys);
+public:
+    RoktFieldPath(const std::string &compoundKey, const RoktKeyDictionary &keys);
+    // Position de la valeur du champ dans la ligne `row` (npos si absente). Un chemin inconnu
+    // est résolu à nouveau si le dictionnaire s'est enrichi (lecture en flux).
+    size_t lookup(const RoktRowStore &store, size_t row);
+};
+
+/**
+ * @brief Clause WHERE compilée pour être évaluée directement sur le ruban.
+ *
+ * Reproduit la sémantique de evaluateConditions : la valeur de comparaison est convertie
+ * une seule fois et les chemins sont résolus en identifiants de clés.
+ */
+class RoktPredicate {
+private:
+    struct CompiledCondition {
+        RoktFieldPath path;
+        std::string op;
+        std::string value;
+        bool numeric;
+        double number;
+        std::string logic;
+    };
+    std::vector<CompiledCondition> conditions;
+
+    bool evaluate(const RoktRowStore &store, size_t row, CompiledCondition &cond, bool *res);
+public:
+    RoktPredicate(const std::vector<Condition> &conds, const RoktKeyDictionary &keys);
+    // Évalue la clause sur la ligne `row` ; renvoie false si la logique n'est pas reconnue
+    bool matches(const RoktRowStore &store, size_t row, bool *result);
+};
+
+#endif // ROKTROWSTORE_H
@@ -10,8 +10,8 @@
 
 
 
-RoktService::RoktService(const std::string& dir, std::shared_ptr<EncryptService> enc)
-    : baseDir(dir), encryptService(enc)
+RoktService::RoktService(const std::string& dir, std::shared_ptr<EncryptService> enc, const Config::Storage& sto, int scanThr)
+    : baseDir(dir), encryptService(enc), storage(sto), scanThreads(scanThr)
 {
     // On conserve le dossier "shared" en clair,
     // puis on crypte le nom du dossier "datas" pour obtenir le dossier contenant les datasets.
@@ -74,6 +74,72 @@ void RoktService::writeConfig(const nlohmann::json &configJson) {
     outConfig.write(encryptedData.data(), encryptedData.size());
 }
 
+std::string RoktService::datasetDirFor(const std::string &dataset) {
+    return encryptedDatabaseRoot + "/" + encryptService->encryptFilename(dataset);
+}
+
+std::shared_ptr<RoktDatasetState> RoktService::stateFor(const std::string &dataset, const std::string &datasetDir, const nlohmann::json &configJson) {
+    std::lock_guard<std::mutex> lock(statesMutex);
+    return stateLocked(dataset, datasetDir, configJson);
+}
+
+std::shared_ptr<RoktDatasetState> RoktService::stateLocked(const std::string &dataset, const std::string &datasetDir, const nlohmann::json &configJson) {
+    auto &st = states[datasetDir];
+    if (!st) {
+        st = std::make_shared<RoktDatasetState>();
+        st->maxResidentBytes = storage.maxResidentBytes;
+        st->compactionRatio = storage.compactionRatio;
+        st->memtableBytes = storage.memtableBytes;
+        st->scanThreads = scanThreads;
+        st->backgroundTasks = &backgroundTasks;
+        auto settings = configJson["datasets"].find(dataset);
+        if (settings != configJson["datasets"].end())
+            st->lsmKey = settings->value("key", "");
+        // Vues définies sur ce dataset : leurs accumulateurs seront recalculés à la première écriture
+        for (auto &entry : configJson["datasets"].items()) {
+            if (entry.value().value("type", "") != "VIEW" || entry.value().value("source", "") != dataset)
+                continue;
+            std::shared_ptr<RoktView> view = makeView(entry.key(), entry.value(), configJson);
+            if (view)
+                st->views.push_back(view);
+        }
+    }
+    namedStates[dataset] = st;
+    return st;
+}
+
+std::shared_ptr<RoktView> RoktService::makeView(const std::string &name, const nlohmann::json &entry, const nlohmann::json &configJson) {
+    std::shared_ptr<const RoktCommand> definition = RoktCommand::parse(entry.value("definition", ""));
+    std::string error;
+    if (definition->hasError() || !RoktView::validate(*definition, &error))
+        return nullptr;
+    std::string viewDir = datasetDirFor(name);
+    auto viewStorage = std::make_shared<RoktDataset>(DatasetConfigType::DATASET, viewDir, encryptService->encryptFilename("dataset.rokt"),
+                                                     encryptService, stateLocked(name, viewDir, configJson));
+    return std::make_shared<RoktView>(name, entry.value("source", ""), definition, viewStorage);
+}
+
+bool RoktService::version(const std::string &dataset, uint64_t *result, bool prefixOnly) {
+    {
+        std::lock_guard<std::mutex> lock(statesMutex);
+        auto it = namedStates.find(dataset);
+        if (it != namedStates.end()) {
+            *result = prefixOnly ? it->second->prefixVersion : it->second->version;
+            return true;
+        }
+    }
+    // Premier accès : from() lit la configuration et enregistre l'état du dataset
+    std::shared_ptr<RoktDataset> opened;
+    if (from(dataset, opened)->hasError())
+        return false;
+    std::lock_guard<std::mutex> lock(statesMutex);
+    auto it = namedStates.find(dataset);
+    if (it == namedStates.end())
+        return false;
+    *result = prefixOnly ? it->second->prefixVersion : it->second->version;
+    return true;
+}
+
 std::unique_ptr<ROKT::ResponseObject>RoktService::create(const std::string& dataset, const std::string& type, const std::vector<std::string>& args) {
     // Charger la configuration chiffrée
     nlohmann::json configJson = loadConfig();
@@ -110,6 +176,11 @@ std::unique_ptr<ROKT::ResponseObject>RoktService::create(const std::string& data
             configJson["datasets"][dataset]["nb_rotation"] = 2;
         }
     }
+    if (type == "LSM") {
+        // Champ clé facultatif : chaque run a alors un filtre de Bloom de ses valeurs
+        if (!args.empty() && !args[0].empty())
+            configJson["datasets"][dataset]["key"] = args[0];
+    }
     
     // Le nom du dataset est conservé en clair dans la configuration,
     // mais le dossier créé sera obfusqué.
@@ -141,16 +212,82 @@ std::unique_ptr<ROKT::ResponseObject>RoktService::create(const std::string& data
 }
 
 
+std::unique_ptr<ROKT::ResponseObject> RoktService::createView(const std::string& name, const std::shared_ptr<const RoktCommand>& definition) {
+    std::string error;
+    if (!RoktView::validate(*definition, &error))
+        return ROKT::ResponseService::response(1, error);
+    const std::string &source = definition->as<RoktGetQuery>().dataset;
+    nlohmann::json configJson = loadConfig();
+    if (configJson["datasets"].contains(name))
+        return ROKT::ResponseService::response(10, "Already Exists");
+    if (!configJson["datasets"].contains(source))
+        return ROKT::ResponseService::response(1, "Dataset does not exist");
+    if (configJson["datasets"][source].value("type", "") == "VIEW")
+        return ROKT::ResponseService::response(1, "Une vue ne peut pas être définie sur une autre vue.");
+
+    // L'état du dataset source est créé avant l'enregistrement de la vue : elle lui est
+    // attachée une seule fois, par attachView()
+    std::shared_ptr<RoktDataset> sourceDataset;
+    std::unique_ptr<ROKT::ResponseObject> status = from(source, sourceDataset);
+    if (status->hasError())
+        return status;
+
+    nlohmann::json &entry = configJson["datasets"][name];
+    entry["type"] = "VIEW";
+    entry["file"] = encryptService->encryptFilename("dataset.rokt");
+    entry["source"] = source;
+    entry["definition"] = definition->getSource();
+    std::filesystem::create_directories(datasetDirFor(name));
+    writeConfig(configJson);
+
+    std::shared_ptr<RoktView> view;
+    {
+        std::lock_guard<std::mutex> lock(statesMutex);
+        view = makeView(name, entry, configJson);
+    }
+    sourceDataset->attachView(view);
+    return ROKT::ResponseService::response(0, "OK");
+}
+
 std::unique_ptr<ROKT::ResponseObject> RoktService::drop(const std::string& dataset) {
     nlohmann::json configJson = loadConfig();
     if (!configJson["datasets"].contains(dataset))
         return ROKT::ResponseService::response(567); // Dataset non existant
 
+    const nlohmann::json &entry = configJson["datasets"][dataset];
+    if (entry.value("type", "") == "VIEW") {
+        // La vue cesse d'être alimentée par son dataset source
+        std::shared_ptr<RoktDataset> sourceDataset;
+        if (!from(entry.value("source", ""), sourceDataset)->hasError())
+            sourceDataset->detachView(dataset);
+    } else {
+        for (auto &other : configJson["datasets"].items()) {
+            if (other.value().value("type", "") == "VIEW" && other.value().value("source", "") == dataset)
+                return ROKT::ResponseService::response(1, "Dataset utilisé par la vue : " + other.key());
+        }
+    }
+
     std::string encryptedDatasetName = encryptService->encryptFilename(dataset);
     std::string datasetDir = encryptedDatabaseRoot;
     datasetDir.append("/"); 
     datasetDir.append(encryptedDatasetName);
 
+    std::shared_ptr<RoktDatasetState> state;
+    {
+        std::lock_guard<std::mutex> lock(statesMutex);
+        auto it = states.find(datasetDir);
+        if (it != states.end())
+            state = it->second;
+    }
+    if (state) {
+        // Aucun compactage ne doit écrire dans le dossier supprimé : ceux en cours sont attendus
+        {
+            std::unique_lock<std::shared_mutex> writeLock(state->mutex);
+            state->closed = true;
+        }
+        backgroundTasks.wait(state.get());
+    }
+
     std::error_code ec;
     std::filesystem::remove_all(datasetDir, ec);
     
@@ -158,18 +295,31 @@ std::unique_ptr<ROKT::ResponseObject> RoktService::drop(const std::string& datas
         return ROKT::ResponseService::response(457);
     }
 
+    {
+        // Les lignes résidentes du dataset supprimé sont libérées
+        std::lock_guard<std::mutex> lock(statesMutex);
+        states.erase(datasetDir);
+        namedStates.erase(dataset);
+    }
+
     configJson["datasets"].erase(dataset);
     writeConfig(configJson);
     return ROKT::ResponseService::response(0);
 }
 
-std::unique_ptr<ROKT::ResponseObject> RoktService::from(const std::string& dataset, std::shared_ptr<RoktDataset>& result) {
+void RoktService::shutdown() {
+    backgroundTasks.stop();
+}
+
+std::unique_ptr<ROKT::ResponseObject> RoktService::from(const std::string& dataset, std::shared_ptr<RoktDataset>& result, bool forWrite) {
     nlohmann::json configJson = loadConfig();
     if (!configJson["datasets"].contains(dataset)) {
         return ROKT::ResponseService::response(1, "Dataset does not exist");
     }
 
     std::string type = configJson["datasets"][dataset]["type"].get<std::string>();
+    if (forWrite && type == "VIEW")
+        return ROKT::ResponseService::response(1, "Vue en lecture seule : " + dataset);
     std::string encryptedDatasetName = encryptService->encryptFilename(dataset);
     std::string datasetDir = encryptedDatabaseRoot;
     datasetDir.std::string::append("/");
@@ -177,11 +327,17 @@ std::unique_ptr<ROKT::ResponseObject> RoktService::from(const std::string& datas
     
     if (type == "ROTATE") {
         std::vector<std::string> files = { encryptService->encryptFilename("1.rokt") };
-        result = std::make_shared<RoktDataset>(DatasetConfigType::ROTATE, datasetDir, files, encryptService);
+        result = std::make_shared<RoktDataset>(DatasetConfigType::ROTATE, datasetDir, files, encryptService, stateFor(dataset, datasetDir, configJson));
         return ROKT::ResponseService::response(0);
     } 
+    if (type == "LSM") {
+        // Les runs sont décrits par la liste du dossier (RoktLsmTree), pas par un fichier unique
+        result = std::make_shared<RoktDataset>(DatasetConfigType::LSM, datasetDir, encryptService->encryptFilename("dataset.rokt"),
+                                               encryptService, stateFor(dataset, datasetDir, configJson));
+        return ROKT::ResponseService::response(0);
+    }
 
     // Tous les autres cas (SIMPLE et NON EXISTANTS)
-    result = std::make_shared<RoktDataset>(DatasetConfigType::DATASET, datasetDir, encryptService->encryptFilename("dataset.rokt"), encryptService);
+    result = std::make_shared<RoktDataset>(DatasetConfigType::DATASET, datasetDir, encryptService->encryptFilename("dataset.rokt"), encryptService, stateFor(dataset, datasetDir, configJson));
     return ROKT::ResponseService::response(0);
 }
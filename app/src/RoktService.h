@@ -5,8 +5,11 @@
 #include "RoktDataset.h"
 #include "EncryptService.h"
 #include "RoktResponseService.h"
+#include "Config.h"
 #include <string>
 #include <vector>
+#include <mutex>
+#include <unordered_map>
 #include <nlohmann/json.hpp>
 
 class RoktService {
@@ -17,6 +20,21 @@ private:
     // Variables membres pour les chemins encryptés
     std::string encryptedDatabaseRoot;
     std::string encryptedDataConfigFile;
+
+    // État partagé (lignes résidentes) de chaque dataset, indexé par son dossier
+    Config::Storage storage;
+    int scanThreads;
+    std::mutex statesMutex;
+    std::unordered_map<std::string, std::shared_ptr<RoktDatasetState>> states;
+    std::unordered_map<std::string, std::shared_ptr<RoktDatasetState>> namedStates; // même état, indexé par nom
+    // Compactages en arrière-plan des datasets, attendus à leur suppression et à l'arrêt
+    BackgroundTasks backgroundTasks;
+    std::shared_ptr<RoktDatasetState> stateFor(const std::string &dataset, const std::string &datasetDir, const nlohmann::json &configJson);
+    // Variante de stateFor appelée verrou pris ; un nouvel état reçoit les vues définies sur le dataset
+    std::shared_ptr<RoktDatasetState> stateLocked(const std::string &dataset, const std::string &datasetDir, const nlohmann::json &configJson);
+    // Construit la vue décrite par son entrée de configuration (verrou pris) ; nullptr si sa définition est invalide
+    std::shared_ptr<RoktView> makeView(const std::string &name, const nlohmann::json &entry, const nlohmann::json &configJson);
+    std::string datasetDirFor(const std::string &dataset);
     
     // Méthodes privées pour lire/écrire la configuration chiffrée
     nlohmann::json loadConfig();
@@ -25,12 +43,20 @@ private:
 public:
     static const std::string DATABASE_ROOT;  // "shared/datas" n'est plus utilisé directement
     static const std::string DATA_CONFIG_FILENAME; // "datasets.config.json" en clair
-    RoktService(const std::string& dir, std::shared_ptr<EncryptService> enc);
+    RoktService(const std::string& dir, std::shared_ptr<EncryptService> enc, const Config::Storage& sto = Config::Storage(), int scanThr = 1);
     
     // Méthodes publiques
     std::unique_ptr<ROKT::ResponseObject> create(const std::string& dataset, const std::string& type, const std::vector<std::string>& args = {});
+    // Crée une vue matérialisée à partir d'un GET d'agrégats (voir RoktView) et la calcule
+    std::unique_ptr<ROKT::ResponseObject> createView(const std::string& name, const std::shared_ptr<const RoktCommand>& definition);
     std::unique_ptr<ROKT::ResponseObject> drop(const std::string& dataset);
-    std::unique_ptr<ROKT::ResponseObject> from(const std::string& dataset, std::shared_ptr<RoktDataset>& result);
+    // Attend la fin des compactages en cours et n'en lance plus (arrêt du serveur)
+    void shutdown();
+    // `forWrite` refuse les vues, qui ne sont modifiées que par les écritures de leur dataset source
+    std::unique_ptr<ROKT::ResponseObject> from(const std::string& dataset, std::shared_ptr<RoktDataset>& result, bool forWrite = false);
+    // Version courante d'un dataset (false s'il n'existe pas) ; la configuration n'est lue
+    // qu'au premier accès. Avec `prefixOnly`, version des lignes existantes (RoktDatasetState::prefixVersion)
+    bool version(const std::string& dataset, uint64_t *result, bool prefixOnly = false);
 };
 
 #endif // ROKTSERVICE_H
@@ -0,0 +1,174 @@
+// RoktStats.cpp
+#include "RoktStats.h"
+#include <algorithm>
+#include <cstring>
+
+const RoktColumnStats *RoktDatasetStats::column(const std::string &path) const {
+    auto it = columns.find(path);
+    return it == columns.end() ? nullptr : &it->second;
+}
+
+bool RoktDatasetStats::selectivity(const std::vector<Condition> &where, double *fraction) const {
+    *fraction = 1.0;
+    for (size_t i = 0; i < where.size(); i++) {
+        const Condition &cond = where[i];
+        double current = 0.0;
+        const RoktColumnStats *stats = column(cond.field);
+        // Un champ absent de toutes les lignes ne retient aucune ligne
+        if (stats != nullptr && rowCount > 0) {
+            double present = static_cast<double>(stats->present) / static_cast<double>(rowCount);
+            double distinct = static_cast<double>(std::max<uint64_t>(stats->distinct.estimate(), 1));
+            if (cond.op == "==")
+                current = present / distinct;
+            else if (cond.op == "!=")
+                current = present * (1.0 - 1.0 / distinct);
+            else
+                return false;
+        }
+        if (i == 0)
+            *fraction = current;
+        else if (cond.logic == "AND")
+            *fraction *= current;
+        else if (cond.logic == "OR")
+            *fraction = *fraction + current - *fraction * current;
+        else
+            return false;
+    }
+    return true;
+}
+
+uint64_t RoktDatasetStats::valueHash(const RoktRowStore &store, size_t pos) {
+    std::string buffer;
+    if (store.tag(pos) == RoktRowStore::TAG_STRING) {
+        std::string_view str = store.string(pos);
+        buffer.reserve(str.size() + 1);
+        buffer.append(1, 's').append(str);
+    } else if (store.isNumber(pos)) {
+        // 1 et 1.0 sont une même valeur
+        double number = store.number(pos);
+        if (number == 0.0)
+            number = 0.0;
+        buffer.resize(1 + sizeof(number));
+        buffer[0] = 'n';
+        std::memcpy(&buffer[1], &number, sizeof(number));
+    } else {
+        buffer = "j" + store.materializeValue<nlohmann::json>(pos).dump();
+    }
+    return HyperLogLog::hash(buffer.data(), buffer.size());
+}
+
+void RoktDatasetStats::extendRange(RoktColumnStats &stats, RoktSortKey key) {
+    if (!stats.hasRange) {
+        stats.min = key;
+        stats.max = std::move(key);
+        stats.hasRange = true;
+    } else if (RoktSortKey::less(key, stats.min)) {
+        stats.min = std::move(key);
+    } else if (RoktSortKey::less(stats.max, key)) {
+        stats.max = std::move(key);
+    }
+}
+
+void RoktDatasetStats::addObject(const RoktRowStore &store, size_t pos, uint32_t parentPath) {
+    const RoktKeyDictionary &keys = store.dictionary();
+    for (size_t i = 0; i < store.count(pos); i++) {
+        uint32_t path = keys.findChild(parentPath, store.entryKey(pos, i));
+        if (path == RoktKeyDictionary::NO_PATH)
+            continue;
+        size_t value = store.entryValue(pos, i);
+        RoktColumnStats &stats = columns[keys.pathName(path)];
+        RoktRowStore::Tag tag = store.tag(value);
+        if (tag == RoktRowStore::TAG_NULL) {
+            stats.nulls++;
+            continue;
+        }
+        stats.present++;
+        stats.distinct.add(valueHash(store, value));
+        if (tag == RoktRowStore::TAG_STRING || store.isNumber(value))
+            extendRange(stats, RoktSortKey::fromTape(store, value));
+        if (tag == RoktRowStore::TAG_OBJECT)
+            addObject(store, value, path);
+    }
+}
+
+void RoktDatasetStats::addRow(const RoktRowStore &store, size_t row) {
+    version++;
+    rowCount++;
+    size_t pos = store.rowPosition(row);
+    if (store.tag(pos) == RoktRowStore::TAG_OBJECT)
+        addObject(store, pos, RoktKeyDictionary::ROOT_PATH);
+}
+
+void RoktDatasetStats::rebuild(const RoktRowStore &store) {
+    rowCount = 0;
+    columns.clear();
+    for (size_t row = 0; row < store.size(); row++)
+        addRow(store, row);
+    version++;
+}
+
+void RoktDatasetStats::updateColumn(const RoktRowStore &store, const std::string &field, const std::vector<size_t> &rows) {
+    version++;
+    uint32_t keyId;
+    if (!store.dictionary().find(field, &keyId))
+        return;
+    RoktColumnStats &stats = columns[field];
+    uint32_t hint = 0;
+    for (size_t row : rows) {
+        size_t rowPos = store.rowPosition(row);
+        if (store.tag(rowPos) != RoktRowStore::TAG_OBJECT)
+            continue;
+        size_t value = store.find(rowPos, keyId, &hint);
+        if (value == RoktRowStore::npos || store.tag(value) == RoktRowStore::TAG_NULL)
+            continue;
+        stats.distinct.add(valueHash(store, value));
+        if (store.tag(value) == RoktRowStore::TAG_STRING || store.isNumber(value))
+            extendRange(stats, RoktSortKey::fromTape(store, value));
+    }
+}
+
+nlohmann::json RoktDatasetStats::toJson() const {
+    nlohmann::json manifest;
+    manifest["version"] = version;
+    manifest["rows"] = rowCount;
+    manifest["columns"] = nlohmann::json::object();
+    for (auto &entry : columns) {
+        const RoktColumnStats &stats = entry.second;
+        nlohmann::json column;
+        column["present"] = stats.present;
+        column["nulls"] = stats.nulls;
+        column["distinct"] = stats.distinct.estimate();
+        column["hll"] = stats.distinct.toHex();
+        if (stats.hasRange) {
+            column["min"] = stats.min.toJson();
+            column["max"] = stats.max.toJson();
+        }
+        manifest["columns"][entry.first] = column;
+    }
+    return manifest;
+}
+
+bool RoktDatasetStats::fromJson(const nlohmann::json &manifest) {
+    try {
+        version = manifest.at("version").get<uint64_t>();
+        rowCount = manifest.at("rows").get<uint64_t>();
+        columns.clear();
+        for (auto it = manifest.at("columns").begin(); it != manifest.at("columns").end(); ++it) {
+            const nlohmann::json &column = it.value();
+            RoktColumnStats stats;
+            stats.present = column.at("present").get<uint64_t>();
+            stats.nulls = column.at("nulls").get<uint64_t>();
+            if (!stats.distinct.fromHex(column.at("hll").get<std::string>()))
+                return false;
+            if (column.contains("min") && column.contains("max")) {
+                stats.min = RoktSortKey::fromJson(column["min"]);
+                stats.max = RoktSortKey::fromJson(column["max"]);
+                stats.hasRange = true;
+            }
+            columns.emplace(it.key(), std::move(stats));
+        }
+        return true;
+    } catch (std::exception &e) {
+        return false;
+    }
+}
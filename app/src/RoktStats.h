@@ -0,0 +1,71 @@
+#ifndef ROKTSTATS_H
+#define ROKTSTATS_H
+
+#include "RoktRowStore.h"
+#include "RoktTopK.h"
+#include "HyperLogLog.h"
+#include <cstdint>
+#include <map>
+#include <vector>
+#include <string>
+#include <nlohmann/json.hpp>
+
+#define STATS_HLL_PRECISION 10   // 1024 registres par colonne (erreur type d'environ 3 %)
+
+/**
+ * @brief Statistiques d'une colonne (chemin de champ, y compris imbriqué).
+ */
+struct RoktColumnStats {
+    uint64_t present = 0;        ///< lignes où la valeur est présente et non nulle
+    uint64_t nulls = 0;          ///< lignes où la valeur vaut null
+    bool hasRange = false;       ///< min/max connus (nombres et chaînes uniquement)
+    RoktSortKey min;
+    RoktSortKey max;
+    HyperLogLog distinct{STATS_HLL_PRECISION};
+};
+
+/**
+ * @brief Statistiques d'un dataset, enregistrées dans son manifeste.
+ *
+ * Tenues à jour à chaque écriture : un ADD les complète avec la nouvelle ligne, une réécriture
+ * complète (CHANGE, REMOVE, EMPTY) les recalcule pendant l'encodage des lignes. Le numéro de
+ * version augmente à chaque écriture.
+ */
+class RoktDatasetStats {
+private:
+    uint64_t version = 0;
+    uint64_t rowCount = 0;
+    std::map<std::string, RoktColumnStats> columns;
+
+    void addObject(const RoktRowStore &store, size_t pos, uint32_t parentPath);
+    static void extendRange(RoktColumnStats &stats, RoktSortKey key);
+public:
+    uint64_t getVersion() const { return version; }
+    uint64_t getRowCount() const { return rowCount; }
+    const std::map<std::string, RoktColumnStats> &getColumns() const { return columns; }
+    // nullptr si aucune ligne n'a jamais contenu ce chemin
+    const RoktColumnStats *column(const std::string &path) const;
+
+    // Estime la fraction des lignes retenues par un WHERE d'égalités et de différences (une valeur
+    // sur le nombre de valeurs distinctes) ; renvoie false si une condition n'est pas estimable
+    bool selectivity(const std::vector<Condition> &where, double *fraction) const;
+
+    // Prend en compte une ligne ajoutée (nouvelle version)
+    void addRow(const RoktRowStore &store, size_t row);
+    // Recalcule les statistiques à partir de toutes les lignes du store (nouvelle version)
+    void rebuild(const RoktRowStore &store);
+    // Prend en compte les nouvelles valeurs du champ de premier niveau `field` des lignes `rows`,
+    // présent avant la modification (nouvelle version). Les anciennes valeurs ne peuvent être
+    // retirées : l'intervalle et le nombre de valeurs distinctes sont une borne supérieure, et
+    // les valeurs nulles ne sont pas recomptées.
+    void updateColumn(const RoktRowStore &store, const std::string &field, const std::vector<size_t> &rows);
+
+    // Empreinte stable d'une valeur du ruban, utilisée pour l'estimation des valeurs distinctes
+    static uint64_t valueHash(const RoktRowStore &store, size_t pos);
+
+    nlohmann::json toJson() const;
+    // Renvoie false si le manifeste est invalide
+    bool fromJson(const nlohmann::json &manifest);
+};
+
+#endif // ROKTSTATS_H
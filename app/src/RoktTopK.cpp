@@ -0,0 +1,97 @@
+// RoktTopK.cpp
+#include "RoktTopK.h"
+#include <algorithm>
+
+RoktTopK::RoktTopK(const std::string &orderKey, bool desc, size_t limit, size_t partitions)
+    : orderKey(orderKey), desc(desc), limit(limit), partitions(std::max<size_t>(partitions, 1)) {}
+
+RoktSortKey RoktSortKey::fromTape(const RoktRowStore &store, size_t pos) {
+    RoktSortKey key;
+    if (store.isNumber(pos)) {
+        key.numeric = true;
+        key.value = store.number(pos);
+        key.number = store.materializeValue<nlohmann::json>(pos);
+    } else if (store.tag(pos) == RoktRowStore::TAG_STRING) {
+        std::string_view str = store.string(pos);
+        bool needsEscape = std::any_of(str.begin(), str.end(), [](char c) {
+            return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+        });
+        if (needsEscape) {
+            key.text = nlohmann::json(std::string(str)).dump();
+        } else {
+            key.text.reserve(str.size() + 2);
+            key.text.append(1, '"').append(str).append(1, '"');
+        }
+    } else {
+        key.text = store.materializeValue<nlohmann::json>(pos).dump();
+    }
+    return key;
+}
+
+bool RoktSortKey::less(const RoktSortKey &a, const RoktSortKey &b) {
+    if (a.numeric && b.numeric)
+        return a.value < b.value;
+    return (a.numeric ? a.number.dump() : a.text) < (b.numeric ? b.number.dump() : b.text);
+}
+
+bool RoktTopK::before(const Entry &a, const Entry &b) const {
+    if (desc ? RoktSortKey::less(b.key, a.key) : RoktSortKey::less(a.key, b.key))
+        return true;
+    if (desc ? RoktSortKey::less(a.key, b.key) : RoktSortKey::less(b.key, a.key))
+        return false;
+    return a.sequence < b.sequence;
+}
+
+bool RoktTopK::offer(const RoktScanRow &row) {
+    Partition &partition = partitions[row.partition];
+    if (!partition.path)
+        partition.path = std::make_unique<RoktFieldPath>(orderKey, row.store.dictionary());
+    size_t pos = partition.path->lookup(row.store, row.row);
+    if (pos == RoktRowStore::npos || row.store.tag(pos) == RoktRowStore::TAG_NULL) {
+        partition.ignored++;
+        return true;
+    }
+
+    // Clé de tri calculée une fois par ligne, avant toute conversion de la ligne
+    Entry entry{RoktSortKey::fromTape(row.store, pos), row.sequence, nullptr};
+
+    auto worse = [this](const Entry &a, const Entry &b) { return before(a, b); };
+    if (limit > 0 && partition.heap.size() >= limit) {
+        // Tas plein : la ligne ne remplace la moins bonne que si elle la précède
+        if (!before(entry, partition.heap.front()))
+            return true;
+        std::pop_heap(partition.heap.begin(), partition.heap.end(), worse);
+        entry.row = row.store.materialize<ROKT::ArenaJson>(row.row);
+        partition.heap.back() = std::move(entry);
+        std::push_heap(partition.heap.begin(), partition.heap.end(), worse);
+        return true;
+    }
+    entry.row = row.store.materialize<ROKT::ArenaJson>(row.row);
+    partition.heap.push_back(std::move(entry));
+    if (limit > 0)
+        std::push_heap(partition.heap.begin(), partition.heap.end(), worse);
+    return true;
+}
+
+ROKT::ArenaJson RoktTopK::finish(int *ignoredCount) {
+    std::vector<Entry> merged;
+    *ignoredCount = 0;
+    for (auto &partition : partitions) {
+        *ignoredCount += partition.ignored;
+        for (auto &entry : partition.heap)
+            merged.push_back(std::move(entry));
+        partition.heap.clear();
+    }
+    auto ordered = [this](const Entry &a, const Entry &b) { return before(a, b); };
+    if (limit > 0 && merged.size() > limit) {
+        std::partial_sort(merged.begin(), merged.begin() + limit, merged.end(), ordered);
+        merged.resize(limit);
+    } else {
+        std::sort(merged.begin(), merged.end(), ordered);
+    }
+    ROKT::ArenaJson result = ROKT::ArenaJson::array();
+    result.get_ref<ROKT::ArenaJson::array_t &>().reserve(merged.size());
+    for (auto &entry : merged)
+        result.push_back(std::move(entry.row));
+    return result;
+}
@@ -0,0 +1,89 @@
+#ifndef ROKTTOPK_H
+#define ROKTTOPK_H
+
+#include "RoktRowStore.h"
+#include "RequestArena.h"
+#include <memory>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+/**
+ * @brief Clé de comparaison d'une valeur du ruban, calculée une seule fois.
+ *
+ * Reprend l'ordre historique d'ORDER BY : deux nombres sont comparés numériquement, sinon les
+ * formes JSON des valeurs sont comparées.
+ */
+struct RoktSortKey {
+    bool numeric = false;
+    double value = 0.0;
+    nlohmann::json number;  // valeur numérique d'origine (sa forme JSON sert aux comparaisons mixtes)
+    std::string text;       // forme JSON des valeurs non numériques
+
+    static RoktSortKey fromTape(const RoktRowStore &store, size_t pos);
+    // Clé d'une valeur JSON (nlohmann::json ou ROKT::ArenaJson), sans conversion intermédiaire
+    template <typename BasicJsonType>
+    static RoktSortKey fromJson(const BasicJsonType &value);
+    static bool less(const RoktSortKey &a, const RoktSortKey &b);
+    // Valeur d'origine
+    nlohmann::json toJson() const { return numeric ? number : nlohmann::json::parse(text); }
+};
+
+template <typename BasicJsonType>
+RoktSortKey RoktSortKey::fromJson(const BasicJsonType &value) {
+    RoktSortKey key;
+    if (value.is_number()) {
+        key.numeric = true;
+        key.value = value.template get<double>();
+        if (value.is_number_unsigned())
+            key.number = value.template get<uint64_t>();
+        else if (value.is_number_integer())
+            key.number = value.template get<int64_t>();
+        else
+            key.number = key.value;
+    } else {
+        key.text = value.dump();
+    }
+    return key;
+}
+
+/**
+ * @brief Opérateur ORDER BY [... LIMIT] appliqué pendant le parcours.
+ *
+ * La clé de tri de chaque ligne est calculée une seule fois, directement sur le ruban. Avec un
+ * LIMIT, chaque partition du parcours ne conserve que les `limit` meilleures lignes dans un tas
+ * borné : seules ces lignes sont converties en JSON. Les tas des partitions sont fusionnés à la
+ * fin. L'ordre est celui de l'ancien tri (nombres comparés entre eux, sinon forme JSON), les
+ * égalités étant départagées par l'ordre des lignes dans le dataset.
+ */
+class RoktTopK {
+private:
+    struct Entry {
+        RoktSortKey key;
+        size_t sequence;
+        ROKT::ArenaJson row;
+    };
+    struct Partition {
+        std::unique_ptr<RoktFieldPath> path;
+        std::vector<Entry> heap;  // tas dont le sommet est la moins bonne ligne conservée
+        int ignored = 0;
+    };
+
+    std::string orderKey;
+    bool desc;
+    size_t limit;  // 0 : pas de limite
+    std::vector<Partition> partitions;
+
+    // Vrai si `a` précède `b` dans le résultat
+    bool before(const Entry &a, const Entry &b) const;
+
+public:
+    RoktTopK(const std::string &orderKey, bool desc, size_t limit, size_t partitions);
+    // Prend en compte une ligne retenue par le parcours ; sûr entre partitions distinctes
+    bool offer(const RoktScanRow &row);
+    // Fusionne les partitions : renvoie les lignes triées et le nombre de lignes ignorées
+    // (champ absent ou null)
+    ROKT::ArenaJson finish(int *ignoredCount);
+};
+
+#endif // ROKTTOPK_H
@@ -0,0 +1,451 @@
+// RoktTransfer.cpp
+#include "RoktTransfer.h"
+#include "RoktDataset.h"
+#include "RoktRowStore.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <unordered_set>
+
+#define IMPORT_MIN_PART_BYTES (1024 * 1024)  // taille minimale d'une part analysée par un thread
+
+namespace {
+    // Part d'une tranche, analysée par un thread ; les numéros de ligne sont relatifs à la part
+    struct Part {
+        std::string_view data;
+        std::vector<nlohmann::json> rows;
+        std::vector<std::pair<uint64_t, std::string>> errors;
+        uint64_t rejected = 0;
+        uint64_t lines = 0;
+    };
+
+    void reject(Part &part, uint64_t line, const char *reason) {
+        if (part.errors.size() < IMPORT_MAX_REPORTED_ERRORS)
+            part.errors.emplace_back(line, reason);
+        part.rejected++;
+    }
+
+    void parseNdjson(Part &part) {
+        std::string_view data = part.data;
+        size_t pos = 0;
+        while (pos < data.size()) {
+            size_t end = data.find('\n', pos);
+            if (end == std::string_view::npos)
+                end = data.size();
+            std::string_view line = data.substr(pos, end - pos);
+            pos = end + 1;
+            uint64_t index = part.lines++;
+            size_t first = line.find_first_not_of(" \t\r");
+            if (first == std::string_view::npos)
+                continue;
+            nlohmann::json row = nlohmann::json::parse(line.begin() + first, line.end(), nullptr, false);
+            if (row.is_discarded())
+                reject(part, index, "JSON invalide");
+            else if (!row.is_object())
+                reject(part, index, "Ligne qui n'est pas un objet JSON");
+            else
+                part.rows.push_back(std::move(row));
+        }
+    }
+
+    // Lit un enregistrement CSV à partir de `pos` (champs entre guillemets avec "" pour un
+    // guillemet, fins de ligne possibles à l'intérieur) ; renvoie le nombre de fins de ligne lues
+    size_t readCsvRecord(std::string_view data, size_t &pos, std::vector<std::string> &fields, std::vector<bool> &quoted) {
+        fields.assign(1, std::string());
+        quoted.assign(1, false);
+        size_t newlines = 0;
+        bool inQuotes = false;
+        while (pos < data.size()) {
+            char c = data[pos++];
+            if (inQuotes) {
+                if (c == '"') {
+                    if (pos < data.size() && data[pos] == '"')
+                        fields.back() += data[pos++];
+                    else
+                        inQuotes = false;
+                } else {
+                    newlines += c == '\n' ? 1 : 0;
+                    fields.back() += c;
+                }
+            } else if (c == '"') {
+                inQuotes = true;
+                quoted.back() = true;
+            } else if (c == ',') {
+                fields.emplace_back();
+                quoted.push_back(false);
+            } else if (c == '\n') {
+                newlines++;
+                break;
+            } else if (c != '\r') {
+                fields.back() += c;
+            }
+        }
+        return newlines;
+    }
+
+    // Vrai si le texte entier est un nombre JSON, précédé au plus d'un signe : les zéros en tête
+    // ("01234"), l'hexadécimal, "inf" ou "nan" ne sont pas des nombres (identifiants, codes postaux)
+    bool isCsvNumber(const std::string &field) {
+        size_t i = field[0] == '-' || field[0] == '+' ? 1 : 0;
+        auto digits = [&]() {
+            size_t start = i;
+            while (i < field.size() && std::isdigit(static_cast<unsigned char>(field[i])))
+                i++;
+            return i - start;
+        };
+        if (i < field.size() && field[i] == '0')
+            i++;
+        else if (digits() == 0)
+            return false;
+        if (i < field.size() && field[i] == '.') {
+            i++;
+            if (digits() == 0)
+                return false;
+        }
+        if (i < field.size() && (field[i] == 'e' || field[i] == 'E')) {
+            i++;
+            if (i < field.size() && (field[i] == '-' || field[i] == '+'))
+                i++;
+            if (digits() == 0)
+                return false;
+        }
+        return i == field.size();
+    }
+
+    // Valeur d'une cellule : une chaîne si elle était entre guillemets, sinon un booléen, null ou
+    // un nombre quand le texte entier en est un, une chaîne à défaut
+    nlohmann::json csvValue(const std::string &field, bool quoted) {
+        if (quoted)
+            return field;
+        if (field == "true")
+            return true;
+        if (field == "false")
+            return false;
+        if (field == "null")
+            return nullptr;
+        if (!field.empty() && isCsvNumber(field)) {
+            const char *text = field.c_str();
+            char *end = nullptr;
+            errno = 0;
+            long long integer = std::strtoll(text, &end, 10);
+            if (*end == '\0' && errno == 0)
+                return static_cast<int64_t>(integer);
+            errno = 0;
+            double number = std::strtod(text, &end);
+            if (*end == '\0' && errno == 0)
+                return number;
+        }
+        return field;
+    }
+
+    void parseCsv(Part &part, const std::vector<std::string> &header) {
+        std::vector<std::string> fields;
+        std::vector<bool> quoted;
+        size_t pos = 0;
+        while (pos < part.data.size()) {
+            size_t newlines = readCsvRecord(part.data, pos, fields, quoted);
+            // Les erreurs portent le numéro de la première ligne de l'enregistrement
+            uint64_t line = part.lines;
+            part.lines += std::max<size_t>(newlines, 1);
+            if (fields.size() == 1 && fields[0].empty() && !quoted[0])
+                continue;
+            if (fields.size() > header.size()) {
+                reject(part, line, "Plus de valeurs que de colonnes");
+                continue;
+            }
+            nlohmann::json row = nlohmann::json::object();
+            for (size_t i = 0; i < fields.size(); i++) {
+                // Une cellule vide hors guillemets correspond à un champ absent
+                if (!fields[i].empty() || quoted[i])
+                    row[header[i]] = csvValue(fields[i], quoted[i]);
+            }
+            part.rows.push_back(std::move(row));
+        }
+    }
+
+    // Fin du dernier enregistrement complet de `data` et bornes de `parts` parts de tailles
+    // voisines, chacune terminée par une fin de ligne (hors guillemets en CSV)
+    size_t splitParts(std::string_view data, bool csv, bool atEnd, size_t parts, std::vector<size_t> *bounds) {
+        std::vector<size_t> targets;
+        for (size_t k = 1; k < parts; k++)
+            targets.push_back(data.size() * k / parts);
+        size_t complete = 0;
+        size_t next = 0;
+        if (csv) {
+            bool inQuotes = false;
+            for (size_t i = 0; i < data.size(); i++) {
+                char c = data[i];
+                if (c == '"') {
+                    inQuotes = !inQuotes;
+                } else if (c == '\n' && !inQuotes) {
+                    complete = i + 1;
+                    while (next < targets.size() && targets[next] <= i) {
+                        bounds->push_back(complete);
+                        next++;
+                    }
+                }
+            }
+        } else {
+            size_t last = data.rfind('\n');
+            complete = last == std::string_view::npos ? 0 : last + 1;
+            for (size_t target : targets) {
+                size_t end = data.find('\n', target);
+                if (end == std::string_view::npos || end + 1 > complete)
+                    break;
+                bounds->push_back(end + 1);
+            }
+        }
+        if (atEnd)
+            complete = data.size();
+        // Bornes au-delà du dernier enregistrement complet ou en double retirées
+        bounds->erase(std::remove_if(bounds->begin(), bounds->end(), [&](size_t bound) { return bound >= complete; }), bounds->end());
+        bounds->erase(std::unique(bounds->begin(), bounds->end()), bounds->end());
+        bounds->push_back(complete);
+        return complete;
+    }
+
+    void writeCsvString(std::string &out, const std::string &value) {
+        out += '"';
+        for (char c : value) {
+            if (c == '"')
+                out += '"';
+            out += c;
+        }
+        out += '"';
+    }
+}
+
+bool RoktTransfer::parseFormat(std::string_view name, Format *format) {
+    std::string upper(name);
+    std::transform(upper.begin(), upper.end(), upper.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+    if (upper == "NDJSON" || upper == "JSONL")
+        *format = Format::NDJSON;
+    else if (upper == "CSV")
+        *format = Format::CSV;
+    else
+        return false;
+    return true;
+}
+
+RoktTransfer::Format RoktTransfer::formatOf(const std::string &path) {
+    std::string extension = std::filesystem::path(path).extension().string();
+    Format format = Format::NDJSON;
+    parseFormat(extension.empty() ? extension : extension.substr(1), &format);
+    return format;
+}
+
+bool RoktTransfer::resolvePath(const std::string &directory, const std::string &name, std::string *path, std::string *error) {
+    std::filesystem::path relative(name);
+    bool escapes = name.empty() || relative.is_absolute() || relative.has_root_name();
+    for (const auto &component : relative)
+        escapes = escapes || component == "..";
+    if (escapes) {
+        *error = "Chemin invalide : '" + name + "' doit être relatif au répertoire d'échange, sans '..'.";
+        return false;
+    }
+    *path = (std::filesystem::path(directory) / relative).string();
+    return true;
+}
+
+bool RoktTransfer::importFile(const std::string &path, Format format, size_t threads,
+                              const std::function<bool(std::vector<nlohmann::json> &rows)> &onRows, RoktTransferResult *result,
+                              std::string *error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        *error = "Fichier introuvable : " + path;
+        return false;
+    }
+    bool csv = format == Format::CSV;
+    std::vector<std::string> header;
+    std::string buffer;
+    uint64_t line = 1;  // numéro de la première ligne de la tranche
+    bool atEnd = false;
+    while (!atEnd) {
+        // Lecture de la tranche suivante, à la suite de l'enregistrement incomplet de la précédente
+        size_t carried = buffer.size();
+        buffer.resize(carried + IMPORT_WAVE_BYTES);
+        file.read(&buffer[carried], IMPORT_WAVE_BYTES);
+        buffer.resize(carried + static_cast<size_t>(file.gcount()));
+        result->bytes += static_cast<uint64_t>(file.gcount());
+        atEnd = file.eof() || file.gcount() == 0;
+
+        // Marque d'ordre des octets UTF-8 éventuelle en tête du fichier
+        if (result->bytes == buffer.size() && buffer.compare(0, 3, "\xEF\xBB\xBF") == 0)
+            buffer.erase(0, 3);
+        std::string_view data(buffer);
+        size_t parts = std::max<size_t>(1, std::min(threads, data.size() / IMPORT_MIN_PART_BYTES));
+        std::vector<size_t> bounds;
+        size_t complete = splitParts(data, csv, atEnd, parts, &bounds);
+        // Enregistrement plus grand qu'une tranche : la lecture continue
+        if (complete == 0 && !atEnd)
+            continue;
+        size_t begin = 0;
+        if (csv && header.empty()) {
+            std::vector<bool> quoted;
+            line += readCsvRecord(data, begin, header, quoted);
+            if (header.size() == 1 && header[0].empty()) {
+                *error = "En-tête CSV manquant.";
+                return false;
+            }
+        }
+
+        std::vector<Part> partsData;
+        for (size_t end : bounds) {
+            if (end <= begin)
+                continue;
+            Part part;
+            part.data = data.substr(begin, end - begin);
+            partsData.push_back(std::move(part));
+            begin = end;
+        }
+        auto run = [&](size_t index) {
+            if (csv)
+                parseCsv(partsData[index], header);
+            else
+                parseNdjson(partsData[index]);
+        };
+        std::vector<std::thread> workers;
+        for (size_t index = 1; index < partsData.size(); index++)
+            workers.emplace_back(run, index);
+        if (!partsData.empty())
+            run(0);
+        for (auto &worker : workers)
+            worker.join();
+
+        // Lignes rassemblées dans l'ordre du fichier
+        std::vector<nlohmann::json> rows;
+        size_t total = 0;
+        for (const auto &part : partsData)
+            total += part.rows.size();
+        rows.reserve(total);
+        for (auto &part : partsData) {
+            for (auto &row : part.rows)
+                rows.push_back(std::move(row));
+            for (const auto &failure : part.errors) {
+                if (result->errors.size() < IMPORT_MAX_REPORTED_ERRORS)
+                    result->errors.push_back({{"line", line + failure.first}, {"reason", failure.second}});
+            }
+            result->rejected += part.rejected;
+            line += part.lines;
+        }
+        partsData.clear();
+        if (!rows.empty()) {
+            if (!onRows(rows))
+                return false;
+            result->rows += rows.size();
+        }
+        buffer.erase(0, complete);
+    }
+    return true;
+}
+
+std::unique_ptr<ROKT::ResponseObject> RoktTransfer::exportDataset(RoktDataset &dataset, const std::vector<Condition> &where,
+                                                                  Format format, const std::string &path, RoktTransferResult *result) {
+    std::error_code ec;
+    std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty())
+        std::filesystem::create_directories(parent, ec);
+    // Écrit dans un fichier temporaire : un export interrompu ne remplace pas le précédent
+    std::string temporary = path + ".tmp";
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return ROKT::ResponseService::response(1, "Impossible d'écrire le fichier : " + path);
+    std::string buffer;
+    auto flush = [&]() {
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        result->bytes += buffer.size();
+        buffer.clear();
+    };
+
+    bool scanned;
+    if (format == Format::NDJSON) {
+        scanned = dataset.scanRows(where, 1, [&](const RoktScanRow &row) {
+            buffer += row.store.materialize<nlohmann::json>(row.row).dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+            buffer += '\n';
+            result->rows++;
+            if (buffer.size() >= EXPORT_FLUSH_BYTES)
+                flush();
+            return true;
+        });
+    } else {
+        // Premier parcours : champs de premier niveau des lignes exportées, dans l'ordre de leur
+        // apparition (le dictionnaire connaît aussi les champs des lignes écartées ou supprimées)
+        std::vector<std::string> columns;
+        std::unordered_set<std::string> columnNames;
+        const RoktRowStore *seenStore = nullptr;
+        std::vector<bool> seenKeys;  // clés déjà vues, par identifiant dans `seenStore`
+        scanned = dataset.scanRows(where, 1, [&](const RoktScanRow &row) {
+            if (&row.store != seenStore) {
+                seenStore = &row.store;
+                seenKeys.clear();
+            }
+            size_t root = row.store.rowPosition(row.row);
+            if (row.store.tag(root) != RoktRowStore::TAG_OBJECT)
+                return true;
+            for (size_t i = 0; i < row.store.count(root); i++) {
+                uint32_t key = row.store.entryKey(root, i);
+                if (key < seenKeys.size() && seenKeys[key])
+                    continue;
+                if (key >= seenKeys.size())
+                    seenKeys.resize(key + 1, false);
+                seenKeys[key] = true;
+                // Une clé contenant un '.' n'est pas adressable par un chemin
+                const std::string &name = row.store.dictionary().name(key);
+                if (name.find('.') == std::string::npos && columnNames.insert(name).second)
+                    columns.push_back(name);
+            }
+            return true;
+        });
+        for (size_t i = 0; i < columns.size(); i++) {
+            buffer += i > 0 ? "," : "";
+            writeCsvString(buffer, columns[i]);
+        }
+        // Second parcours : chaque cellule est lue directement sur le ruban
+        std::vector<std::unique_ptr<RoktFieldPath>> paths;
+        if (scanned && !columns.empty()) {
+            buffer += '\n';
+            scanned = dataset.scanRows(where, 1, [&](const RoktScanRow &row) {
+                if (paths.empty()) {
+                    for (const auto &column : columns)
+                        paths.push_back(std::make_unique<RoktFieldPath>(column, row.store.dictionary()));
+                }
+                for (size_t i = 0; i < paths.size(); i++) {
+                    if (i > 0)
+                        buffer += ',';
+                    size_t pos = paths[i]->lookup(row.store, row.row);
+                    if (pos == RoktRowStore::npos)
+                        continue;
+                    nlohmann::json value = row.store.materializeValue<nlohmann::json>(pos);
+                    if (value.is_string())
+                        writeCsvString(buffer, value.get_ref<const std::string &>());
+                    else if (value.is_structured())
+                        writeCsvString(buffer, value.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace));
+                    else
+                        buffer += value.dump();
+                }
+                buffer += '\n';
+                result->rows++;
+                if (buffer.size() >= EXPORT_FLUSH_BYTES)
+                    flush();
+                return true;
+            });
+        }
+    }
+    flush();
+    out.close();
+    if (!scanned || !out) {
+        std::filesystem::remove(temporary, ec);
+        return ROKT::ResponseService::response(1, scanned ? "Impossible d'écrire le fichier : " + path : "Can't read dataset");
+    }
+    std::filesystem::rename(temporary, path, ec);
+    if (ec) {
+        std::filesystem::remove(temporary, ec);
+        return ROKT::ResponseService::response(1, "Impossible de renommer le fichier : " + path);
+    }
+    return ROKT::ResponseService::response(0, "OK");
+}
@@ -0,0 +1,67 @@
+#ifndef ROKTTRANSFER_H
+#define ROKTTRANSFER_H
+
+#include "ConditionUtils.h"
+#include "RoktResponseObject.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+class RoktDataset;
+
+#define IMPORT_WAVE_BYTES (64 * 1024 * 1024)  // octets du fichier lus puis analysés en parallèle à la fois
+#define IMPORT_MAX_REPORTED_ERRORS 1000       // erreurs détaillées au plus dans la réponse d'IMPORT
+#define EXPORT_FLUSH_BYTES (1024 * 1024)      // taille du tampon d'écriture d'EXPORT
+
+// Bilan d'un IMPORT ou d'un EXPORT
+struct RoktTransferResult {
+    uint64_t rows = 0;      // lignes importées ou exportées
+    uint64_t rejected = 0;  // lignes du fichier écartées (IMPORT)
+    uint64_t bytes = 0;     // octets lus ou écrits
+    nlohmann::json errors = nlohmann::json::array();  // [{"line", "reason"}, ...]
+};
+
+/**
+ * @brief Import et export de datasets depuis et vers des fichiers NDJSON ou CSV du serveur.
+ *
+ * L'import lit le fichier par tranches de IMPORT_WAVE_BYTES ; chaque tranche est découpée en
+ * parts terminées par une fin de ligne (hors guillemets pour le CSV), analysées en parallèle,
+ * puis transmise en un seul bloc de lignes, dans l'ordre du fichier : le dataset est écrit une
+ * fois par tranche, statistiques et vues comprises.
+ *
+ * L'export parcourt le dataset en flux (scanRows) : une ligne est convertie à la fois et écrite
+ * dans un fichier temporaire, renommé à la fin. En CSV, l'en-tête reprend les champs de premier
+ * niveau des lignes exportées ; les chaînes sont toujours entre guillemets, une cellule vide
+ * signale un champ absent, un objet ou un tableau est écrit sous forme de texte JSON (relu
+ * comme une chaîne).
+ */
+class RoktTransfer {
+public:
+    enum class Format { NDJSON, CSV };
+
+    // "NDJSON" ou "CSV", quelle que soit la casse
+    static bool parseFormat(std::string_view name, Format *format);
+    // Format déduit de l'extension du fichier (.csv : CSV, sinon NDJSON)
+    static Format formatOf(const std::string &path);
+    // Chemin d'un fichier relatif au répertoire d'échange ; un chemin absolu ou contenant '..'
+    // est refusé
+    static bool resolvePath(const std::string &directory, const std::string &name, std::string *path, std::string *error);
+
+    /**
+     * @brief Lit et analyse le fichier ; `onRows` reçoit les lignes valides de chaque tranche et
+     * renvoie false pour arrêter (échec de l'écriture).
+     */
+    static bool importFile(const std::string &path, Format format, size_t threads,
+                           const std::function<bool(std::vector<nlohmann::json> &rows)> &onRows, RoktTransferResult *result,
+                           std::string *error);
+
+    // Écrit les lignes du dataset vérifiant `where` dans le fichier ; statut 0 si l'export a abouti
+    static std::unique_ptr<ROKT::ResponseObject> exportDataset(RoktDataset &dataset, const std::vector<Condition> &where, Format format,
+                                                               const std::string &path, RoktTransferResult *result);
+};
+
+#endif // ROKTTRANSFER_H
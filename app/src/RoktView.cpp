@@ -0,0 +1,181 @@
+// RoktView.cpp
+#include "RoktView.h"
+#include <climits>
+
+RoktView::RoktView(const std::string &name, const std::string &source, const std::shared_ptr<const RoktCommand> &definition,
+                   std::shared_ptr<RoktDataset> storage)
+    : name(name), source(source), definition(definition->getSource()), query(definition->as<RoktGetQuery>()),
+      storage(std::move(storage)), ready(false) {}
+
+bool RoktView::validate(const RoktCommand &definition, std::string *error) {
+    if (definition.getKind() != RoktCommand::Kind::GET) {
+        *error = "Une vue est définie par 'GET <agrégats> IN <dataset> [WHERE ...] [GROUP BY <clé>]'.";
+        return false;
+    }
+    const RoktGetQuery &query = definition.as<RoktGetQuery>();
+    if (query.aggregates.empty()) {
+        *error = "Une vue doit calculer des agrégats (COUNT, SUM, AVG, MIN, MAX).";
+        return false;
+    }
+    if (!query.orderByKey.empty() || query.limit >= 0 || !query.alias.empty()) {
+        *error = "ORDER BY, LIMIT et AS ne sont pas acceptés dans une vue.";
+        return false;
+    }
+    // Un ensemble de valeurs distinctes ne se met pas à jour au retrait d'une ligne sans
+    // conserver chaque occurrence, et un estimateur HyperLogLog pas du tout
+    for (const auto &aggregate : query.aggregates) {
+        if (aggregate.function == RoktAggregator::Function::COUNT_DISTINCT ||
+            aggregate.function == RoktAggregator::Function::APPROX_COUNT_DISTINCT) {
+            *error = "COUNT(DISTINCT) et APPROX_COUNT_DISTINCT ne sont pas acceptés dans une vue.";
+            return false;
+        }
+    }
+    return true;
+}
+
+void RoktView::reset() {
+    groups.clear();
+    ready = true;
+}
+
+void RoktView::invalidate() {
+    groups.clear();
+    ready = false;
+}
+
+RoktView::Binding RoktView::bind(const RoktRowStore &store) const {
+    Binding binding;
+    binding.predicate = std::make_unique<RoktPredicate>(query.conditions, store.dictionary());
+    binding.groupPath = query.groupByKey.empty() ? nullptr : std::make_unique<RoktFieldPath>(query.groupByKey, store.dictionary());
+    for (auto &aggregate : query.aggregates) {
+        binding.paths.push_back(aggregate.field.empty() ? nullptr : std::make_unique<RoktFieldPath>(aggregate.field, store.dictionary()));
+    }
+    return binding;
+}
+
+void RoktView::accumulate(Accumulator &acc, const RoktAggregator::Aggregate &aggregate, const RoktRowStore &store, size_t pos, int sign) {
+    bool present = pos != RoktRowStore::npos && store.tag(pos) != RoktRowStore::TAG_NULL;
+    switch (aggregate.function) {
+        case RoktAggregator::Function::COUNT:
+            if (aggregate.field.empty() || present)
+                acc.count += sign;
+            break;
+        case RoktAggregator::Function::SUM:
+        case RoktAggregator::Function::AVG: {
+            if (!present || !store.isNumber(pos))
+                break;
+            acc.count += sign;
+            acc.sum += sign * store.number(pos);
+            nlohmann::json value = store.materializeValue<nlohmann::json>(pos);
+            if (!value.is_number_integer() || (value.is_number_unsigned() && value.get<uint64_t>() > static_cast<uint64_t>(INT64_MAX)))
+                acc.nonIntegral += sign;
+            else if (__builtin_add_overflow(acc.integerSum, sign * value.get<int64_t>(), &acc.integerSum))
+                acc.overflow = true;
+            break;
+        }
+        case RoktAggregator::Function::MIN:
+        case RoktAggregator::Function::MAX: {
+            if (!present)
+                break;
+            RoktSortKey key = RoktSortKey::fromTape(store, pos);
+            if (sign > 0) {
+                acc.values[key]++;
+            } else {
+                auto it = acc.values.find(key);
+                if (it != acc.values.end() && --it->second == 0)
+                    acc.values.erase(it);
+            }
+            break;
+        }
+        case RoktAggregator::Function::COUNT_DISTINCT:
+        case RoktAggregator::Function::APPROX_COUNT_DISTINCT:
+            break;  // refusés par validate()
+    }
+}
+
+void RoktView::apply(Binding &bound, const RoktRowStore &store, size_t row, int sign) {
+    bool matches = true;
+    if (!bound.predicate->matches(store, row, &matches) || !matches)
+        return;
+    keyBuffer.clear();
+    if (bound.groupPath)
+        RoktAggregator::groupKeyText(query.groupByKey, store, bound.groupPath->lookup(store, row), keyBuffer);
+    auto it = groups.find(keyBuffer);
+    if (it == groups.end()) {
+        if (sign < 0)
+            return;
+        it = groups.emplace(keyBuffer, Group()).first;
+        it->second.accumulators.resize(query.aggregates.size());
+    }
+    Group &group = it->second;
+    group.rows += sign;
+    for (size_t i = 0; i < query.aggregates.size(); i++) {
+        size_t pos = bound.paths[i] ? bound.paths[i]->lookup(store, row) : RoktRowStore::npos;
+        accumulate(group.accumulators[i], query.aggregates[i], store, pos, sign);
+    }
+    // Un groupe sans ligne disparaît, comme il serait absent d'un recalcul
+    if (group.rows <= 0)
+        groups.erase(it);
+}
+
+void RoktView::apply(const RoktRowStore &store, size_t begin, size_t end, int sign) {
+    Binding bound = bind(store);
+    for (size_t row = begin; row < end; row++)
+        apply(bound, store, row, sign);
+}
+
+void RoktView::apply(const RoktRowDelta &delta) {
+    apply(delta.removed, 0, delta.removed.size(), -1);
+    apply(delta.added, 0, delta.added.size(), 1);
+}
+
+// Même présentation que RoktAggregator::output
+nlohmann::json RoktView::output(const std::string &key, const Group *group) const {
+    nlohmann::json result = nlohmann::json::object();
+    if (!query.groupByKey.empty())
+        result[query.groupByKey] = nlohmann::json::parse(key);
+    for (size_t i = 0; i < query.aggregates.size(); i++) {
+        Accumulator empty;
+        const Accumulator &acc = group ? group->accumulators[i] : empty;
+        bool integral = acc.nonIntegral == 0 && !acc.overflow;
+        nlohmann::json &value = result[query.aggregates[i].label];
+        switch (query.aggregates[i].function) {
+            case RoktAggregator::Function::COUNT:
+                value = acc.count;
+                break;
+            case RoktAggregator::Function::SUM:
+                if (acc.count > 0)
+                    value = integral ? nlohmann::json(acc.integerSum) : nlohmann::json(acc.sum);
+                break;
+            case RoktAggregator::Function::AVG:
+                if (acc.count > 0)
+                    value = (integral ? static_cast<double>(acc.integerSum) : acc.sum) / static_cast<double>(acc.count);
+                break;
+            case RoktAggregator::Function::MIN:
+                if (!acc.values.empty())
+                    value = acc.values.begin()->first.toJson();
+                break;
+            case RoktAggregator::Function::MAX:
+                if (!acc.values.empty())
+                    value = acc.values.rbegin()->first.toJson();
+                break;
+            case RoktAggregator::Function::COUNT_DISTINCT:
+            case RoktAggregator::Function::APPROX_COUNT_DISTINCT:
+                break;
+        }
+    }
+    return result;
+}
+
+nlohmann::json RoktView::rows() const {
+    nlohmann::json result = nlohmann::json::array();
+    // Sans GROUP BY, la vue contient toujours une ligne (agrégats d'un ensemble vide compris)
+    if (query.groupByKey.empty()) {
+        auto it = groups.find("");
+        result.push_back(output("", it == groups.end() ? nullptr : &it->second));
+        return result;
+    }
+    for (const auto &group : groups)
+        result.push_back(output(group.first, &group.second));
+    return result;
+}
@@ -0,0 +1,101 @@
+#ifndef ROKTVIEW_H
+#define ROKTVIEW_H
+
+#include "RoktAggregate.h"
+#include "RoktCommand.h"
+#include "RoktRowStore.h"
+#include "RoktTopK.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+class RoktDataset;
+
+/**
+ * @brief Lignes retirées et ajoutées par une écriture (CHANGE, REMOVE), transmises aux vues
+ * matérialisées du dataset. Une ligne modifiée figure dans les deux stores.
+ */
+struct RoktRowDelta {
+    RoktRowStore removed;
+    RoktRowStore added;
+};
+
+/**
+ * @brief Vue matérialisée : résultat d'un GET d'agrégats [GROUP BY] sur un dataset, tenu à jour
+ * à chaque écriture au lieu d'être recalculé à chaque lecture.
+ *
+ * Chaque groupe conserve des accumulateurs réversibles : COUNT, SUM et AVG sont ajustés dans les
+ * deux sens, MIN et MAX conservent le nombre d'occurrences de chaque valeur pour retrouver la
+ * suivante quand la meilleure est retirée. Les lignes de la vue (une par groupe, avec la valeur
+ * de la clé et les agrégats) sont réécrites après chaque écriture dans un dataset ordinaire, lu
+ * comme tel par GET et COUNT. Les accumulateurs ne sont pas enregistrés : ils sont recalculés par un parcours
+ * complet du dataset source à la première écriture qui suit le démarrage du serveur.
+ *
+ * Les méthodes sont appelées verrou exclusif du dataset source pris.
+ */
+class RoktView {
+private:
+    struct Accumulator {
+        int64_t count = 0;
+        double sum = 0.0;
+        int64_t integerSum = 0;
+        int64_t nonIntegral = 0;   // valeurs non entières (ou hors de int64) additionnées
+        bool overflow = false;     // dépassement de integerSum depuis le dernier recalcul
+        std::map<RoktSortKey, uint64_t, bool (*)(const RoktSortKey &, const RoktSortKey &)> values{RoktSortKey::less};
+    };
+    struct Group {
+        int64_t rows = 0;
+        std::vector<Accumulator> accumulators;
+    };
+    // Chemins et prédicat compilés pour le dictionnaire d'un store
+    struct Binding {
+        std::unique_ptr<RoktPredicate> predicate;
+        std::unique_ptr<RoktFieldPath> groupPath;
+        std::vector<std::unique_ptr<RoktFieldPath>> paths;
+    };
+
+    std::string name;
+    std::string source;
+    std::string definition;  // texte du GET d'origine
+    RoktGetQuery query;
+    std::shared_ptr<RoktDataset> storage;
+    std::map<std::string, Group> groups;  // clé de groupe (forme JSON) -> accumulateurs
+    bool ready;
+    std::string keyBuffer;
+
+    Binding bind(const RoktRowStore &store) const;
+    void apply(Binding &bound, const RoktRowStore &store, size_t row, int sign);
+    void accumulate(Accumulator &acc, const RoktAggregator::Aggregate &aggregate, const RoktRowStore &store, size_t pos, int sign);
+    nlohmann::json output(const std::string &key, const Group *group) const;
+
+public:
+    RoktView(const std::string &name, const std::string &source, const std::shared_ptr<const RoktCommand> &definition,
+             std::shared_ptr<RoktDataset> storage);
+
+    // Vérifie qu'une commande peut définir une vue : GET d'agrégats, sans ORDER BY, LIMIT ni AS
+    static bool validate(const RoktCommand &definition, std::string *error);
+
+    const std::string &getName() const { return name; }
+    const std::string &getSource() const { return source; }
+    const std::string &getDefinition() const { return definition; }
+    // false tant que les accumulateurs n'ont pas été calculés depuis le démarrage
+    bool isReady() const { return ready; }
+
+    // Vide les accumulateurs avant un recalcul complet ; la vue est ensuite considérée à jour
+    void reset();
+    // Vide les accumulateurs après un recalcul impossible : la vue sera recalculée à la prochaine écriture
+    void invalidate();
+    // Prend en compte les lignes [begin, end) d'un store du dataset source : `sign` vaut 1 pour
+    // un ajout, -1 pour un retrait
+    void apply(const RoktRowStore &store, size_t begin, size_t end, int sign);
+    void apply(const RoktRowDelta &delta);
+    // Lignes de la vue, une par groupe (dans l'ordre des clés)
+    nlohmann::json rows() const;
+    // Dataset dans lequel les lignes de la vue sont écrites
+    const std::shared_ptr<RoktDataset> &getStorage() const { return storage; }
+};
+
+#endif // ROKTVIEW_H
@@ -1,4 +1,5 @@
 #include "CreateTableCommandHandler.h"
+#include "CreateViewCommandHandler.h"
 #include "AddCommandHandler.h"
 #include "GetCommandHandler.h"
 #include "RemoveCommandHandler.h"
@@ -6,13 +7,19 @@
 #include "DeleteCommandHandler.h"
 #include "ChangeCommandHandler.h"
 #include "CountCommandHandler.h"
+#include "StatsCommandHandler.h"
+#include "PrepareCommandHandler.h"
+#include "ExecuteCommandHandler.h"
+#include "ExplainCommandHandler.h"
+#include "TransferCommandHandler.h"
+#include "PreparedStatements.h"
 #include "LogService.h"
 #include "RoktResponseService.h"
 #include "RoktService.h"
 #include "Config.h"
 #include "EncryptService.h"
 #include "CommandHandler.h"
-#include "Utils.h"
+#include "RoktCommand.h"
 #include "SyncService.h"
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -24,6 +31,8 @@
 #include <sstream>
 #include <condition_variable>
 #include <mutex>
+#include <thread>
+#include <chrono>
 #include <unordered_map>
 #include <cerrno> // Pour strerror
 
@@ -35,7 +44,7 @@ std::condition_variable stop_condition;
 std::mutex stop_mutex;
 
 // Définition de la map pour associer les commandes aux handlers
-using HandlerMap = std::unordered_map<std::string, std::unique_ptr<CommandHandler>>;
+using HandlerMap = SyncService::HandlerMap;
 
 /**
  * @brief Gère les signaux d'arrêt (SIGINT, SIGTERM) pour un arrêt propre du serveur.
@@ -50,18 +59,40 @@ void signal_handler(int sig) {
 /**
  * @brief Crée et configure la map des handlers pour traiter les différentes commandes.
  * @param roktService Pointeur vers l'instance de RoktService utilisée par les handlers.
- * @return Une HandlerMap contenant les associations commande-handler.
+ * @param resultCache Cache de résultats dont les compteurs sont renvoyés par STATS.
+ * @param singleFlight Regroupement des lectures dont les compteurs sont renvoyés par STATS.
+ * @param preparedStatements Requêtes préparées par PREPARE et exécutées par EXECUTE.
+ * @return Une HandlerMap associant chaque type de commande à son handler.
  */
-HandlerMap createHandlerMap(RoktService* roktService) {
+HandlerMap createHandlerMap(RoktService* roktService, ResultCache* resultCache, SingleFlight* singleFlight,
+                            PreparedStatements* preparedStatements, ResponseCompression* compression,
+                            const std::string& transferDirectory) {
     HandlerMap handlers;
-    handlers["CREATE"] = std::make_unique<CreateTableCommandHandler>(roktService);
-    handlers["ADD"] = std::make_unique<AddCommandHandler>(roktService);
-    handlers["GET"] = std::make_unique<GetCommandHandler>(roktService);
-    handlers["REMOVE"] = std::make_unique<RemoveCommandHandler>(roktService);
-    handlers["EMPTY"] = std::make_unique<EmptyCommandHandler>(roktService);
-    handlers["DELETE"] = std::make_unique<DeleteCommandHandler>(roktService);
-    handlers["COUNT"] = std::make_unique<CountCommandHandler>(roktService);
-    handlers["CHANGE"] = std::make_unique<ChangeCommandHandler>(roktService);
+    handlers[RoktCommand::Kind::CREATE] = std::make_unique<CreateTableCommandHandler>(roktService);
+    handlers[RoktCommand::Kind::CREATE_VIEW] = std::make_unique<CreateViewCommandHandler>(roktService);
+    handlers[RoktCommand::Kind::ADD] = std::make_unique<AddCommandHandler>(roktService);
+    handlers[RoktCommand::Kind::BULK_ADD] = std::make_unique<AddCommandHandler>(roktService);
+    handlers[RoktCommand::Kind::IMPORT] = std::make_unique<TransferCommandHandler>(roktService, transferDirectory);
+    handlers[RoktCommand::Kind::EXPORT] = std::make_unique<TransferCommandHandler>(roktService, transferDirectory);
+    handlers[RoktCommand::Kind::GET] = std::make_unique<GetCommandHandler>(roktService);
+    handlers[RoktCommand::Kind::REMOVE] = std::make_unique<RemoveCommandHandler>(roktService);
+    handlers[RoktCommand::Kind::EMPTY] = std::make_unique<EmptyCommandHandler>(roktService);
+    handlers[RoktCommand::Kind::DELETE] = std::make_unique<DeleteCommandHandler>(roktService);
+    handlers[RoktCommand::Kind::COUNT] = std::make_unique<CountCommandHandler>(roktService);
+    handlers[RoktCommand::Kind::CHANGE] = std::make_unique<ChangeCommandHandler>(roktService);
+    handlers[RoktCommand::Kind::STATS] = std::make_unique<StatsCommandHandler>(roktService, resultCache, singleFlight, compression);
+    // Les handlers sont enregistrés pour PREPARE avant l'ajout de PREPARE/EXECUTE eux-mêmes
+    for (auto& entry : handlers)
+        preparedStatements->addHandler(entry.first, entry.second.get());
+    handlers[RoktCommand::Kind::PREPARE] = std::make_unique<PrepareCommandHandler>(roktService, preparedStatements);
+    handlers[RoktCommand::Kind::DEALLOCATE] = std::make_unique<PrepareCommandHandler>(roktService, preparedStatements);
+    handlers[RoktCommand::Kind::EXECUTE] = std::make_unique<ExecuteCommandHandler>(roktService, preparedStatements);
+    // EXPLAIN et PROFILE s'appliquent à toutes les autres commandes
+    auto explainHandler = std::make_unique<ExplainCommandHandler>(roktService);
+    for (auto& entry : handlers)
+        explainHandler->addHandler(entry.first, entry.second.get());
+    handlers[RoktCommand::Kind::PROFILE] = std::make_unique<ExplainCommandHandler>(*explainHandler);
+    handlers[RoktCommand::Kind::EXPLAIN] = std::move(explainHandler);
     return handlers;
 }
 
@@ -85,10 +116,20 @@ int main() {
 
     // Initialisation du service de chiffrement et de RoktService
     auto encryptService = std::make_shared<EncryptService>(config.encryption.passphrase, config.encryption.iv);
-    auto roktService = std::make_unique<RoktService>(".", encryptService);
+    auto roktService = std::make_unique<RoktService>(".", encryptService, config.storage, config.thread.scanThreads);
+
+    // Cache des réponses aux lectures (GET, COUNT), partagé par les workers
+    ResultCache resultCache(config.cache.maxBytes);
+    // Lectures identiques simultanées exécutées une seule fois
+    SingleFlight singleFlight;
+    // Requêtes préparées, partagées par toutes les connexions
+    PreparedStatements preparedStatements;
+    // Compression des réponses demandée par COMPRESS, et ses compteurs
+    ResponseCompression responseCompression(config.compression.minBytes, config.compression.level);
 
     // Création de la table de dispatch pour les handlers
-    HandlerMap handlers = createHandlerMap(roktService.get());
+    HandlerMap handlers = createHandlerMap(roktService.get(), &resultCache, &singleFlight, &preparedStatements, &responseCompression,
+                                           config.transfer.directory);
 
     // Création du socket serveur
     int server_fd = socket(AF_INET, SOCK_STREAM, 0);
@@ -138,15 +179,24 @@ int main() {
     LogService::log(startupMsg.str());
 
     // Démarrage du service de synchronisation avec la HandlerMap
-    SyncService syncService(server_fd, handlers, config.thread.maxWorkers, config.thread.maxTaskQueueSize);
-    syncService.start();
-
-    // Attente efficace de l'arrêt via condition variable
-    std::unique_lock<std::mutex> lk(stop_mutex);
-    stop_condition.wait(lk, [] { return !keep_running; });
+    SyncService syncService(server_fd, handlers, config.thread.maxWorkers, config.thread.maxTaskQueueSize, &resultCache, &singleFlight,
+                            &responseCompression);
+    // La boucle epoll tourne dans son propre thread : le thread principal attend le signal d'arrêt
+    std::thread eventLoop(&SyncService::start, &syncService);
+
+    // Attente de l'arrêt via condition variable (le drapeau est relu chaque seconde, la
+    // notification depuis le gestionnaire de signal pouvant être manquée)
+    {
+        std::unique_lock<std::mutex> lk(stop_mutex);
+        while (keep_running)
+            stop_condition.wait_for(lk, std::chrono::seconds(1));
+    }
 
     // Arrêt propre du service et fermeture du socket
     syncService.stop();
+    eventLoop.join();
+    // Les compactages en cours terminent leurs écritures avant la sortie
+    roktService->shutdown();
     LogService::log("Arrêt propre du serveur. Fermeture du socket principal.");
     close(server_fd);
 
@@ -53,6 +53,82 @@ class RoktClient {
         $this->close();
         return $response;
     }
+
+    // Envoie un GET ... STREAM : chaque bloc de lignes est transmis à $onRows dès sa réception,
+    // la réponse de fin (statut et résumé) est renvoyée.
+    public function streamCommand(string $command, callable $onRows): string {
+        $this->connect();
+        $command = rtrim($command);
+        if (socket_write($this->socket, $command, strlen($command)) === false) {
+            $this->close();
+            throw new Exception("Erreur d'écriture sur le socket : " . socket_strerror(socket_last_error($this->socket)));
+        }
+        $buffer = "";
+        while (true) {
+            // Erreur de syntaxe : réponse simple, sans blocs
+            if ($buffer !== "" && $buffer[0] === '{') break;
+            $eol = strpos($buffer, "\r\n");
+            if ($eol !== false) {
+                $size = hexdec(substr($buffer, 0, $eol));
+                if ($size === 0) {
+                    $buffer = substr($buffer, $eol + 2);
+                    break;
+                }
+                if (strlen($buffer) >= $eol + 2 + $size + 2) {
+                    $onRows(json_decode(substr($buffer, $eol + 2, $size), true));
+                    $buffer = substr($buffer, $eol + 2 + $size + 2);
+                    continue;
+                }
+            }
+            $out = socket_read($this->socket, 65536);
+            if ($out === false || $out === "") {
+                $this->close();
+                throw new Exception("Réponse interrompue par le serveur.");
+            }
+            $buffer .= $out;
+        }
+        while (($out = socket_read($this->socket, 65536)) !== false && $out !== "") {
+            $buffer .= $out;
+        }
+        $this->close();
+        return $buffer;
+    }
+
+    // Envoie un BULK ADD : les lignes de $rows (tableaux ou objets) sont transmises une par ligne
+    // au fil de l'itération, le serveur les écrit par lots de $batch lignes.
+    public function bulkAdd(string $dataset, iterable $rows, ?string $uniqueField = null, int $batch = 0): string {
+        $this->connect();
+        $header = "BULK ADD" . ($uniqueField !== null ? " UNIQUE " . $uniqueField : "") . " IN " . $dataset;
+        if ($batch > 0) {
+            $header .= " BATCH " . $batch;
+        }
+        $buffer = $header . "\n";
+        foreach ($rows as $row) {
+            $buffer .= json_encode($row) . "\n";
+            if (strlen($buffer) >= 65536) {
+                $this->writeAll($buffer);
+                $buffer = "";
+            }
+        }
+        $this->writeAll($buffer . "END\n");
+        $response = "";
+        while (($out = socket_read($this->socket, 65536)) !== false && $out !== "") {
+            $response .= $out;
+        }
+        $this->close();
+        return $response;
+    }
+
+    private function writeAll(string $data): void {
+        while ($data !== "") {
+            $written = socket_write($this->socket, $data, strlen($data));
+            if ($written === false) {
+                $this->close();
+                throw new Exception("Erreur d'écriture sur le socket : " . socket_strerror(socket_last_error()));
+            }
+            $data = substr($data, $written);
+        }
+    }
 }
 
 /**
@@ -178,6 +254,14 @@ class QueryBuilder {
         return $this;
     }
     
+    // Exécution par blocs : $onRows reçoit chaque tableau de lignes, la réponse de fin est renvoyée.
+    public function stream(callable $onRows, int $batch = 0): string {
+        $cmd = rtrim($this->command) . " STREAM" . ($batch > 0 ? " " . $batch : "") . ";";
+        $this->command = "";
+        $this->commandType = "";
+        return $this->client->streamCommand($cmd, $onRows);
+    }
+
     // Méthode d'exécution : envoie la commande construite au serveur.
     public function get(): string {
         // On termine toujours la commande par un point-virgule.
@@ -0,0 +1,1852 @@
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <csignal>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <random>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <arpa/inet.h>
+#include <zlib.h>
+
+namespace fs = std::filesystem;
+
+// Constantes pour le test
+const std::string SERVER_IP = "127.0.0.1";
+const int SERVER_PORT = 18090;           // port du serveur lancé par le test
+const int STARTUP_TIMEOUT_MS = 10000;    // attente maximale du démarrage du serveur
+const int RECEIVE_TIMEOUT_SEC = 30;      // attente maximale d'une réponse
+const int WAIT_TIMEOUT_MS = 20000;       // attente maximale d'un compactage en arrière-plan
+
+// Scénario "replay" : modifications journalisées puis relues après redémarrage
+const int REPLAY_ROWS = 200;
+// Scénario "fold" : les déchets doivent dépasser 1 Mio (COMPACTION_MIN_GARBAGE_BYTES) pour être compactés
+const int FOLD_ROWS = 20000;
+const int FOLD_CHANGES = 16;
+const uintmax_t COMPACTION_MIN_GARBAGE_BYTES = 1024 * 1024;
+// Scénario "lsm" : une memtable minuscule provoque un vidage tous les quelques ADD
+const int LSM_WRITERS = 4;
+const int LSM_ROWS_PER_WRITER = 1000;
+const int LSM_MAX_RUNS = 9;              // au plus 3 runs par niveau (LSM_RUNS_PER_LEVEL = 4) sur 3 niveaux
+// Scénario "stream" : la mémoire d'un GET ... STREAM ne doit pas croître avec le nombre de lignes
+const int STREAM_SMALL_ROWS = 50000;
+const int STREAM_LARGE_ROWS = 200000;
+const long long STREAM_MAX_EXTRA_KIB = 16 * 1024;  // écart toléré entre les deux pics de mémoire
+// Scénario "arène" : requêtes concurrentes de plusieurs clients
+const int ARENA_ROWS = 20000;
+const int ARENA_CLIENTS = 8;
+const int ARENA_ROUNDS = 25;
+// Scénario "top-K" : pages triées comparées à un tri complet
+const int TOPK_ROWS = 20000;
+// Scénario "agrégats" : agrégats de chaque groupe comparés à un calcul ligne à ligne
+const int AGGREGATE_ROWS = 30000;
+const int AGGREGATE_GROUPS = 7;
+// Scénario "COUNT" : statistiques comparées aux lignes lues
+const int STATS_ROWS = 300;
+// Scénario "single-flight" : vagues de lectures identiques lancées ensemble
+const int FLIGHT_ROWS = 50000;
+const int FLIGHT_CLIENTS = 8;
+const int FLIGHT_ROUNDS = 10;
+// Scénario "EXPLAIN" : lignes estimées d'après les statistiques
+const int PLAN_ROWS = 20000;
+// Scénario "vue" : agrégats de la vue comparés à ceux de la source
+const int VIEW_ROWS = 2000;
+const int VIEW_GROUPS = 5;
+// Scénario "JOIN" : lignes jointes comparées à une jointure imbriquée
+const int JOIN_CUSTOMERS = 200;
+const int JOIN_ORDERS = 5000;
+// Scénario "DISTINCT" : valeurs distinctes connues (nombres, dont des doubles égaux, et chaînes)
+const int DISTINCT_VALUES = 10000;
+const int DISTINCT_STRINGS = 100;
+// Scénario "compression" : réponse bien au-delà de compression.minBytes
+const int COMPRESS_ROWS = 5000;
+// Scénario "compteurs" : incréments concurrents sur une même ligne
+const int COUNTER_CLIENTS = 8;
+const int COUNTER_INCREMENTS = 50;
+const int ADD_BATCH_ROWS = 10000;        // lignes par ADD [...] lors du remplissage d'un dataset
+
+/**
+ * @brief Ouvre une connexion au serveur.
+ * @return Socket connectée, ou -1 en cas d'échec.
+ */
+int openConnection() {
+    int client_socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (client_socket < 0) return -1;
+
+    struct sockaddr_in server_addr;
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(SERVER_PORT);
+    server_addr.sin_addr.s_addr = inet_addr(SERVER_IP.c_str());
+
+    if (connect(client_socket, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
+        close(client_socket);
+        return -1;
+    }
+    struct timeval timeout = {RECEIVE_TIMEOUT_SEC, 0};
+    setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return client_socket;
+}
+
+/**
+ * @brief Lit la réponse du serveur jusqu'à la fermeture de la connexion, puis ferme la socket.
+ */
+std::string readResponse(int client_socket) {
+    std::string response;
+    char buffer[65536];
+    ssize_t bytes_received;
+    while ((bytes_received = recv(client_socket, buffer, sizeof(buffer), 0)) > 0) {
+        response.append(buffer, bytes_received);
+    }
+    close(client_socket);
+    return response;
+}
+
+/**
+ * @brief Envoie une commande au serveur et lit la réponse jusqu'à la fermeture de la connexion.
+ * @param command Commande à envoyer.
+ * @return Réponse du serveur ou chaîne vide en cas d'échec.
+ */
+std::string sendCommand(const std::string& command) {
+    int client_socket = openConnection();
+    if (client_socket < 0) return "";
+
+    if (send(client_socket, command.c_str(), command.size(), 0) < 0) {
+        close(client_socket);
+        return "";
+    }
+    return readResponse(client_socket);
+}
+
+/**
+ * @brief Supprime les blancs d'une réponse (les valeurs testées ne contiennent pas d'espace).
+ */
+std::string compact(const std::string& response) {
+    std::string out;
+    for (char c : response) {
+        if (c != ' ' && c != '\n' && c != '\r' && c != '\t') out.push_back(c);
+    }
+    return out;
+}
+
+/**
+ * @brief Lit l'entier qui suit `key` (par exemple "\"count\":") dans une réponse.
+ * @return La valeur, ou -1 si la clé est absente.
+ */
+long long numberAfter(const std::string& response, const std::string& key) {
+    std::string text = compact(response);
+    size_t pos = text.find(key);
+    if (pos == std::string::npos) return -1;
+    return std::atoll(text.c_str() + pos + key.size());
+}
+
+/**
+ * @brief Entiers renvoyés par GET <champ> : tableau "result" (avec WHERE) ou "datas" (sans WHERE).
+ */
+std::vector<long long> resultNumbers(const std::string& response) {
+    std::vector<long long> values;
+    std::string text = compact(response);
+    size_t pos = text.find("\"result\":[");
+    if (pos != std::string::npos) pos += 10;
+    else if ((pos = text.find("\"datas\":[")) != std::string::npos) pos += 9;
+    else return values;
+    while (pos < text.size() && text[pos] != ']') {
+        char* end = nullptr;
+        long long value = std::strtoll(text.c_str() + pos, &end, 10);
+        // Valeur non entière (null, chaîne...) : le tableau est ignoré
+        if (end == text.c_str() + pos) return {};
+        values.push_back(value);
+        pos = end - text.c_str();
+        if (pos < text.size() && text[pos] == ',') pos++;
+    }
+    return values;
+}
+
+/**
+ * @brief Décompresse un flux zlib complet.
+ * @return Données décompressées, ou chaîne vide si le flux est invalide ou tronqué.
+ */
+std::string inflateAll(const std::string& compressed) {
+    z_stream stream{};
+    if (inflateInit(&stream) != Z_OK) return "";
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+    stream.avail_in = static_cast<uInt>(compressed.size());
+    std::string out;
+    char buffer[65536];
+    int status = Z_OK;
+    while (status == Z_OK) {
+        stream.next_out = reinterpret_cast<Bytef*>(buffer);
+        stream.avail_out = sizeof(buffer);
+        status = inflate(&stream, Z_NO_FLUSH);
+        out.append(buffer, sizeof(buffer) - stream.avail_out);
+        if (status == Z_BUF_ERROR && stream.avail_in == 0) break;
+    }
+    bool complete = status == Z_STREAM_END;
+    inflateEnd(&stream);
+    return complete ? out : "";
+}
+
+/**
+ * @brief Serveur ROKT lancé dans un dossier de travail dédié, avec ses variables d'environnement.
+ */
+class Server {
+private:
+    std::string binary;
+    std::string directory;
+    std::vector<std::pair<std::string, std::string>> environment;
+    pid_t pid = -1;
+
+public:
+    Server(const std::string& binary, const std::string& directory,
+           std::vector<std::pair<std::string, std::string>> environment)
+        : binary(binary), directory(directory), environment(std::move(environment)) {}
+
+    ~Server() {
+        if (pid > 0) crash();
+    }
+
+    /**
+     * @brief Lance le serveur et attend qu'il accepte les connexions.
+     * @return true si le serveur répond avant STARTUP_TIMEOUT_MS.
+     */
+    bool start() {
+        pid = fork();
+        if (pid < 0) return false;
+        if (pid == 0) {
+            if (chdir(directory.c_str()) != 0) _exit(127);
+            int log = open("server.log", O_WRONLY | O_CREAT | O_APPEND, 0644);
+            if (log >= 0) {
+                dup2(log, STDOUT_FILENO);
+                dup2(log, STDERR_FILENO);
+            }
+            setenv("ROKT_PORT", std::to_string(SERVER_PORT).c_str(), 1);
+            for (const auto& variable : environment) setenv(variable.first.c_str(), variable.second.c_str(), 1);
+            execl(binary.c_str(), binary.c_str(), (char*)nullptr);
+            _exit(127);
+        }
+        for (int waited = 0; waited < STARTUP_TIMEOUT_MS; waited += 50) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            if (!sendCommand("STATS;").empty()) return true;
+            int status;
+            if (waitpid(pid, &status, WNOHANG) == pid) {
+                pid = -1;
+                return false;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Arrêt propre (SIGTERM) : les compactages en cours se terminent avant la sortie.
+     * @return true si le serveur s'est terminé avec le code 0.
+     */
+    bool stop() {
+        if (pid <= 0) return false;
+        kill(pid, SIGTERM);
+        int status = 0;
+        waitpid(pid, &status, 0);
+        pid = -1;
+        return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+
+    /**
+     * @brief Arrêt brutal (SIGKILL), comme une panne.
+     */
+    void crash() {
+        if (pid <= 0) return;
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+        pid = -1;
+    }
+
+    bool restart() {
+        return stop() && start();
+    }
+
+    /**
+     * @brief Pic de mémoire résidente du serveur depuis son démarrage (VmHWM, en Kio), -1 si inconnu.
+     */
+    long long peakMemoryKib() const {
+        std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.rfind("VmHWM:", 0) == 0) return std::atoll(line.c_str() + 6);
+        }
+        return -1;
+    }
+
+    std::string log() const {
+        std::ifstream file(directory + "/server.log");
+        std::stringstream content;
+        content << file.rdbuf();
+        return content.str();
+    }
+};
+
+/**
+ * @brief Résultat d'un scénario : premier contrôle en échec.
+ */
+struct Check {
+    std::string failure;
+
+    bool expect(bool condition, const std::string& message) {
+        if (!condition && failure.empty()) failure = message;
+        return condition;
+    }
+    bool ok() const { return failure.empty(); }
+};
+
+/**
+ * @brief Dossier du dataset créé par le scénario (shared/<base>/<dataset>, noms chiffrés).
+ * Chaque scénario utilise son propre dossier de travail et un seul dataset.
+ */
+std::string datasetDirectory(const std::string& workDir) {
+    std::error_code ec;
+    for (const auto& base : fs::directory_iterator(workDir + "/shared", ec)) {
+        if (!base.is_directory() || base.path().filename() == "transfer") continue;
+        for (const auto& dataset : fs::directory_iterator(base.path(), ec)) {
+            if (dataset.is_directory()) return dataset.path().string();
+        }
+    }
+    return "";
+}
+
+/**
+ * @brief Fichiers du dossier d'un dataset.
+ */
+std::vector<std::string> listFiles(const std::string& directory) {
+    std::vector<std::string> files;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(directory, ec)) {
+        if (entry.is_regular_file()) files.push_back(entry.path().string());
+    }
+    return files;
+}
+
+/**
+ * @brief Journal du dataset : le fichier créé par la première modification journalisée.
+ * @param before Fichiers du dataset avant cette modification.
+ */
+std::string journalFile(const std::string& directory, const std::vector<std::string>& before) {
+    for (const auto& file : listFiles(directory)) {
+        bool existed = false;
+        for (const auto& known : before) existed = existed || known == file;
+        if (!existed) return file;
+    }
+    return "";
+}
+
+long long count(const std::string& dataset, const std::string& filter = "") {
+    return numberAfter(sendCommand("COUNT " + dataset + (filter.empty() ? "" : " " + filter) + ";"), "\"count\":");
+}
+
+/**
+ * @brief Valeur entière du champ `field` de la ligne d'identifiant `id`, -1 si absente.
+ */
+long long fieldOf(const std::string& dataset, const std::string& field, int id) {
+    std::vector<long long> values = resultNumbers(sendCommand("GET " + field + " IN " + dataset + " WHERE id IS " + std::to_string(id) + ";"));
+    return values.size() == 1 ? values[0] : -1;
+}
+
+/**
+ * @brief Ajoute les lignes [first, first + rows) par tableaux de ADD_BATCH_ROWS lignes.
+ * @param makeRow Objet JSON de la ligne d'identifiant donné.
+ * @return true si toutes les insertions ont réussi.
+ */
+bool addRows(const std::string& dataset, int first, int rows, const std::function<std::string(int)>& makeRow) {
+    bool ok = true;
+    for (int start = first; start < first + rows; start += ADD_BATCH_ROWS) {
+        std::string batch = "[";
+        for (int id = start; id < std::min(first + rows, start + ADD_BATCH_ROWS); ++id) {
+            batch += (id > start ? ", " : "") + makeRow(id);
+        }
+        batch += "]";
+        ok = sendCommand("ADD " + batch + " IN " + dataset + ";").find("\"status\": 2") != std::string::npos && ok;
+    }
+    return ok;
+}
+
+bool waitFor(const std::function<bool()>& condition) {
+    for (int waited = 0; waited < WAIT_TIMEOUT_MS; waited += 100) {
+        if (condition()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    return condition();
+}
+
+/**
+ * @brief Relecture du journal après redémarrage : CHANGE +=, CHANGE = et REMOVE sont journalisés
+ * sans réécrire le fichier, puis rejoués à la relecture (arrêt propre, panne, lecture en flux).
+ */
+Check journalReplay(const std::string& binary, const std::string& workDir) {
+    Check check;
+    Server server(binary, workDir, {{"ROKT_COMPACTION_RATIO", "0"}});  // sans compactage, le journal reste
+    if (!check.expect(server.start(), "démarrage du serveur")) return check;
+
+    sendCommand("CREATE TABLE replay;");
+    for (int id = 0; id < REPLAY_ROWS; ++id) {
+        sendCommand("ADD {\"id\": " + std::to_string(id) + ", \"score\": " + std::to_string(id) + ", \"group\": " +
+                    std::to_string(id % 4) + "} IN replay;");
+    }
+    std::string directory = datasetDirectory(workDir);
+    std::vector<std::string> before = listFiles(directory);
+    sendCommand("CHANGE score += 100 WHERE group IS 0 IN replay;");
+    sendCommand("CHANGE label = done WHERE group IS 1 IN replay;");
+    sendCommand("REMOVE WHERE group IS 2 IN replay;");
+    sendCommand("CHANGE score += 1 WHERE group IS 0 IN replay;");
+    std::string journal = journalFile(directory, before);
+    check.expect(!journal.empty() && fs::file_size(journal) > 0, "journal absent après CHANGE");
+
+    auto verify = [&](const std::string& step) {
+        check.expect(count("replay") == REPLAY_ROWS * 3 / 4, step + " : nombre de lignes");
+        check.expect(count("replay", "group:2") == 0, step + " : pierres tombales");
+        check.expect(fieldOf("replay", "score", 4) == 105, step + " : incréments successifs");
+        check.expect(fieldOf("replay", "score", 7) == 7, step + " : ligne non modifiée");
+        check.expect(count("replay", "label:done") == REPLAY_ROWS / 4, step + " : affectation");
+    };
+    verify("avant redémarrage");
+    check.expect(server.restart(), "redémarrage propre");
+    verify("après arrêt propre");
+    server.crash();
+    check.expect(server.start(), "démarrage après panne");
+    verify("après panne");
+    server.stop();
+
+    // Sans lignes résidentes, le journal est rejoué pendant la lecture en flux du fichier
+    Server streaming(binary, workDir, {{"ROKT_COMPACTION_RATIO", "0"}, {"ROKT_MAX_RESIDENT_BYTES", "0"}});
+    if (!check.expect(streaming.start(), "démarrage sans lignes résidentes")) return check;
+    verify("lecture en flux");
+    check.expect(fs::exists(journal), "journal vidé sans compactage");
+    streaming.stop();
+    return check;
+}
+
+/**
+ * @brief Compactage : au-delà du ratio de déchets, le fichier est réécrit avec les effets du
+ * journal (incréments et pierres tombales), puis le journal est supprimé.
+ */
+Check compactionFold(const std::string& binary, const std::string& workDir) {
+    Check check;
+    Server server(binary, workDir, {{"ROKT_COMPACTION_RATIO", "0.01"}});
+    if (!check.expect(server.start(), "démarrage du serveur")) return check;
+
+    sendCommand("CREATE TABLE fold;");
+    std::string rows = "[";
+    for (int id = 0; id < FOLD_ROWS; ++id) {
+        rows += (id ? ", " : "") + std::string("{\"id\": ") + std::to_string(id) + ", \"score\": 0, \"group\": " +
+                (id < 10 ? "1" : "0") + "}";
+    }
+    rows += "]";
+    check.expect(sendCommand("ADD " + rows + " IN fold;").find("\"status\": 2") != std::string::npos, "insertion des lignes");
+
+    std::string directory = datasetDirectory(workDir);
+    std::vector<std::string> before = listFiles(directory);
+    sendCommand("REMOVE WHERE group IS 1 IN fold;");
+    std::string journal = journalFile(directory, before);
+    check.expect(!journal.empty(), "journal absent après REMOVE");
+    // Chaque CHANGE sur toutes les lignes ajoute un enregistrement d'environ 100 Kio au journal,
+    // jusqu'au compactage qui le supprime
+    int changes = 0;
+    std::error_code ec;
+    while (changes < FOLD_CHANGES && fs::exists(journal, ec)) {
+        sendCommand("CHANGE score += 1 WHERE group IS 0 IN fold;");
+        changes++;
+        if (fs::file_size(journal, ec) >= COMPACTION_MIN_GARBAGE_BYTES) break;
+        // Laisse au compactage éventuel le temps de finir avant le CHANGE suivant
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+    check.expect(waitFor([&]() { return !fs::exists(journal); }), "journal non compacté");
+
+    auto verify = [&](const std::string& step, int expected) {
+        check.expect(count("fold") == FOLD_ROWS - 10, step + " : nombre de lignes");
+        check.expect(count("fold", "score:" + std::to_string(expected)) == FOLD_ROWS - 10, step + " : incréments");
+        check.expect(count("fold", "group:1") == 0, step + " : lignes supprimées");
+    };
+    verify("après compactage", changes);
+    // Un nouvel enregistrement désigne les rangs du fichier compacté
+    sendCommand("CHANGE score += 1 WHERE group IS 0 IN fold;");
+    check.expect(fs::exists(journal), "journal absent après compactage");
+    check.expect(server.restart(), "redémarrage propre");
+    verify("après redémarrage", changes + 1);
+    server.stop();
+    return check;
+}
+
+/**
+ * @brief Panne entre la réécriture du fichier et le vidage du journal : le fichier remplacé porte
+ * une nouvelle génération, le journal restant (de l'ancienne) n'est donc pas rejoué une seconde fois.
+ */
+Check staleJournal(const std::string& binary, const std::string& workDir) {
+    Check check;
+    std::vector<std::pair<std::string, std::string>> environment = {{"ROKT_COMPACTION_RATIO", "0"}, {"DEBUG", "1"}};
+    Server server(binary, workDir, environment);
+    if (!check.expect(server.start(), "démarrage du serveur")) return check;
+
+    sendCommand("CREATE TABLE stale;");
+    for (int id = 0; id < 10; ++id) {
+        sendCommand("ADD {\"id\": " + std::to_string(id) + ", \"score\": 0} IN stale;");
+    }
+    std::string directory = datasetDirectory(workDir);
+    std::vector<std::string> before = listFiles(directory);
+    sendCommand("CHANGE score += 1 WHERE id IS 3 IN stale;");
+    sendCommand("REMOVE WHERE id IS 5 IN stale;");
+    std::string journal = journalFile(directory, before);
+    if (!check.expect(!journal.empty(), "journal absent après CHANGE")) return check;
+    std::string records;
+    {
+        std::ifstream file(journal, std::ios::binary);
+        records.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    // ADD réécrit le fichier avec les effets du journal, puis vide le journal
+    sendCommand("ADD {\"id\": 10, \"score\": 0} IN stale;");
+    check.expect(!fs::exists(journal), "journal non vidé après réécriture");
+    server.crash();
+    // Le journal réapparaît comme si la panne avait eu lieu juste avant son vidage
+    {
+        std::ofstream file(journal, std::ios::binary);
+        file.write(records.data(), static_cast<std::streamsize>(records.size()));
+    }
+
+    auto verify = [&](const std::string& step) {
+        check.expect(count("stale") == 10, step + " : nombre de lignes");
+        check.expect(fieldOf("stale", "score", 3) == 1, step + " : incrément rejoué deux fois");
+        check.expect(fieldOf("stale", "score", 6) == 0, step + " : pierre tombale rejouée sur une autre ligne");
+        check.expect(count("stale", "id:5") == 0, step + " : ligne supprimée");
+    };
+    if (!check.expect(server.start(), "démarrage après panne")) return check;
+    verify("après panne");
+    check.expect(server.log().find("antérieur à la dernière réécriture") != std::string::npos, "journal périmé non signalé");
+    check.expect(!fs::exists(journal), "journal périmé conservé");
+    for (const auto& file : listFiles(directory)) {
+        check.expect(file.size() < 4 || file.compare(file.size() - 4, 4, ".tmp") != 0, "fichier temporaire restant : " + file);
+    }
+    // Les enregistrements suivants portent la génération du fichier et sont rejoués
+    sendCommand("CHANGE score += 2 WHERE id IS 3 IN stale;");
+    check.expect(server.stop(), "arrêt propre");
+    Server streaming(binary, workDir, {{"ROKT_COMPACTION_RATIO", "0"}, {"ROKT_MAX_RESIDENT_BYTES", "0"}});
+    if (!check.expect(streaming.start(), "démarrage sans lignes résidentes")) return check;
+    check.expect(fieldOf("stale", "score", 3) == 3, "lecture en flux : enregistrement de la nouvelle génération");
+    check.expect(count("stale") == 10, "lecture en flux : nombre de lignes");
+    streaming.stop();
+    return check;
+}
+
+/**
+ * @brief LSM : des ADD concurrents vident la memtable en runs et déclenchent des fusions pendant
+ * que les écritures, des CHANGE (qui réécrivent le dataset) et des lectures continuent. Aucune
+ * ligne n'est perdue ni dupliquée, l'ordre d'ajout est conservé et les filtres de Bloom trouvent
+ * chaque clé.
+ */
+Check lsmFlushMerge(const std::string& binary, const std::string& workDir) {
+    Check check;
+    Server server(binary, workDir, {{"ROKT_MEMTABLE_BYTES", "4096"}});
+    if (!check.expect(server.start(), "démarrage du serveur")) return check;
+    sendCommand("CREATE TABLE lsm LSM KEY id;");
+
+    std::atomic<bool> writing{true};
+    std::atomic<int> failed_inserts{0};
+    std::atomic<int> bad_counts{0};
+    std::vector<std::thread> writers;
+    for (int writer = 0; writer < LSM_WRITERS; ++writer) {
+        writers.emplace_back([&, writer]() {
+            for (int i = 0; i < LSM_ROWS_PER_WRITER; ++i) {
+                int id = writer * LSM_ROWS_PER_WRITER + i;
+                std::string response = sendCommand("ADD {\"id\": " + std::to_string(id) + ", \"writer\": " + std::to_string(writer) + "} IN lsm;");
+                if (response.find("\"status\": 2") == std::string::npos) failed_inserts++;
+            }
+        });
+    }
+    // Le nombre de lignes lu pendant les écritures ne doit jamais décroître
+    std::thread reader([&]() {
+        long long last = 0;
+        while (writing) {
+            long long current = count("lsm");
+            if (current < last || current > LSM_WRITERS * LSM_ROWS_PER_WRITER) bad_counts++;
+            if (current >= 0) last = current;
+        }
+    });
+    std::thread changer([&]() {
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<> dis(0, LSM_WRITERS * LSM_ROWS_PER_WRITER - 1);
+        for (int i = 0; i < 20 && writing; ++i) {
+            sendCommand("CHANGE touched = 1 WHERE id IS " + std::to_string(dis(gen)) + " IN lsm;");
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    });
+    for (auto& thread : writers) thread.join();
+    writing = false;
+    reader.join();
+    changer.join();
+    check.expect(failed_inserts == 0, "insertions échouées");
+    check.expect(bad_counts == 0, "COUNT incohérent pendant les écritures");
+
+    auto verify = [&](const std::string& step) {
+        std::vector<long long> ids = resultNumbers(sendCommand("GET id IN lsm;"));
+        check.expect(ids.size() == size_t(LSM_WRITERS * LSM_ROWS_PER_WRITER), step + " : nombre de lignes");
+        // Chaque écrivain a ajouté ses identifiants dans l'ordre : ils doivent être relus dans cet ordre
+        std::vector<long long> next(LSM_WRITERS);
+        for (int writer = 0; writer < LSM_WRITERS; ++writer) next[writer] = writer * LSM_ROWS_PER_WRITER;
+        bool ordered = true;
+        for (long long id : ids) {
+            int writer = static_cast<int>(id / LSM_ROWS_PER_WRITER);
+            if (id < 0 || writer >= LSM_WRITERS || next[writer] != id) {
+                ordered = false;
+                break;
+            }
+            next[writer]++;
+        }
+        check.expect(ordered, step + " : ordre d'ajout ou lignes dupliquées");
+        bool found = true;
+        for (int id = 0; id < LSM_WRITERS * LSM_ROWS_PER_WRITER; id += 97) {
+            found = found && count("lsm", "id:" + std::to_string(id)) == 1;
+        }
+        check.expect(found, step + " : recherche par clé");
+    };
+    verify("pendant les fusions");
+    // L'arrêt propre attend la fin des fusions en cours
+    check.expect(server.restart(), "redémarrage propre");
+    verify("après redémarrage");
+    server.stop();
+
+    // Lecture en flux : EXPLAIN indique le nombre de runs, borné par les fusions
+    Server streaming(binary, workDir, {{"ROKT_MEMTABLE_BYTES", "4096"}, {"ROKT_MAX_RESIDENT_BYTES", "0"}});
+    if (!check.expect(streaming.start(), "démarrage sans lignes résidentes")) return check;
+    long long runs = numberAfter(sendCommand("EXPLAIN GET * IN lsm;"), "\"runs\":");
+    check.expect(runs >= 1 && runs <= LSM_MAX_RUNS, "nombre de runs après fusion : " + std::to_string(runs));
+    verify("lecture en flux");
+    streaming.stop();
+    return check;
+}
+
+/**
+ * @brief LSM : panne entre l'écriture des runs (vidage de la memtable ou réécriture) et le vidage
+ * du journal. La liste des runs porte la génération de la memtable suivante : les enregistrements
+ * restants, déjà contenus dans les runs, ne sont pas relus et aucune ligne n'est dupliquée.
+ */
+Check lsmStaleMemtable(const std::string& binary, const std::string& workDir) {
+    Check check;
+    const std::pair<std::string, std::string> large = {"ROKT_MEMTABLE_BYTES", "1048576"};
+    {
+        Server server(binary, workDir, {large});
+        if (!check.expect(server.start(), "démarrage du serveur")) return check;
+        sendCommand("CREATE TABLE memtable LSM KEY id;");
+        for (int id = 0; id < 5; ++id) {
+            sendCommand("ADD {\"id\": " + std::to_string(id) + "} IN memtable;");
+        }
+        check.expect(server.stop(), "arrêt propre");
+    }
+    std::string directory = datasetDirectory(workDir);
+    auto snapshot = [&]() {
+        std::vector<std::pair<std::string, std::string>> files;
+        for (const auto& file : listFiles(directory)) {
+            std::ifstream in(file, std::ios::binary);
+            files.emplace_back(file, std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()));
+        }
+        return files;
+    };
+    // Remet en place le journal tel qu'il était dans `before`, comme si la panne avait eu lieu
+    // juste avant son vidage. Le journal est le seul fichier supprimé par le premier vidage.
+    std::string journal;
+    auto restoreJournal = [&](const std::vector<std::pair<std::string, std::string>>& before) {
+        if (journal.empty()) {
+            std::vector<std::string> removed;
+            for (const auto& file : before) {
+                if (!fs::exists(file.first)) removed.push_back(file.first);
+            }
+            if (removed.size() != 1) return false;
+            journal = removed[0];
+        }
+        for (const auto& file : before) {
+            if (file.first != journal || fs::exists(journal)) continue;
+            std::ofstream out(journal, std::ios::binary);
+            out.write(file.second.data(), static_cast<std::streamsize>(file.second.size()));
+            return true;
+        }
+        return false;
+    };
+    auto verify = [&](const std::string& step, int rows) {
+        check.expect(count("memtable") == rows, step + " : nombre de lignes");
+        for (int id = 0; id < rows; ++id) {
+            check.expect(count("memtable", "id:" + std::to_string(id)) == 1, step + " : ligne " + std::to_string(id));
+        }
+    };
+
+    // Vidage de la memtable à chaque écriture
+    std::vector<std::pair<std::string, std::string>> before = snapshot();
+    {
+        Server server(binary, workDir, {{"ROKT_MEMTABLE_BYTES", "0"}});
+        if (!check.expect(server.start(), "démarrage du serveur")) return check;
+        sendCommand("ADD {\"id\": 5} IN memtable;");
+        server.crash();
+    }
+    check.expect(restoreJournal(before), "journal non vidé après le vidage de la memtable");
+    Server server(binary, workDir, {large, {"DEBUG", "1"}});
+    if (!check.expect(server.start(), "démarrage après panne")) return check;
+    verify("après vidage", 6);
+    check.expect(server.log().find("antérieur à la dernière réécriture") != std::string::npos, "journal périmé non signalé");
+
+    // Réécriture en un seul run (CHANGE), memtable comprise
+    sendCommand("ADD {\"id\": 6} IN memtable;");
+    sendCommand("ADD {\"id\": 7} IN memtable;");
+    before = snapshot();
+    sendCommand("CHANGE label = done WHERE id IS 0 IN memtable;");
+    server.crash();
+    check.expect(restoreJournal(before), "journal non vidé après la réécriture");
+    if (!check.expect(server.start(), "démarrage après panne")) return check;
+    verify("après réécriture", 8);
+    check.expect(count("memtable", "label:done") == 1, "après réécriture : CHANGE");
+    for (const auto& file : listFiles(directory)) {
+        check.expect(file.size() < 4 || file.compare(file.size() - 4, 4, ".tmp") != 0, "fichier temporaire restant : " + file);
+    }
+    // Les lignes ajoutées ensuite sont relues après un redémarrage
+    sendCommand("ADD {\"id\": 8} IN memtable;");
+    check.expect(server.restart(), "redémarrage propre");
+    verify("après redémarrage", 9);
+    server.stop();
+    return check;
+}
+
+/**
+ * @brief Journal corrompu : la relecture s'arrête au premier enregistrement illisible, le signale
+ * dans les logs, et le journal est tronqué pour que les modifications suivantes soient relues.
+ */
+Check corruptJournal(const std::string& binary, const std::string& workDir) {
+    Check check;
+    // Les logs du serveur ne sont écrits qu'avec DEBUG=1
+    Server server(binary, workDir, {{"ROKT_COMPACTION_RATIO", "0"}, {"DEBUG", "1"}});
+    if (!check.expect(server.start(), "démarrage du serveur")) return check;
+
+    sendCommand("CREATE TABLE corrupt;");
+    for (int id = 0; id < 10; ++id) {
+        sendCommand("ADD {\"id\": " + std::to_string(id) + ", \"score\": 0} IN corrupt;");
+    }
+    std::string directory = datasetDirectory(workDir);
+    std::vector<std::string> before = listFiles(directory);
+    sendCommand("CHANGE score += 1 WHERE id IS 1 IN corrupt;");
+    std::string journal = journalFile(directory, before);
+    if (!check.expect(!journal.empty(), "journal absent après CHANGE")) return check;
+    uintmax_t firstRecord = fs::file_size(journal);
+    sendCommand("CHANGE score += 2 WHERE id IS 2 IN corrupt;");
+    check.expect(server.stop(), "arrêt propre");
+
+    // Premier octet chiffré du second enregistrement (après sa taille sur 4 octets) : le JSON devient illisible
+    {
+        std::fstream file(journal, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(firstRecord + 4);
+        char byte = 0;
+        file.get(byte);
+        file.seekp(firstRecord + 4);
+        file.put(static_cast<char>(byte ^ 0x5A));
+    }
+    if (!check.expect(server.start(), "démarrage avec un journal corrompu")) return check;
+    check.expect(fieldOf("corrupt", "score", 1) == 1, "enregistrement valide non rejoué");
+    check.expect(fieldOf("corrupt", "score", 2) == 0, "enregistrement corrompu rejoué");
+    check.expect(server.log().find("enregistrement illisible") != std::string::npos, "corruption non signalée");
+    check.expect(fs::exists(journal + ".corrupt"), "copie du journal corrompu absente");
+    check.expect(fs::file_size(journal) == firstRecord, "journal non tronqué");
+
+    // Les enregistrements ajoutés après la réparation sont relus
+    sendCommand("CHANGE score += 3 WHERE id IS 3 IN corrupt;");
+    check.expect(server.stop(), "arrêt propre");
+    // Enregistrement tronqué, comme après une panne pendant son écriture
+    {
+        std::ofstream file(journal, std::ios::binary | std::ios::app);
+        file.write("\x40\x00", 2);
+    }
+    if (!check.expect(server.start(), "démarrage avec un journal tronqué")) return check;
+    check.expect(fieldOf("corrupt", "score", 1) == 1, "premier enregistrement perdu");
+    check.expect(fieldOf("corrupt", "score", 3) == 3, "enregistrement ajouté après réparation perdu");
+    check.expect(server.log().find("en-tête tronqué") != std::string::npos, "troncature non signalée");
+    check.expect(count("corrupt") == 10, "nombre de lignes");
+    server.stop();
+    return check;
+}
+
+/**
+ * @brief GET ... STREAM : chaque bloc est libéré après son envoi, le pic de mémoire du serveur
+ * ne dépend donc pas du nombre de lignes renvoyées (lignes lues en flux, sans store résident).
+ */
+Check streamMemory(const std::string& binary, const std::string& workDir) {
+    Check check;
+    std::vector<std::pair<std::string, std::string>> environment = {{"ROKT_MAX_RESIDENT_BYTES", "0"}, {"ROKT_RESULT_CACHE_BYTES", "0"}};
+    auto makeRow = [](int id) {
+        return "{\"id\": " + std::to_string(id) + ", \"name\": \"user" + std::to_string(id) + "\", \"payload\": \"" +
+               std::string(160, 'x') + "\"}";
+    };
+    // Pic de mémoire ajouté par le GET ... STREAM, mesuré sur un serveur fraîchement démarré
+    auto streamGrowth = [&](int rows, size_t* bytes) -> long long {
+        Server server(binary, workDir, environment);
+        if (!check.expect(server.start(), "démarrage du serveur")) return -1;
+        check.expect(count("big") == rows, "nombre de lignes avant STREAM");
+        long long before = server.peakMemoryKib();
+        std::string response = sendCommand("GET * IN big STREAM 1000;");
+        long long after = server.peakMemoryKib();
+        *bytes = response.size();
+        check.expect(numberAfter(response, "\"rows\":") == rows, "lignes envoyées par STREAM");
+        server.stop();
+        return after - before;
+    };
+
+    {
+        Server server(binary, workDir, environment);
+        if (!check.expect(server.start(), "démarrage du serveur")) return check;
+        sendCommand("CREATE TABLE big;");
+        check.expect(addRows("big", 0, STREAM_SMALL_ROWS, makeRow), "insertion des lignes");
+        server.stop();
+    }
+    size_t smallBytes = 0;
+    long long smallGrowth = streamGrowth(STREAM_SMALL_ROWS, &smallBytes);
+    {
+        Server server(binary, workDir, environment);
+        if (!check.expect(server.start(), "redémarrage du serveur")) return check;
+        check.expect(addRows("big", STREAM_SMALL_ROWS, STREAM_LARGE_ROWS - STREAM_SMALL_ROWS, makeRow), "insertion des lignes");
+        server.stop();
+    }
+    size_t largeBytes = 0;
+    long long largeGrowth = streamGrowth(STREAM_LARGE_ROWS, &largeBytes);
+    check.expect(smallGrowth >= 0 && largeGrowth >= 0, "mémoire du serveur illisible (/proc)");
+    check.expect(largeBytes > 3 * smallBytes, "taille des réponses");
+    check.expect(largeGrowth <= smallGrowth + STREAM_MAX_EXTRA_KIB,
+                 "pic de mémoire : +" + std::to_string(smallGrowth) + " Kio pour " + std::to_string(STREAM_SMALL_ROWS) + " lignes, +" +
+                 std::to_string(largeGrowth) + " Kio pour " + std::to_string(STREAM_LARGE_ROWS));
+    return check;
+}
+
+/**
+ * @brief UNIQUE sur de grands entiers : au-delà de 2^53, deux identifiants voisins ont le même
+ * double mais restent distincts ; un double entier reste égal à l'entier de même valeur.
+ */
+Check uniqueLargeIntegers(const std::string& binary, const std::string& workDir) {
+    Check check;
+    Server server(binary, workDir, {});
+    if (!check.expect(server.start(), "démarrage du serveur")) return check;
+
+    sendCommand("CREATE TABLE large;");
+    check.expect(sendCommand("ADD {\"id\": 9007199254740992} UNIQUE id IN large;").find("\"status\": 2") != std::string::npos,
+                 "premier identifiant refusé");
+    check.expect(sendCommand("ADD {\"id\": 9007199254740993} UNIQUE id IN large;").find("\"status\": 2") != std::string::npos,
+                 "identifiant voisin au-delà de 2^53 refusé");
+    check.expect(sendCommand("ADD {\"id\": 9007199254740993} UNIQUE id IN large;").find("\"status\": 10") != std::string::npos,
+                 "doublon accepté");
+    check.expect(sendCommand("ADD {\"id\": 9007199254740992.0} UNIQUE id IN large;").find("\"status\": 10") != std::string::npos,
+                 "double égal à un entier existant accepté");
+    std::string batch = sendCommand("ADD [{\"id\": 18014398509481985}, {\"id\": 18014398509481984}] UNIQUE id IN large;");
+    check.expect(numberAfter(batch, "\"inserted\":") == 2, "identifiants voisins d'un même ADD refusés");
+    // L'upsert fusionne dans la ligne de même identifiant, pas dans sa voisine
+    sendCommand("ADD {\"id\": 9007199254740993, \"score\": 7} UNIQUE id ON CONFLICT UPDATE IN large;");
+    check.expect(count("large") == 4, "nombre de lignes");
+    check.expect(count("large", "score:7") == 1, "upsert non appliqué");
+    check.expect(compact(sendCommand("GET * IN large;")).find("\"id\":9007199254740993,\"score\":7") != std::string::npos,
+                 "upsert appliqué à la ligne voisine");
+    server.stop();
+    return check;
+}
+
+/**
+ * @brief UNIQUE sur un chemin ("user.id") : les lignes ajoutées sont lues par le même chemin que
+ * les lignes du dataset (ajout, doublon, upsert), avec et sans lignes résidentes ; une ligne sans
+ * le champ est refusée.
+ */
+Check uniqueFieldPath(const std::string& binary, const std::string& workDir) {
+    Check check;
+    for (const std::string residentBytes : {"67108864", "0"}) {
+        std::string step = residentBytes == "0" ? "lecture en flux : " : "lignes résidentes : ";
+        std::string dataset = residentBytes == "0" ? "streamed" : "resident";
+        Server server(binary, workDir, {{"ROKT_MAX_RESIDENT_BYTES", residentBytes}});
+        if (!check.expect(server.start(), step + "démarrage du serveur")) return check;
+        sendCommand("CREATE TABLE " + dataset + ";");
+        auto add = [&](const std::string& rows, const std::string& clause = "") {
+            return sendCommand("ADD " + rows + " UNIQUE user.id " + clause + "IN " + dataset + ";");
+        };
+        check.expect(add("{\"user\": {\"id\": 1}, \"v\": 1}").find("\"status\": 2") != std::string::npos, step + "premier ajout");
+        check.expect(add("{\"user\": {\"id\": 2}, \"v\": 1}").find("\"status\": 2") != std::string::npos, step + "second ajout");
+        check.expect(add("{\"user\": {\"id\": 1}, \"v\": 9}").find("\"status\": 10") != std::string::npos, step + "doublon accepté");
+        check.expect(add("{\"v\": 1}").find("\"status\": 12") != std::string::npos, step + "ligne sans le champ acceptée");
+        std::string batch = add("[{\"user\": {\"id\": 3}}, {\"user\": {\"id\": 3}}, {\"v\": 1}]");
+        check.expect(numberAfter(batch, "\"inserted\":") == 1 && numberAfter(batch, "\"rejected\":") == 2, step + "ajout multiple");
+        check.expect(add("{\"user\": {\"id\": 2}, \"v\": 5}", "ON CONFLICT UPDATE ").find("Updated") != std::string::npos,
+                     step + "upsert non fusionné");
+        check.expect(add("{\"v\": 5}", "ON CONFLICT UPDATE ").find("\"status\": 12") != std::string::npos,
+                     step + "upsert sans le champ accepté");
+        std::string upserted = add("[{\"user\": {\"id\": 2}, \"w\": 1}, {\"user\": {\"id\": 4}}]", "ON CONFLICT UPDATE ");
+        check.expect(numberAfter(upserted, "\"inserted\":") == 1 && numberAfter(upserted, "\"updated\":") == 1,
+                     step + "upsert multiple");
+        check.expect(count(dataset) == 4, step + "nombre de lignes");
+        check.expect(count(dataset, "v:5") == 1 && count(dataset, "w:1") == 1, step + "lignes fusionnées");
+        server.stop();
+    }
+    return check;
+}
+
+/**
+ * @brief Fichier de dataset illisible : les lectures et les écritures renvoient une erreur au lieu
+ * de réécrire le fichier vide ; une fois le fichier restauré, toutes les lignes sont relues.
+ */
+Check unreadableDataset(const std::string& binary, const std::string& workDir) {
+    Check check;
+    {
+        Server server(binary, workDir, {});
+        if (!check.expect(server.start(), "démarrage du serveur")) return check;
+        sendCommand("CREATE TABLE broken;");
+        check.expect(addRows("broken", 0, 100, [](int id) {
+            return "{\"id\": " + std::to_string(id) + ", \"payload\": \"" + std::string(200, 'x') + "\"}";
+        }), "insertion des lignes");
+        check.expect(server.stop(), "arrêt propre");
+    }
+    // Le plus gros fichier du dossier est celui des lignes ; son premier octet est altéré
+    std::string dataFile;
+    for (const auto& file : listFiles(datasetDirectory(workDir))) {
+        if (dataFile.empty() || fs::file_size(file) > fs::file_size(dataFile)) dataFile = file;
+    }
+    std::string original;
+    {
+        std::ifstream in(dataFile, std::ios::binary);
+        original.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    if (!check.expect(original.size() > 100 * 200, "fichier du dataset introuvable")) return check;
+    std::string corrupted = original;
+    corrupted[0] = static_cast<char>(corrupted[0] ^ 0x5A);
+    corrupted[20] = static_cast<char>(corrupted[20] ^ 0x5A);
+    auto writeFile = [&](const std::string& content) {
+        std::ofstream out(dataFile, std::ios::binary | std::ios::trunc);
+        out.write(content.data(), static_cast<std::streamsize>(content.size()));
+    };
+    writeFile(corrupted);
+
+    for (const std::string residentBytes : {"67108864", "0"}) {
+        std::string step = residentBytes == "0" ? "lecture en flux : " : "lignes résidentes : ";
+        Server server(binary, workDir, {{"ROKT_MAX_RESIDENT_BYTES", residentBytes}});
+        if (!check.expect(server.start(), step + "démarrage du serveur")) return check;
+        check.expect(sendCommand("GET * IN broken;").find("Can't read dataset") != std::string::npos, step + "GET sans erreur");
+        check.expect(sendCommand("GET id IN broken WHERE id IS 5;").find("Can't read dataset") != std::string::npos,
+                     step + "GET WHERE sans erreur");
+        check.expect(sendCommand("GET * IN broken STREAM 10;").find("Can't read dataset") != std::string::npos,
+                     step + "GET STREAM sans erreur");
+        check.expect(sendCommand("ADD {\"id\": 100} IN broken;").find("\"status\": 3") != std::string::npos, step + "ADD accepté");
+        check.expect(sendCommand("ADD {\"id\": 101} UNIQUE id IN broken;").find("\"status\": 3") != std::string::npos,
+                     step + "ADD UNIQUE accepté");
+        check.expect(sendCommand("REMOVE WHERE id IS 1 IN broken;").find("\"status\": 3") != std::string::npos, step + "REMOVE accepté");
+        server.stop();
+        std::ifstream in(dataFile, std::ios::binary);
+        check.expect(std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()) == corrupted,
+                     step + "fichier illisible réécrit");
+    }
+
+    writeFile(original);
+    Server server(binary, workDir, {});
+    if (!check.expect(server.start(), "démarrage après restauration")) return check;
+    check.expect(resultNumbers(sendCommand("GET id IN broken WHERE id != -1;")).size() == 100, "lignes perdues");
+    server.stop();
+    return check;
+}
+
+/**
+ * @brief Priorité d'EXECUTE : une requête préparée prend la priorité de sa commande. Avec un seul
+ * worker occupé par une lecture longue, un EXECUTE d'un CHANGE mis en file après un GET passe avant lui.
+ */
+Check executePriority(const std::string& binary, const std::string& workDir) {
+    Check check;
+    Server server(binary, workDir, {{"ROKT_MAX_WORKERS", "1"}, {"ROKT_RESULT_CACHE_BYTES", "0"}, {"ROKT_MAX_RESIDENT_BYTES", "0"}});
+    if (!check.expect(server.start(), "démarrage du serveur")) return check;
+
+    sendCommand("CREATE TABLE held;");
+    sendCommand("CREATE TABLE counter;");
+    sendCommand("ADD {\"id\": 1, \"hits\": 0} IN counter;");
+    check.expect(sendCommand("PREPARE hit AS CHANGE hits += 1 WHERE id IS ? IN counter;").find("\"status\": 0") != std::string::npos,
+                 "PREPARE refusé");
+
+    // Un BULK ADD laissé ouvert occupe l'unique worker pendant que le GET puis l'EXECUTE sont mis en file
+    int bulk = openConnection();
+    if (!check.expect(bulk >= 0, "connexion du BULK ADD")) return check;
+    std::string header = "BULK ADD IN held\n{\"id\": 1}\n";
+    send(bulk, header.c_str(), header.size(), 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    std::string read;
+    std::thread reader([&read]() { read = sendCommand("GET hits IN counter WHERE id IS 1;"); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::string executed;
+    std::thread writer([&executed]() { executed = sendCommand("EXECUTE hit (1);"); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    send(bulk, "END\n", 4, 0);
+    readResponse(bulk);
+    writer.join();
+    reader.join();
+    check.expect(executed.find("\"status\": 0") != std::string::npos, "EXECUTE en échec");
+    std::vector<long long> hits = resultNumbers(read);
+    check.expect(hits.size() == 1 && hits[0] == 1, "GET exécuté avant l'EXECUTE d'un CHANGE : " + compact(read));
+    server.stop();
+    return check;
+}
+
+/**
+ * @brief Documents de requête alloués dans l'arène des workers : des GET concurrents (ORDER BY,
+ * DISTINCT, GROUP BY, JOIN) construisent leurs résultats sur les threads de scan et les libèrent
+ * sur le worker ; chaque réponse reste exacte et le serveur survit.
+ */
+Check arenaConcurrency(const std::string& binary, const std::string& workDir) {
+    Check check;
+    Server server(binary, workDir, {{"ROKT_MAX_WORKERS", std::to_string(ARENA_CLIENTS)}, {"ROKT_RESULT_CACHE_BYTES", "0"}});
+    if (!check.expect(server.start(), "démarrage du serveur")) return check;
+
+    sendCommand("CREATE TABLE items;");
+    check.expect(addRows("items", 0, ARENA_ROWS, [](int id) {
+        return "{\"id\": " + std::to_string(id) + ", \"group\": " + std::to_string(id % 10) + ", \"score\": " + std::to_string(id % 997) + "}";
+    }), "insertion des lignes");
+    sendCommand("CREATE TABLE groups;");
+    check.expect(addRows("groups", 0, 10, [](int group) {
+        return "{\"group\": " + std::to_string(group) + ", \"name\": \"g" + std::to_string(group) + "\"}";
+    }), "insertion des groupes");
+
+    std::vector<std::string> failures(ARENA_CLIENTS);
+    std::vector<std::thread> clients;
+    for (int client = 0; client < ARENA_CLIENTS; client++) {
+        clients.emplace_back([client, &failures]() {
+            for (int round = 0; round < ARENA_ROUNDS && failures[client].empty(); round++) {
+                int id = (client * ARENA_ROUNDS + round) % ARENA_ROWS;
+                std::string top = compact(sendCommand("GET id, score IN items ORDER BY score DESC LIMIT 3;"));
+                if (top.find("{\"id\":996,\"score\":996}") == std::string::npos) failures[client] = "ORDER BY : " + top;
+                if (resultNumbers(sendCommand("GET DISTINCT group IN items;")).size() != 10) failures[client] = "DISTINCT";
+                std::string groups = compact(sendCommand("GET COUNT(*) IN items GROUP BY group;"));
+                if (groups.find("\"9\":{\"COUNT(*)\":" + std::to_string(ARENA_ROWS / 10) + "}") == std::string::npos)
+                    failures[client] = "GROUP BY : " + groups;
+                std::string joined = compact(sendCommand("GET items.id, groups.name IN groups JOIN items ON groups.group = items.group WHERE items.id IS " +
+                                                         std::to_string(id) + ";"));
+                if (joined.find("\"groups.name\":\"g" + std::to_string(id % 10) + "\"") == std::string::npos) failures[client] = "JOIN : " + joined;
+            }
+        });
+    }
+    for (auto& client : clients) client.join();
+    for (const auto& failure : failures) {
+        if (!failure.empty()) {
+            check.expect(false, "réponse inexacte, " + failure);
+            break;
+        }
+    }
+    check.expect(count("items") == ARENA_ROWS, "serveur arrêté après les requêtes concurrentes");
+    server.stop();
+    return check;
+}
+
+/**
+ * @brief IMPORT et EXPORT CSV : une cellule non quotée n'est un nombre que si elle en a la forme
+ * JSON (zéros en tête, hexadécimal ou "inf" restent des chaînes) ; l'en-tête exporté ne reprend que
+ * les champs des lignes exportées.
+ */
+Check csvTransfer(const std::string& binary, const std::string& workDir) {
+    Check check;
+    Server server(binary, workDir, {});
+    if (!check.expect(server.start(), "démarrage du serveur")) return check;
+
+    std::string transfer = workDir + "/shared/transfer";
+    fs::create_directories(transfer);
+    std::ofstream(transfer + "/codes.csv") << "id,zip,code,amount,delta\n1,01234,0x1A,1.5,-007\n2,0,inf,-0.25,-0\n";
+    sendCommand("CREATE TABLE codes;");
+    std::string imported = sendCommand("IMPORT codes.csv INTO codes;");
+    check.expect(numberAfter(imported, "\"imported\":") == 2, "IMPORT : " + compact(imported));
+    std::string rows = compact(sendCommand("GET * IN codes;"));
+    for (const std::string expected : {"\"zip\":\"01234\"", "\"code\":\"0x1A\"", "\"amount\":1.5", "\"delta\":\"-007\"",
+                                       "\"zip\":0", "\"code\":\"inf\"", "\"amount\":-0.25", "\"delta\":0"}) {
+        check.expect(rows.find(expected) != std::string::npos, "cellule importée " + expected + " : " + rows);
+    }
+
+    // "removed" n'existe plus que dans le dictionnaire, "other" dans une ligne écartée par le WHERE
+    sendCommand("CREATE TABLE mixed;");
+    sendCommand("ADD [{\"id\": 1, \"kept\": 1}, {\"id\": 2, \"removed\": 2}, {\"id\": 3, \"other\": 3}] IN mixed;");
+    sendCommand("REMOVE WHERE id IS 2 IN mixed;");
+    std::string exported = sendCommand("EXPORT mixed TO mixed.csv FORMAT CSV WHERE id != 3;");
+    check.expect(exported.find("\"status\": 0") != std::string::npos, "EXPORT : " + compact(exported));
+    std::ifstream csv(transfer + "/mixed.csv");
+    std::string header;
+    std::getline(csv, header);
+    check.expect(header == "\"id\",\"kept\"", "en-tête exporté : " + header);
+    server.stop();
+    return check;
+}
+
+/**
+ * @brief Curseurs de pagination : un ADD en fin de dataset (LSM, avec vidages de la memtable,
+ * ou classique) laisse le curseur valide et ses lignes sont lues par les pages suivantes ; un
+ * CHANGE le rend caduc.
+ */
+Check cursorAppend(const std::string& binary, const std::string& workDir) {
+    Check check;
+    Server server(binary, workDir, {{"ROKT_MEMTABLE_BYTES", "256"}});
+    if (!check.expect(server.start(), "démarrage du serveur")) return check;
+
+    auto cursorOf = [](const std::string& response) {
+        std::string text = compact(response);
+        size_t pos = text.find("\"cursor\":\"");
+        if (pos == std::string::npos) return std::string();
+        pos += 10;
+        return text.substr(pos, text.find('"', pos) - pos);
+    };
+    for (const std::string create : {"CREATE TABLE appended LSM KEY id;", "CREATE TABLE appended;"}) {
+        std::string step = create.find("LSM") != std::string::npos ? "LSM : " : "classique : ";
+        sendCommand(create);
+        for (int id = 0; id < 10; id++) sendCommand("ADD {\"id\": " + std::to_string(id) + "} IN appended;");
+        std::string cursor = cursorOf(sendCommand("GET id IN appended LIMIT 4;"));
+        check.expect(!cursor.empty(), step + "curseur absent");
+        sendCommand("ADD {\"id\": 10} IN appended;");
+        sendCommand("ADD [{\"id\": 11}, {\"id\": 12}] IN appended;");
+        std::vector<long long> read;
+        for (int page = 0; page < 3 && !cursor.empty(); page++) {
+            std::string response = sendCommand("GET id IN appended LIMIT 4 CURSOR " + cursor + ";");
+            check.expect(response.find("\"status\": 0") != std::string::npos, step + "curseur refusé après un ADD : " + compact(response));
+            for (long long id : resultNumbers(response)) read.push_back(id);
+            cursor = cursorOf(response);
+        }
+        check.expect(read == std::vector<long long>({4, 5, 6, 7, 8, 9, 10, 11, 12}), step + "lignes lues après le curseur");
+
+        cursor = cursorOf(sendCommand("GET id IN appended LIMIT 4;"));
+        sendCommand("CHANGE id += 0 WHERE id IS 1 IN appended;");
+        check.expect(sendCommand("GET id IN appended LIMIT 4 CURSOR " + cursor + ";").find("Curseur expir") != std::string::npos,
+                     step + "curseur accepté après un CHANGE");
+        sendCommand("DELETE appended;");
+    }
+    server.stop();
+    return check;
+}
+
+/**
+ * @brief Ruban des lignes : les valeurs de tous les types (entiers aux limites de 64 bits, double,
+ * null, chaînes échappées, objets et tableaux imbriqués ou vides) sont relues à l'identique,
+ * résidentes, après redémarrage et en flux ; un incrément qui dépasse l'entier sur 56 bits de
+ * l'en-tête réencode la valeur sans la tronquer.
+ */
+Check tapeRoundTrip(const std::string& binary, const std::string& workDir) {
+    Check check;
+    Server server(binary, workDir, {});
+    if (!check.expect(server.start(), "démarrage du serveur")) return check;
+
+    sendCommand("CREATE TABLE tape;");
+    std::string added = sendCommand(
+        "ADD [{\"id\": 0, \"null\": null, \"flag\": true, \"ratio\": -0.5, \"max\": 18446744073709551615, "
+        "\"min\": -9223372036854775808, \"text\": \"é \\\"q\\\" \\\\ ☃\", \"nested\": {\"a\": {\"b\": [1, {\"c\": []}]}}, "
+        "\"empty\": {}, \"list\": []}, {\"id\": 1, \"edge\": 36028797018963967, \"low\": -36028797018963968}] IN tape;");
+    check.expect(numberAfter(added, "\"inserted\":") == 2, "insertion des lignes : " + compact(added));
+    sendCommand("CHANGE edge += 1 WHERE id IS 1 IN tape;");
+    sendCommand("CHANGE low -= 1 WHERE id IS 1 IN tape;");
+
+    std::string expected = compact(sendCommand("GET * IN tape;"));
+    for (const std::string value : {"\"max\":18446744073709551615", "\"min\":-9223372036854775808", "\"ratio\":-0.5",
+                                    "\"null\":null", "\"text\":\"é\\\"q\\\"\\\\☃\"", "\"nested\":{\"a\":{\"b\":[1,{\"c\":[]}]}}",
+                                    "\"empty\":{}", "\"list\":[]", "\"edge\":36028797018963968", "\"low\":-36028797018963969"}) {
+        check.expect(expected.find(value) != std::string::npos, "valeur " + value + " : " + expected);
+    }
+    check.expect(server.restart(), "redémarrage");
+    check.expect(compact(sendCommand("GET * IN tape;")) == expected, "lignes relues après redémarrage");
+    server.stop();
+
+    Server streaming(binary, workDir, {{"ROKT_MAX_RESIDENT_BYTES", "0"}});
+    if (!check.expect(streaming.start(), "démarrage sans lignes résidentes")) return check;
+    check.expect(compact(sendCommand("GET * IN tape;")) == expected, "lignes lues en flux");
+    streaming.stop();
+    return check;
+}
+
+/**
+ * @brief Dictionnaire de clés : des lignes de formes différentes, ajoutées avant et après un
+ * redémarrage (et vidées dans des runs LSM successifs), gardent chacune leurs clés ; un chemin
+ * imbriqué reste adressable par WHERE et une clé contenant un '.' reste une clé simple.
+ */
+Check keyDictionary(const std::string& binary, const std::string& workDir) {
+    Check check;
+    Server server(binary, workDir, {{"ROKT_MEMTABLE_BYTES", "256"}});
+    if (!check.expect(server.start(), "démarrage du serveur")) return check;
+
+    // Clés dans l'ordre où le serveur les renvoie
+    const std::vector<std::string> rows = {
+        "{\"id\": 0, \"name\": \"a\"}",
+        "{\"details\": {\"city\": \"Paris\", \"zip\": \"75001\"}, \"id\": 1}",
+        "{\"details\": {\"city\": \"Lyon\"}, \"id\": 2, \"x.y\": 3}",
+        "{\"details\": {\"geo\": {\"lat\": 1}}, \"id\": 3, \"tags\": [\"t\"]}",
+        "{\"details\": {\"city\": \"Paris\"}, \"id\": 4, \"late\": true}",
+    };
+    for (const std::string create : {"CREATE TABLE shapes;", "CREATE TABLE shapes_lsm LSM;"}) {
+        std::string dataset = create.find("LSM") != std::string::npos ? "shapes_lsm" : "shapes";
+        sendCommand(create);
+        for (size_t i = 0; i + 1 < rows.size(); i++) sendCommand("ADD " + rows[i] + " IN " + dataset + ";");
+    }
+    check.expect(server.restart(), "redémarrage");
+    for (const std::string dataset : {"shapes", "shapes_lsm"}) {
+        // La dernière forme n'apparaît qu'après le redémarrage
+        sendCommand("ADD " + rows.back() + " IN " + dataset + ";");
+        std::string all = compact(sendCommand("GET * IN " + dataset + ";"));
+        for (const std::string& row : rows) {
+            check.expect(all.find(compact(row)) != std::string::npos, dataset + " : ligne " + row + " relue : " + all);
+        }
+        check.expect(resultNumbers(sendCommand("GET id IN " + dataset + " WHERE details.city IS Paris;")) == std::vector<long long>({1, 4}),
+                     dataset + " : WHERE sur un chemin imbriqué");
+        check.expect(resultNumbers(sendCommand("GET id IN " + dataset + " WHERE details.geo.lat IS 1;")) == std::vector<long long>({3}),
+                     dataset + " : WHERE sur un chemin de trois clés");
+        check.expect(resultNumbers(sendCommand("GET id IN " + dataset + " WHERE late IS true;")) == std::vector<long long>({4}),
+                     dataset + " : clé apparue après le redémarrage");
+    }
+    server.stop();
+    return check;
+}
+
+/**
+ * @brief ORDER BY ... LIMIT (tas top-K) : pour plusieurs LIMIT et OFFSET, dans les deux sens, les
+ * identifiants renvoyés sont ceux d'un tri complet stable (égalités dans l'ordre du dataset), sur
+ * un parcours parallèle des lignes résidentes comme en flux.
+ */
+Check topKOrder(const std::string& binary, const std::string& workDir) {
+    Check check;
+    auto scoreOf = [](int id) { return (id * 7919) % 1000; };
+    std::vector<int> ascending(TOPK_ROWS);
+    for (int id = 0; id < TOPK_ROWS; id++) ascending[id] = id;
+    std::stable_sort(ascending.begin(), ascending.end(), [&](int a, int b) { return scoreOf(a) < scoreOf(b); });
+    std::vector<int> descending(TOPK_ROWS);
+    for (int id = 0; id < TOPK_ROWS; id++) descending[id] = id;
+    std::stable_sort(descending.begin(), descending.end(), [&](int a, int b) { return scoreOf(a) > scoreOf(b); });
+
+    for (const std::string residentBytes : {"67108864", "0"}) {
+        std::string step = residentBytes == "0" ? "lecture en flux : " : "lignes résidentes : ";
+        Server server(binary, workDir, {{"ROKT_MAX_RESIDENT_BYTES", residentBytes}, {"ROKT_RESULT_CACHE_BYTES", "0"}});
+        if (!check.expect(server.start(), step + "démarrage du serveur")) return check;
+        if (residentBytes != "0") {
+            sendCommand("CREATE TABLE ranked;");
+            check.expect(addRows("ranked", 0, TOPK_ROWS, [&](int id) {
+                return "{\"id\": " + std::to_string(id) + ", \"score\": " + std::to_string(scoreOf(id)) + "}";
+            }), "insertion des lignes");
+        }
+        for (const auto& page : std::vector<std::pair<int, int>>{{1, 0}, {10, 0}, {25, 40}, {100, 950}}) {
+            for (bool desc : {false, true}) {
+                const std::vector<int>& sorted = desc ? descending : ascending;
+                std::vector<long long> expected(sorted.begin() + page.second, sorted.begin() + page.second + page.first);
+                std::string query = "GET id IN ranked ORDER BY score " + std::string(desc ? "DESC" : "ASC") + " LIMIT " +
+                                    std::to_string(page.first) + (page.second > 0 ? " OFFSET " + std::to_string(page.second) : "") + ";";
+                check.expect(resultNumbers(sendCommand(query)) == expected, step + query);
+            }
+        }
+        server.stop();
+    }
+    return check;
+}
+
+/**
+ * @brief Agrégats par GROUP BY : COUNT, SUM, MIN, MAX et AVG de chaque groupe sont ceux calculés
+ * ligne à ligne, sur un parcours parallèle comme en flux, avant et après un CHANGE += et un
+ * REMOVE ; une somme d'entiers au-delà de 2^53 reste exacte.
+ */
+Check groupAggregates(const std::string& binary, const std::string& workDir) {
+    Check check;
+    auto verify = [&](const std::string& step, int bonus, bool removed) {
+        std::string response = compact(sendCommand("GET COUNT(*), SUM(v), MIN(v), MAX(v), AVG(v) IN grouped GROUP BY g;"));
+        for (int group = 0; group < AGGREGATE_GROUPS; group++) {
+            long long rows = 0, sum = 0, low = 0, high = 0;
+            for (int id = group; id < AGGREGATE_ROWS; id += AGGREGATE_GROUPS) {
+                long long v = id + (group == 0 ? bonus : 0);
+                low = rows == 0 ? v : std::min(low, v);
+                high = rows == 0 ? v : std::max(high, v);
+                sum += v;
+                rows++;
+            }
+            std::string key = "\"" + std::to_string(group) + "\":{";
+            size_t pos = response.find(key);
+            if (removed && group == AGGREGATE_GROUPS - 1) {
+                check.expect(pos == std::string::npos, step + " : groupe retiré encore présent");
+                continue;
+            }
+            if (!check.expect(pos != std::string::npos, step + " : groupe " + std::to_string(group) + " absent : " + response)) return;
+            std::string groupText = response.substr(pos, response.find('}', pos) - pos);
+            double average = std::strtod(groupText.c_str() + groupText.find("\"AVG(v)\":") + 9, nullptr);
+            check.expect(std::abs(average - static_cast<double>(sum) / rows) < 1e-6, step + " : AVG du groupe " + groupText);
+            check.expect(groupText.find("\"COUNT(*)\":" + std::to_string(rows) + ",\"MAX(v)\":" + std::to_string(high) + ",\"MIN(v)\":" +
+                                        std::to_string(low) + ",\"SUM(v)\":" + std::to_string(sum)) != std::string::npos,
+                         step + " : agrégats du groupe " + groupText);
+        }
+    };
+
+    Server server(binary, workDir, {{"ROKT_RESULT_CACHE_BYTES", "0"}});
+    if (!check.expect(server.start(), "démarrage du serveur")) return check;
+    sendCommand("CREATE TABLE grouped;");
+    check.expect(addRows("grouped", 0, AGGREGATE_ROWS, [](int id) {
+        return "{\"id\": " + std::to_string(id) + ", \"g\": " + std::to_string(id % AGGREGATE_GROUPS) + ", \"v\": " + std::to_string(id) + "}";
+    }), "insertion des lignes");
+    verify("lignes résidentes", 0, false);
+    sendCommand("CHANGE v += 1000000 WHERE g IS 0 IN grouped;");
+    sendCommand("REMOVE WHERE g IS " + std::to_string(AGGREGATE_GROUPS - 1) + " IN grouped;");
+    verify("après CHANGE et REMOVE", 1000000, true);
+
+    sendCommand("CREATE TABLE large_sum;");
+    sendCommand("ADD [{\"v\": 9007199254740993}, {\"v\": 9007199254740993}, {\"v\": 9007199254740993}] IN large_sum;");
+    check.expect(compact(sendCommand("GET SUM(v) IN large_sum;")).find("\"SUM(v)\":27021597764222979") != std::string::npos,
+                 "somme d'entiers au-delà de 2^53");
+    server.stop();
+
+    Server streaming(binary, workDir, {{"ROKT_RESULT_CACHE_BYTES", "0"}, {"ROKT_MAX_RESIDENT_BYTES", "0"}});
+    if (!check.expect(streaming.start(), "démarrage sans lignes résidentes")) return check;
+    verify("lecture en flux", 1000000, true);
+    streaming.stop();
+    return check;
+}
+
+/**
+ * @brief COUNT répondu par les statistiques du manifeste : avec et sans filtre, il reste égal au
+ * nombre de lignes lues par GET après des ADD, un upsert, un REMOVE, un CHANGE du champ filtré et
+ * une panne, sur un dataset classique et sur un dataset LSM.
+ */
+Check statsCount(const std::string& binary, const std::string& workDir) {
+    Check check;
+    Server server(binary, workDir, {{"ROKT_MEMTABLE_BYTES", "256"}, {"ROKT_RESULT_CACHE_BYTES", "0"}});
+    if (!check.expect(server.start(), "démarrage du serveur")) return check;
+
+    const std::vector<std::string> datasets = {"counted", "counted_lsm"};
+    auto verify = [&](const std::string& step, long long rows) {
+        for (const auto& dataset : datasets) {
+            std::string prefix = dataset + ", " + step;
+            check.expect(count(dataset) == rows, prefix + " : COUNT " + std::to_string(count(dataset)) + " au lieu de " + std::to_string(rows));
+            check.expect(static_cast<long long>(resultNumbers(sendCommand("GET id IN " + dataset + ";")).size()) == rows,
+                         prefix + " : lignes lues par GET");
+            for (int status = 0; status < 3; status++) {
+                long long scanned = resultNumbers(sendCommand("GET id IN " + dataset + " WHERE status IS " + std::to_string(status) + ";")).size();
+                check.expect(count(dataset, "status:" + std::to_string(status)) == scanned,
+                             prefix + " : COUNT status:" + std::to_string(status));
+            }
+        }
+    };
+    sendCommand("CREATE TABLE counted;");
+    sendCommand("CREATE TABLE counted_lsm LSM KEY id;");
+    for (const auto& dataset : datasets) {
+        check.expect(addRows(dataset, 0, STATS_ROWS, [](int id) {
+            return "{\"id\": " + std::to_string(id) + ", \"status\": " + std::to_string(id % 3) + "}";
+        }), dataset + " : insertion des lignes");
+        sendCommand("ADD {\"id\": " + std::to_string(STATS_ROWS) + ", \"status\": 1} IN " + dataset + ";");
+    }
+    verify("après ADD", STATS_ROWS + 1);
+    for (const auto& dataset : datasets) {
+        // Deux lignes existantes mises à jour, une nouvelle ligne
+        sendCommand("ADD [{\"id\": 0, \"status\": 2}, {\"id\": 1, \"status\": 2}, {\"id\": " + std::to_string(STATS_ROWS + 1) +
+                    ", \"status\": 0}] UNIQUE id ON CONFLICT UPDATE IN " + dataset + ";");
+    }
+    verify("après upsert", STATS_ROWS + 2);
+    long long removed = count(datasets[0], "status:0");
+    for (const auto& dataset : datasets) {
+        sendCommand("REMOVE WHERE status IS 0 IN " + dataset + ";");
+        sendCommand("CHANGE status = 0 WHERE status IS 2 IN " + dataset + ";");
+    }
+    verify("après REMOVE et CHANGE", STATS_ROWS + 2 - removed);
+    server.crash();
+    check.expect(server.start(), "démarrage après panne");
+    verify("après panne", STATS_ROWS + 2 - removed);
+    server.stop();
+    return check;
+}
+
+/**
+ * @brief Cache des résultats : une lecture répétée est servie par le cache (STATS), mais toute
+ * écriture (CHANGE += journalisé, ADD, REMOVE) sur le dataset lu, sur le second dataset d'un JOIN
+ * ou sur la source d'une vue rend la réponse suivante à jour ; chaque format a sa propre entrée.
+ */
+Check resultCache(const std::string& binary, const std::string& workDir) {
+    Check check;
+    Server server(binary, workDir, {});
+    if (!check.expect(server.start(), "démarrage du serveur")) return check;
+
+    sendCommand("CREATE TABLE cached;");
+    sendCommand("ADD [{\"id\": 1, \"score\": 0}, {\"id\": 2, \"score\": 5}] IN cached;");
+    sendCommand("CREATE TABLE owners;");
+    sendCommand("ADD {\"id\": 1, \"name\": \"first\"} IN owners;");
+    sendCommand("CREATE VIEW total AS GET SUM(score) IN cached;");
+    const std::string read = "GET score IN cached WHERE id IS 1;";
+    const std::string joined = "GET owners.name IN cached JOIN owners ON cached.id = owners.id;";
+    const std::string viewed = "GET * IN total;";
+    for (const std::string& query : {read, joined, viewed}) sendCommand(query);
+    long long hits = numberAfter(sendCommand("STATS;"), "\"hits\":");
+    check.expect(resultNumbers(sendCommand(read)) == std::vector<long long>({0}), "lecture répétée");
+    check.expect(numberAfter(sendCommand("STATS;"), "\"hits\":") == hits + 1, "lecture répétée non servie par le cache");
+
+    sendCommand("CHANGE score += 3 WHERE id IS 1 IN cached;");
+    check.expect(resultNumbers(sendCommand(read)) == std::vector<long long>({3}), "lecture périmée après CHANGE +=");
+    check.expect(compact(sendCommand(viewed)).find("\"SUM(score)\":8") != std::string::npos, "vue périmée après CHANGE +=");
+    // Même commande, autre format : pas de réponse indentée servie pour FORMAT json
+    check.expect(sendCommand("FORMAT json " + read) == "{\"status\":0,\"reason\":\"OK\",\"datas\":{\"result\":[3]}}", "format de la réponse en cache");
+    check.expect(sendCommand(read).find('\n') != std::string::npos, "réponse indentée remplacée par le format json");
+
+    sendCommand("ADD {\"id\": 2, \"name\": \"second\"} IN owners;");
+    check.expect(compact(sendCommand(joined)).find("\"second\"") != std::string::npos, "JOIN périmé après un ADD sur le second dataset");
+    sendCommand("REMOVE WHERE id IS 1 IN cached;");
+    check.expect(resultNumbers(sendCommand(read)).empty(), "lecture périmée après REMOVE");
+    check.expect(compact(sendCommand(joined)).find("\"first\"") == std::string::npos, "JOIN périmé après REMOVE");
+    check.expect(compact(sendCommand(viewed)).find("\"SUM(score)\":5") != std::string::npos, "vue périmée après REMOVE");
+    server.stop();
+    return check;
+}
+
+/**
+ * @brief Lectures identiques concurrentes (single-flight, cache désactivé) : les clients lancés
+ * ensemble reçoivent tous la réponse exacte et certaines exécutions sont partagées (STATS) ; une
+ * lecture envoyée après un CHANGE ne reçoit jamais le résultat partagé de la version précédente.
+ */
+Check singleFlight(const std::string& binary, const std::string& workDir) {
+    Check check;
+    Server server(binary, workDir, {{"ROKT_MAX_WORKERS", std::to_string(FLIGHT_CLIENTS)}, {"ROKT_RESULT_CACHE_BYTES", "0"}});
+    if (!check.expect(server.start(), "démarrage du serveur")) return check;
+
+    sendCommand("CREATE TABLE flights;");
+    check.expect(addRows("flights", 0, FLIGHT_ROWS, [](int id) {
+        return "{\"id\": " + std::to_string(id) + ", \"v\": 1}";
+    }), "insertion des lignes");
+    const std::string query = "GET SUM(v) IN flights;";
+    auto sumOf = [](const std::string& response) { return numberAfter(response, "\"SUM(v)\":"); };
+
+    std::atomic<int> ready(0);
+    std::vector<long long> sums(FLIGHT_CLIENTS * FLIGHT_ROUNDS, -1);
+    std::vector<std::thread> clients;
+    for (int client = 0; client < FLIGHT_CLIENTS; client++) {
+        clients.emplace_back([&, client]() {
+            for (int round = 0; round < FLIGHT_ROUNDS; round++) {
+                // Les clients d'une même vague partent ensemble
+                ready++;
+                while (ready < FLIGHT_CLIENTS * (round + 1)) std::this_thread::yield();
+                sums[client * FLIGHT_ROUNDS + round] = sumOf(sendCommand(query));
+            }
+        });
+    }
+    for (auto& client : clients) client.join();
+    check.expect(std::all_of(sums.begin(), sums.end(), [](long long sum) { return sum == FLIGHT_ROWS; }), "somme lue par un client");
+    check.expect(numberAfter(sendCommand("STATS;"), "\"coalesced\":") > 0, "aucune lecture partagée");
+
+    // Un lecteur continu garde une exécution en vol pendant chaque écriture
+    std::atomic<bool> writing(true);
+    std::thread reader([&]() {
+        while (writing) sendCommand(query);
+    });
+    for (int change = 1; change <= FLIGHT_ROUNDS; change++) {
+        sendCommand("CHANGE v += 1 WHERE id IS 0 IN flights;");
+        check.expect(sumOf(sendCommand(query)) == FLIGHT_ROWS + change, "résultat d'avant le CHANGE " + std::to_string(change));
+    }
+    writing = false;
+    reader.join();
+    server.stop();
+    return check;
+}
+
+/**
+ * @brief Analyse des commandes en un seul passage : valeurs entre guillemets (espaces, ';' et
+ * mots-clés compris), clauses de GET dans n'importe quel ordre, blancs répétés ; une commande
+ * incomplète ou inconnue reçoit une erreur et le serveur continue de répondre.
+ */
+Check commandLexer(const std::string& binary, const std::string& workDir) {
+    Check check;
+    Server server(binary, workDir, {});
+    if (!check.expect(server.start(), "démarrage du serveur")) return check;
+
+    sendCommand("CREATE TABLE lexed;");
+    sendCommand("ADD [{\"id\": 1, \"city\": \"New York\", \"note\": \"a;b WHERE c\"}, {\"id\": 2, \"city\": \"Paris\"}] IN lexed;");
+    const std::vector<std::pair<std::string, std::vector<long long>>> reads = {
+        {"GET id IN lexed WHERE city IS \"New York\";", {1}},
+        {"GET id IN lexed WHERE note IS \"a;b WHERE c\";", {1}},
+        {"GET id IN lexed LIMIT 1 ORDER BY id DESC WHERE id != 0;", {2}},
+        {"   GET   id   IN   lexed\n  WHERE   id   IS   2  ;", {2}},
+    };
+    for (const auto& read : reads) {
+        check.expect(resultNumbers(sendCommand(read.first)) == read.second, "lecture : " + read.first);
+    }
+    sendCommand("CHANGE city = \"Saint Malo\" WHERE id IS 2 IN lexed;");
+    check.expect(resultNumbers(sendCommand("GET id IN lexed WHERE city IS \"Saint Malo\";")) == std::vector<long long>({2}),
+                 "valeur entre guillemets d'un CHANGE");
+    for (const std::string invalid : {"GET;", "GET id IN;", "GET id IN lexed GROUP BY;", "GARBAGE foo;", "get id in lexed;"}) {
+        std::string response = compact(sendCommand(invalid));
+        check.expect(!response.empty() && response.find("\"status\":0") == std::string::npos, "commande invalide acceptée : " + invalid);
+    }
+    check.expect(count("lexed") == 2, "serveur après les commandes invalides");
+    server.stop();
+    return check;
+}
+
+/**
+ * @brief EXPLAIN et PROFILE : EXPLAIN décrit le plan (stockage résident ou en flux, lignes
+ * estimées, top-K) sans exécuter la commande, même une écriture ; PROFILE exécute la commande
+ * une seule fois et rend ses étapes avec leurs lignes.
+ */
+Check explainProfile(const std::string& binary, const std::string& workDir) {
+    Check check;
+    Server server(binary, workDir, {{"ROKT_RESULT_CACHE_BYTES", "0"}});
+    if (!check.expect(server.start(), "démarrage du serveur")) return check;
+
+    sendCommand("CREATE TABLE planned;");
+    check.expect(addRows("planned", 0, PLAN_ROWS, [](int id) {
+        return "{\"id\": " + std::to_string(id) + ", \"s\": " + std::to_string(id % 5) + "}";
+    }), "insertion des lignes");
+    std::string plan = compact(sendCommand("EXPLAIN GET id IN planned WHERE s IS 1 ORDER BY id DESC LIMIT 5;"));
+    check.expect(plan.find("\"storage\":\"resident\"") != std::string::npos, "stockage résident : " + plan);
+    check.expect(numberAfter(plan, "\"rows\":") == PLAN_ROWS, "lignes estimées : " + plan);
+    check.expect(plan.find("\"topK\":true") != std::string::npos, "top-K absent du plan : " + plan);
+
+    sendCommand("EXPLAIN CHANGE s += 10 WHERE id IS 1 IN planned;");
+    sendCommand("EXPLAIN REMOVE WHERE id IS 2 IN planned;");
+    check.expect(fieldOf("planned", "s", 1) == 1, "CHANGE exécuté par EXPLAIN");
+    check.expect(count("planned") == PLAN_ROWS, "REMOVE exécuté par EXPLAIN");
+    std::string profile = compact(sendCommand("PROFILE CHANGE s += 10 WHERE id IS 1 IN planned;"));
+    check.expect(profile.find("\"status\":0") != std::string::npos, "PROFILE d'un CHANGE : " + profile);
+    check.expect(fieldOf("planned", "s", 1) == 11, "CHANGE de PROFILE exécuté " + std::to_string(fieldOf("planned", "s", 1) - 1) + " fois / 10");
+
+    profile = compact(sendCommand("PROFILE GET SUM(s) IN planned GROUP BY s;"));
+    size_t scan = profile.find("\"stage\":\"scan\"");
+    check.expect(scan != std::string::npos, "étape scan absente : " + profile);
+    std::string stage = scan == std::string::npos ? "" : profile.substr(profile.rfind('{', scan), scan - profile.rfind('{', scan));
+    check.expect(stage.find("\"rowsIn\":" + std::to_string(PLAN_ROWS) + ",") != std::string::npos, "lignes de l'étape scan : " + profile);
+    server.stop();
+
+    Server streaming(binary, workDir, {{"ROKT_MAX_RESIDENT_BYTES", "0"}});
+    if (!check.expect(streaming.start(), "démarrage sans lignes résidentes")) return check;
+    plan = compact(sendCommand("EXPLAIN GET id IN planned;"));
+    check.expect(plan.find("\"storage\":\"stream\"") != std::string::npos, "stockage en flux : " + plan);
+    streaming.stop();
+    return check;
+}
+
+/**
+ * @brief Vues matérialisées : après chaque écriture de la source (ADD, CHANGE +=, CHANGE =,
+ * REMOVE du minimum ou d'un groupe entier, upsert) et après un redémarrage, chaque ligne de la
+ * vue est égale aux agrégats calculés directement sur la source, et la vue refuse les écritures.
+ */
+Check materializedView(const std::string& binary, const std::string& workDir) {
+    Check check;
+    Server server(binary, workDir, {{"ROKT_RESULT_CACHE_BYTES", "0"}});
+    if (!check.expect(server.start(), "démarrage du serveur")) return check;
+
+    const std::string aggregates = "COUNT(*), SUM(v), MIN(v), MAX(v)";
+    auto verify = [&](const std::string& step) {
+        std::string direct = compact(sendCommand("GET " + aggregates + " IN sales GROUP BY g;"));
+        std::string view = compact(sendCommand("GET * IN totals;"));
+        for (int group = 0; group < VIEW_GROUPS; group++) {
+            std::string name = "g" + std::to_string(group);
+            size_t pos = direct.find("\"\\\"" + name + "\\\"\":{");
+            if (pos == std::string::npos) {
+                check.expect(view.find("\"g\":\"" + name + "\"") == std::string::npos, step + " : groupe " + name + " retiré encore dans la vue");
+                continue;
+            }
+            pos = direct.find('{', pos) + 1;
+            std::string expected = "{" + direct.substr(pos, direct.find('}', pos) - pos) + ",\"g\":\"" + name + "\"}";
+            check.expect(view.find(expected) != std::string::npos, step + " : " + expected + " absent de la vue " + view);
+        }
+    };
+    sendCommand("CREATE TABLE sales;");
+    check.expect(addRows("sales", 0, VIEW_ROWS, [](int id) {
+        return "{\"id\": " + std::to_string(id) + ", \"g\": \"g" + std::to_string(id % VIEW_GROUPS) + "\", \"v\": " +
+               std::to_string(id * 37 % 101) + "}";
+    }), "insertion des lignes");
+    check.expect(sendCommand("CREATE VIEW totals AS GET " + aggregates + " IN sales GROUP BY g;").find("\"status\": 0") != std::string::npos,
+                 "création de la vue");
+    verify("création");
+    sendCommand("ADD [{\"id\": -1, \"g\": \"g0\", \"v\": 1000}, {\"id\": -2, \"g\": \"g1\", \"v\": -5}] IN sales;");
+    verify("ADD");
+    sendCommand("CHANGE v += 5 WHERE g IS g1 IN sales;");
+    verify("CHANGE +=");
+    sendCommand("CHANGE v = 500 WHERE id IS 7 IN sales;");
+    verify("CHANGE =");
+    sendCommand("REMOVE WHERE v IS 0 IN sales;");
+    sendCommand("REMOVE WHERE id IS -2 IN sales;");
+    verify("REMOVE du minimum");
+    sendCommand("REMOVE WHERE g IS g3 IN sales;");
+    verify("REMOVE d'un groupe");
+    sendCommand("ADD [{\"id\": 4, \"g\": \"g3\", \"v\": 9}, {\"id\": -1, \"v\": 1}] UNIQUE id ON CONFLICT UPDATE IN sales;");
+    verify("upsert");
+    check.expect(server.restart(), "redémarrage");
+    verify("après redémarrage");
+    sendCommand("ADD {\"id\": -3, \"g\": \"g2\", \"v\": 2000} IN sales;");
+    verify("ADD après redémarrage");
+    std::string rejected = sendCommand("ADD {\"id\": 0} IN totals;");
+    check.expect(rejected.find("\"status\": 1") != std::string::npos, "écriture directe acceptée par la vue : " + compact(rejected));
+    server.stop();
+    return check;
+}
+
+/**
+ * @brief JOIN par table de hachage : quel que soit le dataset chargé dans la table (le plus petit
+ * d'après les statistiques), les lignes jointes sont celles d'une jointure imbriquée (clés
+ * absentes écartées, clé répétée jointe deux fois, WHERE sur chaque côté), résidentes comme en
+ * flux, et suivent un REMOVE sur l'un des datasets.
+ */
+Check hashJoin(const std::string& binary, const std::string& workDir) {
+    Check check;
+    auto customerOf = [](int order) { return order * 13 % (JOIN_CUSTOMERS + 50); };
+    // Jointure imbriquée de référence ; le client 5 apparaît deux fois
+    auto expected = [&](bool goldOnly, bool skipFirst) {
+        std::vector<long long> ids;
+        for (int order = 0; order < JOIN_ORDERS; order++) {
+            int customer = customerOf(order);
+            if (customer >= JOIN_CUSTOMERS || (goldOnly && customer % 4 != 0) || (skipFirst && customer == 0)) continue;
+            ids.push_back(order);
+            if (customer == 5) ids.push_back(order);
+        }
+        return ids;
+    };
+    const std::string gold = "GET orders.id IN orders JOIN customers ON orders.customer = customers.id WHERE customers.tier IS gold "
+                             "AND orders.customer != 0 ORDER BY orders.id;";
+    const std::string all = "GET orders.id IN customers JOIN orders ON customers.id = orders.customer ORDER BY orders.id;";
+
+    Server server(binary, workDir, {{"ROKT_RESULT_CACHE_BYTES", "0"}});
+    if (!check.expect(server.start(), "démarrage du serveur")) return check;
+    sendCommand("CREATE TABLE customers;");
+    check.expect(addRows("customers", 0, JOIN_CUSTOMERS, [](int id) {
+        return "{\"id\": " + std::to_string(id) + ", \"tier\": \"" + (id % 4 == 0 ? "gold" : "basic") + "\"}";
+    }), "insertion des clients");
+    sendCommand("ADD {\"id\": 5, \"tier\": \"duplicate\"} IN customers;");
+    sendCommand("CREATE TABLE orders;");
+    check.expect(addRows("orders", 0, JOIN_ORDERS, [&](int id) {
+        return "{\"id\": " + std::to_string(id) + ", \"customer\": " + std::to_string(customerOf(id)) + "}";
+    }), "insertion des commandes");
+    check.expect(resultNumbers(sendCommand(gold)) == expected(true, true), "jointure filtrée des deux côtés");
+    check.expect(resultNumbers(sendCommand(all)) == expected(false, false), "jointure complète depuis le petit dataset");
+    server.stop();
+
+    Server streaming(binary, workDir, {{"ROKT_RESULT_CACHE_BYTES", "0"}, {"ROKT_MAX_RESIDENT_BYTES", "0"}});
+    if (!check.expect(streaming.start(), "démarrage sans lignes résidentes")) return check;
+    check.expect(resultNumbers(sendCommand(gold)) == expected(true, true), "lecture en flux : jointure filtrée");
+    check.expect(resultNumbers(sendCommand(all)) == expected(false, false), "lecture en flux : jointure complète");
+    sendCommand("REMOVE WHERE tier IS gold IN customers;");
+    check.expect(resultNumbers(sendCommand(gold)).empty(), "jointure après REMOVE des clients joints");
+    streaming.stop();
+    return check;
+}
+
+/**
+ * @brief DISTINCT et COUNT(DISTINCT) : le compte exact ignore null et les champs absents et
+ * confond 1 et 1.0, par groupe comme sur tout le dataset ; APPROX_COUNT_DISTINCT reste dans la
+ * marge de son sketch HyperLogLog, sur un parcours parallèle comme en flux.
+ */
+Check distinctCounts(const std::string& binary, const std::string& workDir) {
+    Check check;
+    auto verify = [&](const std::string& step) {
+        std::string total = compact(sendCommand("GET COUNT(DISTINCT u), APPROX_COUNT_DISTINCT(u), APPROX_COUNT_DISTINCT(u, 14) IN uniques;"));
+        check.expect(numberAfter(total, "\"COUNT(DISTINCTu)\":") == DISTINCT_VALUES + DISTINCT_STRINGS, step + " : compte exact " + total);
+        double expected = DISTINCT_VALUES + DISTINCT_STRINGS;
+        check.expect(std::abs(numberAfter(total, "\"APPROX_COUNT_DISTINCT(u)\":") - expected) < expected * 0.05,
+                     step + " : compte approché (précision 12) " + total);
+        check.expect(std::abs(numberAfter(total, "\"APPROX_COUNT_DISTINCT(u,14)\":") - expected) < expected * 0.025,
+                     step + " : compte approché (précision 14) " + total);
+        std::string grouped = compact(sendCommand("GET COUNT(DISTINCT u) IN uniques WHERE g != -1 GROUP BY g;"));
+        std::string perGroup = "{\"COUNT(DISTINCTu)\":" + std::to_string((DISTINCT_VALUES + DISTINCT_STRINGS) / 2) + "}";
+        check.expect(grouped.find("\"0\":" + perGroup) != std::string::npos && grouped.find("\"1\":" + perGroup) != std::string::npos,
+                     step + " : compte exact par groupe " + grouped);
+        check.expect(resultNumbers(sendCommand("GET DISTINCT g IN uniques ORDER BY g DESC;")) == std::vector<long long>({1, 0}),
+                     step + " : DISTINCT trié");
+    };
+
+    Server server(binary, workDir, {{"ROKT_RESULT_CACHE_BYTES", "0"}});
+    if (!check.expect(server.start(), "démarrage du serveur")) return check;
+    sendCommand("CREATE TABLE uniques;");
+    // Chaque valeur apparaît quatre fois, une fois sur deux sous forme de double (1 et 1.0)
+    check.expect(addRows("uniques", 0, DISTINCT_VALUES * 4, [](int id) {
+        int value = id % DISTINCT_VALUES;
+        return "{\"id\": " + std::to_string(id) + ", \"g\": " + std::to_string(id % 2) + ", \"u\": " + std::to_string(value) +
+               (id / DISTINCT_VALUES % 2 == 1 ? ".0" : "") + "}";
+    }), "insertion des lignes");
+    check.expect(addRows("uniques", 0, DISTINCT_STRINGS, [](int id) {
+        return "{\"g\": " + std::to_string(id % 2) + ", \"u\": \"s" + std::to_string(id) + "\"}";
+    }), "insertion des chaînes");
+    sendCommand("ADD [{\"g\": 0, \"u\": null}, {\"g\": 1}, {\"u\": 3}] IN uniques;");
+    verify("lignes résidentes");
+    server.stop();
+
+    Server streaming(binary, workDir, {{"ROKT_RESULT_CACHE_BYTES", "0"}, {"ROKT_MAX_RESIDENT_BYTES", "0"}});
+    if (!check.expect(streaming.start(), "démarrage sans lignes résidentes")) return check;
+    verify("lecture en flux");
+    streaming.stop();
+    return check;
+}
+
+/**
+ * @brief Formats de réponse : FORMAT json est le JSON indenté sans ses blancs, msgpack et cbor
+ * encodent toute la réponse (GET encodé directement, COUNT converti), ndjson écrit une ligne
+ * par ligne dans chaque bloc de STREAM ; un format inconnu est refusé.
+ */
+Check responseFormats(const std::string& binary, const std::string& workDir) {
+    Check check;
+    Server server(binary, workDir, {});
+    if (!check.expect(server.start(), "démarrage du serveur")) return check;
+
+    sendCommand("CREATE TABLE formatted;");
+    sendCommand("ADD [{\"id\": 1, \"s\": \"a\"}, {\"id\": 2, \"s\": \"b\"}] IN formatted;");
+    check.expect(sendCommand("FORMAT json GET * IN formatted;") == compact(sendCommand("GET * IN formatted;")), "FORMAT json");
+    // Littéral contenant des octets nuls : sa taille vient du tableau
+    auto bytes = [](const auto& literal) { return std::string(literal, sizeof(literal) - 1); };
+    const std::vector<std::pair<std::string, std::string>> binaries = {
+        {"FORMAT msgpack GET * IN formatted;",
+         bytes("\x83\xa6status\x00\xa6reason\xa2OK\xa5" "datas\x92\x82\xa2id\x01\xa1s\xa1" "a\x82\xa2id\x02\xa1s\xa1" "b")},
+        {"FORMAT cbor GET * IN formatted;",
+         bytes("\xa3" "fstatus\x00" "freasonbOKedatas\x82\xa2" "bid\x01" "asaa\xa2" "bid\x02" "asab")},
+        {"FORMAT msgpack COUNT formatted;", bytes("\x83\xa5" "datas\x81\xa5" "count\x02\xa6reason\xa2OK\xa6status\x00")},
+    };
+    for (const auto& binary : binaries) {
+        check.expect(sendCommand(binary.first) == binary.second, "réponse binaire de " + binary.first);
+    }
+    check.expect(sendCommand("FORMAT ndjson GET * IN formatted STREAM 1;") ==
+                     "11\r\n{\"id\":1,\"s\":\"a\"}\n\r\n11\r\n{\"id\":2,\"s\":\"b\"}\n\r\n0\r\n{\"status\":0,\"reason\":\"OK\",\"datas\":{\"rows\":2}}",
+                 "blocs ndjson de STREAM");
+    check.expect(sendCommand("FORMAT xml GET * IN formatted;").find("\"status\": 423") != std::string::npos, "format inconnu accepté");
+    server.stop();
+    return check;
+}
+
+/**
+ * @brief Compression des réponses : une petite réponse est envoyée telle quelle (identity), une
+ * grande réponse, avec ou sans FORMAT dans l'un ou l'autre ordre, et une réponse STREAM se
+ * décompressent à l'identique de la réponse non compressée, y compris servies par le cache.
+ */
+Check responseCompression(const std::string& binary, const std::string& workDir) {
+    Check check;
+    Server server(binary, workDir, {});
+    if (!check.expect(server.start(), "démarrage du serveur")) return check;
+
+    sendCommand("CREATE TABLE compressed;");
+    check.expect(addRows("compressed", 0, COMPRESS_ROWS, [](int id) {
+        return "{\"id\": " + std::to_string(id) + ", \"label\": \"row " + std::to_string(id % 10) + "\"}";
+    }), "insertion des lignes");
+    const std::string deflated = "deflate\r\n";
+    std::string small = sendCommand("COMPRESS GET id IN compressed WHERE id IS 1;");
+    check.expect(small == "identity\r\n" + sendCommand("GET id IN compressed WHERE id IS 1;"), "petite réponse : " + small.substr(0, 40));
+
+    const std::vector<std::pair<std::string, std::string>> reads = {
+        {"COMPRESS GET * IN compressed;", "GET * IN compressed;"},
+        {"COMPRESS FORMAT json GET * IN compressed;", "FORMAT json GET * IN compressed;"},
+        {"FORMAT json COMPRESS deflate GET * IN compressed;", "FORMAT json GET * IN compressed;"},
+        {"COMPRESS GET * IN compressed STREAM 100;", "GET * IN compressed STREAM 100;"},
+    };
+    // Deux passages : le second est servi par le cache (sauf STREAM)
+    for (int pass = 0; pass < 2; pass++) {
+        for (const auto& read : reads) {
+            std::string response = sendCommand(read.first);
+            std::string plain = sendCommand(read.second);
+            bool framed = response.compare(0, deflated.size(), deflated) == 0;
+            check.expect(framed, read.first + " : en-tête " + response.substr(0, 10));
+            if (!framed) continue;
+            check.expect(response.size() < plain.size() / 2, read.first + " : réponse peu compressée");
+            check.expect(inflateAll(response.substr(deflated.size())) == plain, read.first + " : réponse décompressée différente");
+        }
+    }
+    check.expect(numberAfter(sendCommand("STATS;"), "\"compressed\":") >= 8, "réponses compressées absentes de STATS");
+    server.stop();
+    return check;
+}
+
+/**
+ * @brief Compteurs CHANGE += / -= : des incréments concurrents de plusieurs clients ne se
+ * perdent pas, sur des lignes résidentes comme lues en flux ; un champ absent prend la valeur
+ * ajoutée, une chaîne n'est pas modifiée et les valeurs survivent à une panne.
+ */
+Check concurrentCounters(const std::string& binary, const std::string& workDir) {
+    Check check;
+    for (const std::string residentBytes : {"67108864", "0"}) {
+        std::string step = residentBytes == "0" ? "lecture en flux : " : "lignes résidentes : ";
+        std::string dataset = residentBytes == "0" ? "streamed" : "resident";
+        Server server(binary, workDir, {{"ROKT_MAX_RESIDENT_BYTES", residentBytes}, {"ROKT_MAX_WORKERS", std::to_string(COUNTER_CLIENTS)}});
+        if (!check.expect(server.start(), step + "démarrage du serveur")) return check;
+        sendCommand("CREATE TABLE " + dataset + ";");
+        sendCommand("ADD [{\"id\": 1, \"hits\": 0, \"misses\": 1000}, {\"id\": 2, \"hits\": \"text\"}, {\"id\": 3}] IN " + dataset + ";");
+
+        std::vector<std::thread> clients;
+        for (int client = 0; client < COUNTER_CLIENTS; client++) {
+            clients.emplace_back([&dataset]() {
+                for (int i = 0; i < COUNTER_INCREMENTS; i++) {
+                    sendCommand("CHANGE hits += 1 WHERE id IS 1 IN " + dataset + ";");
+                    sendCommand("CHANGE misses -= 1 WHERE id IS 1 IN " + dataset + ";");
+                }
+            });
+        }
+        for (auto& client : clients) client.join();
+        sendCommand("CHANGE hits += 5 WHERE id != 1 IN " + dataset + ";");
+
+        auto verify = [&](const std::string& when) {
+            check.expect(fieldOf(dataset, "hits", 1) == COUNTER_CLIENTS * COUNTER_INCREMENTS, step + when + " : incréments perdus");
+            check.expect(fieldOf(dataset, "misses", 1) == 1000 - COUNTER_CLIENTS * COUNTER_INCREMENTS, step + when + " : décréments perdus");
+            check.expect(compact(sendCommand("GET hits IN " + dataset + " WHERE id IS 2;")).find("[\"text\"]") != std::string::npos,
+                         step + when + " : chaîne modifiée");
+            check.expect(fieldOf(dataset, "hits", 3) == 5, step + when + " : champ absent");
+        };
+        verify("avant la panne");
+        server.crash();
+        check.expect(server.start(), step + "démarrage après panne");
+        verify("après la panne");
+        server.stop();
+    }
+    return check;
+}
+
+/**
+ * @brief Point d'entrée du test de régression du stockage ROKT.
+ * Chaque scénario lance le serveur dans un dossier de travail temporaire (conservé en cas d'échec).
+ * @return 0 si tous les scénarios réussissent, 1 sinon.
+ */
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Usage : " << argv[0] << " <binaire rokt_socket> <config.json> [scénario]\n";
+        return 1;
+    }
+    std::string binary = fs::absolute(argv[1]).string();
+    std::string config = fs::absolute(argv[2]).string();
+    // Troisième argument facultatif : seuls les scénarios dont le nom le contient sont lancés
+    std::string filter = argc > 3 ? argv[3] : "";
+
+    const std::vector<std::pair<std::string, std::function<Check(const std::string&, const std::string&)>>> scenarios = {
+        {"relecture du journal après redémarrage", journalReplay},
+        {"compactage du journal", compactionFold},
+        {"vidage et fusion LSM pendant les écritures", lsmFlushMerge},
+        {"memtable LSM déjà vidée après une panne", lsmStaleMemtable},
+        {"enregistrement de journal corrompu", corruptJournal},
+        {"journal antérieur à la réécriture du fichier", staleJournal},
+        {"mémoire d'un GET ... STREAM", streamMemory},
+        {"UNIQUE sur de grands entiers", uniqueLargeIntegers},
+        {"UNIQUE sur un chemin", uniqueFieldPath},
+        {"fichier de dataset illisible", unreadableDataset},
+        {"priorité d'un EXECUTE", executePriority},
+        {"arène des requêtes concurrentes", arenaConcurrency},
+        {"import et export CSV", csvTransfer},
+        {"curseur après un ajout", cursorAppend},
+        {"ruban des lignes", tapeRoundTrip},
+        {"dictionnaire de clés", keyDictionary},
+        {"ORDER BY ... LIMIT", topKOrder},
+        {"agrégats par GROUP BY", groupAggregates},
+        {"COUNT par les statistiques", statsCount},
+        {"cache des résultats", resultCache},
+        {"lectures concurrentes partagées", singleFlight},
+        {"analyse des commandes", commandLexer},
+        {"EXPLAIN et PROFILE", explainProfile},
+        {"vue matérialisée", materializedView},
+        {"JOIN par table de hachage", hashJoin},
+        {"DISTINCT et COUNT(DISTINCT)", distinctCounts},
+        {"formats de réponse", responseFormats},
+        {"compression des réponses", responseCompression},
+        {"compteurs concurrents", concurrentCounters},
+    };
+
+    int failures = 0;
+    for (const auto& scenario : scenarios) {
+        if (scenario.first.find(filter) == std::string::npos) continue;
+        char workDir[] = "/tmp/rokt_regression_XXXXXX";
+        if (mkdtemp(workDir) == nullptr) {
+            std::cerr << "Impossible de créer le dossier de travail\n";
+            return 1;
+        }
+        fs::copy_file(config, std::string(workDir) + "/config.json");
+        auto start_time = std::chrono::high_resolution_clock::now();
+        Check check = scenario.second(binary, workDir);
+        auto end_time = std::chrono::high_resolution_clock::now();
+        long long duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+        if (check.ok()) {
+            std::cout << "[OK] " << scenario.first << " (" << duration_ms << " ms)\n";
+            fs::remove_all(workDir);
+        } else {
+            std::cout << "[ÉCHEC] " << scenario.first << " : " << check.failure << " (dossier conservé : " << workDir << ")\n";
+            failures++;
+        }
+    }
+    std::cout << "Test de régression ROKT terminé : " << failures << " scénario(s) en échec.\n";
+    return failures == 0 ? 0 : 1;
+}